@@ -40,6 +40,7 @@ LICENSE: END
 #include <cstdlib>
 #include <cmath>
 #include <cstdint>
+#include <type_traits>
 #include <vector>
 #include <set>
 #include "exception.hpp"
@@ -100,15 +101,22 @@ bool to_bool(const std::string& _input, const match_case _matchCase, /*out*/ boo
 template <typename T>
 std::string to_str(const T& _number, const num_base& _baseType = num_base::any, bool _bShowBase = false)
 {
-  std::string res;
-  T baseValue = static_cast<T>(( _baseType != num_base::any )? _baseType : num_base::decimal);
-  T copy = _number < 0 ? -_number : _number;
+  using unsigned_type = typename std::make_unsigned<T>::type;
+  const unsigned_type baseValue = static_cast<unsigned_type>(
+    ( _baseType != num_base::any )? _baseType : num_base::decimal);
+  // The magnitude is taken in the unsigned type, which holds that of the most negative number too
+  unsigned_type copy = static_cast<unsigned_type>(_number);
+  if ( _number < 0 )
+    copy = unsigned_type(0) - copy;
 
+  // The characters are written backwards from the end of the buffer, which has room for the
+  // binary digits, the base and the sign. Only the result is allocated.
+  char buf[sizeof(T) * 8 + 3];
+  char* p = buf + sizeof(buf);
   do
   {
-    T val = (copy % baseValue);
-    char ch = (char) (((val < 10)? '0':('A'-10)) + val);
-    res.insert(0, 1, ch);
+    const unsigned_type val = (copy % baseValue);
+    *--p = static_cast<char>(((val < 10)? '0':('A'-10)) + val);
   }
   while ( (copy /= baseValue) != 0 );
 
@@ -120,24 +128,45 @@ std::string to_str(const T& _number, const num_base& _baseType = num_base::any,
     case num_base::decimal:
       break;
     case num_base::binary:
-      res.insert(0, "0b");
+      *--p = 'b';
+      *--p = '0';
       break;
     case num_base::octal:
-      res.insert(0, "0");
+      *--p = '0';
       break;
     case num_base::hex:
-      res.insert(0, "0x");
+      *--p = 'x';
+      *--p = '0';
       break;
     }
   }
   if ( _number < 0 )
-    res.insert(0, "-");
-  return res;
+    *--p = '-';
+  return std::string(p, buf + sizeof(buf) - p);
 }
 
-//! Convert double to string
+//! Convert floating point numbers to string, in the shortest form that reads back to the
+//! same value (see float_to_chars)
+std::string to_str(const float& _number);
+std::string to_str(const double& _number);
 std::string to_str(const long double& _number);
 
+//! Room needed by float_to_chars for any number
+constexpr size_t float_chars_max = 48;
+/**
+ * @fn char* float_to_chars(char* _first, double _number);
+ * @brief Write the shortest digits that read back to the same number, laid out the way
+ *        printf("%.18g") lays them out: in scientific notation when the decimal exponent is
+ *        below -4 or at least 18, otherwise in fixed notation. For instance 0.0001, 1e-05,
+ *        123456789012345678 and 1.2345678901234568e+20.
+ *
+ * @param _first [out] Buffer of at least float_chars_max characters
+ * @return The end of the characters written
+ */
+char* float_to_chars(char* _first, float _number);
+char* float_to_chars(char* _first, double _number);
+char* float_to_chars(char* _first, long double _number);
+
 /**
  * @brief Template class to convert from string to decimal value. Throws an std::string exception on error.
  *        Valid datatypes can be char, short, int, long, long long and unsigned versions of these.
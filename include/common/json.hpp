@@ -34,24 +34,24 @@ LICENSE: END
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <map>
+#include <memory_resource>
+#include <memory>
 #include <set>
+#include <optional>
+#include <utility>
+#include <iterator>
+#include <bit>
+#include <type_traits>
 #include <cstdint>
 #include "exception.hpp"
+#include "io_buffer.hpp"
 
 #include "opt.hpp"
 #include "smart_ptr.hpp"
 
-// ======================
-// Compiler optimization for the size of the structure
-#define SID_JSON_MAP_OPTIMIZE_FOR_SIZE
-
-#if defined(SID_JSON_MAP_OPTIMIZE_FOR_SIZE)
-//#pragma message "Compiler flag set to optimize json for size"
-#endif
-// ======================
-
 namespace sid {
 namespace json {
 
@@ -102,15 +102,54 @@ struct format
 
 //! Forward declaration of json schema
 class schema;
+//! Forward declaration of json schema validator
+class validator;
 //! Forward declaration of parser (not exposed)
 struct parser;
+//! Forward declaration of serializer (not exposed)
+struct serializer;
+//! Forward declaration of binary encoder and decoder (not exposed)
+struct encoder;
+struct decoder;
+//! Forward declaration of path (see json_path.hpp)
+class path;
+//! Forward declaration of projection (see json_path.hpp)
+class projection;
+//! Forward declaration of snapshot (see json_snapshot.hpp)
+class snapshot;
+//! Forward declaration of writer (see json_writer.hpp)
+class writer;
+//! Forward declaration of cached_value (see json_cache.hpp)
+class cached_value;
 
-#ifdef SID_JSON_MAP_OPTIMIZE_FOR_SIZE
-#pragma pack(push)
-#pragma pack(1)
-#endif
+/**
+ * Numbers with a fraction or an exponent are stored as double, which keeps a value in a
+ * 16-byte cell. Numbers with more digits than a double holds are rounded to the nearest double.
+ * get_long_double() gives a number as long double, which holds the 64-bit integers exactly.
+ *
+ * A number too large for a double but within the range of long double, such as 1e400, is read
+ * as an infinity with the sign of the number, and written back as 1e999 or -1e999. A number
+ * beyond the range of long double, such as 1e99999, is rejected: the parsers throw a
+ * sid::exception giving its @line/@pos location.
+ * A number too small for a double, such as 1e-400, is read as zero with the sign of the number.
+ *
+ * With parser_control::longDouble set, a number that a double does not hold exactly, such as
+ * 1e400, 1e-400 or 0.1, is kept as long double instead (see value::is_long_double()).
+ */
+using float_type = double;
 
-//! Parser statistics object
+/**
+ * @struct parser_stats
+ * @brief Parser statistics object. The statistics of several parses, for instance those of
+ *        different threads, can be added up with merge().
+ *
+ * The counters are cheap enough to be always collected. The split of the time between the
+ * phases of the parse is collected only when parser_control::timePhases is set: the clock is
+ * read around one token in 32, picked at random, and the time of the sampled tokens is scaled
+ * up to all of them. The phases always add up to time_ns: where the estimate of the string,
+ * number and build phases exceeds the time of the parse, which happens on short inputs, they
+ * are scaled down to it and scan_ns is zero.
+ */
 struct parser_stats
 {
   uint64_t objects;
@@ -120,10 +159,26 @@ struct parser_stats
   uint64_t booleans;
   uint64_t nulls;
   uint64_t keys;
-  uint64_t time_ms;
+  uint64_t time_ms;     //! Time of the parse in milliseconds (time_ns rounded down)
+  uint64_t time_ns;     //! Time of the parse in nanoseconds, from a monotonic clock
+  uint64_t bytes;       //! Bytes of input consumed
+  uint64_t maxDepth;    //! Deepest nesting of containers
+  uint64_t allocations; //! Blocks allocated from the heap for the tree (the arena blocks
+                        //!   for a document)
+  uint64_t allocBytes;  //! Bytes of these blocks
+  // Phases of the parse in nanoseconds (parser_control::timePhases)
+  uint64_t scan_ns;     //! Whitespace, structure and literals. The rest of time_ns.
+  uint64_t string_ns;   //! String decoding
+  uint64_t number_ns;   //! Number conversion
+  uint64_t build_ns;    //! Tree building: allocation of the nodes and insertion of the members
 
   parser_stats();
   void clear();
+  //! Add the statistics of another parse. The depth is the deepest of the two.
+  parser_stats& merge(const parser_stats& _stats);
+  parser_stats& operator+=(const parser_stats& _stats) { return merge(_stats); }
+  //! Bytes parsed per second, in MB/s (10^6 bytes per second)
+  double throughput() const;
   std::string to_str() const;
 };
 
@@ -134,6 +189,13 @@ struct parser_stats
 //! Parser control parameters
 struct parser_control
 {
+  //! Handling of a key found again in the same object:
+  //!   accept: the last value replaces the earlier one, of any type (containers are not merged)
+  //!   ignore: the first value is kept and the others are checked and dropped
+  //!   append: the values are kept in an array, in the order of the input
+  //!   reject: the parse fails
+  //! json::reader and json::push_parser build the same trees as value::parse(). A key of a
+  //! json::lazy_document refers to its last value, as with accept.
   enum class dup_key : uint8_t {
     accept = 0, ignore, append, reject
   };
@@ -165,39 +227,83 @@ struct parser_control
   };
 
   //! Members
-  parse_mode mode;    //! Parser control modes
-  dup_key    dupKey;  //! Duplicate key handling
+  parse_mode mode;       //! Parser control modes
+  dup_key    dupKey;     //! Duplicate key handling
+  bool       internKeys; //! If set, the object keys of more than value::short_capacity
+                         //!   (14) characters are stored once per parse and shared by all
+                         //!   the objects using them, instead of being allocated for every
+                         //!   object. Shorter keys are kept in the cell of their member, as
+                         //!   without the flag. Two keys are compared by pointer before
+                         //!   their characters are, so a shared key matches without its
+                         //!   characters being read. The objects of more than
+                         //!   object::index_threshold members still hash the key looked up.
+                         //!   Copies of a value get their own keys.
+  bool       timePhases; //! If set, the time of the phases of the parse is measured
+                         //!   (see parser_stats). This slows down the parse.
+  bool       longDouble; //! If set, a number with a fraction or an exponent that a double
+                         //!   does not hold exactly is kept as long double, in a block
+                         //!   allocated like a long string, so that 1e400 is not read as an
+                         //!   infinity and 0.1 keeps the precision of long double. The
+                         //!   other numbers are kept in the cell, as without the flag.
 
   //! Default constructor
   parser_control(
     const parse_mode& _mode = parse_mode(),
     const dup_key&    _dupKey = dup_key::accept
-    ) : mode(_mode), dupKey(_dupKey)
+    ) : mode(_mode), dupKey(_dupKey), internKeys(false), timePhases(false), longDouble(false)
     {}
   //! One argment constructor
   parser_control(
     const dup_key&    _dupKey,
     const parse_mode& _mode = parse_mode()
-    ) : mode(_mode), dupKey(_dupKey)
+    ) : mode(_mode), dupKey(_dupKey), internKeys(false), timePhases(false), longDouble(false)
     {}
 };
 
 /**
  * @class value
  * @brief json value class
+ *
+ * A value is a cell of cell_size bytes tagged with its type. Numbers and booleans are
+ * stored in the cell, as are strings of up to short_capacity characters. Longer strings,
+ * arrays and objects are held by a pointer to a block allocated from the memory resource of
+ * the value.
+ *
+ * Floating point numbers are stored as double (see float_type). Numbers with more digits than
+ * a double holds are rounded to the nearest double: 3.14159265358979323846264 reads back as
+ * 3.141592653589793. A value made from a long double, or parsed with
+ * parser_control::longDouble, keeps a number that a double does not hold in a block of its
+ * own, as a long string is kept.
  */
 class value
 {
-  friend class parser;
+  friend struct parser;
+  friend struct serializer;
+  friend struct encoder;
+  friend struct decoder;
+  friend class path;
+  friend class validator;
+  friend class document;
+  friend class snapshot;
+  friend class writer;
+  friend class cached_value;
 public:
+  //! Size of the cell
+  static constexpr size_t cell_size = 16;
+  //! Number of characters of a string that are kept in the cell
+  static constexpr size_t short_capacity = cell_size - 2;
+
   /**
    * @fn bool parse(value&                _jout,
    *                parser_stats&         _stats,
-   *                const std::string&    _value,
+   *                std::string_view      _value,
    *                const schema&         _schema,
    *                const parser_control& _ctrl = parser_control()
    *               );
-   * @brief Convert the given json string to json object
+   * @brief Convert the given json string to json object.
+   *        The input is parsed in place and need not be NUL terminated.
+   *        If a schema (or a validator compiled from it) is given, each value is validated
+   *        as it is parsed and a violation fails the parse right away.
    *
    * @param _jout [out] json output
    * @param _stats [out] Parser statistics
@@ -207,28 +313,96 @@ public:
    */
   static bool parse(
     value&                _jout,
-    const std::string&    _value,
+    std::string_view      _value,
     const parser_control& _ctrl = parser_control()
     );
   static bool parse(
     value&                _jout,
-    const std::string&    _value,
+    std::string_view      _value,
     const schema&         _schema,
     const parser_control& _ctrl = parser_control()
     );
   static bool parse(
     value&                _jout,
     parser_stats&         _stats,
-    const std::string&    _value,
+    std::string_view      _value,
     const parser_control& _ctrl = parser_control()
     );
   static bool parse(
     value&                _jout,
     parser_stats&         _stats,
-    const std::string&    _value,
+    std::string_view      _value,
     const schema&         _schema,
     const parser_control& _ctrl = parser_control()
     );
+  //! Validate with a compiled schema, saving the compilation of the schema for every parse
+  static bool parse(
+    value&                _jout,
+    std::string_view      _value,
+    const validator&      _validator,
+    const parser_control& _ctrl = parser_control()
+    );
+  static bool parse(
+    value&                _jout,
+    parser_stats&         _stats,
+    std::string_view      _value,
+    const validator&      _validator,
+    const parser_control& _ctrl = parser_control()
+    );
+  //! Convert only the values at the paths of the projection, skipping the rest of the input
+  static bool parse(
+    value&                _jout,
+    std::string_view      _value,
+    const projection&     _projection,
+    const parser_control& _ctrl = parser_control()
+    );
+  static bool parse(
+    value&                _jout,
+    parser_stats&         _stats,
+    std::string_view      _value,
+    const projection&     _projection,
+    const parser_control& _ctrl = parser_control()
+    );
+  //! Convert the given character sequence of _len bytes to json object
+  static bool parse(
+    value&                _jout,
+    const char*           _data,
+    size_t                _len,
+    const parser_control& _ctrl = parser_control()
+    );
+  static bool parse(
+    value&                _jout,
+    parser_stats&         _stats,
+    const char*           _data,
+    size_t                _len,
+    const parser_control& _ctrl = parser_control()
+    );
+
+  /**
+   * @fn bool parse_file(value&                _jout,
+   *                     parser_stats&         _stats,
+   *                     const std::string&    _filePath,
+   *                     const parser_control& _ctrl = parser_control()
+   *                    );
+   * @brief Convert the contents of the given json file to json object.
+   *        The file is memory mapped and parsed in place without an intermediate buffer.
+   *
+   * @param _jout [out] json output
+   * @param _stats [out] Parser statistics
+   * @param _filePath [in] Path of the json file
+   * @param _ctrl [in] Parser control flags
+   */
+  static bool parse_file(
+    value&                _jout,
+    const std::string&    _filePath,
+    const parser_control& _ctrl = parser_control()
+    );
+  static bool parse_file(
+    value&                _jout,
+    parser_stats&         _stats,
+    const std::string&    _filePath,
+    const parser_control& _ctrl = parser_control()
+    );
 
   // Constructors
   value(const value_type _type = value_type::null);
@@ -238,6 +412,7 @@ public:
   value(const long double _val);
   value(const bool _val);
   value(const std::string& _val);
+  value(std::string_view _val);
   value(const char* _val);
   value(const int _val);
   // Copy constructor
@@ -269,29 +444,98 @@ public:
 
   // operator= overloads
   value& operator=(const value& _obj);
+  //! Take over the given value, which is left null. It keeps its memory resource.
+  value& operator=(value&& _obj) noexcept;
   value& operator=(const int64_t _val);
   value& operator=(const uint64_t _val);
   value& operator=(const double _val);
   value& operator=(const long double _val);
   value& operator=(const bool _val);
   value& operator=(const std::string& _val);
+  value& operator=(std::string_view _val);
   value& operator=(const char* _val);
   value& operator=(const int _val);
 
   bool has_index(const size_t _index) const;
-  bool has_key(const std::string& _key) const;
-  bool has_key(const std::string& _key, value& _obj) const;
+  bool has_key(std::string_view _key) const;
+  bool has_key(std::string_view _key, value& _obj) const;
+  //! Find the value of the given key. Returns nullptr if the key does not exist.
+  //! The pointer stays valid while keys are added to the object (see operator[]).
+  const value* find(std::string_view _key) const;
+  value* find(std::string_view _key);
+  //! Get the value at the given index. Returns nullptr if the index is out of range.
+  const value* get_ptr(const size_t _index) const;
+  value* get_ptr(const size_t _index);
+  //! Keys of the object in the order in which they were added
   std::vector<std::string> get_keys() const;
   size_t size() const; // For array and object type
 
   //! get functions
   int64_t get_int64() const;
   uint64_t get_uint64() const;
-  long double get_double() const;
+  //! The number as float_type, in which the numbers with a fraction or an exponent are stored
+  float_type get_double() const;
+  //! The number as long double, which holds the 64-bit integers exactly. A number with a
+  //! fraction or an exponent has no more precision than float_type, unless it is kept as
+  //! long double (see is_long_double()).
+  long double get_long_double() const;
+  //! True if the number is kept as long double because a double does not hold it exactly.
+  //! get_double() gives it rounded to a double.
+  bool is_long_double() const { return is_double() && m_length == long_length; }
   bool get_bool() const;
   std::string get_str() const;
+  //! String of a scalar value. Numbers are formatted without allocating anything but the
+  //! result, doubles in the shortest form that reads back to the same value.
   std::string as_str() const;
 
+  /**
+   * @fn std::optional<T> get_if() const;
+   * @brief Typed access to the value without copying it.
+   *        T can be bool, an integral or a floating point type, or std::string_view.
+   *        An integral type matches a decimal value that fits in T.
+   *        A std::string_view refers to the stored string and is valid until the value is modified.
+   *
+   * @return The value if it is of the type T, an empty optional otherwise.
+   */
+  template <typename T> std::optional<T> get_if() const
+  {
+    if constexpr ( std::is_same<T, bool>::value )
+    {
+      if ( is_bool() )
+        return m_data._bval;
+    }
+    else if constexpr ( std::is_same<T, std::string_view>::value )
+    {
+      if ( is_string() )
+        return p_str();
+    }
+    else if constexpr ( std::is_floating_point<T>::value )
+    {
+      if ( is_double() )
+        return static_cast<T>(p_long_double());
+      if ( is_signed() )
+        return static_cast<T>(m_data._i64);
+      if ( is_unsigned() )
+        return static_cast<T>(m_data._u64);
+    }
+    else
+    {
+      static_assert(std::is_integral<T>::value,
+                    "get_if() can be used only for bool, number and std::string_view types");
+      if ( is_signed() && std::in_range<T>(m_data._i64) )
+        return static_cast<T>(m_data._i64);
+      if ( is_unsigned() && std::in_range<T>(m_data._u64) )
+        return static_cast<T>(m_data._u64);
+    }
+    return std::nullopt;
+  }
+  //! Typed access to the value of the given key without copying it. See get_if()
+  template <typename T> std::optional<T> get_if(std::string_view _key) const
+  {
+    const value* pval = find(_key);
+    return ( pval != nullptr )? pval->get_if<T>() : std::nullopt;
+  }
+
   //! get functions with arguments
   //    0 : doesn't exist
   //    1 : Exists with non-null value
@@ -314,35 +558,58 @@ public:
   int get_value(bool& _val) const;
   int get_value(std::string& _val) const;
 
-  int get_value(const std::string& _key, value& _obj) const
+  int get_value(std::string_view _key, value& _obj) const
   {
     return has_key(_key, _obj)? ( ! _obj.is_null()? 1 : -1 ) : 0;
   }
 
-  template <typename T> int get_value(const std::string& _key, T& _val) const
+  template <typename T> int get_value(std::string_view _key, T& _val) const
   {
-    value jval;
-    return has_key(_key, jval)? jval.get_value(_val) : 0;
+    const value* pval = find(_key);
+    return ( pval != nullptr )? pval->get_value(_val) : 0;
   }
 
   const value& operator[](const size_t _index) const;
   value& operator[](const size_t _index);
-  const value& operator[](const std::string& _key) const;
-  value& operator[](const std::string& _key);
+  const value& operator[](std::string_view _key) const;
+  //! Get the value of the given key, adding a null value if the key does not exist. Adding a
+  //! key leaves the other members in place: references and pointers to them, from operator[]
+  //! or find(), stay valid until the object is cleared or replaced. So obj["new"] = obj["old"]
+  //! copies the member. The elements of an array move when it grows, as in a std::vector.
+  value& operator[](std::string_view _key);
   //! Append value to the array
   value& append();
   value& append(const value& _obj);
+  value& append(value&& _obj);
   template <typename T> value& append(const T& _val)
   {
-    if ( ! is_array() )
-    {
-      clear();
-      m_type = m_data.init(value_type::array);
-    }
     value& jval = append();
-    jval.m_type = jval.m_data.init(_val);
+    jval = _val;
     return jval;
   }
+  //! Append a value made from the given arguments, as value(_args...), to the array.
+  //! The value is made before the array grows, so the arguments may refer to its elements.
+  template <typename... Args> value& emplace_back(Args&&... _args)
+  {
+    value jval(std::forward<Args>(_args)...);
+    return append(std::move(jval));
+  }
+  //! Set the given key to a value made from the given arguments, as value(_args...).
+  //! The key is added if it does not exist. Otherwise its value is replaced.
+  template <typename... Args> value& emplace(std::string_view _key, Args&&... _args)
+  {
+    value jval(std::forward<Args>(_args)...);
+    return (*this)[_key] = std::move(jval);
+  }
+  //! Reserve room for the given number of elements of an array, or members of an object
+  void reserve(size_t _size);
+  /**
+   * @fn value take() noexcept;
+   * @brief Move the value out, leaving null in its place. A subtree is moved without
+   *        copying its nodes, which stay in the memory resource they were allocated from:
+   *        a subtree taken from a document must not outlive the document.
+   */
+  value take() noexcept { return value(std::move(*this)); }
 
   //! Convert json to string using the given format type
   std::string to_str(const format_type _type = format_type::compact) const;
@@ -354,69 +621,337 @@ public:
   //! Write json to the given output stream using pretty format
   void write(std::ostream& _out, const format& _format) const;
 
+  //! Append json to the given buffer. The buffer can be cleared and reused for the next value
+  //! so that its memory is allocated only once.
+  void write(std::string& _out, const format_type _type = format_type::compact) const;
+  //! Append json to the given buffer using the given format
+  void write(std::string& _out, const format& _format) const;
+
+  /*
+   * Binary encodings: CBOR (RFC 8949) and MessagePack.
+   * Any value can be encoded, not only objects and arrays. Numbers keep their value_type:
+   *  - CBOR: _unsigned is an unsigned integer and a negative _signed a negative integer.
+   *          A non-negative _signed is an unsigned integer wrapped in tag cbor_signed_tag.
+   *          Doubles use the shortest of half, single and double precision that is exact.
+   *  - MessagePack: _unsigned uses the positive fixint and uint formats, _signed the
+   *          negative fixint and int formats. Doubles use float 32 when it is exact.
+   * The encoders append to the buffer, so that a sequence of values can be written to it.
+   */
+  //! Tag of a non-negative _signed integer in CBOR (from the first come first served range)
+  static constexpr uint64_t cbor_signed_tag = 0x8053;
+  //! Deepest nesting of arrays, maps and tags accepted by from_cbor() and from_msgpack()
+  static constexpr uint32_t max_binary_depth = 1024;
+
+  //! Append the CBOR encoding of the value to the given buffer
+  void to_cbor(io_buffer& _out) const;
+  io_buffer to_cbor() const;
+  //! Append the MessagePack encoding of the value to the given buffer
+  void to_msgpack(io_buffer& _out) const;
+  io_buffer to_msgpack() const;
+
+  /**
+   * @fn size_t from_cbor(value& _jout, const void* _data, size_t _len);
+   * @brief Convert the CBOR data item at the start of the given data to json object.
+   *        Byte strings are converted to strings. Tags other than cbor_signed_tag are
+   *        ignored. Map keys must be strings.
+   *
+   * @param _jout [out] json output
+   * @param _data [in] CBOR data
+   * @param _len [in] Length of the data in bytes
+   * @param _maxDepth [in] Deepest nesting of arrays, maps and tags. A deeper input throws
+   *                       sid::exception rather than exhausting the stack.
+   *
+   * @return Number of bytes of the data item, so that a sequence of items can be decoded
+   *         one after the other
+   */
+  static size_t from_cbor(value& _jout, const void* _data, size_t _len,
+                          uint32_t _maxDepth = max_binary_depth);
+  //! Convert the CBOR data item at the read position (rd_data()) of the buffer
+  static size_t from_cbor(value& _jout, const io_buffer& _in,
+                          uint32_t _maxDepth = max_binary_depth);
+  //! Convert the MessagePack object at the start of the given data. See from_cbor().
+  //! Binaries are converted to strings. Extension types are not supported.
+  static size_t from_msgpack(value& _jout, const void* _data, size_t _len,
+                             uint32_t _maxDepth = max_binary_depth);
+  static size_t from_msgpack(value& _jout, const io_buffer& _in,
+                             uint32_t _maxDepth = max_binary_depth);
+
 private:
-  void p_write(std::ostream& _out, const format& _format, uint32_t _level) const;
   void p_set(const value_type _type = value_type::null);
+  void p_set(const value_type _type, std::pmr::memory_resource* _resource);
+  void p_set(std::string_view _val, std::pmr::memory_resource* _resource);
+  //! Default memory resource of the values
+  static std::pmr::memory_resource* p_resource();
+
+  //! Initialize a cleared value. Copies always use the default memory resource.
+  void p_init(const value_type _type, std::pmr::memory_resource* _resource = p_resource());
+  void p_init(std::string_view _val, std::pmr::memory_resource* _resource = p_resource());
+  void p_init(const value& _obj);
+  //! Initialize a cleared value with a number kept in the cell
+  void p_init(const float_type _val) noexcept {
+    m_type = value_type::_double;
+    m_length = 0;
+    m_data._dbl = _val;
+  }
+  //! Initialize a cleared value with a number, kept as long double if a double does not hold it
+  void p_init(const long double _val, std::pmr::memory_resource* _resource);
+  //! Take over the cell of the given value, leaving it null
+  void p_take(value& _obj) noexcept;
+  //! Characters of the string value
+  std::string_view p_str() const {
+    return ( m_length < interned_length )? std::string_view(m_short, m_length)
+      : std::string_view(reinterpret_cast<const char*>(m_data._str + 1), m_data._str->length);
+  }
 
-private:
-  using array = std::vector<value>;
-  using object = std::map<std::string, value>;
+  //! Containers allocate from the memory resource they were created with (see document)
+  using array = std::pmr::vector<value>;
 
+  /**
+   * @struct long_string
+   * @brief Header of a string that does not fit in the cell. The characters follow the header.
+   */
+  struct long_string
+  {
+    std::pmr::memory_resource* resource; //! Memory resource the string was allocated from
+    size_t                     length;   //! Number of characters
+  };
+
+  /**
+   * @struct long_number
+   * @brief Number kept as long double, which does not fit in the cell (see is_long_double())
+   */
+  struct long_number
+  {
+    std::pmr::memory_resource* resource; //! Memory resource the number was allocated from
+    long double                value;
+  };
+  //! The double number rounded to float_type, and as long double
+  float_type p_double() const {
+    return ( m_length == long_length )? static_cast<float_type>(m_data._ldbl->value) : m_data._dbl;
+  }
+  long double p_long_double() const {
+    return ( m_length == long_length )? m_data._ldbl->value : m_data._dbl;
+  }
+
+  //! Long string shared by several values through a reference count (see internKeys)
+  struct shared_string;
+  //! Allocate a shared string holding a single reference
+  static long_string* p_intern(std::string_view _val, std::pmr::memory_resource* _resource);
+  //! Drop a reference to the shared string, releasing it with the last one
+  static void p_release(long_string* _str) noexcept;
+  //! Initialize a cleared value with a new reference to the shared string
+  void p_share(long_string* _str) noexcept;
+
+  /**
+   * @class object
+   * @brief Key/value entries of a json object kept in insertion order.
+   *        Small objects are searched linearly. Once an object grows beyond
+   *        index_threshold entries a hash index is built over the entries,
+   *        making key lookups O(1).
+   *        The keys are string values, so that short keys are kept in the entry itself.
+   *
+   * The members are written by to_str() and listed by get_keys() in the order in which they
+   * were added. Until objects were kept this way, std::map wrote and listed them sorted by key.
+   *
+   * The entries are kept in blocks that are never moved: each block holds twice as many
+   * entries as the one before it. So adding an entry leaves the earlier ones in place, and
+   * references to them stay valid, as they did with the std::map used before.
+   */
+  class object
+  {
+  public:
+    using entry = std::pair<value, value>;
+    template <typename E> class basic_iterator;
+    using iterator = basic_iterator<entry>;
+    using const_iterator = basic_iterator<const entry>;
+
+    //! Number of entries up to which a linear search is used
+    static constexpr size_t index_threshold = 8;
+
+    object(std::pmr::memory_resource* _resource = p_resource())
+      : m_blocks{}, m_more(nullptr), m_index(_resource), m_size(0), m_count(0), m_shift(first_shift) {}
+    //! Copies use the default memory resource
+    object(const object& _obj);
+    object(object&& _obj) noexcept;
+    ~object();
+    object& operator=(const object&) = delete;
+    object& operator=(object&&) = delete;
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    //! Remove the entries, keeping the blocks for the next ones
+    void clear();
+    void reserve(size_t _n);
+    //! Memory resource used by the object
+    std::pmr::memory_resource* resource() const { return m_index.get_allocator().resource(); }
+
+    iterator begin();
+    iterator end();
+    const_iterator begin() const;
+    const_iterator end() const;
+    //! Entry at the given position in the order of insertion, which must be below size()
+    entry& at(size_t _pos) { return *p_at(_pos); }
+    const entry& at(size_t _pos) const { return *p_at(_pos); }
+
+    //! Find the value of the given key. Returns nullptr if the key does not exist.
+    const value* find(std::string_view _key) const;
+    value* find(std::string_view _key);
+    //! Find the value of the given key whose hash() is already known
+    const value* find(std::string_view _key, uint32_t _hash) const;
+    //! Get the value of the given key. Adds a null value if the key does not exist.
+    value& operator[](std::string_view _key);
+    //! Add a new key, which the caller knows does not exist in the object
+    value& add(std::string_view _key);
+    //! Add a new key given as a string value, which is taken over
+    value& take_key(value&& _key);
+
+    //! Hash of the key used by the index
+    static uint32_t hash(std::string_view _key);
+
+  private:
+    //! Index slot. pos is the position of the entry + 1 (0 for an empty slot).
+    struct slot
+    {
+      uint32_t hash;
+      uint32_t pos;
+    };
+    //! The first block holds 1 << first_shift entries, unless reserve() asked for more
+    static constexpr uint8_t first_shift = 2;
+    //! Blocks whose address is kept in the object, enough for most objects
+    static constexpr size_t inline_blocks = 3;
+    //! Blocks that the entries of an object can ever need
+    static constexpr size_t max_blocks = 64;
+
+    entry*                 m_blocks[inline_blocks]; //! The first blocks
+    entry**                m_more;  //! The other blocks. max_blocks - inline_blocks addresses
+                                    //!   allocated along with the first of them.
+    std::pmr::vector<slot> m_index; //! Open addressing hash index (empty for small objects)
+    size_t                 m_size;  //! Number of entries
+    uint8_t                m_count; //! Number of blocks allocated
+    uint8_t                m_shift; //! The first block holds 1 << m_shift entries
+
+    //! Block holding the given position, the position of its first entry and its capacity
+    size_t p_block(size_t _pos) const { return std::bit_width((_pos >> m_shift) + 1) - 1; }
+    size_t p_start(size_t _block) const { return ((size_t(1) << _block) - 1) << m_shift; }
+    size_t p_capacity(size_t _block) const { return size_t(1) << (_block + m_shift); }
+    entry* p_first(size_t _block) const {
+      return ( _block < inline_blocks )? m_blocks[_block] : m_more[_block - inline_blocks];
+    }
+    entry* p_at(size_t _pos) const {
+      const size_t block = p_block(_pos);
+      return p_first(block) + (_pos - p_start(block));
+    }
+    //! Allocate the next block
+    void p_grow();
+    //! Room for a new entry at the end, in a new block if the last one is full
+    entry* p_next();
+    void p_destroy() noexcept;
+    size_t p_find(std::string_view _key) const;
+    size_t p_find(std::string_view _key, uint32_t _hash) const;
+    //! Keys are equal if they are the same characters, as shared keys are
+    static bool p_equal(std::string_view _a, std::string_view _b) {
+      return ( _a.data() == _b.data() && _a.length() == _b.length() ) || _a == _b;
+    }
+    //! Index the last entry added
+    void p_added();
+    void p_index(uint32_t _hash, uint32_t _pos);
+    void p_rehash(size_t _capacity);
+  };
+
+  //! Data of the value, or the handle to it, kept in the second half of the cell
   union union_data
   {
-    int64_t     _i64;
-    uint64_t    _u64;
-    long double _dbl;
-    bool        _bval;
-    std::string _str;
-    array       _arr;
-#if defined(SID_JSON_MAP_OPTIMIZE_FOR_SIZE)
-    object*     _map;
-#else
-    object      _map;
-#endif
-    //! Default constructor
-    union_data(const value_type _type = value_type::null);
-    //! Copy constructor
-    union_data(const union_data& _obj, const value_type _type = value_type::null);
-    //! Move constructor
-    union_data(union_data&& _obj, const value_type _type = value_type::null) noexcept;
-    //! Destructor
-    ~union_data();
-
-    //! Clear the memory used by the object
-    value_type clear(const value_type _type);
-
-    //! Copy initializer routines
-    value_type init(const value_type _type = value_type::null);
-    value_type init(const union_data& _obj, const bool _new = true,
-                       const value_type _type = value_type::null);
-    value_type init(const int _val);
-    value_type init(const int64_t _val);
-    value_type init(const uint64_t _val);
-    value_type init(const long double _val);
-    value_type init(const bool _val);
-    value_type init(const std::string& _val);
-    value_type init(const char* _val);
-    value_type init(const array& _val);
-    value_type init(const object& _val, const bool _new = true);
-    //! Move initializer routine
-    value_type init(union_data&& _obj, value_type _type) noexcept;
-
-    union_data& operator=(const union_data& _obj) { *this = std::move(_obj); return *this; }
-#if defined(SID_JSON_MAP_OPTIMIZE_FOR_SIZE)
-    const object& map() const { return (*_map); }
-    object& map() { return (*_map); }
-#else
-    const object& map() const { return _map; }
-    object& map() { return _map; }
-#endif
+    int64_t      _i64;
+    uint64_t     _u64;
+    float_type   _dbl;
+    bool         _bval;
+    long_string* _str;
+    long_number* _ldbl;
+    array*       _arr;
+    object*      _map;
+  };
+
+  //! m_length of a string, or of a double number, that is not kept in the cell
+  static constexpr uint8_t long_length = 0xFF;
+  //! m_length of a long string that is shared with other values
+  static constexpr uint8_t interned_length = 0xFE;
+
+  union
+  {
+    struct
+    {
+      value_type m_type;                  //! Type of the object
+      uint8_t    m_length;                //! Length of a short string (or long/interned_length)
+      char       m_short[short_capacity]; //! Characters of a short string
+    };
+    struct
+    {
+      uint8_t    m_tag[8];                //! Overlaps m_type and m_length
+      union_data m_data;                  //! The object
+    };
   };
+};
+
+/**
+ * @class value::object::basic_iterator
+ * @brief Forward iterator over the entries of an object, in the order of insertion.
+ *        It steps through the entries of a block and moves to the next block at its end.
+ */
+template <typename E>
+class value::object::basic_iterator
+{
+public:
+  using iterator_category = std::forward_iterator_tag;
+  using value_type = std::remove_const_t<E>;
+  using difference_type = std::ptrdiff_t;
+  using pointer = E*;
+  using reference = E&;
+
+  basic_iterator() : m_obj(nullptr), m_pos(0), m_cur(nullptr), m_last(nullptr) {}
+  basic_iterator(const object* _obj, size_t _pos)
+    : m_obj(_obj), m_pos(_pos), m_cur(nullptr), m_last(nullptr) { p_seek(); }
+  //! An iterator converts to a const_iterator
+  operator basic_iterator<const E>() const requires ( ! std::is_const_v<E> ) {
+    return basic_iterator<const E>(m_obj, m_pos);
+  }
 
-  value_type m_type; //! Type of the object
-  union_data m_data; //! The object
+  reference operator*() const { return *m_cur; }
+  pointer operator->() const { return m_cur; }
+  basic_iterator& operator++()
+  {
+    ++m_pos;
+    if ( ++m_cur == m_last )
+      p_seek();
+    return *this;
+  }
+  basic_iterator operator++(int) { basic_iterator it(*this); ++(*this); return it; }
+  bool operator==(const basic_iterator& _it) const { return m_pos == _it.m_pos; }
+
+private:
+  const object* m_obj;  //! Object iterated
+  size_t        m_pos;  //! Position of the entry
+  E*            m_cur;  //! The entry, if m_pos is below the size of the object
+  E*            m_last; //! End of the block of the entry
+
+  //! Point to the entry at m_pos
+  void p_seek()
+  {
+    if ( m_pos >= m_obj->m_size )
+      return;
+    const size_t block = m_obj->p_block(m_pos);
+    E* first = m_obj->p_first(block);
+    m_cur = first + (m_pos - m_obj->p_start(block));
+    m_last = first + m_obj->p_capacity(block);
+  }
 };
 
+inline value::object::iterator value::object::begin() { return iterator(this, 0); }
+inline value::object::iterator value::object::end() { return iterator(this, m_size); }
+inline value::object::const_iterator value::object::begin() const { return const_iterator(this, 0); }
+inline value::object::const_iterator value::object::end() const { return const_iterator(this, m_size); }
+
+static_assert(sizeof(value) == value::cell_size, "json value must fit in its cell");
+
 /**
  * @class schema_type
  * @brief json schema_type
@@ -534,10 +1069,99 @@ public:
   static schema parse(const value& _jroot);
 };
 
+/**
+ * @class validator
+ * @brief Json schema compiled for validation while parsing (see value::parse()).
+ *
+ * The schema is translated once into a tree of checks, with its patterns compiled.
+ * The parser runs the checks of a value as soon as the value is produced: the type of
+ * an object or an array is checked before its members are parsed, maxItems and
+ * maxProperties as the members are added, and uniqueItems by hashing each element.
+ * A validator can be used for any number of parses, but only one at a time.
+ */
+class validator
+{
+public:
+  //! Compiled checks of a value (internal)
+  struct node;
+
+  explicit validator(const schema& _schema);
+  ~validator();
+  validator(const validator&) = delete;
+  validator& operator=(const validator&) = delete;
+
+  //! Checks of the root value
+  const node& root() const { return *m_root; }
+
+private:
+  std::unique_ptr<node> m_root;
 
-#ifdef SID_JSON_MAP_OPTIMIZE_FOR_SIZE
-#pragma pack(pop)
-#endif
+  //! Hash of a value, equal for the values that are equal in the sense of json schema
+  static uint64_t p_hash(const value& _val);
+  //! Equality in the sense of json schema: numbers by value, objects regardless of key order
+  static bool p_equal(const value& _lhs, const value& _rhs);
+};
+
+/**
+ * @class document
+ * @brief Owner of a json tree whose nodes and strings are allocated from a bump arena.
+ *
+ * Parsing into a document replaces the per node heap allocations by pointer bumps in a
+ * monotonic arena and the whole tree is released at once when the document is cleared
+ * or destroyed, without visiting the nodes.
+ *
+ * Lifetime rules:
+ *  - Values borrowed from root() or moved out of the tree refer to the arena and must not
+ *    outlive the document (or the next parse/clear).
+ *  - Copying a value detaches it. The copy uses the default memory resource.
+ *  - Modifying the tree via mutable_root() is allowed. Such a document releases its tree
+ *    node by node, as the modified nodes may use memory from outside the arena.
+ *  - A document is not thread safe and can be neither copied nor moved.
+ */
+class document
+{
+public:
+  document();
+  ~document();
+  document(const document&) = delete;
+  document& operator=(const document&) = delete;
+
+  /**
+   * @fn bool parse(parser_stats& _stats, std::string_view _value, const parser_control& _ctrl);
+   * @brief Convert the given json string to a json tree allocated in the arena.
+   *        Any existing tree of the document is released.
+   *
+   * @param _stats [out] Parser statistics
+   * @param _value [in] Input json string
+   * @param _ctrl [in] Parser control flags
+   */
+  bool parse(std::string_view _value, const parser_control& _ctrl = parser_control());
+  bool parse(parser_stats& _stats, std::string_view _value,
+             const parser_control& _ctrl = parser_control());
+  //! Convert the contents of the given json file to a json tree allocated in the arena
+  bool parse_file(const std::string& _filePath, const parser_control& _ctrl = parser_control());
+  bool parse_file(parser_stats& _stats, const std::string& _filePath,
+                  const parser_control& _ctrl = parser_control());
+
+  //! Root of the json tree
+  const value& root() const { return m_root; }
+  //! Root of the json tree for modification. See the lifetime rules above.
+  value& mutable_root() { m_modified = true; return m_root; }
+
+  //! Release the json tree and all the memory held by the arena
+  void clear();
+
+private:
+  void p_release();
+
+  //! The arena is created for every parse so that its first block fits the input
+  std::optional<std::pmr::monotonic_buffer_resource> m_arena;
+  union
+  {
+    value m_root; //! Destroyed only if the tree was modified
+  };
+  bool m_modified; //! Set when the tree is accessed for modification
+};
 
 } // namespace json
 
@@ -0,0 +1,393 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@file json_bind.hpp
+@brief Binding of c++ structures to json
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+/**
+ * @file  json_bind.hpp
+ * @brief Binding of c++ structures to json, read and written without building a json tree
+ */
+#pragma once
+
+#include "json_reader.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <optional>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+/**
+ * The json keys of the members of a structure are declared once, next to the structure
+ * (in the same namespace, so that they are found by argument dependent lookup):
+ *
+ *   struct device { std::string name; uint64_t size; std::vector<device> children; };
+ *   SID_JSON_BIND(device,
+ *     SID_JSON_FIELD("name", name),
+ *     SID_JSON_FIELD("size", size),
+ *     SID_JSON_FIELD("children", children))
+ *
+ *   std::vector<device> devices;
+ *   json::bind::parse(input, devices);
+ *   std::string out = json::bind::to_str(devices);
+ *
+ * The binding of private members is declared with SID_JSON_BIND_FRIEND in the structure.
+ */
+#define SID_JSON_BIND(_type, ...)                                        \
+  constexpr auto sid_json_fields(const _type*)                           \
+  {                                                                      \
+    using bound_type = _type;                                            \
+    return std::make_tuple(__VA_ARGS__);                                 \
+  }
+#define SID_JSON_BIND_FRIEND(_type, ...)                                 \
+  friend SID_JSON_BIND(_type, __VA_ARGS__)
+//! Json key and member of a field. Used in SID_JSON_BIND.
+#define SID_JSON_FIELD(_key, _member)                                    \
+  ::sid::json::bind::field<bound_type, decltype(bound_type::_member)>{   \
+    std::string_view(_key), &bound_type::_member }
+
+namespace sid {
+namespace json {
+namespace bind {
+
+/**
+ * The members are converted as value::get_value() and value::operator=() do:
+ *  - bool from a boolean, numbers from any number (the fraction of a double is dropped
+ *    for an integer), std::string from a string, a number or a boolean
+ *  - std::optional<T> from null (empty) or T, std::vector<T> from an array of T,
+ *    json::value from any value, and the bound structures from an object
+ * A null leaves the member as it is (other than an optional). The keys of an object that
+ * are not bound are skipped, and the fields whose key is missing are left as they are.
+ * An empty optional is not written.
+ */
+
+//! Key and member of a field of the structure C
+template <typename C, typename M>
+struct field
+{
+  std::string_view key;
+  M C::*           member;
+};
+
+//! Structures with a binding declared with SID_JSON_BIND
+template <typename T>
+concept bound = requires { sid_json_fields(static_cast<const T*>(nullptr)); };
+
+//! Hash of a key for the given seed (FNV-1a)
+constexpr uint32_t hash(std::string_view _key, uint32_t _seed)
+{
+  uint32_t h = 2166136261u ^ _seed;
+  for ( const char ch : _key )
+  {
+    h ^= static_cast<uint8_t>(ch);
+    h *= 16777619u;
+  }
+  return h ^ ( h >> 15 );
+}
+
+/**
+ * @struct key_table
+ * @brief Perfect hash of the keys of N fields, built at compile time.
+ *        A key is looked up with a single hash, a slot and a comparison.
+ */
+template <size_t N>
+struct key_table
+{
+  //! Slots for up to 16 per key, of which the first power of 2 that has no collision is used
+  static constexpr size_t max_slots = std::bit_ceil(16 * N);
+  using index_type = std::conditional_t<(N < 255), uint8_t, uint16_t>;
+
+  std::array<std::string_view, N> keys{};
+  std::array<index_type, max_slots> slots{}; //! Index of the field + 1, 0 for none
+  uint32_t seed = 0;
+  uint32_t mask = 0;
+  bool     found = false;
+
+  constexpr explicit key_table(const std::array<std::string_view, N>& _keys) : keys(_keys)
+  {
+    for ( size_t size = std::bit_ceil(2 * N); size <= max_slots && ! found; size *= 2 )
+      for ( uint32_t s = 0; s < 256 && ! found; s++ )
+        found = p_try(size, s);
+  }
+
+  //! Index of the field of the given key, N if it is not a key of the fields
+  constexpr size_t find(std::string_view _key) const
+  {
+    const size_t slot = slots[hash(_key, seed) & mask];
+    return ( slot != 0 && keys[slot-1] == _key )? slot - 1 : N;
+  }
+
+private:
+  constexpr bool p_try(size_t _size, uint32_t _seed)
+  {
+    slots.fill(0);
+    for ( size_t i = 0; i < N; i++ )
+    {
+      index_type& slot = slots[hash(keys[i], _seed) & (_size - 1)];
+      if ( slot != 0 )
+        return false;
+      slot = static_cast<index_type>(i + 1);
+    }
+    seed = _seed;
+    mask = static_cast<uint32_t>(_size - 1);
+    return true;
+  }
+};
+
+/**
+ * @struct fields_of
+ * @brief Fields of the bound structure T and the table of their keys
+ */
+template <bound T>
+struct fields_of
+{
+  static constexpr auto list = sid_json_fields(static_cast<const T*>(nullptr));
+  static constexpr size_t count = std::tuple_size_v<decltype(list)>;
+  static constexpr key_table<count> table = []<size_t... Is>(std::index_sequence<Is...>)
+    {
+      return key_table<count>(std::array<std::string_view, count>{ std::get<Is>(list).key... });
+    }(std::make_index_sequence<count>());
+  static_assert(table.found, "No perfect hash found for the keys of the json binding. "
+                "Are two keys the same?");
+  //! The keys are written as they are
+  static_assert(std::ranges::none_of(table.keys, [](std::string_view _key) {
+        return std::ranges::any_of(_key, [](char _ch) {
+            return _ch == '\"' || _ch == '\\' || static_cast<uint8_t>(_ch) < 0x20; });
+      }), "The keys of a json binding cannot have characters to be escaped");
+};
+
+//! Error for a value of the wrong type
+[[noreturn]] void type_error(std::string_view _key, const char* _expected);
+//! Append the string in quotes, escaped as value::write() does
+void write_string(std::string& _out, std::string_view _str);
+//! Append the json of any value, not only of an object or an array (compact format)
+void write_value(std::string& _out, const value& _jval);
+
+template <typename T> struct is_optional : std::false_type {};
+template <typename T> struct is_optional<std::optional<T>> : std::true_type {};
+template <typename T> struct is_vector : std::false_type {};
+template <typename T, typename A> struct is_vector<std::vector<T, A>> : std::true_type {};
+
+/**
+ * @fn void read(reader& _reader, T& _obj, std::string_view _key = std::string_view());
+ * @brief Convert the value at the current event of the reader. The next call to next() moves
+ *        to the event following the value.
+ *
+ * @param _reader [in] Reader at the first event of the value
+ * @param _obj [out] Object converted
+ * @param _key [in] Key of the value, for the error messages
+ */
+template <typename T>
+void read(reader& _reader, T& _obj, std::string_view _key = std::string_view())
+{
+  const event_type evt = _reader.event();
+  if constexpr ( is_optional<T>::value )
+  {
+    if ( evt == event_type::null )
+      _obj.reset();
+    else
+      read(_reader, _obj.emplace(), _key);
+  }
+  else if constexpr ( std::is_same_v<T, value> )
+    _reader.read(_obj);
+  else if ( evt == event_type::null )
+    return;
+  else if constexpr ( bound<T> )
+  {
+    using fields = fields_of<T>;
+    if ( evt != event_type::start_object )
+      type_error(_key, "object");
+    while ( _reader.next() && _reader.event() == event_type::key )
+    {
+      const size_t index = fields::table.find(_reader.get_str());
+      if ( index == fields::count )
+      {
+        _reader.skip();
+        continue;
+      }
+      _reader.next();
+      // The fields are visited at compile time; only the one found is converted
+      [&]<size_t... Is>(std::index_sequence<Is...>)
+        {
+          ( ( index == Is
+              && ( read(_reader, _obj.*(std::get<Is>(fields::list).member),
+                        std::get<Is>(fields::list).key), true ) ) || ... );
+        }(std::make_index_sequence<fields::count>());
+    }
+  }
+  else if constexpr ( is_vector<T>::value )
+  {
+    if ( evt != event_type::start_array )
+      type_error(_key, "array");
+    _obj.clear();
+    while ( _reader.next() && _reader.event() != event_type::end_array )
+      read(_reader, _obj.emplace_back(), _key);
+  }
+  else if constexpr ( std::is_same_v<T, std::string> )
+  {
+    if ( evt == event_type::string )
+      _obj = _reader.get_str();
+    else if ( evt == event_type::boolean )
+      _obj = _reader.get_bool()? "true" : "false";
+    else if ( evt == event_type::number )
+    {
+      _obj.clear();
+      write_value(_obj, _reader.type() == value_type::_double? value(_reader.get_double())
+                   : _reader.type() == value_type::_signed? value(_reader.get_int64())
+                   : value(_reader.get_uint64()));
+    }
+    else
+      type_error(_key, "string, number or boolean");
+  }
+  else if constexpr ( std::is_same_v<T, bool> )
+  {
+    if ( evt != event_type::boolean )
+      type_error(_key, "boolean");
+    _obj = _reader.get_bool();
+  }
+  else
+  {
+    static_assert(std::is_arithmetic_v<T>, "json binding of an unsupported member type");
+    if ( evt != event_type::number )
+      type_error(_key, "number");
+    if constexpr ( std::is_floating_point_v<T> )
+      _obj = static_cast<T>(_reader.get_double());
+    else if constexpr ( std::is_signed_v<T> )
+      _obj = static_cast<T>(_reader.get_int64());
+    else
+      _obj = static_cast<T>(_reader.get_uint64());
+  }
+}
+
+/**
+ * @fn void parse(std::string_view _input, T& _obj, const parser_control& _ctrl = parser_control());
+ * @brief Convert the given json to the object. The root must be an object or an array.
+ *        Throws sid::exception on invalid json or a value of the wrong type.
+ */
+template <typename T>
+void parse(std::string_view _input, T& _obj, const parser_control& _ctrl = parser_control())
+{
+  reader jreader(_input, _ctrl);
+  jreader.next();
+  read(jreader, _obj);
+  // Checks what follows the root
+  jreader.next();
+}
+
+//! Append the json of the object to the given buffer (compact format)
+template <typename T>
+void write(const T& _obj, std::string& _out)
+{
+  if constexpr ( is_optional<T>::value )
+  {
+    if ( _obj )
+      write(*_obj, _out);
+    else
+      _out.append("null", 4);
+  }
+  else if constexpr ( std::is_same_v<T, value> )
+    write_value(_out, _obj);
+  else if constexpr ( bound<T> )
+  {
+    using fields = fields_of<T>;
+    _out += '{';
+    bool isFirst = true;
+    [&]<size_t... Is>(std::index_sequence<Is...>)
+      {
+        const auto write_field = [&](const auto& _field)
+          {
+            const auto& member = _obj.*(_field.member);
+            if constexpr ( is_optional<std::remove_cvref_t<decltype(member)>>::value )
+            {
+              if ( ! member )
+                return;
+            }
+            if ( ! isFirst )
+              _out += ',';
+            isFirst = false;
+            _out += '\"';
+            _out.append(_field.key);
+            _out.append("\":", 2);
+            write(member, _out);
+          };
+        ( write_field(std::get<Is>(fields::list)), ... );
+      }(std::make_index_sequence<fields::count>());
+    _out += '}';
+  }
+  else if constexpr ( is_vector<T>::value )
+  {
+    _out += '[';
+    for ( size_t i = 0; i < _obj.size(); i++ )
+    {
+      if ( i != 0 )
+        _out += ',';
+      write(_obj[i], _out);
+    }
+    _out += ']';
+  }
+  else if constexpr ( std::is_convertible_v<const T&, std::string_view> )
+    write_string(_out, _obj);
+  else if constexpr ( std::is_same_v<T, bool> )
+  {
+    if ( _obj )
+      _out.append("true", 4);
+    else
+      _out.append("false", 5);
+  }
+  else
+  {
+    static_assert(std::is_arithmetic_v<T>, "json binding of an unsupported member type");
+    if constexpr ( std::is_floating_point_v<T> )
+      write_value(_out, value(static_cast<double>(_obj)));
+    else
+    {
+      // Integers are written as the serializer does
+      char buf[24];
+      _out.append(buf, std::to_chars(buf, buf + sizeof(buf), _obj).ptr);
+    }
+  }
+}
+
+//! Json of the object (compact format)
+template <typename T>
+std::string to_str(const T& _obj)
+{
+  std::string out;
+  write(_obj, out);
+  return out;
+}
+
+} // namespace bind
+} // namespace json
+} // namespace sid
@@ -0,0 +1,150 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@file json_cache.hpp
+@brief Json value with the text of its objects and arrays cached
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+/**
+ * @file  json_cache.hpp
+ * @brief Json value re-serialized incrementally, with the text of its objects and arrays cached
+ */
+#pragma once
+
+#include "json.hpp"
+#include "json_path.hpp"
+#include <string>
+#include <unordered_map>
+
+namespace sid {
+namespace json {
+
+//! Statistics of the last cached_value::to_str()
+struct cache_stats
+{
+  uint64_t encoded;      //! Objects and arrays serialized
+  uint64_t spliced;      //! Objects and arrays copied from the previous text
+  uint64_t splicedBytes; //! Bytes copied from the previous text
+
+  cache_stats() { clear(); }
+  void clear() { encoded = spliced = splicedBytes = 0; }
+};
+
+/**
+ * @class cached_value
+ * @brief A json tree that keeps the text of each of its objects and arrays, so that it is
+ *        serialized again at the cost of what changed rather than of its size.
+ *
+ *   json::cached_value jstate(std::move(jroot));
+ *   jstate.at("/devices/3/size") = newSize;
+ *   response.content.set_data(jstate.to_str());
+ *
+ * The tree is changed through at(), which marks the objects and arrays leading to the value
+ * as dirty and drops the text kept for the objects and arrays inside the value. to_str()
+ * serializes the dirty objects and arrays again, copying the text of the others from the
+ * previous text as it is. The cost is that of the entries of the dirty objects and arrays,
+ * plus a copy of the text.
+ *
+ * The text of an object or an array is kept as its position in the text of its parent, and
+ * is found by the address of its entries, which does not change when the value is moved.
+ * The tree must not be changed but through the references returned by at(), until the next
+ * to_str(). Call invalidate() after changing it otherwise.
+ */
+class cached_value
+{
+public:
+  explicit cached_value(const format& _format = format());
+  explicit cached_value(value&& _root, const format& _format = format());
+  cached_value(const cached_value&) = delete;
+  cached_value& operator=(const cached_value&) = delete;
+
+  //! The tree. Use at() to change it.
+  const value& root() const { return m_root; }
+
+  /**
+   * @fn value& at(const path& _path);
+   * @brief Get the value at the given path to change it.
+   *        Throws sid::exception if the path is not single or if there is no value at the path.
+   *
+   * @param _path [in] A path matching at most one value (see path::is_single()). The empty
+   *                   path gets the root.
+   *
+   * @return The value, which can be changed in any way up to the next to_str()
+   */
+  value& at(const path& _path);
+  value& at(std::string_view _path) { return at(path(_path)); }
+
+  //! Replace the tree
+  void reset(value&& _root);
+  //! Drop the text kept for the whole tree, after it was changed other than through at()
+  void invalidate();
+
+  /**
+   * @fn const std::string& to_str();
+   * @brief Serialize the tree, serializing again only the objects and arrays that are dirty.
+   *        Throws sid::exception if the root is not an object or an array, as value::to_str().
+   *
+   * @return The json text of the tree, valid until the next call
+   */
+  const std::string& to_str();
+
+  //! Statistics of the last to_str()
+  const cache_stats& stats() const { return m_stats; }
+
+private:
+  //! Text of an object or an array
+  struct entry
+  {
+    size_t offset;  //! Position in the text of the parent, of the whole text for the root
+    size_t length;  //! Length of the text
+    bool   isDirty; //! The text is outdated, the entries are written again
+  };
+
+  //! Key of the entry of the object or the array (the address of its entries)
+  static const void* p_key(const value& _jval);
+  //! Drop the entries of the objects and the arrays in the given value
+  void p_drop(const value& _jval);
+  /**
+   * Write the object or the array at the given level of nesting.
+   * _oldParent is the position of the parent in the previous text (npos if it has no text)
+   * and _newParent is its position in the new text.
+   */
+  void p_write(const value& _jval, uint32_t _level, size_t _oldParent, size_t _newParent);
+
+  value                                    m_root;    //! The tree
+  const format                             m_format;  //! Output format
+  std::unordered_map<const void*, entry>   m_entries; //! Text of the objects and the arrays
+  std::string                              m_text;    //! Text of the tree
+  std::string                              m_next;    //! Text being written
+  cache_stats                              m_stats;   //! Statistics of the last to_str()
+};
+
+} // namespace json
+} // namespace sid
@@ -0,0 +1,187 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@file json_lazy.hpp
+@brief Lazy json document decoded only where it is accessed
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+/**
+ * @file  json_lazy.hpp
+ * @brief Lazy json document decoded only where it is accessed
+ */
+#pragma once
+
+#include "json.hpp"
+#include <iterator>
+#include <memory>
+
+namespace sid {
+namespace json {
+
+/**
+ * @class lazy_document
+ * @brief Json document that is validated in one pass and decoded only where it is accessed.
+ *
+ * parse() checks the syntax of the whole input and records a tape of its tokens: the type,
+ * the position in the input and, for containers, the number of members and where they end.
+ * Nothing is decoded or allocated per value. Strings and numbers are decoded when they are
+ * read. An object gets a hash index of its keys the first time a key is looked up in it, and
+ * an array an index of its elements the first time it is accessed by position, if they have
+ * more than a few members.
+ *
+ *   json::lazy_document jdoc;
+ *   jdoc.parse(response);
+ *   const std::string id = jdoc.root()["items"][0]["id"].get_str();
+ *
+ * The grammar is the default one of value::parse(). The ranges of the numbers are checked
+ * when they are decoded. A duplicate key refers to its last value.
+ * The input is not copied and must stay alive while the document is used (see parse_file()).
+ * Elements are valid until the next parse or clear. A document is not thread safe.
+ */
+class lazy_document
+{
+public:
+  class element;
+
+  lazy_document();
+  ~lazy_document();
+  lazy_document(const lazy_document&) = delete;
+  lazy_document& operator=(const lazy_document&) = delete;
+
+  /**
+   * @fn bool parse(std::string_view _value);
+   * @brief Validate the given json and record its tape. Throws sid::exception on invalid json.
+   *        The root must be an object or an array, and the input less than 4 GB.
+   *
+   * @param _value [in] Input json string. It must stay alive while the document is used.
+   */
+  bool parse(std::string_view _value);
+  //! Validate the contents of the given json file, which is memory mapped by the document
+  bool parse_file(const std::string& _filePath);
+  //! Release the tape and the input
+  void clear();
+  bool empty() const;
+
+  //! The root object or array
+  element root() const;
+  //! Number of tokens in the tape
+  size_t tape_size() const;
+
+  /**
+   * @class element
+   * @brief Handle to a value of the document. Copying it copies only the handle.
+   */
+  class element
+  {
+  public:
+    class iterator;
+
+    value_type type() const;
+    bool is_null() const { return type() == value_type::null; }
+    bool is_string() const { return type() == value_type::string; }
+    bool is_num() const { const value_type t = type(); return t == value_type::_signed
+        || t == value_type::_unsigned || t == value_type::_double; }
+    bool is_bool() const { return type() == value_type::boolean; }
+    bool is_array() const { return type() == value_type::array; }
+    bool is_object() const { return type() == value_type::object; }
+
+    //! Number of members of an object or an array. Duplicate keys are counted.
+    size_t size() const;
+    //! Element at the given index of an array
+    element operator[](const size_t _index) const;
+    //! Value of the given key of an object. Throws if the key does not exist.
+    element operator[](std::string_view _key) const;
+    //! Value of the given key of an object, if it exists
+    std::optional<element> find(std::string_view _key) const;
+    bool has_key(std::string_view _key) const { return find(_key).has_value(); }
+
+    //! get functions. The value is decoded on every call.
+    int64_t get_int64() const;
+    uint64_t get_uint64() const;
+    float_type get_double() const;
+    bool get_bool() const;
+    std::string get_str() const;
+    //! Json text of the element as it is in the input
+    std::string_view raw() const;
+
+    //! Convert the element to a json value
+    void get(value& _jout) const;
+    value to_value() const { value jval; get(jval); return jval; }
+
+    //! Iteration over the members of an object or an array
+    iterator begin() const;
+    iterator end() const;
+
+  private:
+    friend class lazy_document;
+    element(const lazy_document* _doc, uint32_t _pos) : m_doc(_doc), m_pos(_pos) {}
+
+    const lazy_document* m_doc; //! Document of the element
+    uint32_t             m_pos; //! Position of the element in the tape
+  };
+
+  /**
+   * @class element::iterator
+   * @brief Forward iterator over the members of an object (key() and value) or an array
+   */
+  class element::iterator
+  {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = element;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = element;
+
+    element operator*() const;
+    //! Key of the current member of an object
+    std::string key() const;
+    iterator& operator++();
+    iterator operator++(int) { iterator it = *this; ++(*this); return it; }
+    bool operator==(const iterator& _it) const { return m_pos == _it.m_pos; }
+    bool operator!=(const iterator& _it) const { return m_pos != _it.m_pos; }
+
+  private:
+    friend class element;
+    iterator(const lazy_document* _doc, uint32_t _pos, bool _isObject)
+      : m_doc(_doc), m_pos(_pos), m_isObject(_isObject) {}
+
+    const lazy_document* m_doc;
+    uint32_t             m_pos;      //! Position of the member (of its key for an object)
+    bool                 m_isObject;
+  };
+
+private:
+  struct impl;
+  std::unique_ptr<impl> m_impl;
+};
+
+} // namespace json
+} // namespace sid
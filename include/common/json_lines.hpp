@@ -0,0 +1,160 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@file json_lines.hpp
+@brief Parallel parsing of newline delimited json (JSON Lines / NDJSON)
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+/**
+ * @file  json_lines.hpp
+ * @brief Parallel parsing of newline delimited json (JSON Lines / NDJSON)
+ */
+#pragma once
+
+#include "json.hpp"
+#include <functional>
+#include <memory>
+
+namespace sid {
+namespace json {
+
+/**
+ * @struct line_record
+ * @brief A record of a json lines input, as given to the callback of parse_lines()
+ */
+struct line_record
+{
+  uint64_t    line;  //! Line number of the record in the input, starting from 1
+  value       jval;  //! The record. null if it could not be parsed.
+  std::string error; //! Reason the record could not be parsed. Empty if it was parsed.
+
+  line_record() : line(0) {}
+  bool is_valid() const { return error.empty(); }
+};
+
+/**
+ * @struct lines_control
+ * @brief Control parameters of parse_lines()
+ *
+ * Each worker parses a chunk of chunkSize bytes into its own records, without locking. The
+ * workers lock only to take a chunk from the queue and to hand its records back, once per
+ * chunk, so larger chunks leave less to contend on. json_bench --threads=N measures the
+ * throughput with N threads.
+ */
+struct lines_control
+{
+  parser_control ctrl;      //! Grammar of the records, as in value::parse()
+  uint32_t       threads;   //! Number of worker threads. 0 uses one per core.
+  size_t         chunkSize; //! Approximate number of bytes given to a worker at a time
+  bool           ordered;   //! Deliver the records in the order of the input
+
+  lines_control() : threads(0), chunkSize(1024 * 1024), ordered(true) {}
+};
+
+/**
+ * @brief Callback of parse_lines() for each record. Return false to stop parsing.
+ *
+ * The record can be moved out of. In the ordered mode the callback is called from the thread
+ * that parses the input. Otherwise it is called from the worker threads as soon as their chunk
+ * is parsed, concurrently, and must be thread safe. Records of a chunk are always delivered in
+ * the order of the input.
+ */
+using line_callback = std::function<bool(line_record& _record)>;
+
+/**
+ * @fn bool parse_lines(std::string_view _input, const line_callback& _callback,
+ *                      const lines_control& _lctrl);
+ * @brief Parse the records of a json lines input on a pool of worker threads.
+ *
+ * The input is split at line boundaries into chunks which are parsed in parallel, in place.
+ * Every non-blank line is a record, which follows the grammar of value::parse(), ie. an object
+ * or an array. An invalid record does not stop the parsing, it is delivered with its error.
+ * Exceptions thrown by the callback stop the parsing and are rethrown to the caller.
+ *
+ * @param _input [in] Json lines input. Must stay alive until the function returns.
+ * @param _callback [in] Called for each record
+ * @param _lctrl [in] Control parameters
+ *
+ * @return false if the callback stopped the parsing
+ */
+bool parse_lines(std::string_view _input, const line_callback& _callback,
+                 const lines_control& _lctrl = lines_control());
+//! Parse the records of the given json lines file, which is memory mapped
+bool parse_lines_file(const std::string& _filePath, const line_callback& _callback,
+                      const lines_control& _lctrl = lines_control());
+
+/**
+ * @class lines_parser
+ * @brief parse_lines() for an input that arrives in pieces, for example from a socket.
+ *
+ *   json::lines_parser jparser(callback);
+ *   while ( (nread = ::read(fd, buffer, sizeof(buffer))) > 0 )
+ *     jparser.feed(buffer, nread);
+ *   jparser.finish();
+ *
+ * A piece can end anywhere. The complete lines are handed to the workers once a chunk worth
+ * of them has been collected. The callback is called as in parse_lines(), from feed() and
+ * finish() in the ordered mode.
+ */
+class lines_parser
+{
+public:
+  lines_parser(const line_callback& _callback, const lines_control& _lctrl = lines_control());
+  //! Stops the workers. Records that are not delivered yet are dropped.
+  ~lines_parser();
+  lines_parser(const lines_parser&) = delete;
+  lines_parser& operator=(const lines_parser&) = delete;
+
+  /**
+   * @fn bool feed(const char* _data, size_t _len);
+   * @brief Add the next piece of the input
+   *
+   * @return false if the callback has stopped the parsing. The rest of the input is ignored.
+   */
+  bool feed(const char* _data, size_t _len);
+  bool feed(std::string_view _data) { return feed(_data.data(), _data.length()); }
+
+  /**
+   * @fn bool finish();
+   * @brief End of the input. Parses the last line and waits for all the records to be
+   *        delivered.
+   *
+   * @return false if the callback has stopped the parsing
+   */
+  bool finish();
+
+private:
+  friend bool parse_lines(std::string_view, const line_callback&, const lines_control&);
+  struct impl;
+  std::unique_ptr<impl> m_impl;
+};
+
+} // namespace json
+} // namespace sid
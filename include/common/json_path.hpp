@@ -0,0 +1,203 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@file json_path.hpp
+@brief Compiled json paths (JSON Pointer and simple JSONPath)
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+/**
+ * @file  json_path.hpp
+ * @brief Compiled json paths (RFC 6901 JSON Pointer and simple JSONPath) evaluated without
+ *        copying the matched values
+ */
+#pragma once
+
+#include "json.hpp"
+#include <initializer_list>
+#include <memory>
+
+namespace sid {
+namespace json {
+
+/**
+ * @class path
+ * @brief A path into a json tree, parsed once and evaluated against any number of trees.
+ *
+ * Two syntaxes are accepted:
+ *  - JSON Pointer (RFC 6901): "" or a sequence of "/token". ~0 and ~1 stand for ~ and /.
+ *    A token selects the key of an object or the index of an array. The token * selects
+ *    every element of an array or every value of an object.
+ *      /blockdevices/0/name
+ *      /blockdevices/ * /children/ * /mountpoint (without the spaces)
+ *  - JSONPath, restricted to the steps without filters and recursive descent:
+ *      $.key  $['key']  $["key"]  $[2]  $[-1]  $.*  $[*]  $[start:end:step]
+ *    A negative index or slice bound counts from the end of the array. A slice has the
+ *    semantics of Python's slices.
+ *
+ * A path does not throw when the tree does not match it. A step that does not apply to the
+ * value it meets (a key on an array, a missing key, an index out of range) simply yields
+ * no match. Keys are looked up with the hash index of large objects, the hash of each key
+ * being computed when the path is parsed.
+ *
+ *   json::path jpath("/blockdevices/ * /children/ * /mountpoint");
+ *   for ( const json::value* pval : jpath.eval(jroot) )
+ *     ...
+ *
+ * The pointers returned refer to the values in the tree and are valid until it is modified.
+ */
+class path
+{
+  friend class projection;
+public:
+  path();
+  //! Parse the given path. Throws sid::exception if the path is invalid.
+  explicit path(std::string_view _path);
+
+  //! Parse the given path, replacing the existing one. Throws sid::exception if it is invalid.
+  void set(std::string_view _path);
+  //! The path as it was given
+  const std::string& to_str() const { return m_path; }
+  //! Number of steps of the path. An empty path matches the root.
+  size_t size() const { return m_steps.size(); }
+  bool empty() const { return m_steps.empty(); }
+  //! Returns true if the path can match at most one value (no wildcard or slice)
+  bool is_single() const { return m_single; }
+
+  /**
+   * @fn std::vector<const value*> eval(const value& _root) const;
+   * @brief Get the values matching the path, in the order they appear in the tree.
+   *        Wildcard and slice steps are expanded in the same pass over the tree.
+   *
+   * @param _root [in] json tree to evaluate the path against
+   */
+  std::vector<const value*> eval(const value& _root) const;
+  //! Append the values matching the path to _out, which can be reused between calls
+  void eval(const value& _root, std::vector<const value*>& _out) const;
+  //! Get the first value matching the path. Returns nullptr if there is none.
+  const value* find(const value& _root) const;
+  /**
+   * @fn const value* find(const value& _root, std::vector<const value*>& _trail) const;
+   * @brief Get the value matching a single path (see is_single()) along with the values
+   *        leading to it. Throws sid::exception if the path is not single.
+   *
+   * @param _root [in] json tree to evaluate the path against
+   * @param _trail [out] The root and the values up to the parent of the match
+   *
+   * @return The value matching the path, nullptr if there is none
+   */
+  const value* find(const value& _root, std::vector<const value*>& _trail) const;
+
+private:
+  //! A step of the path
+  struct step
+  {
+    enum class kind : uint8_t {
+      key,      //! Key of an object, or index of an array if the key is an array index
+      index,    //! Index of an array (JSONPath), negative from the end
+      wildcard, //! All the elements of an array or the values of an object
+      slice     //! Elements of an array from start to end by stride
+    };
+    kind        type;
+    bool        hasIndex; //! The key of a key step is also an array index
+    bool        hasStart; //! The start of a slice is given (or the index of an index step)
+    bool        hasEnd;   //! The end of a slice is given
+    uint32_t    hash;     //! Hash of the key of a key step
+    int64_t     index;    //! Index of a key or an index step, start of a slice
+    int64_t     end;      //! End of a slice
+    int64_t     stride;   //! Stride of a slice
+    std::string key;      //! Key of a key step
+  };
+
+  std::string       m_path;   //! Path as given
+  std::vector<step> m_steps;  //! Parsed steps
+  bool              m_single; //! No step matches more than one value
+
+  void p_pointer(std::string_view _path);
+  void p_jsonpath(std::string_view _path);
+  void p_key(std::string _key, bool _hasIndex);
+  template <typename F> bool p_eval(const value& _val, size_t _step, F& _match) const;
+};
+
+/**
+ * @class projection
+ * @brief Paths of a document that a parse converts to json, skipping everything else.
+ *
+ * The paths are JSON Pointers or JSONPaths (see path) made of key, index and wildcard steps.
+ * value::parse() with a projection returns the values at the paths, and the objects and the
+ * arrays leading to them:
+ *  - An object keeps only its keys that are on a path.
+ *  - An array keeps its elements up to the last one that is on a path, the others being
+ *    null, so that each element keeps its index.
+ *  - A value that is not an object or an array where a path goes on is left out, like a key
+ *    that is not on a path (it is null in an array).
+ *
+ *   json::projection proj({"$.blockdevices[*].name", "$.blockdevices[*].size"});
+ *   json::value::parse(jroot, response, proj);
+ *
+ * The values that are left out are skipped without being converted, and nothing is allocated
+ * for them. They are checked as a parse without projection checks them: a document that such
+ * a parse rejects for its grammar, its strings, its numbers or its literals is rejected with
+ * the same error. Only the duplicates of the keys left out are not detected, whatever the
+ * parser_control::dupKey setting.
+ * A projection can be used by any number of parses at a time.
+ */
+class projection
+{
+public:
+  //! Paths going on below a value of the document (internal)
+  struct node;
+
+  projection();
+  //! Add the given paths. See add().
+  explicit projection(std::initializer_list<std::string_view> _paths);
+  explicit projection(const std::vector<std::string>& _paths);
+  ~projection();
+  projection(projection&&) noexcept;
+  projection& operator=(projection&&) noexcept;
+  projection(const projection&) = delete;
+  projection& operator=(const projection&) = delete;
+
+  //! Add the given path. Throws sid::exception if the path is invalid, or has a slice or
+  //! a negative index.
+  void add(std::string_view _path);
+  //! Number of paths added
+  size_t size() const { return m_size; }
+  bool empty() const { return m_size == 0; }
+
+  //! Paths from the root of the document
+  const node& root() const { return *m_root; }
+
+private:
+  std::unique_ptr<node> m_root; //! Tree of the steps of all the paths
+  size_t                m_size; //! Number of paths
+};
+
+} // namespace json
+} // namespace sid
@@ -0,0 +1,226 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@brief Event based json reader
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+/**
+ * @file  json_reader.hpp
+ * @brief Event based (SAX and pull) json reader that does not build a json tree, and the
+ *        incremental (push) parser built on it
+ */
+#pragma once
+
+#include "json.hpp"
+#include <memory>
+
+namespace sid {
+namespace json {
+
+//! Events generated by the json reader
+enum class event_type : uint8_t {
+  none, start_object, end_object, start_array, end_array, key, null, boolean, number, string
+};
+
+/**
+ * @class reader
+ * @brief Reads json as a sequence of events, without building a json tree.
+ *
+ * The grammar is the one of value::parse(), including the parser_control modes.
+ * Memory use is bounded by the nesting depth of the input and the length of the longest
+ * string, except for the dup_key::reject and dup_key::ignore modes which remember the keys
+ * of the open objects. In dup_key::accept and dup_key::append modes every occurrence of a
+ * duplicate key is reported.
+ *
+ * Pull model:
+ *   json::reader jreader(input);
+ *   while ( jreader.next() )
+ *     if ( jreader.event() == json::event_type::key && jreader.get_str() == "id" )
+ *       ...
+ *
+ * Push (SAX) model:
+ *   Derive from reader::handler and call parse().
+ *
+ * The input must stay alive while it is being read. Strings returned by the reader are
+ * valid until the next call to next().
+ */
+class reader
+{
+public:
+  /**
+   * @class handler
+   * @brief Callback interface of parse(). Return false from a callback to stop reading.
+   */
+  struct handler
+  {
+    virtual ~handler() = default;
+    virtual bool start_object() { return true; }
+    virtual bool end_object() { return true; }
+    virtual bool start_array() { return true; }
+    virtual bool end_array() { return true; }
+    virtual bool key(std::string_view _key) { return true; }
+    virtual bool null() { return true; }
+    virtual bool boolean(bool _val) { return true; }
+    //! _num is of value_type::_signed, value_type::_unsigned or value_type::_double
+    virtual bool number(const value& _num) { return true; }
+    virtual bool string(std::string_view _val) { return true; }
+  };
+
+  reader();
+  reader(std::string_view _input, const parser_control& _ctrl = parser_control());
+  ~reader();
+  reader(const reader&) = delete;
+  reader& operator=(const reader&) = delete;
+
+  //! Start reading the given json string. The string must stay alive while it is read.
+  void open(std::string_view _input, const parser_control& _ctrl = parser_control());
+  //! Start reading the contents of the given json file. The file is memory mapped.
+  void open_file(const std::string& _filePath, const parser_control& _ctrl = parser_control());
+
+  /**
+   * @fn bool next();
+   * @brief Move to the next event. Throws sid::exception on invalid json.
+   *
+   * @return false if the end of the document is reached
+   */
+  bool next();
+  //! Current event
+  event_type event() const;
+  //! Type of the current value. object/array for start and end events, string for a key.
+  value_type type() const;
+  //! Number of containers open at the current event (the one started counts)
+  size_t depth() const;
+
+  //! get functions for the current event
+  std::string_view get_str() const; // key or string
+  bool get_bool() const;
+  int64_t get_int64() const;
+  uint64_t get_uint64() const;
+  float_type get_double() const;
+
+  /**
+   * @fn void skip();
+   * @brief Skip the value of the current key, or the rest of the container just started.
+   *        The next call to next() moves to the event following the skipped value.
+   */
+  void skip();
+  /**
+   * @fn void read(value& _jval);
+   * @brief Build the value of the current key, or the current value, as a json tree.
+   *        Its duplicate keys are handled as value::parse() handles them (see
+   *        parser_control::dup_key). The next call to next() moves to the event following
+   *        the value.
+   */
+  void read(value& _jval);
+
+  /**
+   * @fn bool parse(handler& _handler);
+   * @brief Report the remaining events to the given handler
+   *
+   * @return false if the handler stopped reading before the end of the document
+   */
+  bool parse(handler& _handler);
+
+  //! Statistics of the values read so far. The times are set by parse().
+  const parser_stats& stats() const;
+
+private:
+  friend class push_parser;
+  struct impl;
+  std::unique_ptr<impl> m_impl;
+};
+
+/**
+ * @class push_parser
+ * @brief Incremental json parser fed with pieces of the input as they arrive, for example
+ *        the buffers read from http::connection::read().
+ *
+ * A piece can end anywhere, even in the middle of a token. Everything up to the last complete
+ * token is parsed right away and only the incomplete tail is kept until the next piece arrives.
+ * The grammar and the parser_control modes are the ones of value::parse().
+ *
+ * The parser either reports the events to a reader::handler as soon as they are complete,
+ * or builds the json tree which is available once the input is finished:
+ *
+ *   json::push_parser jparser;
+ *   while ( (nread = conn->read(buffer, sizeof(buffer))) > 0 )
+ *     jparser.feed(buffer, nread);
+ *   jparser.finish();
+ *   json::value& jroot = jparser.root();
+ *
+ * Errors in the input are thrown as sid::exception from feed() or finish(), after which the
+ * parser must be reset() to be used again.
+ */
+class push_parser
+{
+public:
+  //! Build the json tree of the input
+  push_parser(const parser_control& _ctrl = parser_control());
+  //! Report the events to the given handler. The handler must outlive the parser.
+  push_parser(reader::handler& _handler, const parser_control& _ctrl = parser_control());
+  ~push_parser();
+  push_parser(const push_parser&) = delete;
+  push_parser& operator=(const push_parser&) = delete;
+
+  //! Start over with a new document
+  void reset();
+
+  /**
+   * @fn bool feed(const char* _data, size_t _len);
+   * @brief Parse the next piece of the input
+   *
+   * @return false if the handler has stopped parsing. The rest of the input is ignored.
+   */
+  bool feed(const char* _data, size_t _len);
+  bool feed(std::string_view _data) { return feed(_data.data(), _data.length()); }
+
+  /**
+   * @fn void finish();
+   * @brief Mark the end of the input. Throws sid::exception if the document is incomplete.
+   */
+  void finish();
+
+  //! Whether the root container has been closed
+  bool is_complete() const;
+  //! Number of bytes kept from the previous pieces, waiting for the rest of a token
+  size_t pending() const;
+
+  //! The json tree built when no handler is used. Complete only after finish().
+  value& root();
+  //! Statistics of the values parsed so far
+  const parser_stats& stats() const;
+
+private:
+  struct impl;
+  std::unique_ptr<impl> m_impl;
+};
+
+} // namespace json
+} // namespace sid
@@ -0,0 +1,244 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@file json_snapshot.hpp
+@brief Memory mappable binary snapshot of json
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+/**
+ * @file  json_snapshot.hpp
+ * @brief Memory mappable binary snapshot of json
+ */
+#pragma once
+
+#include "json.hpp"
+#include "util.hpp"
+#include <iterator>
+#include <memory>
+
+namespace sid {
+namespace json {
+
+/**
+ * @class snapshot
+ * @brief Read-only json value stored in a binary image that is used in place.
+ *
+ * write() lays a value out as an image of fixed size nodes. The members of an array or an
+ * object are contiguous, so that an element is found by its offset. An object also has a
+ * table of its members sorted by key, which is searched by binary search. Each distinct
+ * string is stored once, whether it is a key or a value.
+ *
+ * open() maps the image and checks its header only: loading takes the same time whatever
+ * the size of the image, and nothing is allocated per value. The pages are read as they are
+ * accessed, and the processes that open the same image share one copy of it in the page cache.
+ *
+ *   json::snapshot::write(catalog, "/var/cache/app/catalog.snap");
+ *   ...
+ *   json::snapshot snap = json::snapshot::open("/var/cache/app/catalog.snap");
+ *   const std::string_view name = snap.root()["items"][0]["name"].get_view();
+ *
+ * The image is in the byte order of the host that wrote it and is rejected by a host of
+ * the other order. It is trusted beyond its header: it must be produced by write().
+ * Elements are valid until the snapshot is closed. A snapshot can be read by any number of
+ * threads at a time.
+ */
+class snapshot
+{
+public:
+  class element;
+  //! Node of the image (internal)
+  struct node;
+
+  /**
+   * @fn void write(const value& _jval, const std::string& _filePath);
+   * @brief Write the snapshot of the given value to the given file. The image is written
+   *        to a temporary file that is renamed to the given one, so that the processes that
+   *        have the previous image open keep reading it. Throws sid::exception on error.
+   *
+   * @param _jval [in] Value to be written
+   * @param _filePath [in] Path of the snapshot file
+   */
+  static void write(const value& _jval, const std::string& _filePath);
+  //! Map the given snapshot file. Throws sid::exception if it is not a valid snapshot.
+  static snapshot open(const std::string& _filePath);
+
+  snapshot();
+  ~snapshot();
+  snapshot(snapshot&& _obj) noexcept;
+  snapshot& operator=(snapshot&& _obj) noexcept;
+  snapshot(const snapshot&) = delete;
+  snapshot& operator=(const snapshot&) = delete;
+
+  //! Unmap the image
+  void close();
+  bool empty() const;
+
+  //! The root value
+  element root() const;
+  //! Size of the image in bytes
+  size_t image_size() const;
+
+  /**
+   * @class element
+   * @brief Handle to a value of the snapshot. Copying it copies only the handle.
+   */
+  class element
+  {
+  public:
+    class iterator;
+
+    value_type type() const;
+    bool is_null() const { return type() == value_type::null; }
+    bool is_string() const { return type() == value_type::string; }
+    bool is_signed() const { return type() == value_type::_signed; }
+    bool is_unsigned() const { return type() == value_type::_unsigned; }
+    bool is_decimal() const { return is_signed() || is_unsigned(); }
+    bool is_double() const { return type() == value_type::_double; }
+    bool is_num() const { return is_decimal() || is_double(); }
+    bool is_bool() const { return type() == value_type::boolean; }
+    bool is_array() const { return type() == value_type::array; }
+    bool is_object() const { return type() == value_type::object; }
+    bool is_basic_type() const { return ! ( is_array() || is_object() ); }
+    bool is_complex_type() const { return ( is_array() || is_object() ); }
+
+    //! Number of members of an object or an array
+    size_t size() const;
+    bool has_index(const size_t _index) const;
+    //! Element at the given index of an array
+    element operator[](const size_t _index) const;
+    //! Value of the given key of an object. Throws if the key does not exist.
+    element operator[](std::string_view _key) const;
+    //! Value of the given key of an object, if it exists
+    std::optional<element> find(std::string_view _key) const;
+    bool has_key(std::string_view _key) const { return find(_key).has_value(); }
+    //! Keys of an object in the order of the value written
+    std::vector<std::string> get_keys() const;
+
+    //! get functions, with the conversions of the value ones
+    int64_t get_int64() const;
+    uint64_t get_uint64() const;
+    double get_double() const;
+    bool get_bool() const;
+    std::string get_str() const;
+    //! Characters of a string, referring to the image
+    std::string_view get_view() const;
+
+    //! Typed access to the element without copying it. See value::get_if()
+    template <typename T> std::optional<T> get_if() const
+    {
+      if constexpr ( std::is_same<T, bool>::value )
+      {
+        if ( is_bool() )
+          return get_bool();
+      }
+      else if constexpr ( std::is_same<T, std::string_view>::value )
+      {
+        if ( is_string() )
+          return get_view();
+      }
+      else if constexpr ( std::is_floating_point<T>::value )
+      {
+        if ( is_num() )
+          return static_cast<T>(get_double());
+      }
+      else
+      {
+        static_assert(std::is_integral<T>::value,
+                      "get_if() can be used only for bool, number and std::string_view types");
+        if ( is_signed() && std::in_range<T>(get_int64()) )
+          return static_cast<T>(get_int64());
+        if ( is_unsigned() && std::in_range<T>(get_uint64()) )
+          return static_cast<T>(get_uint64());
+      }
+      return std::nullopt;
+    }
+    //! Typed access to the value of the given key. See value::get_if()
+    template <typename T> std::optional<T> get_if(std::string_view _key) const
+    {
+      const std::optional<element> elem = find(_key);
+      return elem? elem->get_if<T>() : std::nullopt;
+    }
+
+    //! Convert the element to a json value
+    void get(value& _jout) const;
+    value to_value() const { value jval; get(jval); return jval; }
+
+    //! Iteration over the members of an object (in the order of the value written) or an array
+    iterator begin() const;
+    iterator end() const;
+
+  private:
+    friend class snapshot;
+    element(const char* _image, const node* _node) : m_image(_image), m_node(_node) {}
+
+    const char* m_image; //! Start of the image
+    const node* m_node;  //! Node of the element
+  };
+
+  /**
+   * @class element::iterator
+   * @brief Forward iterator over the members of an object (key() and value) or an array
+   */
+  class element::iterator
+  {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = element;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = element;
+
+    element operator*() const;
+    //! Key of the current member of an object, referring to the image
+    std::string_view key() const;
+    iterator& operator++();
+    iterator operator++(int) { iterator it = *this; ++(*this); return it; }
+    bool operator==(const iterator& _it) const { return m_pos == _it.m_pos; }
+    bool operator!=(const iterator& _it) const { return m_pos != _it.m_pos; }
+
+  private:
+    friend class element;
+    iterator(const char* _image, const node* _pos, bool _isObject)
+      : m_image(_image), m_pos(_pos), m_isObject(_isObject) {}
+
+    const char* m_image;
+    const node* m_pos;      //! Node of the member (of its key for an object)
+    bool        m_isObject;
+  };
+
+private:
+  //! Layout of a value into an image (see write())
+  struct writer;
+
+  util::mapped_file m_file; //! Mapped image
+};
+
+} // namespace json
+} // namespace sid
@@ -0,0 +1,161 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@file json_writer.hpp
+@brief Streaming json writer
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+/**
+ * @file  json_writer.hpp
+ * @brief Streaming json writer, writing to a sink through a buffer of fixed size
+ */
+#pragma once
+
+#include "json.hpp"
+#include <concepts>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace sid {
+namespace json {
+
+/**
+ * @brief Destination of the json text of a writer, for example a file, a socket or
+ *        http::response::chunk_sink(). It is given the text a buffer at a time, and throws
+ *        a sid::exception if the text cannot be written.
+ */
+using write_sink = std::function<void(const char* _data, size_t _len)>;
+
+/**
+ * @class writer
+ * @brief Writes json text incrementally, without building a json::value first.
+ *
+ *   json::writer jw(response.chunk_sink(conn));
+ *   jw.begin_object().key("devices").begin_array();
+ *   for ( const device_detail& dev : devices )
+ *     jw.begin_object().key("name").value(dev.name).key("size").value(dev.size).end_object();
+ *   jw.end_array().end_object().finish();
+ *
+ * The text is collected in a buffer, which is handed to the sink once it holds the buffer
+ * size, so that the memory used does not depend on the size of the output. The text is the
+ * same as value::to_str() gives for the same format. Calls out of the json grammar, such as
+ * a value in an object without its key, throw a sid::exception.
+ */
+class writer
+{
+public:
+  //! Default size of the buffer
+  static constexpr size_t default_buffer_size = 16 * 1024;
+
+  writer(const write_sink& _sink, const format& _format = format(),
+         size_t _bufferSize = default_buffer_size);
+  writer(const writer&) = delete;
+  writer& operator=(const writer&) = delete;
+
+  //! Start and end an object or an array
+  writer& begin_object();
+  writer& end_object();
+  writer& begin_array();
+  writer& end_array();
+
+  //! Key of the next value of the object. The key is escaped as needed.
+  writer& key(std::string_view _key);
+
+  //! Next value of the array or of the object, or the root value
+  writer& value(std::nullptr_t);
+  writer& value(bool _val);
+  writer& value(int64_t _val);
+  writer& value(uint64_t _val);
+  writer& value(double _val);
+  writer& value(std::string_view _val);
+  writer& value(const char* _val) { return value(std::string_view(_val)); }
+  writer& value(const std::string& _val) { return value(std::string_view(_val)); }
+  //! Integers of the other sizes
+  template <std::integral T>
+  writer& value(T _val) {
+    if constexpr ( std::is_signed_v<T> )
+      return value(static_cast<int64_t>(_val));
+    else
+      return value(static_cast<uint64_t>(_val));
+  }
+  //! Write a whole json value. Its containers are written a piece at a time.
+  writer& value(const json::value& _jval);
+
+  /**
+   * @fn void flush();
+   * @brief Hand the text in the buffer to the sink
+   */
+  void flush();
+
+  /**
+   * @fn void finish();
+   * @brief End of the output. Throws a sid::exception if the root value is not complete,
+   *        otherwise flushes the buffer.
+   */
+  void finish();
+
+  //! Number of bytes written so far, including those still in the buffer
+  uint64_t bytes() const { return m_flushed + m_buffer.length(); }
+
+private:
+  //! Object or array being written
+  struct level
+  {
+    bool isObject;   //! Object or array
+    bool hasEntries; //! An entry was written, the next one is preceded by a comma
+  };
+
+  //! Start the next value, checking that a value is expected
+  void p_begin_value();
+  //! End of a value, the buffer is flushed once it is full
+  void p_end_value();
+  void p_begin(bool _isObject, char _ch);
+  void p_end(bool _isObject, char _ch);
+  //! Write the key of the next entry of the innermost object
+  void p_key(std::string_view _key, bool _escape);
+  //! Write the elements of a container and the scalar values
+  void p_write(const json::value& _jval);
+  //! Write the scalar value through the serializer
+  void p_write_scalar(const json::value& _jval);
+
+  write_sink         m_sink;       //! Destination of the text
+  const format       m_format;     //! Output format
+  const size_t       m_bufferSize; //! Size at which the buffer is flushed
+  std::string        m_buffer;     //! Text not flushed yet
+  std::vector<level> m_levels;     //! Containers being written, the innermost last
+  bool               m_isKeyed;    //! A key was written, its value is expected
+  bool               m_isComplete; //! The root value is written
+  uint64_t           m_flushed;    //! Number of bytes handed to the sink
+};
+
+} // namespace json
+} // namespace sid
@@ -34,6 +34,7 @@ LICENSE: END
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include "exception.hpp"
 
@@ -64,5 +65,55 @@ private:
   command& operator=(const sid::exception& _e);
 };
 
+/**
+ * @struct mapped_file
+ * @brief Read-only memory mapping of a file. The contents can be accessed in place
+ *        without copying them into an intermediate buffer.
+ *
+ *        Inputs that cannot be mapped because they are not regular files or do not
+ *        report a size (pipes, FIFOs, /proc, /sys) are read into a buffer instead.
+ */
+struct mapped_file
+{
+  //! Default constructor
+  mapped_file();
+  //! Constructor that maps the given file. Throws sid::exception on error.
+  mapped_file(const std::string& _filePath);
+  //! Move constructor
+  mapped_file(mapped_file&& _obj) noexcept;
+  //! Move operator
+  mapped_file& operator=(mapped_file&& _obj) noexcept;
+  //! Destructor
+  ~mapped_file();
+
+  //! Cannot be copied
+  mapped_file(const mapped_file&) = delete;
+  mapped_file& operator=(const mapped_file&) = delete;
+
+  //! Map the given file. Throws sid::exception on error.
+  void open(const std::string& _filePath);
+  //! Unmap the file
+  void close();
+  bool is_open() const { return m_isOpen; }
+
+  const char* data() const { return m_data; }
+  size_t size() const { return m_size; }
+  std::string_view view() const { return std::string_view(m_data, m_size); }
+  //! Whether the contents are mapped rather than read into a buffer
+  bool is_mapped() const { return m_isMapped; }
+
+  //! Release the memory of the whole pages within the first _len bytes. The contents
+  //! remain accessible and are read again from the file if they are accessed.
+  //! Has no effect if the contents were read into a buffer.
+  void discard(size_t _len);
+
+private:
+  const char* m_data;
+  size_t      m_size;
+  bool        m_isOpen;
+  bool        m_isMapped; //! Whether m_data is a mapping or points to m_buffer
+  std::string m_buffer;   //! Contents of an input that cannot be mapped
+};
+
 } // namespace util
 } // namespace sid
@@ -45,6 +45,7 @@ LICENSE: END
 #include "content.hpp"
 #include "connection.hpp"
 #include <string>
+#include <functional>
 
 namespace sid::http {
 
@@ -81,12 +82,51 @@ public:
   bool send(connection_ptr _conn);
   bool recv(connection_ptr _conn, const method& _requestMethod);
 
+  /**
+   * @fn bool send_head(connection_ptr _conn);
+   * @brief Send the status line and the headers only, for a payload that is sent in pieces
+   *        with send_chunk(). The Transfer-Encoding header is set to chunked and the
+   *        Content-Length header is removed.
+   */
+  bool send_head(connection_ptr _conn);
+
+  /**
+   * @fn bool send_chunk(connection_ptr _conn, const char* _data, size_t _len);
+   * @brief Send a piece of the payload as a chunk. An empty piece is the last chunk, which
+   *        ends the payload. The chunk goes out in a single write of the connection.
+   */
+  bool send_chunk(connection_ptr _conn, const char* _data, size_t _len);
+
+  /**
+   * @fn std::function<void(const char* _data, size_t _len)> chunk_sink(connection_ptr _conn);
+   * @brief Sink that sends each piece given to it as a chunk, as send_chunk() does, and throws
+   *        a sid::exception on failure. The sink holds a reference to the connection only, it
+   *        does not refer to the response and can outlive it. Used as the sink of a
+   *        json::writer:
+   *
+   *   response.send_head(conn);
+   *   json::writer jw(response.chunk_sink(conn));
+   *   ...
+   *   jw.finish();
+   *   response.send_chunk(conn, nullptr, 0);
+   */
+  static std::function<void(const char* _data, size_t _len)> chunk_sink(connection_ptr _conn);
+
 public:
   http::version version;    //! HTTP version in Line-1 of response
   http::status  status;     //! Status code and message in Line-1 of response
   http::headers headers;    //! List of response headers
   http::content content;    //! HTTP response payload
   std::string   error;
+
+  /**
+   * Optional consumer of the payload, called by recv() with each piece of the payload as it is
+   * received (after removing the chunked transfer encoding), for example with
+   * json::push_parser::feed() to parse the payload while it downloads.
+   * Return false to stop receiving. The payload is not stored in content when a handler is
+   * set, so that it is never held in memory as a whole.
+   */
+  std::function<bool(const char* _data, size_t _len)> data_handler;
 };
 
 } // namespace sid::http
@@ -40,6 +40,7 @@ LICENSE: END
 #include <block/device.hpp>
 #include <common/util.hpp>
 #include <common/json.hpp>
+#include <common/json_bind.hpp>
 #include <common/convert.hpp>
 
 #include <sstream>
@@ -47,8 +48,28 @@ LICENSE: END
 using namespace sid;
 using namespace sid::block;
 
+namespace sid {
+namespace block {
+
+//! Columns of lsblk read into a device_detail, the other columns are skipped
+SID_JSON_BIND(device_detail,
+  SID_JSON_FIELD("name", name), SID_JSON_FIELD("path", path), SID_JSON_FIELD("type", type),
+  SID_JSON_FIELD("size", size), SID_JSON_FIELD("phy-sec", blockSize), SID_JSON_FIELD("ro", isReadOnly),
+  SID_JSON_FIELD("model", model), SID_JSON_FIELD("serial", serial), SID_JSON_FIELD("wwn", wwn),
+  SID_JSON_FIELD("label", label), SID_JSON_FIELD("mountpoint", mountPoint))
+
+} // namespace block
+} // namespace sid
+
 namespace local
 {
+  //! Output of lsblk --json. The devices are optional only to detect a missing key.
+  struct lsblk_output
+  {
+    std::optional<std::vector<device_detail>> blockdevices;
+  };
+  SID_JSON_BIND(lsblk_output, SID_JSON_FIELD("blockdevices", blockdevices))
+
   bool enum_block_devices(
     const std::string&      _path,
     FNDeviceDetailCallback& _fnDeviceDetailCallback
@@ -217,25 +238,12 @@ bool local::enum_block_devices(
   if ( cmdOut.retVal )
     throw sid::exception(-1, cmdOut.error);
 
-  json::value jroot;
-  json::value::parse(jroot, cmdOut.response);
-  const json::value& jdevices = jroot["blockdevices"];
-  for ( size_t i = 0; i < jdevices.size(); i++ )
+  local::lsblk_output output;
+  json::bind::parse(cmdOut.response, output);
+  if ( ! output.blockdevices )
+    throw sid::exception(-1, "The output of lsblk does not have blockdevices");
+  for ( device_detail& deviceDetail : *output.blockdevices )
   {
-    const json::value& jdevice = jdevices[i];
-    device_detail deviceDetail;
-    jdevice.get_value("name", deviceDetail.name);
-    jdevice.get_value("path", deviceDetail.path);
-    jdevice.get_value("type", deviceDetail.type);
-    jdevice.get_value("size", deviceDetail.size);
-    jdevice.get_value("phy-sec", deviceDetail.blockSize);
-    jdevice.get_value("ro", deviceDetail.isReadOnly);
-    jdevice.get_value("model", deviceDetail.model);
-    jdevice.get_value("serial", deviceDetail.serial);
-    jdevice.get_value("wwn", deviceDetail.wwn);
-    jdevice.get_value("label", deviceDetail.label);
-    jdevice.get_value("mountpoint", deviceDetail.mountPoint);
-
     // Fill any missing details using another command
     local::fill_missing_details(deviceDetail);
 
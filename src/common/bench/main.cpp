@@ -0,0 +1,762 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@file main.cpp
+@brief Benchmark of the json parser and serializer against jsoncpp
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+/**
+ * @file main.cpp
+ * @brief Benchmark of the json parser and serializer against jsoncpp.
+ *
+ * Every case of the corpus is parsed and serialized by each library. The corpus is made of
+ * generated documents (deep nesting, wide objects, numbers, strings with escapes and json
+ * lines), to which files can be added. For each case and library it reports the throughput
+ * of the best of the iterations, the allocations made by the first iteration and the peak
+ * resident set size while the case was run.
+ *
+ * With --numbers it compares instead the two conversions of the numbers of the json lexer on
+ * arrays of numbers: the value computed during the scan that validates the number (scan), and
+ * the copy of the number into a string converted by sid::to_num (to_num), which is how every
+ * number was converted before the scan computed them.
+ *
+ * Usage: json_bench [<file>...] [--iterations=N] [--size=MB] [--threads=N] [--numbers]
+ *                   [--library=all|sid|jsoncpp] [--output=text|json|csv] [--label=NAME]
+ *
+ * Files ending with .jsonl or .ndjson are parsed as json lines. The json and csv outputs are
+ * meant to be compared between versions, which can be told apart with --label.
+ */
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <cstring>
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <functional>
+#include <random>
+#include <charconv>
+#include <cmath>
+#include <iomanip>
+#include <new>
+#include <malloc.h>
+#include <time.h>
+#include "common/json.hpp"
+#include "common/json_lines.hpp"
+#include "common/convert.hpp"
+#include "common/util.hpp"
+#include "json_lexer.h"
+
+#include <jsoncpp/json/json.h>
+
+using namespace std;
+using namespace sid;
+
+namespace local
+{
+//! Allocations made through the global operator new, by all the threads
+std::atomic<uint64_t> allocCount{0};
+std::atomic<uint64_t> allocBytes{0};
+
+void* allocate(size_t _size)
+{
+  allocCount.fetch_add(1, std::memory_order_relaxed);
+  allocBytes.fetch_add(_size, std::memory_order_relaxed);
+  void* p = ::malloc(_size? _size : 1);
+  if ( p == nullptr )
+    throw std::bad_alloc();
+  return p;
+}
+}
+
+// Both libraries allocate through the global operator new, which is counted
+void* operator new(size_t _size) { return local::allocate(_size); }
+void* operator new[](size_t _size) { return local::allocate(_size); }
+void operator delete(void* _p) noexcept { ::free(_p); }
+void operator delete[](void* _p) noexcept { ::free(_p); }
+void operator delete(void* _p, size_t) noexcept { ::free(_p); }
+void operator delete[](void* _p, size_t) noexcept { ::free(_p); }
+
+namespace local
+{
+/**
+ * @struct item
+ * @brief A case of the corpus. Generated cases are created only when they are run, so that
+ *        the memory of the other cases does not count in the peak resident set size.
+ */
+struct item
+{
+  std::string name;    //! Name of the case
+  bool        isLines; //! The input is json lines
+  std::string path;    //! Path of the file. Empty for a generated case.
+  std::function<void(std::string&, size_t)> generate; //! Generator of the input
+};
+
+/**
+ * @struct result
+ * @brief Measurements of a case run by a library
+ */
+struct result
+{
+  std::string caseName;
+  std::string library;
+  size_t      inputBytes = 0;      //! Size of the input
+  size_t      outputBytes = 0;     //! Size of the serialized output
+  uint64_t    parseNs = 0;         //! Best parse time
+  uint64_t    writeNs = 0;         //! Best serialization time
+  uint64_t    parseAllocs = 0;     //! Allocations of a parse
+  uint64_t    parseAllocBytes = 0; //! Bytes allocated by a parse
+  uint64_t    writeAllocs = 0;     //! Allocations of a serialization
+  uint64_t    peakRssKb = 0;       //! Peak resident set size while parsing and serializing
+
+  double parse_mbps() const { return parseNs? (inputBytes * 1e3 / parseNs) : 0; }
+  double write_mbps() const { return writeNs? (outputBytes * 1e3 / writeNs) : 0; }
+};
+
+uint64_t now_ns()
+{
+  struct timespec ts = {0};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+//! Value in kB of the given field of /proc/self/status (VmRSS, VmHWM)
+uint64_t status_kb(const std::string& _field)
+{
+  std::ifstream in("/proc/self/status");
+  std::string line;
+  while ( std::getline(in, line) )
+    if ( line.compare(0, _field.length(), _field) == 0 && line[_field.length()] == ':' )
+      return ::strtoull(line.c_str() + _field.length() + 1, nullptr, 10);
+  return 0;
+}
+
+//! Reset the peak resident set size (VmHWM) to the current one. Needs Linux 4.0 or later.
+bool reset_peak_rss()
+{
+  std::ofstream out("/proc/self/clear_refs");
+  out << "5";
+  out.flush();
+  return out.good();
+}
+
+/**
+ * @struct sid_library
+ * @brief sid::json. Json lines are parsed with json::parse_lines().
+ */
+struct sid_library
+{
+  static constexpr const char* name = "sid";
+  json::value              m_root;
+  std::vector<json::value> m_records;
+  json::lines_control      m_lctrl;
+
+  sid_library(uint32_t _threads) { m_lctrl.threads = _threads; }
+
+  void parse(std::string_view _data, bool _isLines)
+  {
+    if ( ! _isLines )
+    {
+      json::value::parse(m_root, _data);
+      return;
+    }
+    json::parse_lines(_data, [&](json::line_record& _rec)
+      {
+        if ( ! _rec.is_valid() )
+          throw sid::exception("Line " + sid::to_str(_rec.line) + ": " + _rec.error);
+        m_records.push_back(std::move(_rec.jval));
+        return true;
+      }, m_lctrl);
+  }
+
+  void write(std::string& _out) const
+  {
+    if ( m_records.empty() )
+      return m_root.write(_out);
+    for ( const json::value& jrec : m_records )
+    {
+      jrec.write(_out);
+      _out += '\n';
+    }
+  }
+};
+
+/**
+ * @struct jsoncpp_library
+ * @brief jsoncpp. Json lines are parsed one line at a time.
+ */
+struct jsoncpp_library
+{
+  static constexpr const char* name = "jsoncpp";
+  Json::Value                        m_root;
+  std::vector<Json::Value>           m_records;
+  std::unique_ptr<Json::CharReader>   m_reader;
+  std::unique_ptr<Json::StreamWriter> m_writer;
+
+  jsoncpp_library(uint32_t)
+  {
+    Json::CharReaderBuilder readerBuilder;
+    m_reader.reset(readerBuilder.newCharReader());
+    Json::StreamWriterBuilder writerBuilder;
+    writerBuilder["indentation"] = "";
+    m_writer.reset(writerBuilder.newStreamWriter());
+  }
+
+  void parse_one(const char* _begin, const char* _end, Json::Value& _jout)
+  {
+    Json::String errs;
+    if ( ! m_reader->parse(_begin, _end, &_jout, &errs) )
+      throw sid::exception("jsoncpp: " + errs);
+  }
+
+  void parse(std::string_view _data, bool _isLines)
+  {
+    if ( ! _isLines )
+      return parse_one(_data.data(), _data.data() + _data.size(), m_root);
+    size_t pos = 0;
+    while ( pos < _data.size() )
+    {
+      size_t end = _data.find('\n', pos);
+      if ( end == std::string::npos )
+        end = _data.size();
+      if ( _data.find_first_not_of(" \t\r", pos) < end )
+        parse_one(_data.data() + pos, _data.data() + end, m_records.emplace_back());
+      pos = end + 1;
+    }
+  }
+
+  void write(std::string& _out) const
+  {
+    std::ostringstream out;
+    if ( m_records.empty() )
+      m_writer->write(m_root, &out);
+    for ( const Json::Value& jrec : m_records )
+    {
+      m_writer->write(jrec, &out);
+      out << '\n';
+    }
+    _out += out.str();
+  }
+};
+
+/**
+ * @struct number_library
+ * @brief Conversion of the numbers of an array of numbers by the json lexer, without building
+ *        a tree. With FULL_CHECK the value is computed during the scan that validates the number.
+ *        Without it the number is copied into a string and converted by sid::to_num. This is the
+ *        conversion the lexer used before, less the validation, so it is if anything faster.
+ */
+template <bool FULL_CHECK>
+struct number_library : protected json::lexer
+{
+  static constexpr const char* name = FULL_CHECK? "scan" : "to_num";
+  uint64_t m_bits = 0; //! Bits of the values, so that the conversions are used
+
+  number_library(uint32_t) {}
+
+  void parse(std::string_view _data, bool)
+  {
+    reset(_data.data(), _data.size());
+    m_containerStack.push(json::value_type::array);
+    REMOVE_LEADING_SPACES(m_p);
+    if ( at(m_p) != '[' )
+      throw sid::exception("--numbers needs an array of numbers");
+    number num;
+    do
+    {
+      ++m_p;
+      parse_number(num, FULL_CHECK);
+      m_bits ^= num.u64;
+    }
+    while ( at(m_p) == ',' );
+    if ( at(m_p) != ']' )
+      throw sid::exception("--numbers needs an array of numbers " + loc_str());
+  }
+
+  //! Nothing is serialized
+  void write(std::string&) const {}
+};
+
+/**
+ * @fn result run(const std::string& _name, std::string_view _data, bool _isLines,
+ *                uint32_t _iterations, uint32_t _threads);
+ * @brief Parse and serialize the input with the given library.
+ *        The library is created for every iteration, so that nothing is reused between them.
+ *        The allocations and the peak resident set size are those of the first iteration.
+ */
+template <typename LIB>
+result run(const std::string& _name, std::string_view _data, bool _isLines,
+           uint32_t _iterations, uint32_t _threads)
+{
+  result res;
+  res.caseName = _name;
+  res.library = LIB::name;
+  res.inputBytes = _data.size();
+  for ( uint32_t i = 0; i < _iterations; i++ )
+  {
+    const bool isFirst = ( i == 0 );
+    std::string out;
+    LIB lib(_threads);
+    if ( isFirst )
+    {
+      // Give the memory freed by the previous runs back to the system before the peak is reset
+      ::malloc_trim(0);
+      reset_peak_rss();
+    }
+    uint64_t allocs = allocCount.load(), bytes = allocBytes.load();
+    uint64_t start = now_ns();
+    lib.parse(_data, _isLines);
+    const uint64_t parseNs = now_ns() - start;
+    if ( isFirst )
+    {
+      res.parseAllocs = allocCount.load() - allocs;
+      res.parseAllocBytes = allocBytes.load() - bytes;
+    }
+
+    allocs = allocCount.load();
+    start = now_ns();
+    lib.write(out);
+    const uint64_t writeNs = now_ns() - start;
+    if ( isFirst )
+    {
+      res.writeAllocs = allocCount.load() - allocs;
+      res.outputBytes = out.size();
+      res.peakRssKb = status_kb("VmHWM");
+    }
+
+    if ( isFirst || parseNs < res.parseNs )
+      res.parseNs = parseNs;
+    if ( isFirst || writeNs < res.writeNs )
+      res.writeNs = writeNs;
+  }
+  return res;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Generators of the corpus. They are seeded with a constant so that every run has the same input.
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void append_double(std::string& _out, double _val)
+{
+  char buf[32];
+  _out.append(buf, std::to_chars(buf, buf + sizeof(buf), _val, std::chars_format::general).ptr);
+}
+
+//! Branches of 64 nested levels, alternating objects and arrays
+void gen_deep(std::string& _out, size_t _size)
+{
+  const int depth = 64;
+  _out = "[";
+  while ( _out.size() < _size )
+  {
+    if ( _out.size() > 1 )
+      _out += ',';
+    for ( int d = 0; d < depth; d++ )
+      _out += (d % 2)? "[" : ("{\"level\":" + sid::to_str(d) + ",\"child\":");
+    _out += "\"leaf\"";
+    for ( int d = depth - 1; d >= 0; d-- )
+      _out += (d % 2)? ']' : '}';
+  }
+  _out += ']';
+}
+
+//! Objects of 256 members of all the types
+void gen_wide(std::string& _out, size_t _size)
+{
+  std::mt19937_64 rng(1);
+  _out = "[";
+  while ( _out.size() < _size )
+  {
+    if ( _out.size() > 1 )
+      _out += ',';
+    _out += '{';
+    for ( int k = 0; k < 256; k++ )
+    {
+      if ( k > 0 )
+        _out += ',';
+      _out += "\"attribute_" + sid::to_str(k) + "\":";
+      switch ( k % 5 )
+      {
+      case 0: _out += sid::to_str(rng() % 100000); break;
+      case 1: _out += "\"value-" + sid::to_str(rng() % 1000) + "\""; break;
+      case 2: _out += (rng() & 1)? "true" : "false"; break;
+      case 3: _out += "null"; break;
+      default: append_double(_out, (rng() % 1000000) / 100.0); break;
+      }
+    }
+    _out += '}';
+  }
+  _out += ']';
+}
+
+//! Rows of integers and floating point numbers of all magnitudes
+void gen_numbers(std::string& _out, size_t _size)
+{
+  std::mt19937_64 rng(2);
+  std::uniform_real_distribution<double> mantissa(-1.0, 1.0);
+  std::uniform_int_distribution<int> exponent(-30, 30);
+  _out = "[";
+  while ( _out.size() < _size )
+  {
+    if ( _out.size() > 1 )
+      _out += ',';
+    _out += '[';
+    for ( int k = 0; k < 16; k++ )
+    {
+      if ( k > 0 )
+        _out += ',';
+      if ( k % 4 == 0 )
+        _out += sid::to_str(static_cast<int64_t>(rng()));
+      else if ( k % 4 == 1 )
+        _out += sid::to_str(rng() % 1000);
+      else
+        append_double(_out, mantissa(rng) * std::pow(10.0, exponent(rng)));
+    }
+    _out += ']';
+  }
+  _out += ']';
+}
+
+//! Array of the numbers given by _append, for the conversion of numbers (--numbers)
+void gen_number_array(std::string& _out, size_t _size, uint64_t _seed,
+                      const std::function<void(std::string&, std::mt19937_64&)>& _append)
+{
+  std::mt19937_64 rng(_seed);
+  _out = "[";
+  while ( _out.size() < _size )
+  {
+    if ( _out.size() > 1 )
+      _out += ',';
+    _append(_out, rng);
+  }
+  _out += ']';
+}
+
+//! Signed integers of all magnitudes and small unsigned integers
+void gen_integers(std::string& _out, size_t _size)
+{
+  gen_number_array(_out, _size, 10, [](std::string& _num, std::mt19937_64& _rng) {
+      _num += ( _rng() % 2 )? sid::to_str(static_cast<int64_t>(_rng())) : sid::to_str(_rng() % 1000);
+    });
+}
+
+//! Decimals with two digits of fraction, such as prices
+void gen_decimals(std::string& _out, size_t _size)
+{
+  gen_number_array(_out, _size, 11, [](std::string& _num, std::mt19937_64& _rng) {
+      append_double(_num, (_rng() % 10000000) / 100.0);
+    });
+}
+
+//! Doubles of up to 17 digits with exponents of -30 to 30
+void gen_doubles(std::string& _out, size_t _size)
+{
+  std::uniform_real_distribution<double> mantissa(-1.0, 1.0);
+  std::uniform_int_distribution<int> exponent(-30, 30);
+  gen_number_array(_out, _size, 12, [&](std::string& _num, std::mt19937_64& _rng) {
+      append_double(_num, mantissa(_rng) * std::pow(10.0, exponent(_rng)));
+    });
+}
+
+//! Doubles of up to 17 digits with exponents of -300 to 300, beyond the exact powers of 10
+void gen_exponents(std::string& _out, size_t _size)
+{
+  std::uniform_real_distribution<double> mantissa(-1.0, 1.0);
+  std::uniform_int_distribution<int> exponent(-300, 300);
+  gen_number_array(_out, _size, 13, [&](std::string& _num, std::mt19937_64& _rng) {
+      append_double(_num, mantissa(_rng) * std::pow(10.0, exponent(_rng)));
+    });
+}
+
+//! Text with escapes of all kinds, including unicode escapes and surrogate pairs
+void gen_strings(std::string& _out, size_t _size)
+{
+  static const char* words[] = {
+    "lorem", "ipsum", "\\\"quoted\\\"", "back\\\\slash", "line\\nbreak", "tab\\there",
+    "caf\\u00e9", "\\ud83d\\ude00", "path\\/to", "\\r\\n", "plain", "text"
+  };
+  const size_t count = sizeof(words) / sizeof(words[0]);
+  std::mt19937_64 rng(3);
+  _out = "[";
+  while ( _out.size() < _size )
+  {
+    if ( _out.size() > 1 )
+      _out += ',';
+    _out += "{\"id\":\"" + sid::to_str(rng() % 100000) + "\",\"text\":\"";
+    const size_t n = 4 + rng() % 60;
+    for ( size_t k = 0; k < n; k++ )
+    {
+      if ( k > 0 )
+        _out += ' ';
+      _out += words[rng() % count];
+    }
+    _out += "\"}";
+  }
+  _out += ']';
+}
+
+//! Json lines of log like records
+void gen_lines(std::string& _out, size_t _size)
+{
+  static const char* levels[] = { "debug", "info", "warning", "error" };
+  std::mt19937_64 rng(4);
+  _out.clear();
+  for ( uint64_t id = 1; _out.size() < _size; id++ )
+  {
+    _out += "{\"id\":" + sid::to_str(id) + ",\"level\":\"" + levels[rng() % 4]
+      + "\",\"host\":\"node-" + sid::to_str(rng() % 64) + "\",\"latency_ms\":";
+    append_double(_out, (rng() % 100000) / 1000.0);
+    _out += ",\"ok\":";
+    _out += (rng() % 10)? "true" : "false";
+    _out += ",\"tags\":[\"api\",\"v" + sid::to_str(rng() % 4) + "\"],\"request\":{\"method\":\"GET\","
+      "\"path\":\"/api/items/" + sid::to_str(rng() % 10000) + "\",\"bytes\":" + sid::to_str(rng() % 65536)
+      + "}}\n";
+  }
+}
+
+bool ends_with(const std::string& _str, const std::string& _suffix)
+{
+  return _str.length() >= _suffix.length()
+    && _str.compare(_str.length() - _suffix.length(), _suffix.length(), _suffix) == 0;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Output of the results
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+std::string fixed(double _val, int _precision = 1)
+{
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(_precision) << _val;
+  return out.str();
+}
+
+void show_text_header(const std::string& _label, uint32_t _iterations)
+{
+  cout << "json_bench" << (_label.empty()? "" : (" [" + _label + "]")) << ": best of "
+       << _iterations << " iteration(s), MB = 10^6 bytes" << endl;
+  cout << std::left << std::setw(16) << "case" << std::setw(9) << "library" << std::right
+       << std::setw(10) << "input MB" << std::setw(12) << "parse MB/s" << std::setw(12) << "write MB/s"
+       << std::setw(14) << "parse allocs" << std::setw(12) << "alloc MB" << std::setw(14) << "write allocs"
+       << std::setw(13) << "peak RSS MB" << endl;
+}
+
+void show_text(const std::vector<result>& _results)
+{
+  for ( const result& res : _results )
+  {
+    cout << std::left << std::setw(16) << res.caseName << std::setw(9) << res.library << std::right
+         << std::setw(10) << fixed(res.inputBytes / 1e6)
+         << std::setw(12) << fixed(res.parse_mbps())
+         << std::setw(12) << fixed(res.write_mbps())
+         << std::setw(14) << sid::get_sep(res.parseAllocs)
+         << std::setw(12) << fixed(res.parseAllocBytes / 1e6)
+         << std::setw(14) << sid::get_sep(res.writeAllocs)
+         << std::setw(13) << fixed(res.peakRssKb / 1e3) << endl;
+  }
+}
+
+void show_json(const std::vector<result>& _results, const std::string& _label, uint32_t _iterations)
+{
+  json::value jroot;
+  jroot["label"] = _label;
+  jroot["iterations"] = static_cast<uint64_t>(_iterations);
+  json::value& jresults = jroot["results"] = json::value(json::value_type::array);
+  for ( const result& res : _results )
+  {
+    json::value& jres = jresults.append();
+    jres["case"] = res.caseName;
+    jres["library"] = res.library;
+    jres["input_bytes"] = static_cast<uint64_t>(res.inputBytes);
+    jres["output_bytes"] = static_cast<uint64_t>(res.outputBytes);
+    jres["parse_ns"] = res.parseNs;
+    jres["write_ns"] = res.writeNs;
+    jres["parse_mbps"] = res.parse_mbps();
+    jres["write_mbps"] = res.write_mbps();
+    jres["parse_allocs"] = res.parseAllocs;
+    jres["parse_alloc_bytes"] = res.parseAllocBytes;
+    jres["write_allocs"] = res.writeAllocs;
+    jres["peak_rss_kb"] = res.peakRssKb;
+  }
+  cout << jroot.to_str(json::format_type::pretty) << endl;
+}
+
+void show_csv(const std::vector<result>& _results, const std::string& _label)
+{
+  cout << "label,case,library,input_bytes,output_bytes,parse_ns,write_ns,parse_mbps,write_mbps,"
+          "parse_allocs,parse_alloc_bytes,write_allocs,peak_rss_kb" << endl;
+  for ( const result& res : _results )
+    cout << _label << ',' << res.caseName << ',' << res.library << ',' << res.inputBytes << ','
+         << res.outputBytes << ',' << res.parseNs << ',' << res.writeNs << ','
+         << fixed(res.parse_mbps(), 2) << ',' << fixed(res.write_mbps(), 2) << ','
+         << res.parseAllocs << ',' << res.parseAllocBytes << ',' << res.writeAllocs << ','
+         << res.peakRssKb << endl;
+}
+} // namespace local
+
+int main(int argc, char* argv[])
+{
+  try
+  {
+    uint32_t iterations = 5;
+    uint32_t threads = 1;
+    size_t size = 8;
+    bool runSid = true, runJsoncpp = true, runNumbers = false;
+    std::string output = "text";
+    std::string label;
+    std::vector<local::item> files;
+
+    std::string param, key, value;
+    for ( int i = 1; i < argc; i++ )
+    {
+      param = argv[i];
+      if ( param.empty() || param[0] != '-' )
+      {
+        const bool isLines = local::ends_with(param, ".jsonl") || local::ends_with(param, ".ndjson");
+        files.push_back(local::item{param.substr(param.rfind('/') + 1), isLines, param, nullptr});
+        continue;
+      }
+      size_t pos = param.find('=');
+      key = param.substr(0, pos);
+      value = ( pos == std::string::npos )? std::string() : param.substr(pos+1);
+      if ( key == "--iterations" )
+      {
+        if ( ! sid::to_num(value, iterations) || iterations == 0 )
+          throw sid::exception("Invalid number of iterations: " + value);
+      }
+      else if ( key == "--size" )
+      {
+        if ( ! sid::to_num(value, size) )
+          throw sid::exception("Invalid size: " + value);
+      }
+      else if ( key == "--threads" )
+      {
+        if ( ! sid::to_num(value, threads) )
+          throw sid::exception("Invalid number of threads: " + value);
+      }
+      else if ( key == "--library" )
+      {
+        if ( value != "all" && value != "sid" && value != "jsoncpp" )
+          throw sid::exception("Invalid library. Use all|sid|jsoncpp");
+        runSid = ( value != "jsoncpp" );
+        runJsoncpp = ( value != "sid" );
+      }
+      else if ( key == "--output" )
+      {
+        if ( value != "text" && value != "json" && value != "csv" )
+          throw sid::exception("Invalid output. Use text|json|csv");
+        output = value;
+      }
+      else if ( key == "--label" )
+        label = value;
+      else if ( key == "--numbers" )
+        runNumbers = true;
+      else if ( key == "--help" )
+      {
+        cout << "Usage: " << argv[0] << " [<file>...] [--iterations=N] [--size=MB] [--threads=N] [--numbers]"
+             << " [--library=all|sid|jsoncpp] [--output=text|json|csv] [--label=NAME]" << endl
+             << "  --size is the size of the generated cases (0 runs the files only)" << endl
+             << "  --threads is the number of threads of json::parse_lines() for json lines" << endl
+             << "  --numbers compares the conversion of numbers during the scan (scan) with the" << endl
+             << "    conversion through sid::to_num (to_num), on arrays of numbers" << endl;
+        return 0;
+      }
+      else
+        throw sid::exception("Invalid key: " + key);
+    }
+
+    std::vector<local::item> corpus;
+    if ( size > 0 && runNumbers )
+    {
+      corpus.push_back(local::item{"integers", false, "", local::gen_integers});
+      corpus.push_back(local::item{"decimals", false, "", local::gen_decimals});
+      corpus.push_back(local::item{"doubles", false, "", local::gen_doubles});
+      corpus.push_back(local::item{"exponents", false, "", local::gen_exponents});
+    }
+    else if ( size > 0 )
+    {
+      corpus.push_back(local::item{"deep", false, "", local::gen_deep});
+      corpus.push_back(local::item{"wide", false, "", local::gen_wide});
+      corpus.push_back(local::item{"numbers", false, "", local::gen_numbers});
+      corpus.push_back(local::item{"strings", false, "", local::gen_strings});
+      corpus.push_back(local::item{"lines", true, "", local::gen_lines});
+    }
+    corpus.insert(corpus.end(), files.begin(), files.end());
+
+    std::vector<local::result> results;
+    if ( output == "text" )
+      local::show_text_header(label, iterations);
+    for ( const local::item& item : corpus )
+    {
+      std::string text;
+      sid::util::mapped_file file;
+      std::string_view data;
+      if ( item.path.empty() )
+      {
+        item.generate(text, size * 1000000);
+        data = text;
+      }
+      else
+      {
+        file.open(item.path);
+        data = file.view();
+      }
+      if ( runNumbers )
+      {
+        results.push_back(local::run<local::number_library<false>>(item.name, data, item.isLines, iterations, threads));
+        results.push_back(local::run<local::number_library<true>>(item.name, data, item.isLines, iterations, threads));
+      }
+      else if ( runSid )
+        results.push_back(local::run<local::sid_library>(item.name, data, item.isLines, iterations, threads));
+      if ( runJsoncpp && ! runNumbers )
+        results.push_back(local::run<local::jsoncpp_library>(item.name, data, item.isLines, iterations, threads));
+      if ( output == "text" )
+      {
+        // Show the results as they come, as the whole corpus takes a while
+        local::show_text(results);
+        results.clear();
+      }
+    }
+
+    if ( output == "json" )
+      local::show_json(results, label, iterations);
+    else if ( output == "csv" )
+      local::show_csv(results, label);
+  }
+  catch (const std::exception& e)
+  {
+    cerr << e.what() << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -48,6 +48,7 @@ LICENSE: END
 #include <utility>
 #include <cmath>
 #include <limits>
+#include <charconv>
 
 // curses and terminal IO includes
 #include <fcntl.h>
@@ -117,11 +118,86 @@ bool sid::to_num<long double>(const std::string& _csVal, /*out*/ long double& _o
   return to_num<long double>(_csVal.c_str(), _outVal, _pcsError);
 }
 
+namespace local
+{
+//! Largest decimal exponent written in fixed notation, as the earlier 18-digit format did
+constexpr int max_fixed_exponent = 17;
+//! Smallest decimal exponent written in fixed notation
+constexpr int min_fixed_exponent = -4;
+
+template <typename T>
+char* float_to_chars(char* _first, T _number)
+{
+  // The shortest digits are produced in scientific notation, which gives the exponent
+  char sci[sid::float_chars_max];
+  char* end = std::to_chars(sci, sci + sizeof(sci), _number, std::chars_format::scientific).ptr;
+  char* e = std::find(sci, end, 'e');
+  int exponent = 0;
+  if ( e != end )
+    std::from_chars(e + (e[1] == '+'? 2 : 1), end, exponent);
+  if ( e == end || exponent < min_fixed_exponent || exponent > max_fixed_exponent )
+    return std::copy(sci, end, _first);
+
+  const char* p = sci;
+  char* out = _first;
+  if ( *p == '-' )
+    *out++ = *p++;
+  char digits[sid::float_chars_max];
+  size_t count = 0;
+  for ( ; p != e; p++ )
+    if ( *p != '.' )
+      digits[count++] = *p;
+  if ( exponent < 0 )
+  {
+    *out++ = '0';
+    *out++ = '.';
+    out = std::fill_n(out, -exponent - 1, '0');
+    return std::copy(digits, digits + count, out);
+  }
+  const size_t intLen = static_cast<size_t>(exponent) + 1;
+  out = std::copy(digits, digits + std::min(count, intLen), out);
+  if ( count <= intLen )
+    return std::fill_n(out, intLen - count, '0');
+  *out++ = '.';
+  return std::copy(digits + intLen, digits + count, out);
+}
+
+template <typename T>
+std::string float_to_str(T _number)
+{
+  char buf[sid::float_chars_max];
+  return std::string(buf, float_to_chars(buf, _number));
+}
+}
+
+std::string sid::to_str(const float& _number)
+{
+  return local::float_to_str(_number);
+}
+
+std::string sid::to_str(const double& _number)
+{
+  return local::float_to_str(_number);
+}
+
 std::string sid::to_str(const long double& _number)
 {
-  std::ostringstream out;
-  out << std::setprecision(std::numeric_limits<long double>::digits10) << _number;
-  return out.str();
+  return local::float_to_str(_number);
+}
+
+char* sid::float_to_chars(char* _first, float _number)
+{
+  return local::float_to_chars(_first, _number);
+}
+
+char* sid::float_to_chars(char* _first, double _number)
+{
+  return local::float_to_chars(_first, _number);
+}
+
+char* sid::float_to_chars(char* _first, long double _number)
+{
+  return local::float_to_chars(_first, _number);
 }
 
 int sid::is_binary(int c) { return (c == '0' || c == '1')? 1 : 0; }
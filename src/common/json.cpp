@@ -37,9 +37,20 @@ LICENSE: END
  * @brief Implementation of json parser and handler
  */
 #include <common/json.hpp>
+#include <common/json_bind.hpp>
 #include <common/convert.hpp>
 #include <common/opt.hpp>
+#include <common/util.hpp>
+#include "json_lexer.h"
+#include "json_projection.h"
+#include "json_serializer.h"
+#include "json_validator.h"
+#include <cstring>
+#include <cmath>
+#include <atomic>
+#include <charconv>
 #include <fstream>
+#include <functional>
 #include <stack>
 #include <iomanip>
 #include <ctime>
@@ -50,69 +61,117 @@ using namespace sid::json;
 
 //#define REMOVE_LEADING_SPACES(p)  for (; ::isspace(*p) && *p != '\0'; p++ );
 
-static uint64_t gobjects_alloc = 0;
+//! Objects allocated by the calling thread. Per thread, as trees are built in parallel.
+static thread_local uint64_t gobjects_alloc = 0;
+//! Blocks allocated from the heap for the json trees of the thread (see parser_stats)
+static thread_local uint64_t galloc_count = 0;
+static thread_local uint64_t galloc_bytes = 0;
 
 namespace sid {
 namespace json {
 
 /**
  * @struct parser
- * @brief Internal json parser
+ * @brief Internal json parser. Builds the json tree from the tokens of the lexer.
  */
-struct parser
+struct parser : public lexer
 {
-  value&         m_jroot;  //! value output object
-  parser_stats&  m_stats;  //! statistics object
-  parser_control m_ctrl;   //! Parser control flags
-  std::string    m_input;  //! The Json string to be parsed
-  schema*        m_schema; //! Optional schema to validate against
-  std::stack<value_type> m_containerStack; //! Container stack
+  using node = validator::node;
+
+  value&           m_jroot;     //! value output object
+  parser_stats&    m_stats;     //! statistics object
+  const validator* m_validator; //! Optional schema to validate against
+  const projection::node* m_projection; //! Optional paths to convert, skipping the rest
+  std::pmr::memory_resource* m_resource; //! Memory resource for the nodes of the json tree
 
   //! constructor
   parser(value& _jout, parser_stats& _stats)
-    : m_jroot(_jout), m_stats(_stats), m_ctrl(), m_input(), m_schema(nullptr) {
+    : m_jroot(_jout), m_stats(_stats), m_validator(nullptr), m_projection(nullptr),
+      m_resource(value::p_resource()), m_sample(0x9E3779B9), m_clockCost(0) {
+  }
+  //! The parser drops its references to the interned keys
+  ~parser() {
+    for ( auto& key : m_keys )
+      value::p_release(key.second);
   }
 
-  //! parse the string and convert it to json object
-  bool parse(const std::string& _value);
+  //! parse the character sequence in place and convert it to json object
+  bool parse(const char* _data, size_t _len);
 
 private:
-  struct line_info
-  {
-    const char* begin; //! Beginning of word position
-    uint64_t    count; //! Current line number
-  };
   //! Key value for object. It is reused in recursion.
   std::string m_key;
-  const char* m_p;
-  line_info   m_line;
-
-  //! get the current location of paring in the string
-  std::string loc_str(const line_info& line, const char* p) const {
-    return std::string("@line:") + sid::to_str(line.count) + ", @pos:" + sid::to_str(p-line.begin+1);
-  }
-  std::string loc_str(const line_info& line) const { return loc_str(line, m_p); }
-  std::string loc_str(const char* p) const { return loc_str(m_line, p); }
-  std::string loc_str() const { return loc_str(m_line, m_p); }
-
-  //! parse object
-  void parse_object(value& _jobj);
+  //! String value buffer. It is reused in recursion.
+  std::string m_str;
+  //! One phase in phase_sampling is timed
+  static constexpr uint32_t phase_sampling = 32;
+  //! State of the xorshift generator that picks the phases to time
+  uint32_t m_sample;
+  //! clock_cost(), when the phases are timed
+  uint64_t m_clockCost;
+  //! Keys interned in this parse (see parser_control::internKeys). Each holds a reference.
+  std::unordered_map<std::string_view, value::long_string*> m_keys;
+  //! Index of the tokens, for the strict grammar
+  simd::structural_index m_structural;
+
+  //! The interned copy of the key, which is added on its first use
+  value::long_string* intern_key(std::string_view _key);
+
+  //! parse object. The values are validated with the checks of the node, if any.
+  void parse_object(value& _jobj, const node* _node = nullptr);
   //! parse array
-  void parse_array(value& _jarr);
-  //! parse key
-  void parse_key(std::string& _str);
+  void parse_array(value& _jarr, const node* _node = nullptr);
+  //! parse key. The key is in m_key, or in the input if it has no escape sequence.
+  std::string_view parse_key();
   //! parse string
-  void parse_string(std::string& _str, bool _isKey);
-  void parse_string(value& _jstr, bool _isKey);
+  using lexer::parse_string;
+  void parse_string(value& _jstr, bool _isKey, const node* _node = nullptr);
   //! parser number
   void parse_number(value& _jnum, bool bFullCheck);
   //! parse json value
-  void parse_value(value& _jval);
-
-  //! check for space character
-  bool is_space(const char* _p);
-  //! remove leading spaces and comments
-  void REMOVE_LEADING_SPACES(const char*& _p);
+  void parse_value(value& _jval, const node* _node = nullptr);
+  //! parse the object or the array with the paths of the projection, skipping the other members
+  void parse_object(value& _jobj, const projection::node* _proj);
+  void parse_array(value& _jarr, const projection::node* _proj);
+  //! parse the value of a member on the paths of the projection
+  void parse_value(value& _jval, const projection::node* _proj);
+  //! Whether the value at the current position is kept with the paths below it
+  bool is_projected(const projection::node* _proj) const {
+    return ( _proj != nullptr ) && ( _proj->whole || at(m_p) == '{' || at(m_p) == '[' );
+  }
+  //! Element added to the value of a duplicate key (see parser_control::dup_key::append)
+  value& append_duplicate(value& _jexisting);
+  //! Start of a phase of the parse, or 0 if it is not timed. With parser_control::timePhases,
+  //! one phase in phase_sampling is timed, picked at random, as reading the clock costs more
+  //! than most phases.
+  uint64_t phase_start() {
+    if ( ! m_ctrl.timePhases )
+      return 0;
+    m_sample ^= m_sample << 13;
+    m_sample ^= m_sample >> 17;
+    m_sample ^= m_sample << 5;
+    return ( (m_sample % phase_sampling) == 0 )? now_ns() : 0;
+  }
+  //! Add the time since the start of a timed phase to its statistics, scaled to all the phases.
+  //! The time it takes to read the clock is not counted.
+  void phase_end(uint64_t& _phaseNs, uint64_t _start) const {
+    if ( _start == 0 )
+      return;
+    const uint64_t elapsed = now_ns() - _start;
+    if ( elapsed > m_clockCost )
+      _phaseNs += (elapsed - m_clockCost) * phase_sampling;
+  }
+  //! Time it takes to read the clock
+  static uint64_t clock_cost();
+  //! Set the statistics that are collected at the end of the parse
+  void finish_stats(uint64_t _start, uint64_t _allocations, uint64_t _allocBytes);
+  //! throw the schema violation returned by a check of the node, if any
+  void check(const node* _node, const std::string& _error) const
+  {
+    if ( ! _error.empty() )
+      throw sid::exception("Schema violation at " + (_node->name.empty()? "root" : _node->name)
+                           + ": " + _error + " " + loc_str());
+  }
 };
 
 } // namespace json
@@ -126,7 +185,7 @@ private:
 /**
  * @fn bool parse(value&                _jout,
  *                parser_stats&         _stats,
- *                const std::string&    _value,
+ *                std::string_view      _value,
  *                const schema&         _schema,
  *                const parser_control& _ctrl = parser_control()
  *               );
@@ -141,7 +200,7 @@ private:
 /*static*/
 bool value::parse(
   value&                _jout,
-  const std::string&    _value,
+  std::string_view      _value,
   const parser_control& _ctrl /*= parser_control()*/
   )
 {
@@ -152,102 +211,262 @@ bool value::parse(
 /*static*/
 bool value::parse(
   value&                _jout,
-  const std::string&    _value,
+  std::string_view      _value,
   const schema&         _schema,
   const parser_control& _ctrl /*= parser_control()*/
   )
 {
   parser_stats stats;
-  //jparser.m_schema = &_schema;
-  return value::parse(_jout, stats, _value, _ctrl);
+  return value::parse(_jout, stats, _value, validator(_schema), _ctrl);
+}
+
+bool value::parse(
+  value&                _jout,
+  parser_stats&         _stats,
+  std::string_view      _value,
+  const parser_control& _ctrl /*= parser_control()*/
+  )
+{
+  return value::parse(_jout, _stats, _value.data(), _value.length(), _ctrl);
+}
+
+bool value::parse(
+  value&                _jout,
+  parser_stats&         _stats,
+  std::string_view      _value,
+  const schema&         _schema,
+  const parser_control& _ctrl /*= parser_control()*/
+  )
+{
+  return value::parse(_jout, _stats, _value, validator(_schema), _ctrl);
 }
 
+/*static*/
+bool value::parse(
+  value&                _jout,
+  std::string_view      _value,
+  const validator&      _validator,
+  const parser_control& _ctrl /*= parser_control()*/
+  )
+{
+  parser_stats stats;
+  return value::parse(_jout, stats, _value, _validator, _ctrl);
+}
+
+/*static*/
 bool value::parse(
   value&                _jout,
   parser_stats&         _stats,
-  const std::string&    _value,
+  std::string_view      _value,
+  const validator&      _validator,
   const parser_control& _ctrl /*= parser_control()*/
   )
 {
   parser jparser(_jout, _stats);
+  jparser.m_validator = &_validator;
   jparser.m_ctrl = _ctrl;
-  return jparser.parse(_value);
+  return jparser.parse(_value.data(), _value.length());
+}
+
+/*static*/
+bool value::parse(
+  value&                _jout,
+  std::string_view      _value,
+  const projection&     _projection,
+  const parser_control& _ctrl /*= parser_control()*/
+  )
+{
+  parser_stats stats;
+  return value::parse(_jout, stats, _value, _projection, _ctrl);
 }
 
+/*static*/
 bool value::parse(
   value&                _jout,
   parser_stats&         _stats,
-  const std::string&    _value,
-  const schema&         _schema,
+  std::string_view      _value,
+  const projection&     _projection,
+  const parser_control& _ctrl /*= parser_control()*/
+  )
+{
+  parser jparser(_jout, _stats);
+  // A path to the root keeps the whole document
+  if ( ! _projection.root().whole )
+    jparser.m_projection = &_projection.root();
+  jparser.m_ctrl = _ctrl;
+  return jparser.parse(_value.data(), _value.length());
+}
+
+/*static*/
+bool value::parse(
+  value&                _jout,
+  const char*           _data,
+  size_t                _len,
+  const parser_control& _ctrl /*= parser_control()*/
+  )
+{
+  parser_stats stats;
+  return value::parse(_jout, stats, _data, _len, _ctrl);
+}
+
+/*static*/
+bool value::parse(
+  value&                _jout,
+  parser_stats&         _stats,
+  const char*           _data,
+  size_t                _len,
   const parser_control& _ctrl /*= parser_control()*/
   )
 {
   parser jparser(_jout, _stats);
-  //jparser.m_schema = &_schema;
   jparser.m_ctrl = _ctrl;
-  return jparser.parse(_value);
+  return jparser.parse(_data, _len);
+}
+
+/*static*/
+bool value::parse_file(
+  value&                _jout,
+  const std::string&    _filePath,
+  const parser_control& _ctrl /*= parser_control()*/
+  )
+{
+  parser_stats stats;
+  return value::parse_file(_jout, stats, _filePath, _ctrl);
+}
+
+/*static*/
+bool value::parse_file(
+  value&                _jout,
+  parser_stats&         _stats,
+  const std::string&    _filePath,
+  const parser_control& _ctrl /*= parser_control()*/
+  )
+{
+  // The mapping is parsed in place and released once the json object is built
+  util::mapped_file file(_filePath);
+  return value::parse(_jout, _stats, file.data(), file.size(), _ctrl);
+}
+
+/**
+ * @class heap_resource
+ * @brief Memory resource on top of the global operator new and delete.
+ *        std::pmr::new_delete_resource() of libstdc++ always uses the aligned operator new,
+ *        which is much slower than the plain one for the small blocks of a json tree.
+ */
+class heap_resource : public std::pmr::memory_resource
+{
+  void* do_allocate(size_t _bytes, size_t _alignment) override
+  {
+    ++galloc_count;
+    galloc_bytes += _bytes;
+    if ( _alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__ )
+      return ::operator new(_bytes);
+    return ::operator new(_bytes, std::align_val_t(_alignment));
+  }
+  void do_deallocate(void* _p, size_t _bytes, size_t _alignment) override
+  {
+    if ( _alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__ )
+      ::operator delete(_p, _bytes);
+    else
+      ::operator delete(_p, _bytes, std::align_val_t(_alignment));
+  }
+  bool do_is_equal(const std::pmr::memory_resource& _other) const noexcept override
+  {
+    return ( this == &_other );
+  }
+};
+
+/*static*/
+std::pmr::memory_resource* value::p_resource()
+{
+  // Honour the default resource if it was changed by the application
+  static heap_resource s_heap;
+  std::pmr::memory_resource* resource = std::pmr::get_default_resource();
+  return ( resource == std::pmr::new_delete_resource() )? &s_heap : resource;
 }
 
 void value::p_set(const value_type _type/* = value_type::null*/)
 {
-  m_type = m_data.init(_type);
+  this->clear();
+  p_init(_type);
+}
+
+void value::p_set(const value_type _type, std::pmr::memory_resource* _resource)
+{
+  this->clear();
+  p_init(_type, _resource);
+}
+
+void value::p_set(std::string_view _val, std::pmr::memory_resource* _resource)
+{
+  this->clear();
+  p_init(_val, _resource);
 }
 
 value::value(const value_type _type/* = value_type::null*/)
 {
-  m_type = m_data.init(_type);
+  p_init(_type);
 }
 
 value::value(const value& _obj)
 {
-  m_type = m_data.init(_obj.m_data, true, _obj.m_type);
+  p_init(_obj);
 }
 
 // Move constructor
 value::value(value&& _obj) noexcept
 {
-  m_type = m_data.init(std::move(_obj.m_data), _obj.m_type);
-  _obj.m_type = value_type::null;
+  p_take(_obj);
 }
 
 value::value(const int64_t _val)
 {
-  m_type = m_data.init(_val);
+  m_type = value_type::_signed;
+  m_data._i64 = _val;
 }
 
 value::value(const uint64_t _val)
 {
-  m_type = m_data.init(_val);
+  m_type = value_type::_unsigned;
+  m_data._u64 = _val;
 }
 
 value::value(const double _val)
 {
-  m_type = m_data.init(static_cast<long double>(_val));
+  p_init(_val);
 }
 
 value::value(const long double _val)
 {
-  m_type = m_data.init(_val);
+  p_init(_val, p_resource());
 }
 
 value::value(const bool _val)
 {
-  m_type = m_data.init(_val);
+  m_type = value_type::boolean;
+  m_data._bval = _val;
 }
 
 value::value(const std::string& _val)
 {
-  m_type = m_data.init(_val);
+  p_init(std::string_view(_val));
+}
+
+value::value(std::string_view _val)
+{
+  p_init(_val);
 }
 
 value::value(const char* _val)
 {
-  m_type = m_data.init(_val);
+  if ( _val != nullptr )
+    p_init(std::string_view(_val));
+  else
+    p_init(value_type::null);
 }
 
-value::value(const int _val)
+value::value(const int _val) : value(static_cast<int64_t>(_val))
 {
-  m_type = m_data.init(_val);
 }
 
 value::~value()
@@ -257,59 +476,116 @@ value::~value()
 
 void value::clear()
 {
-  m_type = m_data.clear(m_type);
+  switch ( m_type )
+  {
+  case value_type::string:
+    if ( m_length == long_length )
+    {
+      // The string is given back to the memory resource it was allocated from
+      long_string* str = m_data._str;
+      str->resource->deallocate(str, sizeof(long_string) + str->length, alignof(long_string));
+    }
+    else if ( m_length == interned_length )
+      p_release(m_data._str);
+    break;
+  case value_type::_double:
+    if ( m_length == long_length )
+    {
+      long_number* num = m_data._ldbl;
+      num->resource->deallocate(num, sizeof(long_number), alignof(long_number));
+    }
+    break;
+  case value_type::array:
+  {
+    std::pmr::memory_resource* resource = m_data._arr->get_allocator().resource();
+    m_data._arr->~array();
+    resource->deallocate(m_data._arr, sizeof(array), alignof(array));
+  }
+  break;
+  case value_type::object:
+  {
+    std::pmr::memory_resource* resource = m_data._map->resource();
+    m_data._map->~object();
+    resource->deallocate(m_data._map, sizeof(object), alignof(object));
+  }
+  break;
+  default: break;
+  }
+  m_type = value_type::null;
 }
 
 value& value::operator=(const value& _obj)
 {
-#if defined(SID_JSON_MAP_OPTIMIZE_FOR_SIZE)
-  const bool is_new = ( m_type != _obj.m_type || m_type != value_type::object );
-#else
-  const bool is_new = true;
-#endif
-  if ( is_new )
+  // The copy is made before clearing, as _obj can be a part of this value
+  value jcopy(_obj);
+  this->clear();
+  p_take(jcopy);
+  return *this;
+}
+
+value& value::operator=(value&& _obj) noexcept
+{
+  if ( this != &_obj )
+  {
+    // Taken before clearing, as _obj can be a part of this value
+    value jtaken(std::move(_obj));
     this->clear();
-  m_type = m_data.init(_obj.m_data, is_new, _obj.m_type);
+    p_take(jtaken);
+  }
   return *this;
 }
 
 value& value::operator=(const int64_t _val)
 {
   this->clear();
-  m_type = m_data.init(_val);
+  m_type = value_type::_signed;
+  m_data._i64 = _val;
   return *this;
 }
 
 value& value::operator=(const uint64_t _val)
 {
   this->clear();
-  m_type = m_data.init(_val);
+  m_type = value_type::_unsigned;
+  m_data._u64 = _val;
   return *this;
 }
 
 value& value::operator=(const double _val)
 {
-  return operator=(static_cast<long double>(_val));
+  this->clear();
+  p_init(_val);
+  return *this;
 }
 
 value& value::operator=(const long double _val)
 {
   this->clear();
-  m_type = m_data.init(_val);
+  p_init(_val, p_resource());
   return *this;
 }
 
 value& value::operator=(const bool _val)
 {
   this->clear();
-  m_type = m_data.init(_val);
+  m_type = value_type::boolean;
+  m_data._bval = _val;
   return *this;
 }
 
 value& value::operator=(const std::string& _val)
 {
   this->clear();
-  m_type = m_data.init(_val);
+  p_init(std::string_view(_val));
+  return *this;
+}
+
+value& value::operator=(std::string_view _val)
+{
+  // The string is copied before clearing, as it can be the string of this value
+  value jstr(_val);
+  this->clear();
+  p_take(jstr);
   return *this;
 }
 
@@ -317,9 +593,9 @@ value& value::operator=(const char* _val)
 {
   this->clear();
   if ( _val != nullptr )
-    m_type = m_data.init(std::string(_val));
+    p_init(std::string_view(_val));
   else
-    m_type = m_data.init(value_type::null);
+    p_init(value_type::null);
   return *this;
 }
 
@@ -332,28 +608,51 @@ bool value::has_index(const size_t _index) const
 {
   if ( ! is_array() )
     throw sid::exception(__func__ + std::string("() can be used only for array type"));
-  return ( _index < m_data._arr.size() );
+  return ( _index < m_data._arr->size() );
 }
 
-bool value::has_key(const std::string& _key) const
+bool value::has_key(std::string_view _key) const
 {
-  value jval;
-  return has_key(_key, jval);
+  return ( find(_key) != nullptr );
+}
+
+bool value::has_key(std::string_view _key, value& _obj) const
+{
+  const value* pval = find(_key);
+  if ( pval == nullptr )
+    return false;
+  _obj = *pval;
+  return true;
 }
 
-bool value::has_key(const std::string& _key, value& _obj) const
+const value* value::find(std::string_view _key) const
 {
   if ( ! is_object() )
-    throw sid::exception(__func__ + std::string("() can be used only for object type. ") + _key);
-  for ( const auto& entry : m_data.map() )
-  {
-    if ( entry.first == _key )
-    {
-      _obj = entry.second;
-      return true;
-    }
-  }
-  return false;
+    throw sid::exception(__func__ + std::string("() can be used only for object type. ")
+                         + std::string(_key));
+  return m_data._map->find(_key);
+}
+
+value* value::find(std::string_view _key)
+{
+  if ( ! is_object() )
+    throw sid::exception(__func__ + std::string("() can be used only for object type. ")
+                         + std::string(_key));
+  return m_data._map->find(_key);
+}
+
+const value* value::get_ptr(const size_t _index) const
+{
+  if ( ! is_array() )
+    throw sid::exception(__func__ + std::string("() can be used only for array type"));
+  return ( _index < m_data._arr->size() )? &(*m_data._arr)[_index] : nullptr;
+}
+
+value* value::get_ptr(const size_t _index)
+{
+  if ( ! is_array() )
+    throw sid::exception(__func__ + std::string("() can be used only for array type"));
+  return ( _index < m_data._arr->size() )? &(*m_data._arr)[_index] : nullptr;
 }
 
 std::vector<std::string> value::get_keys() const
@@ -361,38 +660,61 @@ std::vector<std::string> value::get_keys() const
   if ( ! is_object() )
     throw sid::exception(__func__ + std::string("() can be used only for object type"));
   std::vector<std::string> keys;
-  for ( const auto& entry : m_data.map() )
-    keys.push_back(entry.first);
+  for ( const auto& entry : *m_data._map )
+    keys.emplace_back(entry.first.p_str());
   return keys;
 }
 
 size_t value::size() const
 {
   if ( is_array() )
-    return m_data._arr.size();
+    return m_data._arr->size();
   else if ( is_object() )
-    return m_data.map().size();
+    return m_data._map->size();
   throw sid::exception(__func__ + std::string("() can be used only for array and object types"));
 }
 
 int64_t value::get_int64() const
 {
-  if ( is_num() )
+  if ( is_signed() )
     return m_data._i64;
+  else if ( is_unsigned() )
+    return static_cast<int64_t>(m_data._u64);
+  else if ( is_double() )
+    return static_cast<int64_t>(p_double());
   throw sid::exception(__func__ + std::string("() can be used only for number type"));
 }
 
 uint64_t value::get_uint64() const
 {
-  if ( is_num() )
+  if ( is_unsigned() )
     return m_data._u64;
+  else if ( is_signed() )
+    return static_cast<uint64_t>(m_data._i64);
+  else if ( is_double() )
+    return static_cast<uint64_t>(p_double());
+  throw sid::exception(__func__ + std::string("() can be used only for number type"));
+}
+
+float_type value::get_double() const
+{
+  if ( is_double() )
+    return p_double();
+  else if ( is_signed() )
+    return static_cast<float_type>(m_data._i64);
+  else if ( is_unsigned() )
+    return static_cast<float_type>(m_data._u64);
   throw sid::exception(__func__ + std::string("() can be used only for number type"));
 }
 
-long double value::get_double() const
+long double value::get_long_double() const
 {
-  if ( is_num() )
-    return m_data._dbl;
+  if ( is_double() )
+    return p_long_double();
+  else if ( is_signed() )
+    return static_cast<long double>(m_data._i64);
+  else if ( is_unsigned() )
+    return static_cast<long double>(m_data._u64);
   throw sid::exception(__func__ + std::string("() can be used only for number type"));
 }
 
@@ -406,20 +728,24 @@ bool value::get_bool() const
 std::string value::get_str() const
 {
   if ( is_string() )
-    return m_data._str;
+    return std::string(p_str());
   throw sid::exception(__func__ + std::string("() can be used only for string type"));
 }
 
 std::string value::as_str() const
 {
   if ( is_string() )
-    return m_data._str;
+    return std::string(p_str());
   else if ( is_bool() )
     return sid::to_str(m_data._bval);
-  else if ( is_signed() )
-    return sid::to_str(m_data._i64);
+  // The numbers are formatted the way the serializer writes them
+  char buf[32];
+  if ( is_signed() )
+    return std::string(buf, std::to_chars(buf, buf + sizeof(buf), m_data._i64).ptr);
   else if ( is_unsigned() )
-    return sid::to_str(m_data._u64);
+    return std::string(buf, std::to_chars(buf, buf + sizeof(buf), m_data._u64).ptr);
+  else if ( is_long_double() )
+    return sid::to_str(m_data._ldbl->value);
   else if ( is_double() )
     return sid::to_str(m_data._dbl);
   throw sid::exception(
@@ -445,30 +771,46 @@ int value::get_value(std::string& _val) const
 //! Convert json to string using the given format type
 std::string value::to_str(const format_type _type/* = format_type::compact*/) const
 {
-  std::ostringstream out;
+  std::string out;
   this->write(out, _type);
-  return out.str();
+  return out;
 }
 
 //! Convert json to string using the given format
 std::string value::to_str(const format& _format) const
 {
-  std::ostringstream out;
+  std::string out;
   this->write(out, _format);
-  return out.str();
+  return out;
 }
 
 //! Write json to the given output stream
 void value::write(std::ostream& _out, const format_type _type/* = format_type::compact*/) const
+{
+  std::string out;
+  this->write(out, _type);
+  _out.write(out.data(), out.length());
+}
+
+//! Write json to the given output stream using pretty format
+void value::write(std::ostream& _out, const format& _format) const
+{
+  std::string out;
+  this->write(out, _format);
+  _out.write(out.data(), out.length());
+}
+
+//! Append json to the given buffer
+void value::write(std::string& _out, const format_type _type/* = format_type::compact*/) const
 {
   if ( ! is_object() && ! is_array() )
     throw sid::exception("Can be applied only on a object or array");
 
-  this->p_write(_out, format(_type), 0);
+  serializer(_out, format(_type)).write(*this, 0);
 }
 
-//! Write json to the given output stream using pretty format
-void value::write(std::ostream& _out, const format& _format) const
+//! Append json to the given buffer using the given format
+void value::write(std::string& _out, const format& _format) const
 {
   if ( ! is_object() && ! is_array() )
     throw sid::exception("Can be applied only on a object or array");
@@ -477,193 +819,314 @@ void value::write(std::ostream& _out, const format& _format) const
     throw sid::exception("Format separator must be a valid space character. It cannot be \""
                          + std::string(1, _format.separator) + "\"");
 
-  this->p_write(_out, _format, 0);
+  serializer(_out, _format).write(*this, 0);
 }
 
-void value::p_write(std::ostream& _out, const format& _format, uint32_t _level) const
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Implementation of serializer
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void serializer::write(const value& _jval, uint32_t _level)
 {
-  auto escape_string =[&](const std::string& _input)->std::string
-    {
-      std::string output;
-      for ( size_t i = 0; i < _input.length(); i++ )
-      {
-        char ch = _input[i];
-        switch ( ch )
-        {
-          //case '/':
-          //output += '\\';
-          //output += ch;
-          //break;
-        case '\b':
-          output += "\\b";
-          break;
-        case '\f':
-          output += "\\f";
-          break;
-        case '\n':
-          output += "\\n";
-          break;
-        case '\r':
-          output += "\\r";
-          break;
-        case '\t':
-          output += "\\t";
-          break;
-        case '\\':
-	  if ( _input[i+1] != 'u' || _format.string_no_quotes )
-	    output += '\\';
-          output += ch;
-          break;
-        case '\"': // Quotation mark
-          output += '\\';
-          output += ch;
-          break;
-          /*
-            case '\u':
-            output += "\\u";
-            break;
-          */
-        default:
-	  if ( ch == ',' && _format.string_no_quotes )
-	    output += "\\u002c";
-	  else
-	    output += ch;
-          break;
-        }
-      }
-      return output;
-    };
-
-  std::string padding;
-  const char* final_padding = padding.c_str();;
-  if ( _format.type == format_type::pretty && _format.separator != '\0' )
+  switch ( _jval.type() )
   {
-    padding = std::string((_level+1) * _format.indent, _format.separator);
-    final_padding = (padding.c_str() + _format.indent);
-  }
-
-  if ( is_object() )
+  case value_type::object:
   {
-    _out << "{";
+    put('{');
     bool isFirst = true;
-    for ( const auto& entry : m_data.map() )
+    for ( const auto& entry : *_jval.m_data._map )
     {
-      if ( ! isFirst )
-      {
-        _out << ",";
-        if ( _format.type == format_type::pretty )
-          _out << endl;
-      }
-      else if ( _format.type == format_type::pretty )
-        _out << endl;
+      begin_entry(isFirst, _level+1);
       isFirst = false;
-      if ( _format.type == format_type::compact )
-      {
-        if ( ! _format.key_no_quotes )
-          _out << "\"" << entry.first << "\":";
-        else
-          _out << entry.first << ":";
-        entry.second.p_write(_out, _format, _level+1);
-      }
-      else if ( _format.type == format_type::pretty )
-      {
-        if ( ! _format.key_no_quotes )
-          _out << padding << "\"" << entry.first << "\" : ";
-        else
-          _out << padding << entry.first << " : ";
-        entry.second.p_write(_out, _format, _level+1);
-      }
+      write_key(entry.first.p_str());
+      write(entry.second, _level+1);
     }
-    if ( !isFirst && _format.type == format_type::pretty )
-      _out << endl << final_padding;
-    _out << "}";
+    end_container(!isFirst, _level, '}');
   }
-  else if ( is_array() )
+  break;
+  case value_type::array:
   {
-    _out << "[";
+    put('[');
     bool isFirst = true;
-    for ( size_t i = 0; i < this->size(); i++ )
+    for ( const value& jelem : *_jval.m_data._arr )
     {
-      if ( ! isFirst )
-      {
-        _out << ",";
-        if ( _format.type == format_type::pretty )
-          _out << endl;
-      }
-      else if ( _format.type == format_type::pretty )
-        _out << endl;
+      begin_entry(isFirst, _level+1);
       isFirst = false;
-      if ( _format.type == format_type::pretty )
-        _out << padding;
-      (*this)[i].p_write(_out, _format, _level+1);
+      write(jelem, _level+1);
     }
-    if ( !isFirst && _format.type == format_type::pretty )
-      _out << endl << final_padding;
-    _out << "]";
+    end_container(!isFirst, _level, ']');
   }
-  else if ( is_string() )
-  {
-    if ( ! _format.string_no_quotes
-         || ( m_data._str.length() == 4 && (m_data._str == "true" || m_data._str == "null") )
-         || ( m_data._str.length() == 5 && m_data._str == "false") )
-     _out << "\"" << escape_string(m_data._str) << "\"";
+  break;
+  case value_type::string:
+    write_text(_jval.p_str());
+    break;
+  case value_type::null:
+    put("null", 4);
+    break;
+  case value_type::boolean:
+    if ( _jval.m_data._bval )
+      put("true", 4);
     else
-     _out << escape_string(m_data._str);
+      put("false", 5);
+    break;
+  default:
+    write_number(_jval);
+    break;
   }
-  else if ( is_null() )
-    _out << "null";
-  else
-    _out << this->as_str();
 }
 
-const value& value::operator[](const size_t _index) const
+void serializer::write_text(std::string_view _str)
 {
-  if ( ! is_array() )
-    throw sid::exception(__func__ + std::string(": can be used only for array type"));
-  if ( _index >= m_data._arr.size() )
-    throw sid::exception(__func__ + std::string(": index(") + sid::to_str(_index)
-                         + ") out of range(" + sid::to_str(m_data._arr.size()) + ")");
-  return m_data._arr[_index];
+  // Strings that would read back as a literal keep their quotes
+  if ( ! m_format.string_no_quotes
+       || ( _str.length() == 4 && (_str == "true" || _str == "null") )
+       || ( _str.length() == 5 && _str == "false") )
+  {
+    put('\"');
+    write_string(_str);
+    put('\"');
+  }
+  else if ( ! _str.empty() )
+    write_string(_str);
 }
 
-value& value::operator[](const size_t _index)
+void serializer::write_key(std::string_view _key, bool _escape/* = false*/)
 {
-  if ( ! is_array() )
-    throw sid::exception(__func__ + std::string(": can be used only for array type"));
-  if ( _index >= m_data._arr.size() )
-    throw sid::exception(__func__ + std::string(": index(") + sid::to_str(_index)
-                         + ") out of range(" + sid::to_str(m_data._arr.size()) + ")");
-  return m_data._arr[_index];
+  if ( m_format.key_no_quotes )
+    put(_key.data(), _key.length());
+  else
+  {
+    put('\"');
+    if ( _escape )
+      write_string(_key, false);
+    else
+      put(_key.data(), _key.length());
+    put('\"');
+  }
+  if ( m_pretty )
+    put(" : ", 3);
+  else
+    put(':');
 }
 
-const value& value::operator[](const std::string& _key) const
+void serializer::write_string(std::string_view _str, bool _noQuotes)
 {
-  if ( ! is_object() )
-    throw sid::exception(__func__ + std::string(": can be used only for object type"));
-  for ( const auto& entry : m_data.map() )
-    if ( entry.first == _key ) return entry.second;
-  throw sid::exception(__func__ + std::string(": key(") + _key + ") not found");
-}
+  const char* p = _str.data();
+  const char* end = p + _str.length();
+  // The , needs escaping only in strings without quotes, which are written one character at a time
+  auto find_escape = [&](const char* _p)->const char*
+    {
+      if ( ! _noQuotes )
+      {
+        // Short runs are checked in place, longer ones with the vector kernel
+        const char* stop = ( end - _p > 16 )? _p + 16 : end;
+        for ( ; _p < stop; _p++ )
+          if ( simd::is_escape(*_p) )
+            return _p;
+        return ( _p < end )? simd::find_escape(_p, end) : _p;
+      }
+      for ( ; _p < end && *_p != ',' && *_p != '\"' && *_p != '\\'
+              && static_cast<uint8_t>(*_p) >= 0x20; _p++ );
+      return _p;
+    };
 
-value& value::operator[](const std::string& _key)
-{
-  if ( ! is_object() )
+  while ( true )
   {
-    this->clear();
-    m_type = m_data.init(value_type::object);
+    // Copy the run of characters that need no escaping in one go
+    const char* q = find_escape(p);
+    put(p, q - p);
+    if ( q == end )
+      break;
+    const char ch = *q;
+    switch ( ch )
+    {
+    case '\b': put("\\b", 2); break;
+    case '\f': put("\\f", 2); break;
+    case '\n': put("\\n", 2); break;
+    case '\r': put("\\r", 2); break;
+    case '\t': put("\\t", 2); break;
+    case '\"': put("\\\"", 2); break;
+    case '\\':
+      // \u sequences are stored as they are in the input
+      if ( q+1 == end || q[1] != 'u' || _noQuotes )
+        put("\\\\", 2);
+      else
+        put(ch);
+      break;
+    case ',':  put("\\u002c", 6); break;
+    default:   put(ch); break;
+    }
+    p = q + 1;
   }
-  return (m_data.map())[_key];
 }
 
-value& value::append(const value& _obj)
+void serializer::write_number(const value& _jnum)
 {
-  if ( ! is_array() )
+  // Large enough for any 64-bit integer and for any double
+  reserve(sid::float_chars_max);
+  if ( _jnum.is_signed() )
+    m_p = std::to_chars(m_p, m_end, _jnum.m_data._i64).ptr;
+  else if ( _jnum.is_unsigned() )
+    m_p = std::to_chars(m_p, m_end, _jnum.m_data._u64).ptr;
+  else if ( _jnum.is_long_double() )
+    // Shortest digits that read back to the same long double
+    m_p = sid::float_to_chars(m_p, _jnum.m_data._ldbl->value);
+  else
   {
-    this->clear();
-    m_type = m_data.init(value_type::array);
+    const float_type dbl = _jnum.m_data._dbl;
+    // Integral values within 18 digits are written the same as integers. An infinity, which
+    // json has no word for, is written as a number that reads back as it (see float_type).
+    if ( std::isinf(dbl) )
+    {
+      const std::string_view word = ( dbl < 0 )? "-1e999" : "1e999";
+      m_p = std::copy(word.begin(), word.end(), m_p);
+    }
+    else if ( dbl > -1e18 && dbl < 1e18 && dbl == static_cast<float_type>(static_cast<int64_t>(dbl))
+         && ( dbl != 0 || ! std::signbit(dbl) ) )
+      m_p = std::to_chars(m_p, m_end, static_cast<int64_t>(dbl)).ptr;
+    else
+      // Shortest digits that read back to the same number, laid out as %.18g
+      m_p = sid::float_to_chars(m_p, dbl);
   }
-  m_data._arr.push_back(_obj);
-  return m_data._arr[m_data._arr.size()-1];
+}
+
+void serializer::new_line(uint32_t _level)
+{
+  const size_t len = ( m_format.separator == '\0' )? 0 : static_cast<size_t>(_level) * m_format.indent;
+  reserve(len + 1);
+  *m_p++ = '\n';
+  ::memset(m_p, m_format.separator, len);
+  m_p += len;
+}
+
+void serializer::p_grow(size_t _len)
+{
+  const size_t used = ( m_p )? (m_p - m_out.data()) : m_out.length();
+  // The capacity of the buffer is used first. Beyond it, the buffer is doubled.
+  const size_t size = ( used + _len <= m_out.capacity() )? m_out.capacity()
+    : std::max({used + _len, 2 * m_out.length(), static_cast<size_t>(256)});
+  // The new space is not initialized, it is written before the buffer is trimmed
+  m_out.resize_and_overwrite(size, [](char*, size_t _n) { return _n; });
+  m_p = m_out.data() + used;
+  m_end = m_out.data() + size;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Implementation of the helpers of the json bindings
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void bind::type_error(std::string_view _key, const char* _expected)
+{
+  throw sid::exception("Expected " + std::string(_expected) + " for "
+                       + ( _key.empty()? std::string("the root") : "key " + std::string(_key) ));
+}
+
+void bind::write_string(std::string& _out, std::string_view _str)
+{
+  // Most strings have nothing to escape and are copied as they are
+  if ( simd::find_escape(_str.data(), _str.data() + _str.length()) == _str.data() + _str.length() )
+  {
+    _out.reserve(_out.length() + _str.length() + 2);
+    _out += '\"';
+    _out.append(_str);
+    _out += '\"';
+    return;
+  }
+  // The serializer grows the buffer it writes to to twice its length. A short value is written
+  // to a buffer of its own, as the output may hold a whole document.
+  static thread_local std::string s_buffer;
+  s_buffer.clear();
+  const format fmt;
+  serializer(s_buffer, fmt).write_quoted(_str);
+  _out.append(s_buffer);
+}
+
+void bind::write_value(std::string& _out, const value& _jval)
+{
+  const format fmt;
+  if ( _jval.is_complex_type() )
+  {
+    serializer(_out, fmt).write(_jval, 0);
+    return;
+  }
+  static thread_local std::string s_buffer;
+  s_buffer.clear();
+  serializer(s_buffer, fmt).write(_jval, 0);
+  _out.append(s_buffer);
+}
+
+const value& value::operator[](const size_t _index) const
+{
+  if ( ! is_array() )
+    throw sid::exception(__func__ + std::string(": can be used only for array type"));
+  if ( _index >= m_data._arr->size() )
+    throw sid::exception(__func__ + std::string(": index(") + sid::to_str(_index)
+                         + ") out of range(" + sid::to_str(m_data._arr->size()) + ")");
+  return (*m_data._arr)[_index];
+}
+
+value& value::operator[](const size_t _index)
+{
+  if ( ! is_array() )
+    throw sid::exception(__func__ + std::string(": can be used only for array type"));
+  if ( _index >= m_data._arr->size() )
+    throw sid::exception(__func__ + std::string(": index(") + sid::to_str(_index)
+                         + ") out of range(" + sid::to_str(m_data._arr->size()) + ")");
+  return (*m_data._arr)[_index];
+}
+
+const value& value::operator[](std::string_view _key) const
+{
+  if ( ! is_object() )
+    throw sid::exception(__func__ + std::string(": can be used only for object type"));
+  const value* pval = m_data._map->find(_key);
+  if ( pval == nullptr )
+    throw sid::exception(__func__ + std::string(": key(") + std::string(_key) + ") not found");
+  return *pval;
+}
+
+value& value::operator[](std::string_view _key)
+{
+  if ( ! is_object() )
+  {
+    this->clear();
+    p_init(value_type::object);
+  }
+  return (*m_data._map)[_key];
+}
+
+value& value::append(value&& _obj)
+{
+  if ( ! is_array() )
+  {
+    this->clear();
+    p_init(value_type::array);
+  }
+  m_data._arr->push_back(std::move(_obj));
+  return m_data._arr->back();
+}
+
+void value::reserve(size_t _size)
+{
+  if ( is_array() )
+    m_data._arr->reserve(_size);
+  else if ( is_object() )
+    m_data._map->reserve(_size);
+  else
+    throw sid::exception(__func__ + std::string("() can be used only for array and object types"));
+}
+
+value& value::append(const value& _obj)
+{
+  if ( ! is_array() )
+  {
+    this->clear();
+    p_init(value_type::array);
+  }
+  m_data._arr->push_back(_obj);
+  return m_data._arr->back();
 }
 
 value& value::append()
@@ -671,185 +1134,451 @@ value& value::append()
   if ( ! is_array() )
   {
     this->clear();
-    m_type = m_data.init(value_type::array);
+    p_init(value_type::array);
   }
   value jval;
-  m_data._arr.push_back(std::move(jval));
-  return m_data._arr[m_data._arr.size()-1];
+  m_data._arr->push_back(std::move(jval));
+  return m_data._arr->back();
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 //
-// Implementation of value::union_data
+// Implementation of the value cell
 //
 ///////////////////////////////////////////////////////////////////////////////////////////////////
-value::union_data::union_data(const value_type _type)
+void value::p_init(
+  const value_type           _type,
+  std::pmr::memory_resource* _resource/* = p_resource()*/
+  )
 {
-  init(_type);
+  switch ( _type )
+  {
+  case value_type::null:      break;
+  case value_type::string:    m_length = 0; break;
+  case value_type::_signed:   m_data._i64 = 0; break;
+  case value_type::_unsigned: m_data._u64 = 0; break;
+  case value_type::_double:   m_length = 0; m_data._dbl = 0; break;
+  case value_type::boolean:   m_data._bval = false; break;
+  case value_type::array:
+    m_data._arr = new (_resource->allocate(sizeof(array), alignof(array))) array(_resource);
+    break;
+  case value_type::object:
+    m_data._map = new (_resource->allocate(sizeof(object), alignof(object))) object(_resource);
+    ++gobjects_alloc;
+    break;
+  }
+  m_type = _type;
 }
 
-value::union_data::union_data(const union_data& _obj, const value_type _type)
+void value::p_init(
+  std::string_view           _val,
+  std::pmr::memory_resource* _resource/* = p_resource()*/
+  )
 {
-  init(_obj, true, _type);
+  if ( _val.length() <= short_capacity )
+  {
+    m_length = static_cast<uint8_t>(_val.length());
+    _val.copy(m_short, _val.length());
+  }
+  else
+  {
+    long_string* str = static_cast<long_string*>(
+      _resource->allocate(sizeof(long_string) + _val.length(), alignof(long_string)));
+    str->resource = _resource;
+    str->length = _val.length();
+    _val.copy(reinterpret_cast<char*>(str + 1), _val.length());
+    m_length = long_length;
+    m_data._str = str;
+  }
+  m_type = value_type::string;
 }
 
-value::union_data::union_data(union_data&& _obj, const value_type _type) noexcept
+void value::p_init(
+  const long double          _val,
+  std::pmr::memory_resource* _resource
+  )
 {
-  init(std::move(_obj), _type);
+  const float_type dbl = static_cast<float_type>(_val);
+  if ( static_cast<long double>(dbl) == _val || std::isnan(_val) )
+    return p_init(dbl);
+  long_number* num = static_cast<long_number*>(
+    _resource->allocate(sizeof(long_number), alignof(long_number)));
+  num->resource = _resource;
+  num->value = _val;
+  m_type = value_type::_double;
+  m_length = long_length;
+  m_data._ldbl = num;
 }
 
-value::union_data::~union_data()
+void value::p_init(const value& _obj)
 {
+  std::pmr::memory_resource* resource = p_resource();
+  switch ( _obj.m_type )
+  {
+  case value_type::string:
+    // A shared string is copied too, so that the copy does not depend on the parse it came from
+    if ( _obj.m_length >= interned_length )
+      return p_init(_obj.p_str(), resource);
+    break;
+  case value_type::_double:
+    if ( _obj.m_length == long_length )
+      return p_init(_obj.m_data._ldbl->value, resource);
+    break;
+  case value_type::array:
+    m_data._arr = new (resource->allocate(sizeof(array), alignof(array)))
+      array(*_obj.m_data._arr, resource);
+    m_type = value_type::array;
+    return;
+  case value_type::object:
+    m_data._map = new (resource->allocate(sizeof(object), alignof(object))) object(*_obj.m_data._map);
+    ++gobjects_alloc;
+    m_type = value_type::object;
+    return;
+  default:
+    break;
+  }
+  // All the other values are kept in the cell
+  m_type = _obj.m_type;
+  m_length = _obj.m_length;
+  ::memcpy(m_short, _obj.m_short, short_capacity);
 }
 
-value_type value::union_data::clear(const value_type _type)
+/**
+ * @struct value::shared_string
+ * @brief The reference count precedes the long string header, which is what the values
+ *        point to. So the characters are read the same way as those of any long string.
+ */
+struct value::shared_string
 {
-  switch ( _type )
-  {
-  case value_type::string: _str.~string(); break;
-  case value_type::array:  _arr.~array(); break;
-#if defined(SID_JSON_MAP_OPTIMIZE_FOR_SIZE)
-  case value_type::object: delete _map; _map = nullptr; break;
-#else
-  case value_type::object: _map.~object(); break;    
-#endif
-  default: break;
-  }
-  return value_type::null;
+  std::atomic<size_t> refs;
+  long_string         str;
+};
+
+/*static*/
+value::long_string* value::p_intern(std::string_view _val, std::pmr::memory_resource* _resource)
+{
+  shared_string* shared = static_cast<shared_string*>(
+    _resource->allocate(sizeof(shared_string) + _val.length(), alignof(shared_string)));
+  new (&shared->refs) std::atomic<size_t>(1);
+  shared->str.resource = _resource;
+  shared->str.length = _val.length();
+  _val.copy(reinterpret_cast<char*>(&shared->str + 1), _val.length());
+  return &shared->str;
 }
 
-value_type value::union_data::init(const value_type _type/* = value_type::null*/)
+/*static*/
+void value::p_release(long_string* _str) noexcept
 {
-  switch ( _type )
+  shared_string* shared = reinterpret_cast<shared_string*>(
+    reinterpret_cast<char*>(_str) - offsetof(shared_string, str));
+  if ( shared->refs.fetch_sub(1, std::memory_order_acq_rel) == 1 )
   {
-  case value_type::null:      break;
-  case value_type::string:    new (&_str) std::string; break;
-  case value_type::_signed:   _i64 = 0; break;
-  case value_type::_unsigned: _u64 = 0; break;
-  case value_type::_double:   _dbl = 0; break;
-  case value_type::boolean:   _bval = false; break;
-  case value_type::array:     new (&_arr) array; break;
-#if defined(SID_JSON_MAP_OPTIMIZE_FOR_SIZE)
-  case value_type::object:    _map = new object; ++gobjects_alloc; break;
-#else
-  case value_type::object:    new (&_map) object; break;
-#endif
+    shared->refs.~atomic();
+    _str->resource->deallocate(shared, sizeof(shared_string) + _str->length, alignof(shared_string));
   }
-  return _type;
 }
 
-value_type value::union_data::init(
-  const union_data& _obj,
-  const bool        _new/* = true*/,
-  const value_type  _type/* = value_type::null*/
-  )
+void value::p_share(long_string* _str) noexcept
 {
-  switch ( _type )
+  shared_string* shared = reinterpret_cast<shared_string*>(
+    reinterpret_cast<char*>(_str) - offsetof(shared_string, str));
+  shared->refs.fetch_add(1, std::memory_order_relaxed);
+  m_type = value_type::string;
+  m_length = interned_length;
+  m_data._str = _str;
+}
+
+void value::p_take(value& _obj) noexcept
+{
+  // The handles are taken over along with the cell. They keep their memory resource.
+  m_type = _obj.m_type;
+  m_length = _obj.m_length;
+  ::memcpy(m_short, _obj.m_short, short_capacity);
+  _obj.m_type = value_type::null;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Implementation of value::object
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+value::object::object(const object& _obj)
+  : object(p_resource())
+{
+  if ( _obj.m_size == 0 )
+    return;
+  // A single block holds all the entries of the copy
+  m_shift = std::max<uint8_t>(first_shift, static_cast<uint8_t>(std::bit_width(_obj.m_size - 1)));
+  p_grow();
+  for ( const entry& e : _obj )
   {
-  case value_type::null:      break;
-  case value_type::string:    init(_obj._str);  break;
-  case value_type::_signed:   init(_obj._i64);  break;
-  case value_type::_unsigned: init(_obj._u64);  break;
-  case value_type::_double:   init(_obj._dbl);  break;
-  case value_type::boolean:   init(_obj._bval); break;
-  case value_type::array:     init(_obj._arr);  break;
-  case value_type::object:    init(_obj.map(), _new); break;
+    new (m_blocks[0] + m_size) entry(e);
+    m_size++;
   }
-  return _type;
+  m_index.assign(_obj.m_index.begin(), _obj.m_index.end());
 }
 
-value_type value::union_data::init(const int _val)
+value::object::object(object&& _obj) noexcept
+  : m_more(_obj.m_more), m_index(std::move(_obj.m_index)),
+    m_size(_obj.m_size), m_count(_obj.m_count), m_shift(_obj.m_shift)
 {
-  return this->init(static_cast<int64_t>(_val));
+  std::copy(std::begin(_obj.m_blocks), std::end(_obj.m_blocks), m_blocks);
+  std::fill(std::begin(_obj.m_blocks), std::end(_obj.m_blocks), nullptr);
+  _obj.m_more = nullptr;
+  _obj.m_index.clear();
+  _obj.m_size = 0;
+  _obj.m_count = 0;
+  _obj.m_shift = first_shift;
 }
 
-value_type value::union_data::init(const int64_t _val)
+value::object::~object()
 {
-  _i64 = _val;
-  return value_type::_signed;
+  p_destroy();
+  std::pmr::memory_resource* resource = this->resource();
+  for ( size_t block = 0; block < m_count; block++ )
+    resource->deallocate(p_first(block), p_capacity(block) * sizeof(entry), alignof(entry));
+  if ( m_more )
+    resource->deallocate(m_more, (max_blocks - inline_blocks) * sizeof(entry*), alignof(entry*));
 }
 
-value_type value::union_data::init(const uint64_t _val)
+void value::object::p_destroy() noexcept
 {
-  _u64 = _val;
-  return value_type::_unsigned;
+  for ( entry& e : *this )
+    e.~entry();
+  m_size = 0;
 }
 
-value_type value::union_data::init(const long double _val)
+void value::object::clear()
 {
-  _dbl = _val;
-  return value_type::_double;
+  p_destroy();
+  m_index.clear();
 }
 
-value_type value::union_data::init(const bool _val)
+void value::object::p_grow()
 {
-  _bval = _val;
-  return value_type::boolean;
+  std::pmr::memory_resource* resource = this->resource();
+  const size_t block = m_count;
+  entry* first = static_cast<entry*>(resource->allocate(p_capacity(block) * sizeof(entry), alignof(entry)));
+  if ( block < inline_blocks )
+    m_blocks[block] = first;
+  else
+  {
+    if ( m_more == nullptr )
+      m_more = static_cast<entry**>(
+        resource->allocate((max_blocks - inline_blocks) * sizeof(entry*), alignof(entry*)));
+    m_more[block - inline_blocks] = first;
+  }
+  m_count++;
 }
 
-value_type value::union_data::init(const std::string& _val)
+value::object::entry* value::object::p_next()
 {
-  new (&_str) std::string(_val);
-  return value_type::string;
+  const size_t block = p_block(m_size);
+  if ( block == m_count )
+    p_grow();
+  return p_first(block) + (m_size - p_start(block));
 }
 
-value_type value::union_data::init(const char* _val)
+/*static*/
+uint32_t value::object::hash(std::string_view _key)
 {
-  if ( _val != nullptr )
-    return init(std::string(_val));
-  return init(value_type::null);
+  return static_cast<uint32_t>(std::hash<std::string_view>()(_key));
 }
 
-value_type value::union_data::init(const array& _val)
+size_t value::object::p_find(std::string_view _key) const
 {
-  new (&_arr) array(_val);
-  return value_type::array;
+  // The key is hashed only if the object is indexed
+  return p_find(_key, m_index.empty()? 0 : hash(_key));
 }
 
-value_type value::union_data::init(const object& _val, const bool _new/* = true*/)
+size_t value::object::p_find(std::string_view _key, uint32_t _hash) const
 {
-#if defined(SID_JSON_MAP_OPTIMIZE_FOR_SIZE)
-  if ( _new )
+  if ( m_index.empty() )
   {
-    _map = new object(_val);
-    ++gobjects_alloc;
+    // Small object. A linear search is cheaper than hashing the key.
+    size_t pos = 0;
+    for ( const entry& e : *this )
+    {
+      if ( p_equal(e.first.p_str(), _key) )
+        return pos;
+      pos++;
+    }
+    return std::string::npos;
   }
-  else
-    *_map = _val;
-#else
-  new (&_map) object(_val);
-#endif
-  return value_type::object;
+
+  const size_t mask = m_index.size() - 1;
+  for ( size_t i = (_hash & mask); m_index[i].pos != 0; i = (i + 1) & mask )
+  {
+    const slot& s = m_index[i];
+    if ( s.hash == _hash && p_equal(p_at(s.pos-1)->first.p_str(), _key) )
+      return s.pos - 1;
+  }
+  return std::string::npos;
 }
 
-//! Move initializer routine
-value_type value::union_data::init(union_data&& _obj, value_type _type) noexcept
+void value::object::p_index(uint32_t _hash, uint32_t _pos)
 {
-  switch ( _type )
+  const size_t mask = m_index.size() - 1;
+  size_t i = (_hash & mask);
+  while ( m_index[i].pos != 0 )
+    i = (i + 1) & mask;
+  m_index[i].hash = _hash;
+  m_index[i].pos = _pos + 1;
+}
+
+void value::object::p_rehash(size_t _capacity)
+{
+  // Capacity must be a power of 2
+  size_t capacity = 32;
+  while ( capacity < _capacity )
+    capacity <<= 1;
+  m_index.assign(capacity, slot{0, 0});
+  uint32_t pos = 0;
+  for ( const entry& e : *this )
+    p_index(hash(e.first.p_str()), pos++);
+}
+
+void value::object::reserve(size_t _n)
+{
+  // Before the first block is allocated, it is made large enough for all of them
+  if ( m_count == 0 && _n > p_capacity(0) )
+    m_shift = static_cast<uint8_t>(std::bit_width(_n - 1));
+  while ( p_start(m_count) < _n )
+    p_grow();
+  // Build the index upfront so that it doesn't have to be rebuilt while the entries are added
+  if ( _n > index_threshold && m_index.size() < (_n * 2) )
+    p_rehash(_n * 2);
+}
+
+const value* value::object::find(std::string_view _key) const
+{
+  const size_t pos = p_find(_key);
+  return ( pos != std::string::npos )? &p_at(pos)->second : nullptr;
+}
+
+const value* value::object::find(std::string_view _key, uint32_t _hash) const
+{
+  const size_t pos = p_find(_key, _hash);
+  return ( pos != std::string::npos )? &p_at(pos)->second : nullptr;
+}
+
+value* value::object::find(std::string_view _key)
+{
+  const size_t pos = p_find(_key);
+  return ( pos != std::string::npos )? &p_at(pos)->second : nullptr;
+}
+
+value& value::object::operator[](std::string_view _key)
+{
+  value* pval = find(_key);
+  return ( pval != nullptr )? *pval : add(_key);
+}
+
+value& value::object::add(std::string_view _key)
+{
+  entry* e = new (p_next()) entry();
+  m_size++;
+  // The key is allocated from the memory resource of the object
+  e->first.p_init(_key, resource());
+  p_added();
+  return e->second;
+}
+
+value& value::object::take_key(value&& _key)
+{
+  entry* e = new (p_next()) entry();
+  m_size++;
+  e->first.p_take(_key);
+  p_added();
+  return e->second;
+}
+
+void value::object::p_added()
+{
+  if ( ! m_index.empty() || m_size > index_threshold )
   {
-  case value_type::null:            break;
-  case value_type::string:          new (&_str) std::string(_obj._str); break;
-  case value_type::_signed:         _i64  = _obj._i64;  break;
-  case value_type::_unsigned:       _u64  = _obj._u64;  break;
-  case value_type::_double:         _dbl  = _obj._dbl;  break;
-  case value_type::boolean:         _bval = _obj._bval; break;
-  case value_type::array:           new (&_arr) array(_obj._arr); break;
-#if defined(SID_JSON_MAP_OPTIMIZE_FOR_SIZE)
-  case value_type::object:          _map  = _obj._map;  break;
-#else
-  case value_type::object:          new (&_map) object(_obj._map); break;
-#endif
+    // Keep the load factor of the index at or below 0.5
+    if ( m_index.size() < (m_size * 2) )
+      p_rehash(m_size * 2);
+    else
+      p_index(hash(p_at(m_size - 1)->first.p_str()), static_cast<uint32_t>(m_size - 1));
   }
-  // We've made a copy of the string and array objects.
-  // So, we need to clear them from _obj
-#if defined(SID_JSON_MAP_OPTIMIZE_FOR_SIZE)
-  // object uses a pointer. We don't want to clear the object type alone
-  if ( _type != value_type::object )
-    _obj.clear(_type);
-#else
-    _obj.clear(_type);
-#endif
-  return _type;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Implementation of document
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+document::document() : m_modified(false)
+{
+  new (&m_root) value;
+}
+
+document::~document()
+{
+  p_release();
+}
+
+void document::clear()
+{
+  p_release();
+  new (&m_root) value;
+}
+
+void document::p_release()
+{
+  // All the nodes of an unmodified tree are in the arena. Releasing the arena releases the
+  // tree, so the nodes need not be visited.
+  if ( m_modified )
+    m_root.~value();
+  m_arena.reset();
+  m_modified = false;
+}
+
+bool document::parse(std::string_view _value, const parser_control& _ctrl/* = parser_control()*/)
+{
+  parser_stats stats;
+  return parse(stats, _value, _ctrl);
+}
+
+bool document::parse(
+  parser_stats&         _stats,
+  std::string_view      _value,
+  const parser_control& _ctrl/* = parser_control()*/
+  )
+{
+  p_release();
+  // The first block of the arena is sized after the input, which is usually close to
+  // the size of the tree. Further blocks are added as needed.
+  // The blocks come from the heap resource of the values, so that they are counted in the
+  // statistics of the parse.
+  m_arena.emplace(std::max<size_t>(_value.length(), 4096), value::p_resource());
+  new (&m_root) value;
+
+  parser jparser(m_root, _stats);
+  jparser.m_ctrl = _ctrl;
+  jparser.m_resource = &(*m_arena);
+  return jparser.parse(_value.data(), _value.length());
+}
+
+bool document::parse_file(
+  const std::string&    _filePath,
+  const parser_control& _ctrl/* = parser_control()*/
+  )
+{
+  parser_stats stats;
+  return parse_file(stats, _filePath, _ctrl);
+}
+
+bool document::parse_file(
+  parser_stats&         _stats,
+  const std::string&    _filePath,
+  const parser_control& _ctrl/* = parser_control()*/
+  )
+{
+  util::mapped_file file(_filePath);
+  return parse(_stats, file.view(), _ctrl);
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -889,150 +1618,62 @@ ________________________________________________________________________________
 ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 */
 
-struct time_calc
-{
-  struct timespec t_start, t_end;
-
-  time_calc() { clear(); }
-  void clear()
-  {
-    ::memset(&t_start, 0, sizeof(t_start));
-    ::memset(&t_end, 0, sizeof(t_end));
-  }
-  void start() { t_start = p_capture(); }
-  void stop() { t_end = p_capture(); }
-
-  uint64_t diff_secs() const { return diff_millisecs() / 1000; }
-  uint64_t diff_millisecs() const { return diff_microsecs() / 1000; }
-  uint64_t diff_microsecs() const
-  {
-    if ( t_end.tv_sec > t_start.tv_sec ||
-         (t_end.tv_sec == t_start.tv_sec && t_end.tv_nsec >= t_start.tv_nsec) )
-    {
-      uint64_t s = (t_end.tv_sec - t_start.tv_sec) * 1000000;
-      uint64_t x = t_end.tv_nsec / 1000;
-      uint64_t y = t_start.tv_nsec / 1000;
-      if ( x < y )
-      {
-        --s;
-        x += 1000000;
-      }
-      s += x;
-      return s;
-    }
-    return 0;
-  }
-  
-private:
-  struct timespec p_capture() const
-  {
-    struct timespec ts = {0};
-    clock_gettime(CLOCK_REALTIME, &ts); // CLOCK_PROCESS_CPUTIME_ID
-    return ts;
-  }
-};
-
-//! check for space character
-bool parser::is_space(const char* _p)
+bool parser::parse(const char* _data, size_t _len)
 {
-  if ( *_p == '\n' )
-  {
-    ++m_line.count;
-    m_line.begin = _p + 1;
-    return true;
-  }
-  return ::isspace(*_p);
-}
+  if ( m_ctrl.timePhases )
+    m_clockCost = clock_cost();
+  const uint64_t start = now_ns();
+  m_jroot.clear();
+  m_stats.clear();
+  const uint64_t allocations = galloc_count;
+  const uint64_t allocBytes = galloc_bytes;
 
-void parser::REMOVE_LEADING_SPACES(const char*& _p)
-{
-  do
+  try
   {
-    for (; is_space(_p) && *_p != '\0'; _p++ );
-    if ( *_p != '/' )
-      return;
 
-    if ( *(_p+1) == '/' )
-    {
-      // C++ style comment encountered. Parse until end of line
-      for ( _p++; *_p != '\n' && *_p != '\0'; _p++ );
-    }
-    else if ( *(_p+1) == '*' )
+    reset(_data, _len);
+    // The index follows the strings of the strict grammar
+    m_index = nullptr;
+    if ( ! m_ctrl.mode.allowFlexibleKeys && ! m_ctrl.mode.allowFlexibleStrings )
     {
-      const line_info old_line = m_line;
-      const char* old_p = _p;
-      // C style comment encountered. Parse until */
-      do
-      {
-        for ( _p++; *_p != '*' && *_p != '\0'; _p++ )
-        {
-          if ( *_p == '\n' )
-          {
-            ++m_line.count;
-            m_line.begin = _p + 1;
-          }
-        }
-        if ( *_p != '*' )
-          throw sid::exception(std::string("Comments starting " + loc_str(old_line, old_p))
-                               + " is not closed");
-      }
-      while ( *(_p+1) != '/' );
-      _p += 2;
+      m_structural.reset(_data, _data + _len);
+      m_index = &m_structural;
     }
-  }
-  while ( true );
-}
-
-bool parser::parse(const std::string& _value)
-{
-  time_calc tc;
-
-  try
-  {
-    if ( m_schema && m_schema->empty() )
-      throw sid::exception("Invalid schema given for validation");
-
-    tc.start();
-
-    m_jroot.clear();
-    m_stats.clear();
-
-    m_input = _value;
-    m_p = m_line.begin = m_input.c_str();
-    m_line.count = 1;
+    const node* root = ( m_validator != nullptr )? &m_validator->root() : nullptr;
     REMOVE_LEADING_SPACES(m_p);
-    char ch = *m_p;
+    char ch = at(m_p);
     if ( ch == '{' )
     {
-      parse_object(m_jroot);
+      if ( m_projection != nullptr )
+        parse_object(m_jroot, m_projection);
+      else
+        parse_object(m_jroot, root);
       REMOVE_LEADING_SPACES(m_p);
-      ch = *m_p;
+      ch = at(m_p);
       if ( ch != '\0' )
 	throw sid::exception(std::string("Invalid character [") + ch + "] " + loc_str()
                            + " after the root object is closed");
     }
     else if ( ch == '[' )
     {
-      parse_array(m_jroot);
+      if ( m_projection != nullptr )
+        parse_array(m_jroot, m_projection);
+      else
+        parse_array(m_jroot, root);
       REMOVE_LEADING_SPACES(m_p);
-      ch = *m_p;
+      ch = at(m_p);
       if ( ch != '\0' )
 	throw sid::exception(std::string("Invalid character [") + ch + "] " + loc_str()
                            + " after the root array is closed");
     }
-    else if ( ch != '\0' )
-      throw sid::exception(std::string("Invalid character [") + ch + "] " + loc_str()
-                           + ". Expecting { or [");
     else
-      throw sid::exception(std::string("End of data reached ") + loc_str() + ". Expecting { or [");
+      root_error();
 
-    tc.stop();
-    m_stats.time_ms = tc.diff_millisecs();
+    finish_stats(start, allocations, allocBytes);
   }
   catch (...)
   {
-    tc.stop();
-    m_stats.time_ms = tc.diff_millisecs();
+    finish_stats(start, allocations, allocBytes);
     throw;
   }
 
@@ -1041,13 +1682,59 @@ bool parser::parse(const std::string& _value)
   return true;
 }
 
-void parser::parse_object(value& _jobj)
+/*static*/
+uint64_t parser::clock_cost()
+{
+  // The average of back to back readings
+  static const uint64_t s_cost = []()
+    {
+      const int count = 1000;
+      const uint64_t start = now_ns();
+      for ( int i = 1; i < count; i++ )
+        now_ns();
+      return (now_ns() - start) / count;
+    }();
+  return s_cost;
+}
+
+void parser::finish_stats(uint64_t _start, uint64_t _allocations, uint64_t _allocBytes)
+{
+  m_stats.time_ns = now_ns() - _start;
+  m_stats.time_ms = m_stats.time_ns / 1000000;
+  m_stats.bytes = m_p - m_begin;
+  m_stats.allocations = galloc_count - _allocations;
+  m_stats.allocBytes = galloc_bytes - _allocBytes;
+  if ( m_ctrl.timePhases )
+  {
+    // Scanning is whatever is not spent in the other phases. The sampled phases are estimates,
+    // which can exceed the time of a short parse: they are then scaled down to it, keeping their
+    // proportions, so that the phases always add up to time_ns.
+    const uint64_t phases = m_stats.string_ns + m_stats.number_ns + m_stats.build_ns;
+    if ( phases > m_stats.time_ns )
+    {
+      const double scale = static_cast<double>(m_stats.time_ns) / phases;
+      m_stats.string_ns = static_cast<uint64_t>(m_stats.string_ns * scale);
+      m_stats.number_ns = static_cast<uint64_t>(m_stats.number_ns * scale);
+      m_stats.build_ns = m_stats.time_ns - m_stats.string_ns - m_stats.number_ns;
+    }
+    m_stats.scan_ns = m_stats.time_ns - m_stats.string_ns - m_stats.number_ns - m_stats.build_ns;
+  }
+}
+
+void parser::parse_object(value& _jobj, const node* _node/* = nullptr*/)
 {
   char ch = 0;
+  // The type is checked before the members are parsed
+  if ( _node != nullptr )
+    check(_node, _node->check_start(value_type::object));
+  uint64_t start = phase_start();
   if ( ! _jobj.is_object() )
-    _jobj.p_set(value_type::object);
+    _jobj.p_set(value_type::object, m_resource);
+  phase_end(m_stats.build_ns, start);
 
   m_containerStack.push(value_type::object);
+  if ( m_containerStack.size() > m_stats.maxDepth )
+    m_stats.maxDepth = m_containerStack.size();
   m_stats.objects++;
   while ( true )
   {
@@ -1055,33 +1742,60 @@ void parser::parse_object(value& _jobj)
     // "string" : value
     REMOVE_LEADING_SPACES(m_p);
     // This is the case where there are no elements in the object (An empty object)
-    if ( *m_p == '}' ) { ++m_p; break; }
-
-    parse_key(m_key);
+    if ( at(m_p) == '}' ) { ++m_p; break; }
+
+    std::string_view key = parse_key();
+    start = phase_start();
+    // Keys that do not fit in the cell are shared when they are interned. A shared key is
+    // found by comparing the characters it points to.
+    value::long_string* shared = nullptr;
+    if ( m_ctrl.internKeys && key.length() > value::short_capacity )
+    {
+      shared = intern_key(key);
+      key = std::string_view(reinterpret_cast<const char*>(shared + 1), shared->length);
+    }
     // Check whether this key already exists in the object map
-    bool isDuplicateKey = _jobj.has_key(m_key);
+    value* jexisting = _jobj.m_data._map->find(key);
+    const bool isDuplicateKey = ( jexisting != nullptr );
+    phase_end(m_stats.build_ns, start);
     if ( isDuplicateKey )
     {
       // Handle duplicate key scenario
       if ( m_ctrl.dupKey == parser_control::dup_key::reject )
-        throw sid::exception("Duplicate key \"" + m_key + "\" encountered");
+        throw sid::exception("Duplicate key \"" + std::string(key) + "\" encountered");
     }
 
     m_stats.keys++;
     REMOVE_LEADING_SPACES(m_p);
-    if ( *m_p != ':' )
+    if ( at(m_p) != ':' )
       throw sid::exception("Expected : " + loc_str());
     m_p++;
     REMOVE_LEADING_SPACES(m_p);
+    // Checks of the value of the key
+    const node* child = ( _node != nullptr )? _node->property(key) : nullptr;
     if ( ! isDuplicateKey )
     {
-      parse_value(_jobj[m_key]);
+      start = phase_start();
+      value* jval = nullptr;
+      if ( shared != nullptr )
+      {
+        value jkey;
+        jkey.p_share(shared);
+        jval = &_jobj.m_data._map->take_key(std::move(jkey));
+      }
+      else
+        jval = &_jobj.m_data._map->add(key);
+      phase_end(m_stats.build_ns, start);
+      parse_value(*jval, child);
+      if ( _node != nullptr )
+        check(_node, _node->check_count(value_type::object, _jobj.m_data._map->size()));
     }
     // Handle duplicate key based on the input mode
     else if ( m_ctrl.dupKey == parser_control::dup_key::accept )
     {
-      // Accept the value and overwrite it
-      parse_value(_jobj[m_key]);
+      // Accept the value and overwrite it. It is not merged with the earlier one.
+      jexisting->clear();
+      parse_value(*jexisting, child);
     }
     else if ( m_ctrl.dupKey == parser_control::dup_key::ignore )
     {
@@ -1090,39 +1804,35 @@ void parser::parse_object(value& _jobj)
       parse_value(jignore);
     }
     else if ( m_ctrl.dupKey == parser_control::dup_key::append )
-    {
-      // make it as an array and append the duplicate keys
-      if ( ! _jobj[m_key].is_array() )
-      {
-        // make a copy of the existing key's value
-        value jcopy = _jobj[m_key];
-        // make they key as an array
-        _jobj[m_key].clear();
-        _jobj[m_key].p_set(value_type::array);
-        // append the copied value to the array
-        _jobj[m_key].append(jcopy);
-      }
-      // Append the new value to the array
-      value& jval = _jobj[m_key].append();
-      parse_value(jval);
-    }
-    ch = *m_p;
+      parse_value(append_duplicate(*jexisting), child);
+    ch = at(m_p);
     // Can have a ,
     // Must end with }
     if ( ch == '}' ) { ++m_p; break; }
     if ( ch != ',' )
-      throw sid::exception("Encountered " + std::string(m_p, 1) + ". Expected , or } " + loc_str());
+      throw sid::exception("Encountered " + std::string(1, ch) + ". Expected , or } " + loc_str());
   }
   m_containerStack.pop();
+  if ( _node != nullptr )
+    check(_node, _node->check_end(_jobj));
 }
 
-void parser::parse_array(value& _jarr)
+void parser::parse_array(value& _jarr, const node* _node/* = nullptr*/)
 {
   char ch = 0;
+  if ( _node != nullptr )
+    check(_node, _node->check_start(value_type::array));
+  uint64_t start = phase_start();
   if ( ! _jarr.is_array() )
-    _jarr.p_set(value_type::array);
+    _jarr.p_set(value_type::array, m_resource);
+  phase_end(m_stats.build_ns, start);
+  std::optional<node::unique_items> uniqueItems;
+  if ( _node != nullptr && _node->uniqueItems )
+    uniqueItems.emplace();
 
   m_containerStack.push(value_type::array);
+  if ( m_containerStack.size() > m_stats.maxDepth )
+    m_stats.maxDepth = m_containerStack.size();
   m_stats.arrays++;
   while ( true )
   {
@@ -1130,11 +1840,20 @@ void parser::parse_array(value& _jarr)
     // value
     REMOVE_LEADING_SPACES(m_p);
     // This is the case where there are no elements in the array (An empty array)
-    if ( *m_p == ']' ) { ++m_p; break; }
+    if ( at(m_p) == ']' ) { ++m_p; break; }
 
+    start = phase_start();
     value& jval = _jarr.append();
+    phase_end(m_stats.build_ns, start);
     parse_value(jval);
-    ch = *m_p;
+    if ( _node != nullptr )
+    {
+      const size_t count = _jarr.m_data._arr->size();
+      check(_node, _node->check_count(value_type::array, count));
+      if ( uniqueItems )
+        check(_node, uniqueItems->add(_jarr, count - 1));
+    }
+    ch = at(m_p);
     // Can have a ,
     // Must end with ]
     if ( ch == ']' ) { ++m_p; break; }
@@ -1142,184 +1861,190 @@ void parser::parse_array(value& _jarr)
       throw sid::exception("Expected , or ] " + loc_str());
   }
   m_containerStack.pop();
+  if ( _node != nullptr )
+    check(_node, _node->check_end(_jarr));
 }
 
-void parser::parse_key(std::string& _str)
+value& parser::append_duplicate(value& _jexisting)
 {
-  parse_string(_str, true);
+  // make it as an array and append the duplicate keys
+  if ( ! _jexisting.is_array() )
+  {
+    // move out the existing key's value. A move keeps its memory resource.
+    value jfirst(std::move(_jexisting));
+    // make they key as an array
+    _jexisting.clear();
+    _jexisting.p_set(value_type::array, m_resource);
+    // append the existing value to the array
+    _jexisting.m_data._arr->push_back(std::move(jfirst));
+  }
+  // Append the new value to the array
+  return _jexisting.append();
 }
 
-void parser::parse_string(std::string& _str, bool _isKey)
+void parser::parse_object(value& _jobj, const projection::node* _proj)
 {
-  _str.clear();
-  const char chContainer = (m_containerStack.top() == value_type::object)? '}' : ']' ;
-  bool hasQuotes = true;
-  if ( ( _isKey && m_ctrl.mode.allowFlexibleKeys ) || ( ! _isKey && m_ctrl.mode.allowFlexibleStrings ) )
-    hasQuotes = (*m_p == '\"');
-  else if ( *m_p != '\"' )
-    throw sid::exception("Expected \" " + loc_str() + ", found \"" + std::string(1, *m_p) + "\"");
+  if ( ! _jobj.is_object() )
+    _jobj.p_set(value_type::object, m_resource);
 
-  const line_info old_line = m_line;
-  const char* old_p = m_p;
+  m_containerStack.push(value_type::object);
+  if ( m_containerStack.size() > m_stats.maxDepth )
+    m_stats.maxDepth = m_containerStack.size();
+  m_stats.objects++;
+  while ( true )
+  {
+    ++m_p;
+    REMOVE_LEADING_SPACES(m_p);
+    if ( at(m_p) == '}' ) { ++m_p; break; }
 
-  auto check_hex = [&](char ch)->char
+    const std::string_view key = parse_key();
+    m_stats.keys++;
+    REMOVE_LEADING_SPACES(m_p);
+    if ( at(m_p) != ':' )
+      throw sid::exception("Expected : " + loc_str());
+    m_p++;
+    REMOVE_LEADING_SPACES(m_p);
+
+    const projection::node* child = _proj->key(key);
+    value* jexisting = nullptr;
+    if ( ! is_projected(child) )
     {
-      if ( ch == '\0' )
-        throw sid::exception("Missing hexadecimal sequence characters at the end position "
-                             + loc_str());
-      if ( ! ::isxdigit(ch) )
-        throw sid::exception("Missing hexadecimal character at " + loc_str());
-      return ch;
-    };
+      skip_value();
+      REMOVE_LEADING_SPACES(m_p);
+    }
+    else if ( (jexisting = _jobj.m_data._map->find(key)) == nullptr )
+      parse_value(_jobj.m_data._map->add(key), child);
+    // Duplicate keys are handled as in a parse without projection
+    else if ( m_ctrl.dupKey == parser_control::dup_key::reject )
+      throw sid::exception("Duplicate key \"" + std::string(key) + "\" encountered");
+    else if ( m_ctrl.dupKey == parser_control::dup_key::accept )
+    {
+      jexisting->clear();
+      parse_value(*jexisting, child);
+    }
+    else if ( m_ctrl.dupKey == parser_control::dup_key::ignore )
+    {
+      skip_value();
+      REMOVE_LEADING_SPACES(m_p);
+    }
+    else if ( m_ctrl.dupKey == parser_control::dup_key::append )
+      parse_value(append_duplicate(*jexisting), child);
 
-  char ch = 0;
-  if ( !hasQuotes )
-    --m_p;
+    const char ch = at(m_p);
+    if ( ch == '}' ) { ++m_p; break; }
+    if ( ch != ',' )
+      throw sid::exception("Encountered " + std::string(1, ch) + ". Expected , or } " + loc_str());
+  }
+  m_containerStack.pop();
+}
 
-  while ( true )
+void parser::parse_array(value& _jarr, const projection::node* _proj)
+{
+  if ( ! _jarr.is_array() )
+    _jarr.p_set(value_type::array, m_resource);
+  // The elements keep their indexes, counted from the elements already in the array
+  const size_t base = _jarr.m_data._arr->size();
+
+  m_containerStack.push(value_type::array);
+  if ( m_containerStack.size() > m_stats.maxDepth )
+    m_stats.maxDepth = m_containerStack.size();
+  m_stats.arrays++;
+  for ( uint64_t index = 0; ; index++ )
   {
-    ch = *(++m_p);
-    if ( hasQuotes )
+    ++m_p;
+    REMOVE_LEADING_SPACES(m_p);
+    if ( at(m_p) == ']' ) { ++m_p; break; }
+
+    const projection::node* child = _proj->index(index);
+    if ( is_projected(child) )
     {
-      if ( ch == '\"' ) break;
-      if ( ch == '\n' )
-      {
-        ++m_line.count;
-        m_line.begin = m_p + 1;
-      }
-      else if ( ch == '\0' )
-        throw sid::exception("Missing \" for string starting " + loc_str(old_line, old_p));
+      // The elements left out before this one are null
+      while ( _jarr.m_data._arr->size() < base + index )
+        _jarr.append();
+      parse_value(_jarr.append(), child);
     }
     else
     {
-      // Cannot have double-quotes, it must be escaped
-      if ( ch == '\"' ) throw sid::exception("Character \" must be escaped " + loc_str());
-      // A space character denotes end of the string
-      if ( is_space(m_p) )
-        break;
-      // For a key : denotes end of the key
-      // For a value , and the end of container key denotes end of the value
-      if ( ( _isKey && ch == ':' ) || ( ! _isKey && (ch == ',' || ch == chContainer) ) )
-        { --m_p; break; }
-      if ( ch == '\0' )
-        throw sid::exception("End of string character not found for string starting " + loc_str());
-    }
-    if ( ch != '\\' ) { _str += ch; continue; }
-    // We're encountered an escape character. Process it
-    {
-      ch = *(++m_p);
-      switch ( ch )
-      {
-      case '/':  _str += ch;   break;
-      case 'b':  _str += '\b'; break;
-      case 'f':  _str += '\f'; break;
-      case 'n':  _str += '\n'; break;
-      case 'r':  _str += '\r'; break;
-      case 't':  _str += '\t'; break;
-      case '\\': _str += ch;   break;
-      case '\"': _str += ch;   break;
-      case 'u':
-      {
-        const char* p = m_p;
-        // Must be followed by 4 hex digits
-        for ( int i = 0; i < 4; i++ )
-          check_hex(*(++m_p));
-        _str.append(p-1, 6);
-      }
-      break;
-      case '\0':
-        throw sid::exception("Missing escape sequence characters at the end position " + loc_str());
-      default:
-        throw sid::exception("Invalid escape sequence (" + std::string(1, ch) +
-                             ") for string at " + loc_str());
-      }
+      skip_value();
+      REMOVE_LEADING_SPACES(m_p);
     }
+
+    const char ch = at(m_p);
+    if ( ch == ']' ) { ++m_p; break; }
+    if ( ch != ',' )
+      throw sid::exception("Expected , or ] " + loc_str());
   }
-  ++m_p;
+  m_containerStack.pop();
 }
 
-void parser::parse_string(value& _jstr, bool _isKey)
+void parser::parse_value(value& _jval, const projection::node* _proj)
 {
-  std::string str;
-  parse_string(str, _isKey);
-  _jstr = str;
+  // A value that is kept whole is parsed without projection
+  if ( _proj->whole )
+    parse_value(_jval);
+  else if ( at(m_p) == '{' )
+    parse_object(_jval, _proj);
+  else
+    parse_array(_jval, _proj);
+  REMOVE_LEADING_SPACES(m_p);
 }
 
-void parser::parse_value(value& _jval)
+value::long_string* parser::intern_key(std::string_view _key)
 {
-  char ch = *m_p;
+  auto it = m_keys.find(_key);
+  if ( it != m_keys.end() )
+    return it->second;
+  // The table is keyed by the characters of the interned copy
+  value::long_string* str = value::p_intern(_key, m_resource);
+  m_keys.emplace(std::string_view(reinterpret_cast<const char*>(str + 1), str->length), str);
+  return str;
+}
+
+std::string_view parser::parse_key()
+{
+  const uint64_t start = phase_start();
+  const std::string_view key = parse_string_view(m_key, true);
+  phase_end(m_stats.string_ns, start);
+  return key;
+}
+
+void parser::parse_string(value& _jstr, bool _isKey, const node* _node/* = nullptr*/)
+{
+  uint64_t start = phase_start();
+  const std::string_view str = parse_string_view(m_str, _isKey);
+  phase_end(m_stats.string_ns, start);
+  if ( _node != nullptr )
+    check(_node, _node->check_string(str));
+  start = phase_start();
+  _jstr.p_set(str, m_resource);
+  phase_end(m_stats.build_ns, start);
+}
+
+void parser::parse_value(value& _jval, const node* _node/* = nullptr*/)
+{
+  char ch = at(m_p);
   if ( ch == '{' )
-    parse_object(_jval);
+    parse_object(_jval, _node);
   else if ( ch == '[' )
-    parse_array(_jval);
+    parse_array(_jval, _node);
   else if ( ch == '\"' )
-    parse_string(_jval, false);
+    parse_string(_jval, false, _node);
   else if ( ch == '-' || ::isdigit(ch) )
     parse_number(_jval, true);
   else if ( ch == '\0' )
     throw sid::exception("Unexpected end of data while expecting a value");
   else
   {
-    const char chContainer = (m_containerStack.top() == value_type::object)? '}' : ']' ;
-    const char* p_start = m_p;
-    const line_info old_line = m_line;
-    for ( char ch; (ch = *m_p) != '\0'; ++m_p )
-    {
-      if ( ch == ',' || is_space(m_p) || ch == chContainer )
-        break;
-    }
-    if ( m_p == p_start )
-      throw sid::exception("Expected value not found " + loc_str());
-
-    bool found = true;
-    size_t len = m_p - p_start;
-    if ( len == 4 )
-    {
-      if ( ::strncmp(p_start, "null", len) == 0 )
-        ;
-      else if ( ::strncmp(p_start, "true", len) == 0 )
-        _jval = true;
-      else if ( ! m_ctrl.mode.allowNocaseValues )
-        found = false;
-      else
-      {
-        if ( ::strncmp(p_start, "Null", len) == 0 || ::strncmp(p_start, "NULL", len) == 0 )
-          ;
-        else if ( ::strncmp(p_start, "True", len) == 0 || ::strncmp(p_start, "TRUE", len) == 0 )
-          _jval = true;
-        else
-          found = false;
-      }
-    }
-    else if ( len == 5 )
-    {
-      if ( ::strncmp(p_start, "false", len) == 0 )
-        _jval = false;
-      else if ( ! m_ctrl.mode.allowNocaseValues )
-        found = false;
-      else
-      {
-        if ( ::strncmp(p_start, "False", len) == 0 || ::strncmp(p_start, "FALSE", len) == 0 )
-          _jval = false;
-        else
-          found = false;
-      }
-    }
-    else
-      found = false;
-    if ( ! found )
-    {
-      if ( m_ctrl.mode.allowFlexibleStrings )
-      {
-        m_p = p_start;
-        m_line = old_line;
-        parse_string(_jval, false);
-      }
-      else
-        throw sid::exception("Invalid value [" + std::string(p_start, len) + "] " + loc_str()
-                             + ". Did you miss enclosing in \"\"?");
-    }
+    bool bval = false;
+    const value_type type = parse_literal(bval);
+    if ( type == value_type::boolean )
+      _jval = bval;
+    else if ( type == value_type::string )
+      parse_string(_jval, false, _node);
   }
+  // Containers and strings are checked as they are parsed
+  if ( _node != nullptr && _jval.is_basic_type() && ! _jval.is_string() )
+    check(_node, _node->check_scalar(_jval));
   // Set the statistics of non-container objects here
   if ( _jval.is_string() )
     m_stats.strings++;
@@ -1335,120 +2060,21 @@ void parser::parse_value(value& _jval)
 
 void parser::parse_number(value& _jnum, bool bFullCheck)
 {
-  REMOVE_LEADING_SPACES(m_p);
-  const char* p_start = m_p;
-  bool isDouble = false;
-  bool isNegative = false;
-  const char chContainer = (m_containerStack.top() == value_type::object)? '}' : ']' ;
-
-  if ( ! bFullCheck )
+  const uint64_t start = phase_start();
+  number num;
+  lexer::parse_number(num, bFullCheck);
+  phase_end(m_stats.number_ns, start);
+  if ( num.isLong )
   {
-    isNegative = (*m_p == '-');
-    for ( ; *m_p != '\0'; m_p++ )
-    {
-      if ( *m_p == ',' || is_space(m_p) ||  *m_p == chContainer )
-        break;
-      if ( !isDouble && (*m_p == '.' || *m_p == 'e' || *m_p == 'E') )
-        isDouble = true;
-    }
+    _jnum.clear();
+    _jnum.p_init(num.ldbl, m_resource);
   }
+  else if ( num.type == value_type::_double )
+    _jnum = num.dbl;
+  else if ( num.type == value_type::_signed )
+    _jnum = num.i64;
   else
-  {
-    // Perform full check and get the number
-    struct number
-    {
-      struct s_integer
-      {
-        bool     negative = false;
-        uint64_t digits = 0;
-      };
-      s_integer integer;
-      bool hasFraction = false;
-      bool hasExponent = false;
-    };
-    number num;
-
-    if ( (num.integer.negative = (*m_p == '-')) )
-      ++m_p;
-    char ch = *m_p;
-    if ( ch < '0' || ch > '9' )
-      throw sid::exception("Missing integer digit" + loc_str());
-
-    if ( ch == '0' )
-    {
-      ch = *(++m_p);
-      if ( ch >= '0' && ch <= '9' )
-        throw sid::exception("Invalid digit (" + std::string(1, ch) + ") after first 0 " + loc_str());
-      num.integer.digits = 0;
-    }
-    else
-    {
-      while ( (ch = *(++m_p)) >= '0' && ch <= '9'  )
-        ;
-    }
-    // Check whether it has fraction and populate accordingly
-    if ( ch == '.' )
-    {
-      bool hasDigits = false;
-      while ( (ch = *(++m_p)) >= '0' && ch <= '9'  )
-        hasDigits = true;
-      if ( !hasDigits )
-        throw sid::exception("Invalid digit (" + std::string(1, ch)
-                             + ") Expected a digit for fraction " + loc_str());
-      num.hasFraction = true;
-    }
-    // Check whether it has an exponent and populate accordingly
-    if ( ch == 'e' || ch == 'E' )
-    {
-      ch = *(++m_p);
-      if ( ch != '-' && ch != '+' )
-        --m_p;
-      bool hasDigits = false;
-      while ( (ch = *(++m_p)) >= '0' && ch <= '9'  )
-        hasDigits = true;
-      if ( !hasDigits )
-        throw sid::exception("Invalid digit (" + std::string(1, ch)
-                             + ") Expected a digit for exponent " + loc_str());
-      num.hasExponent = true;
-    }
-
-    isNegative = num.integer.negative;
-    isDouble = ( num.hasFraction || num.hasExponent );
-  }
-
-  const char* p_end = m_p;
-  REMOVE_LEADING_SPACES(m_p);
-  char ch = *m_p;
-  if ( ch != ',' && ch != '\0' && ch != chContainer )
-    throw sid::exception("Invalid character " + std::string(1, ch) + " Expected , or "
-                         + std::string(1, chContainer) + " " + loc_str());
-
-  std::string numStr(p_start, p_end-p_start);
-  if ( isDouble )
-  {
-    long double dbl = sid::to_num<long double>(numStr);
-    _jnum = dbl;
-  }
-  else
-  {
-    std::string errStr;
-    if ( isNegative )
-    {
-      int64_t v = 0;
-      if ( ! sid::to_num(numStr, /*out*/ v, &errStr) )
-        throw sid::exception("Unable to convert (" + numStr + ") to numeric " + loc_str()
-                             + ": " + errStr);
-      _jnum = v;
-    }
-    else
-    {
-      uint64_t v = 0;
-      if ( ! sid::to_num(numStr, /*out*/ v, &errStr) )
-        throw sid::exception("Unable to convert (" + numStr + ") to numeric " + loc_str()
-                             + ": " + errStr);
-      _jnum = v;
-    }
-  }
+    _jnum = num.u64;
 }
 
 ///////////////////////////////////////////////////////////////////////////////////////////////////
@@ -1471,6 +2097,42 @@ void parser_stats::clear()
   nulls = 0;
   keys = 0;
   time_ms = 0;
+  time_ns = 0;
+  bytes = 0;
+  maxDepth = 0;
+  allocations = 0;
+  allocBytes = 0;
+  scan_ns = 0;
+  string_ns = 0;
+  number_ns = 0;
+  build_ns = 0;
+}
+
+parser_stats& parser_stats::merge(const parser_stats& _stats)
+{
+  objects += _stats.objects;
+  arrays += _stats.arrays;
+  strings += _stats.strings;
+  numbers += _stats.numbers;
+  booleans += _stats.booleans;
+  nulls += _stats.nulls;
+  keys += _stats.keys;
+  time_ns += _stats.time_ns;
+  time_ms = time_ns / 1000000;
+  bytes += _stats.bytes;
+  maxDepth = std::max(maxDepth, _stats.maxDepth);
+  allocations += _stats.allocations;
+  allocBytes += _stats.allocBytes;
+  scan_ns += _stats.scan_ns;
+  string_ns += _stats.string_ns;
+  number_ns += _stats.number_ns;
+  build_ns += _stats.build_ns;
+  return *this;
+}
+
+double parser_stats::throughput() const
+{
+  return ( time_ns > 0 )? (bytes * 1000.0 / time_ns) : 0;
 }
 
 std::string parser_stats::to_str() const
@@ -1485,8 +2147,28 @@ std::string parser_stats::to_str() const
       << "nulls.........: " << sid::get_sep(nulls) << endl
       << "(keys)........: " << sid::get_sep(keys) << endl
       << "(time taken)..: " << sid::get_sep(time_ms/1000)
-      << "." << std::setfill('0') << std::setw(3) << (time_ms % 1000) << " seconds" << endl
+      << "." << std::setfill('0') << std::setw(3) << (time_ms % 1000) << " seconds"
+      << " (" << sid::get_sep(time_ns/1000) << " us)" << endl
+      << "(bytes).......: " << sid::get_sep(bytes)
+      << " (" << std::fixed << std::setprecision(1) << throughput() << " MB/s)" << endl
+      << "(max depth)...: " << sid::get_sep(maxDepth) << endl
+      << "(allocations).: " << sid::get_sep(allocations)
+      << " (" << sid::get_sep(allocBytes) << " bytes)" << endl
     ;
+  // The phases are measured only on demand
+  const uint64_t phases = scan_ns + string_ns + number_ns + build_ns;
+  if ( phases > 0 )
+  {
+    auto phase = [&](const char* _name, uint64_t _ns)
+      {
+        out << _name << sid::get_sep(_ns/1000) << " us (" << std::setprecision(1)
+            << (_ns * 100.0 / phases) << "%)" << endl;
+      };
+    phase("(scan)........: ", scan_ns);
+    phase("(strings).....: ", string_ns);
+    phase("(numbers).....: ", number_ns);
+    phase("(build).......: ", build_ns);
+  }
   return out.str();
 }
 
@@ -0,0 +1,710 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@file json_binary.cpp
+@brief Binary encodings (CBOR and MessagePack) of json
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+/**
+ * @file  json_binary.cpp
+ * @brief Implementation of the CBOR and MessagePack encodings of json
+ */
+#include <common/json.hpp>
+#include <common/convert.hpp>
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+
+using namespace sid;
+using namespace sid::json;
+
+namespace local
+{
+//! Half precision value of the given double, if it is exact (NaN is not handled)
+bool to_half(double _dbl, uint16_t& _half)
+{
+  const float flt = static_cast<float>(_dbl);
+  if ( static_cast<double>(flt) != _dbl )
+    return false;
+  const uint32_t bits = std::bit_cast<uint32_t>(flt);
+  const uint16_t sign = static_cast<uint16_t>((bits >> 16) & 0x8000);
+  const int32_t  exp = static_cast<int32_t>((bits >> 23) & 0xFF) - 127;
+  const uint32_t mant = bits & 0x7FFFFF;
+  if ( exp == 128 )
+    _half = sign | 0x7C00;                      // infinity
+  else if ( exp == -127 && mant == 0 )
+    _half = sign;                               // zero
+  else if ( exp >= -14 && exp <= 15 )
+  {
+    if ( (mant & 0x1FFF) != 0 )
+      return false;
+    _half = sign | static_cast<uint16_t>((exp + 15) << 10) | static_cast<uint16_t>(mant >> 13);
+  }
+  else if ( exp >= -24 && exp < -14 )
+  {
+    // Subnormal half: multiple of 2^-24
+    const uint32_t full = 0x800000 | mant;
+    const int shift = -exp - 1;
+    if ( (full & ((1U << shift) - 1)) != 0 )
+      return false;
+    _half = sign | static_cast<uint16_t>(full >> shift);
+  }
+  else
+    return false;
+  return true;
+}
+
+//! Double value of the given half precision value
+double from_half(uint16_t _half)
+{
+  const int exp = (_half >> 10) & 0x1F;
+  const int mant = _half & 0x3FF;
+  double val;
+  if ( exp == 0 )
+    val = std::ldexp(mant, -24);
+  else if ( exp != 31 )
+    val = std::ldexp(mant + 1024, exp - 25);
+  else
+    val = ( mant == 0 )? INFINITY : NAN;
+  return ( _half & 0x8000 )? -val : val;
+}
+} // namespace local
+
+namespace sid {
+namespace json {
+
+/**
+ * @struct encoder
+ * @brief Writes the binary encoding of a json value to a byte buffer
+ */
+struct encoder
+{
+  io_buffer& m_out; //! Output buffer
+  uint8_t*   m_p;   //! Write position in m_out
+  uint8_t*   m_end; //! End of the space available in m_out
+
+  encoder(io_buffer& _out) : m_out(_out), m_p(nullptr), m_end(nullptr) {}
+  ~encoder() { if ( m_p ) m_out.resize(m_p - m_out.data()); }
+
+  void cbor(const value& _jval);
+  void msgpack(const value& _jval);
+
+private:
+  //! make room for _len more bytes
+  void reserve(size_t _len) { if ( static_cast<size_t>(m_end - m_p) < _len ) p_grow(_len); }
+  void put(uint8_t _byte) { reserve(1); *m_p++ = _byte; }
+  void put(std::string_view _str) {
+    reserve(_str.length()); ::memcpy(m_p, _str.data(), _str.length()); m_p += _str.length();
+  }
+  //! write the byte followed by the big endian value
+  template <typename T> void put(uint8_t _byte, T _val) {
+    reserve(1 + sizeof(T));
+    *m_p++ = _byte;
+    if constexpr ( sizeof(T) > 1 )
+      _val = std::byteswap(_val);
+    ::memcpy(m_p, &_val, sizeof(T));
+    m_p += sizeof(T);
+  }
+  void p_grow(size_t _len);
+
+  //! CBOR head with the major type and the argument in its shortest form
+  void cbor_head(uint8_t _major, uint64_t _arg);
+  void cbor_double(double _dbl);
+  //! MessagePack head of a string, array or map with the given length
+  void msgpack_head(size_t _len, uint8_t _fix, uint8_t _fixMax, uint8_t _head8, uint8_t _head16);
+  void msgpack_double(double _dbl);
+};
+
+/**
+ * @struct decoder
+ * @brief Builds a json value from its binary encoding
+ */
+struct decoder
+{
+  const uint8_t*             m_begin;    //! Start of the input
+  const uint8_t*             m_p;        //! Read position
+  const uint8_t*             m_end;      //! End of the input
+  std::pmr::memory_resource* m_resource; //! Memory resource for the nodes of the json tree
+  std::string                m_str;      //! Buffer of the CBOR strings sent in chunks
+  uint32_t                   m_depth;    //! Nesting of the containers and tags being decoded
+  const uint32_t             m_maxDepth; //! Deepest nesting allowed
+
+  decoder(const void* _data, size_t _len, uint32_t _maxDepth)
+    : m_begin(static_cast<const uint8_t*>(_data)), m_p(m_begin), m_end(m_begin + _len),
+      m_resource(value::p_resource()), m_depth(0), m_maxDepth(_maxDepth) {}
+
+  size_t used() const { return m_p - m_begin; }
+
+  void cbor(value& _jval);
+  void msgpack(value& _jval);
+
+private:
+  //! check that _len more bytes are available
+  void need(size_t _len) const {
+    if ( static_cast<size_t>(m_end - m_p) < _len )
+      throw sid::exception("Unexpected end of data at byte " + sid::to_str(used()));
+  }
+  uint8_t get() { need(1); return *m_p++; }
+  //! read the big endian value
+  template <typename T> T get() {
+    need(sizeof(T));
+    T val;
+    ::memcpy(&val, m_p, sizeof(T));
+    m_p += sizeof(T);
+    if constexpr ( sizeof(T) > 1 )
+      val = std::byteswap(val);
+    return val;
+  }
+  std::string_view get_str(uint64_t _len) {
+    need(_len);
+    std::string_view str(reinterpret_cast<const char*>(m_p), _len);
+    m_p += _len;
+    return str;
+  }
+  //! Number of entries that can be reserved for a container of _count elements,
+  //! without trusting a count larger than the remaining input
+  size_t reserve_count(uint64_t _count) const {
+    return static_cast<size_t>(std::min<uint64_t>(_count, m_end - m_p));
+  }
+  [[noreturn]] void error(const std::string& _msg, const uint8_t* _at) const {
+    throw sid::exception(_msg + " at byte " + sid::to_str(_at - m_begin));
+  }
+  //! Enter a container or a tag, which the input is not trusted to nest within the stack
+  void enter(const uint8_t* _at) {
+    if ( ++m_depth > m_maxDepth )
+      error("Nesting deeper than " + sid::to_str(m_maxDepth) + " levels", _at);
+  }
+  void leave() { --m_depth; }
+
+  //! CBOR argument of the head with the given additional information
+  uint64_t cbor_arg(uint8_t _info);
+  //! CBOR text or byte string
+  std::string_view cbor_str(uint8_t _initial);
+  void msgpack_array(value& _jval, size_t _count, const uint8_t* _at);
+  void msgpack_map(value& _jval, size_t _count, const uint8_t* _at);
+  std::string_view msgpack_key();
+};
+
+} // namespace json
+} // namespace sid
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Implementation of the binary encodings of value
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void value::to_cbor(io_buffer& _out) const
+{
+  encoder(_out).cbor(*this);
+}
+
+io_buffer value::to_cbor() const
+{
+  io_buffer out;
+  to_cbor(out);
+  return out;
+}
+
+void value::to_msgpack(io_buffer& _out) const
+{
+  encoder(_out).msgpack(*this);
+}
+
+io_buffer value::to_msgpack() const
+{
+  io_buffer out;
+  to_msgpack(out);
+  return out;
+}
+
+/*static*/
+size_t value::from_cbor(value& _jout, const void* _data, size_t _len,
+                        uint32_t _maxDepth/* = max_binary_depth*/)
+{
+  _jout.clear();
+  decoder dec(_data, _len, _maxDepth);
+  dec.cbor(_jout);
+  return dec.used();
+}
+
+/*static*/
+size_t value::from_cbor(value& _jout, const io_buffer& _in,
+                        uint32_t _maxDepth/* = max_binary_depth*/)
+{
+  return from_cbor(_jout, _in.rd_data(), _in.rd_length(), _maxDepth);
+}
+
+/*static*/
+size_t value::from_msgpack(value& _jout, const void* _data, size_t _len,
+                        uint32_t _maxDepth/* = max_binary_depth*/)
+{
+  _jout.clear();
+  decoder dec(_data, _len, _maxDepth);
+  dec.msgpack(_jout);
+  return dec.used();
+}
+
+/*static*/
+size_t value::from_msgpack(value& _jout, const io_buffer& _in,
+                        uint32_t _maxDepth/* = max_binary_depth*/)
+{
+  return from_msgpack(_jout, _in.rd_data(), _in.rd_length(), _maxDepth);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Implementation of encoder
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void encoder::p_grow(size_t _len)
+{
+  const size_t used = ( m_p )? (m_p - m_out.data()) : m_out.length();
+  const size_t size = std::max({used + _len, 2 * m_out.length(), static_cast<size_t>(256)});
+  // The new space is not initialized, it is written before the buffer is trimmed
+  m_out.resize_and_overwrite(size, [](uint8_t*, size_t _n) { return _n; });
+  m_p = m_out.data() + used;
+  m_end = m_out.data() + size;
+}
+
+void encoder::cbor_head(uint8_t _major, uint64_t _arg)
+{
+  const uint8_t major = _major << 5;
+  if ( _arg < 24 )
+    put(static_cast<uint8_t>(major | _arg));
+  else if ( _arg <= UINT8_MAX )
+    put(major | 24, static_cast<uint8_t>(_arg));
+  else if ( _arg <= UINT16_MAX )
+    put(major | 25, static_cast<uint16_t>(_arg));
+  else if ( _arg <= UINT32_MAX )
+    put(major | 26, static_cast<uint32_t>(_arg));
+  else
+    put(major | 27, _arg);
+}
+
+void encoder::cbor_double(double _dbl)
+{
+  uint16_t half = 0;
+  if ( std::isnan(_dbl) )
+    put(0xF9, static_cast<uint16_t>(0x7E00));
+  else if ( local::to_half(_dbl, half) )
+    put(0xF9, half);
+  else if ( static_cast<double>(static_cast<float>(_dbl)) == _dbl )
+    put(0xFA, std::bit_cast<uint32_t>(static_cast<float>(_dbl)));
+  else
+    put(0xFB, std::bit_cast<uint64_t>(_dbl));
+}
+
+void encoder::cbor(const value& _jval)
+{
+  switch ( _jval.m_type )
+  {
+  case value_type::null:      put(0xF6); break;
+  case value_type::boolean:   put(_jval.m_data._bval? 0xF5 : 0xF4); break;
+  case value_type::_unsigned: cbor_head(0, _jval.m_data._u64); break;
+  case value_type::_signed:
+    if ( _jval.m_data._i64 < 0 )
+      cbor_head(1, static_cast<uint64_t>(-1 - _jval.m_data._i64));
+    else
+    {
+      cbor_head(6, value::cbor_signed_tag);
+      cbor_head(0, static_cast<uint64_t>(_jval.m_data._i64));
+    }
+    break;
+  case value_type::_double:   cbor_double(static_cast<double>(_jval.p_double())); break;
+  case value_type::string:
+  {
+    const std::string_view str = _jval.p_str();
+    cbor_head(3, str.length());
+    put(str);
+    break;
+  }
+  case value_type::array:
+    cbor_head(4, _jval.m_data._arr->size());
+    for ( const value& jval : *_jval.m_data._arr )
+      cbor(jval);
+    break;
+  case value_type::object:
+    cbor_head(5, _jval.m_data._map->size());
+    for ( const auto& entry : *_jval.m_data._map )
+    {
+      cbor(entry.first);
+      cbor(entry.second);
+    }
+    break;
+  }
+}
+
+void encoder::msgpack_head(
+  size_t  _len,
+  uint8_t _fix,
+  uint8_t _fixMax,
+  uint8_t _head8,
+  uint8_t _head16
+  )
+{
+  if ( _len <= _fixMax )
+    put(static_cast<uint8_t>(_fix | _len));
+  else if ( _head8 != 0 && _len <= UINT8_MAX )
+    put(_head8, static_cast<uint8_t>(_len));
+  else if ( _len <= UINT16_MAX )
+    put(_head16, static_cast<uint16_t>(_len));
+  else if ( _len <= UINT32_MAX )
+    put(_head16 + 1, static_cast<uint32_t>(_len));
+  else
+    throw sid::exception("Length " + sid::to_str(_len) + " is too large for MessagePack");
+}
+
+void encoder::msgpack_double(double _dbl)
+{
+  const float flt = static_cast<float>(_dbl);
+  if ( static_cast<double>(flt) == _dbl || std::isnan(_dbl) )
+    put(0xCA, std::bit_cast<uint32_t>(flt));
+  else
+    put(0xCB, std::bit_cast<uint64_t>(_dbl));
+}
+
+void encoder::msgpack(const value& _jval)
+{
+  switch ( _jval.m_type )
+  {
+  case value_type::null:      put(0xC0); break;
+  case value_type::boolean:   put(_jval.m_data._bval? 0xC3 : 0xC2); break;
+  case value_type::_unsigned:
+  {
+    const uint64_t num = _jval.m_data._u64;
+    if ( num <= INT8_MAX )
+      put(static_cast<uint8_t>(num));
+    else if ( num <= UINT8_MAX )
+      put(0xCC, static_cast<uint8_t>(num));
+    else if ( num <= UINT16_MAX )
+      put(0xCD, static_cast<uint16_t>(num));
+    else if ( num <= UINT32_MAX )
+      put(0xCE, static_cast<uint32_t>(num));
+    else
+      put(0xCF, num);
+    break;
+  }
+  case value_type::_signed:
+  {
+    // Non-negative numbers use the int formats as well, to keep the type
+    const int64_t num = _jval.m_data._i64;
+    if ( num < 0 && num >= -32 )
+      put(static_cast<uint8_t>(num));
+    else if ( num >= INT8_MIN && num <= INT8_MAX )
+      put(0xD0, static_cast<uint8_t>(num));
+    else if ( num >= INT16_MIN && num <= INT16_MAX )
+      put(0xD1, static_cast<uint16_t>(num));
+    else if ( num >= INT32_MIN && num <= INT32_MAX )
+      put(0xD2, static_cast<uint32_t>(num));
+    else
+      put(0xD3, static_cast<uint64_t>(num));
+    break;
+  }
+  case value_type::_double:   msgpack_double(static_cast<double>(_jval.p_double())); break;
+  case value_type::string:
+  {
+    const std::string_view str = _jval.p_str();
+    msgpack_head(str.length(), 0xA0, 31, 0xD9, 0xDA);
+    put(str);
+    break;
+  }
+  case value_type::array:
+    msgpack_head(_jval.m_data._arr->size(), 0x90, 15, 0, 0xDC);
+    for ( const value& jval : *_jval.m_data._arr )
+      msgpack(jval);
+    break;
+  case value_type::object:
+    msgpack_head(_jval.m_data._map->size(), 0x80, 15, 0, 0xDE);
+    for ( const auto& entry : *_jval.m_data._map )
+    {
+      msgpack(entry.first);
+      msgpack(entry.second);
+    }
+    break;
+  }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Implementation of decoder
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+uint64_t decoder::cbor_arg(uint8_t _info)
+{
+  if ( _info < 24 )
+    return _info;
+  switch ( _info )
+  {
+  case 24: return get();
+  case 25: return get<uint16_t>();
+  case 26: return get<uint32_t>();
+  case 27: return get<uint64_t>();
+  }
+  error("Invalid CBOR additional information " + sid::to_str(_info), m_p - 1);
+}
+
+std::string_view decoder::cbor_str(uint8_t _initial)
+{
+  const uint8_t info = _initial & 0x1F;
+  if ( info != 31 )
+    return get_str(cbor_arg(info));
+  // Indefinite length string: definite length chunks of the same major type up to a break
+  m_str.clear();
+  for ( ;; )
+  {
+    const uint8_t* at = m_p;
+    const uint8_t initial = get();
+    if ( initial == 0xFF )
+      break;
+    if ( (initial & 0xE0) != (_initial & 0xE0) || (initial & 0x1F) == 31 )
+      error("Invalid chunk of CBOR string", at);
+    m_str += get_str(cbor_arg(initial & 0x1F));
+  }
+  return m_str;
+}
+
+void decoder::cbor(value& _jval)
+{
+  const uint8_t* at = m_p;
+  const uint8_t initial = get();
+  const uint8_t major = initial >> 5;
+  const uint8_t info = initial & 0x1F;
+  switch ( major )
+  {
+  case 0:
+    _jval.m_data._u64 = cbor_arg(info);
+    _jval.m_type = value_type::_unsigned;
+    break;
+  case 1:
+  {
+    const uint64_t num = cbor_arg(info);
+    if ( num > static_cast<uint64_t>(INT64_MAX) )
+      error("CBOR negative integer out of range", at);
+    _jval.m_data._i64 = -1 - static_cast<int64_t>(num);
+    _jval.m_type = value_type::_signed;
+    break;
+  }
+  case 2:
+  case 3:
+    _jval.p_init(cbor_str(initial), m_resource);
+    break;
+  case 4:
+  {
+    enter(at);
+    _jval.p_init(value_type::array, m_resource);
+    value::array& arr = *_jval.m_data._arr;
+    if ( info == 31 )
+    {
+      while ( need(1), *m_p != 0xFF )
+        cbor(arr.emplace_back());
+      ++m_p;
+    }
+    else
+    {
+      const uint64_t count = cbor_arg(info);
+      arr.reserve(reserve_count(count));
+      for ( uint64_t i = 0; i < count; i++ )
+        cbor(arr.emplace_back());
+    }
+    leave();
+    break;
+  }
+  case 5:
+  {
+    enter(at);
+    _jval.p_init(value_type::object, m_resource);
+    value::object& obj = *_jval.m_data._map;
+    const bool indefinite = ( info == 31 );
+    const uint64_t count = indefinite? UINT64_MAX : cbor_arg(info);
+    if ( ! indefinite )
+      obj.reserve(reserve_count(count));
+    for ( uint64_t i = 0; i < count; i++ )
+    {
+      const uint8_t* keyAt = m_p;
+      const uint8_t keyInitial = get();
+      if ( indefinite && keyInitial == 0xFF )
+        break;
+      if ( (keyInitial >> 5) != 2 && (keyInitial >> 5) != 3 )
+        error("CBOR map key must be a string", keyAt);
+      // A duplicate key keeps the last value
+      value& jval = obj[cbor_str(keyInitial)];
+      jval.clear();
+      cbor(jval);
+    }
+    leave();
+    break;
+  }
+  case 6:
+  {
+    const uint64_t tag = cbor_arg(info);
+    if ( tag != value::cbor_signed_tag )
+    {
+      enter(at);
+      cbor(_jval);
+      leave();
+      return;
+    }
+    const uint8_t* numAt = m_p;
+    const uint8_t numInitial = get();
+    if ( (numInitial >> 5) != 0 )
+      error("CBOR tag " + sid::to_str(tag) + " must be followed by an unsigned integer", numAt);
+    const uint64_t num = cbor_arg(numInitial & 0x1F);
+    if ( num > static_cast<uint64_t>(INT64_MAX) )
+      error("CBOR signed integer out of range", numAt);
+    _jval.m_data._i64 = static_cast<int64_t>(num);
+    _jval.m_type = value_type::_signed;
+    break;
+  }
+  default:
+    switch ( info )
+    {
+    case 20:
+    case 21:
+      _jval.m_data._bval = ( info == 21 );
+      _jval.m_type = value_type::boolean;
+      break;
+    case 22:
+    case 23: // undefined
+      break;
+    case 25:
+      _jval.p_init(local::from_half(get<uint16_t>()));
+      break;
+    case 26:
+      _jval.p_init(std::bit_cast<float>(get<uint32_t>()));
+      break;
+    case 27:
+      _jval.p_init(std::bit_cast<double>(get<uint64_t>()));
+      break;
+    default:
+      error("Unsupported CBOR simple value " + sid::to_str(info), at);
+    }
+    break;
+  }
+}
+
+void decoder::msgpack_array(value& _jval, size_t _count, const uint8_t* _at)
+{
+  enter(_at);
+  _jval.p_init(value_type::array, m_resource);
+  value::array& arr = *_jval.m_data._arr;
+  arr.reserve(reserve_count(_count));
+  for ( size_t i = 0; i < _count; i++ )
+    msgpack(arr.emplace_back());
+  leave();
+}
+
+std::string_view decoder::msgpack_key()
+{
+  const uint8_t* at = m_p;
+  const uint8_t initial = get();
+  if ( (initial & 0xE0) == 0xA0 )
+    return get_str(initial & 0x1F);
+  switch ( initial )
+  {
+  case 0xC4: case 0xD9: return get_str(get());
+  case 0xC5: case 0xDA: return get_str(get<uint16_t>());
+  case 0xC6: case 0xDB: return get_str(get<uint32_t>());
+  }
+  error("MessagePack map key must be a string", at);
+}
+
+void decoder::msgpack_map(value& _jval, size_t _count, const uint8_t* _at)
+{
+  enter(_at);
+  _jval.p_init(value_type::object, m_resource);
+  value::object& obj = *_jval.m_data._map;
+  obj.reserve(reserve_count(_count));
+  for ( size_t i = 0; i < _count; i++ )
+  {
+    // A duplicate key keeps the last value
+    value& jval = obj[msgpack_key()];
+    jval.clear();
+    msgpack(jval);
+  }
+  leave();
+}
+
+void decoder::msgpack(value& _jval)
+{
+  const uint8_t* at = m_p;
+  const uint8_t initial = get();
+  if ( initial <= 0x7F )
+  {
+    _jval.m_data._u64 = initial;
+    _jval.m_type = value_type::_unsigned;
+    return;
+  }
+  if ( initial >= 0xE0 )
+  {
+    _jval.m_data._i64 = static_cast<int8_t>(initial);
+    _jval.m_type = value_type::_signed;
+    return;
+  }
+  switch ( initial & 0xF0 )
+  {
+  case 0x80: return msgpack_map(_jval, initial & 0x0F, at);
+  case 0x90: return msgpack_array(_jval, initial & 0x0F, at);
+  case 0xA0:
+  case 0xB0: return _jval.p_init(get_str(initial & 0x1F), m_resource);
+  }
+  switch ( initial )
+  {
+  case 0xC0: break;
+  case 0xC2:
+  case 0xC3:
+    _jval.m_data._bval = ( initial == 0xC3 );
+    _jval.m_type = value_type::boolean;
+    break;
+  case 0xC4: case 0xD9: _jval.p_init(get_str(get()), m_resource); break;
+  case 0xC5: case 0xDA: _jval.p_init(get_str(get<uint16_t>()), m_resource); break;
+  case 0xC6: case 0xDB: _jval.p_init(get_str(get<uint32_t>()), m_resource); break;
+  case 0xCA:
+    _jval.p_init(std::bit_cast<float>(get<uint32_t>()));
+    break;
+  case 0xCB:
+    _jval.p_init(std::bit_cast<double>(get<uint64_t>()));
+    break;
+  case 0xCC: _jval.m_data._u64 = get(); _jval.m_type = value_type::_unsigned; break;
+  case 0xCD: _jval.m_data._u64 = get<uint16_t>(); _jval.m_type = value_type::_unsigned; break;
+  case 0xCE: _jval.m_data._u64 = get<uint32_t>(); _jval.m_type = value_type::_unsigned; break;
+  case 0xCF: _jval.m_data._u64 = get<uint64_t>(); _jval.m_type = value_type::_unsigned; break;
+  case 0xD0: _jval.m_data._i64 = static_cast<int8_t>(get()); _jval.m_type = value_type::_signed; break;
+  case 0xD1: _jval.m_data._i64 = static_cast<int16_t>(get<uint16_t>()); _jval.m_type = value_type::_signed; break;
+  case 0xD2: _jval.m_data._i64 = static_cast<int32_t>(get<uint32_t>()); _jval.m_type = value_type::_signed; break;
+  case 0xD3: _jval.m_data._i64 = static_cast<int64_t>(get<uint64_t>()); _jval.m_type = value_type::_signed; break;
+  case 0xDC: msgpack_array(_jval, get<uint16_t>(), at); break;
+  case 0xDD: msgpack_array(_jval, get<uint32_t>(), at); break;
+  case 0xDE: msgpack_map(_jval, get<uint16_t>(), at); break;
+  case 0xDF: msgpack_map(_jval, get<uint32_t>(), at); break;
+  default:
+    error("Unsupported MessagePack type " + sid::to_str(static_cast<int>(initial)), at);
+  }
+}
@@ -0,0 +1,202 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@file json_cache.cpp
+@brief Json value with the text of its objects and arrays cached
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+/**
+ * @file  json_cache.cpp
+ * @brief Implementation of the json value with the text of its objects and arrays cached
+ */
+#include <common/json_cache.hpp>
+#include "json_serializer.h"
+#include <cctype>
+
+using namespace sid;
+using namespace sid::json;
+
+cached_value::cached_value(const format& _format/* = format()*/)
+  : m_format(_format)
+{
+  if ( ! ::isspace(_format.separator) && _format.separator != '\0' )
+    throw sid::exception("Format separator must be a valid space character. It cannot be \""
+                         + std::string(1, _format.separator) + "\"");
+}
+
+cached_value::cached_value(value&& _root, const format& _format/* = format()*/)
+  : cached_value(_format)
+{
+  m_root = std::move(_root);
+}
+
+value& cached_value::at(const path& _path)
+{
+  std::vector<const value*> trail;
+  const value* pval = _path.find(m_root, trail);
+  if ( pval == nullptr )
+    throw sid::exception("json::cached_value: no value at " + _path.to_str());
+  // The values leading to the value are objects or arrays
+  for ( const value* pparent : trail )
+  {
+    auto it = m_entries.find(p_key(*pparent));
+    if ( it != m_entries.end() )
+      it->second.isDirty = true;
+  }
+  p_drop(*pval);
+  return const_cast<value&>(*pval);
+}
+
+void cached_value::reset(value&& _root)
+{
+  invalidate();
+  m_root = std::move(_root);
+}
+
+void cached_value::invalidate()
+{
+  m_entries.clear();
+  m_text.clear();
+}
+
+const std::string& cached_value::to_str()
+{
+  m_stats.clear();
+  if ( ! m_root.is_complex_type() )
+    throw sid::exception("Can be applied only on a object or array");
+
+  // Nothing changed since the last call
+  auto it = m_entries.find(p_key(m_root));
+  if ( it != m_entries.end() && ! it->second.isDirty )
+  {
+    m_stats.spliced = 1;
+    m_stats.splicedBytes = m_text.length();
+    return m_text;
+  }
+
+  m_next.clear();
+  m_next.reserve(m_text.length());
+  p_write(m_root, 0, m_text.empty()? std::string::npos : 0, 0);
+  m_text.swap(m_next);
+  return m_text;
+}
+
+/*static*/
+const void* cached_value::p_key(const value& _jval)
+{
+  return ( _jval.is_object() )? static_cast<const void*>(_jval.m_data._map)
+    : static_cast<const void*>(_jval.m_data._arr);
+}
+
+void cached_value::p_drop(const value& _jval)
+{
+  if ( _jval.is_object() )
+  {
+    m_entries.erase(p_key(_jval));
+    for ( const auto& entry : *_jval.m_data._map )
+      p_drop(entry.second);
+  }
+  else if ( _jval.is_array() )
+  {
+    m_entries.erase(p_key(_jval));
+    for ( const value& jelem : *_jval.m_data._arr )
+      p_drop(jelem);
+  }
+}
+
+void cached_value::p_write(const value& _jval, uint32_t _level, size_t _oldParent, size_t _newParent)
+{
+  const size_t start = m_next.length();
+  size_t oldStart = std::string::npos;
+  // The entries are kept by reference, which the insertions of the nested values do not change
+  entry* pentry = nullptr;
+  auto it = m_entries.find(p_key(_jval));
+  if ( it != m_entries.end() )
+  {
+    pentry = &it->second;
+    if ( _oldParent != std::string::npos )
+    {
+      if ( ! pentry->isDirty )
+      {
+        // The text is copied as it is, including that of the nested values, whose positions
+        // are relative to their parents
+        m_next.append(m_text, _oldParent + pentry->offset, pentry->length);
+        pentry->offset = start - _newParent;
+        m_stats.spliced++;
+        m_stats.splicedBytes += pentry->length;
+        return;
+      }
+      oldStart = _oldParent + pentry->offset;
+    }
+  }
+
+  // The containers are laid out by the serializer, a piece at a time so that the text of the
+  // nested containers can be spliced in between
+  auto write_value = [&](const value& _jelem)
+    {
+      if ( _jelem.is_complex_type() )
+        p_write(_jelem, _level+1, oldStart, start);
+      else
+        serializer(m_next, m_format).write(_jelem, _level+1);
+    };
+  bool isFirst = true;
+  if ( _jval.is_object() )
+  {
+    m_next += '{';
+    for ( const auto& entry : *_jval.m_data._map )
+    {
+      {
+        serializer out(m_next, m_format);
+        out.begin_entry(isFirst, _level+1);
+        out.write_key(entry.first.p_str());
+      }
+      isFirst = false;
+      write_value(entry.second);
+    }
+  }
+  else
+  {
+    m_next += '[';
+    for ( const value& jelem : *_jval.m_data._arr )
+    {
+      serializer(m_next, m_format).begin_entry(isFirst, _level+1);
+      isFirst = false;
+      write_value(jelem);
+    }
+  }
+  serializer(m_next, m_format).end_container(!isFirst, _level, _jval.is_object()? '}' : ']');
+  m_stats.encoded++;
+
+  if ( pentry == nullptr )
+    pentry = &m_entries[p_key(_jval)];
+  pentry->offset = start - _newParent;
+  pentry->length = m_next.length() - start;
+  pentry->isDirty = false;
+}
@@ -0,0 +1,650 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@file json_lazy.cpp
+@brief Lazy json document decoded only where it is accessed
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+/**
+ * @file  json_lazy.cpp
+ * @brief Implementation of the lazy json document
+ */
+#include <common/json_lazy.hpp>
+#include <common/convert.hpp>
+#include <common/util.hpp>
+#include "json_lexer.h"
+#include <deque>
+#include <unordered_map>
+
+using namespace sid;
+using namespace sid::json;
+
+namespace sid {
+namespace json {
+
+/**
+ * @struct lazy_document::impl
+ * @brief Tape of the tokens of the input, and the indexes built as the document is accessed
+ */
+struct lazy_document::impl : public lexer
+{
+  /**
+   * @struct token
+   * @brief A value of the input. The keys of an object are string tokens, each followed by
+   *        the tokens of its value.
+   */
+  struct token
+  {
+    uint32_t   offset;  //! Position of the first character in the input
+    uint32_t   length;  //! Number of characters in the input, including quotes and brackets
+    uint32_t   next;    //! Position in the tape of the token following the value
+    uint32_t   count;   //! Number of members of an object or an array
+    value_type type;    //! Type of the value
+    bool       escaped; //! The string has escape sequences
+  };
+
+  //! Number of members up to which an object or an array is searched without an index
+  static constexpr uint32_t index_threshold = 8;
+
+  std::string_view   m_input;   //! Input of the document
+  util::mapped_file  m_file;    //! Input of parse_file()
+  std::vector<token> m_tape;
+  // Built on the first access
+  std::unordered_map<uint32_t, std::unordered_map<std::string_view, uint32_t>> m_objects;
+  std::unordered_map<uint32_t, std::vector<uint32_t>> m_arrays;
+  std::deque<std::string> m_keys; //! Decoded keys with escape sequences, used by m_objects
+
+  void scan(std::string_view _input);
+  void reset_tape();
+
+  const token& tok(uint32_t _pos) const { return m_tape[_pos]; }
+  //! Json text of the token
+  std::string_view text(uint32_t _pos) const {
+    return m_input.substr(m_tape[_pos].offset, m_tape[_pos].length);
+  }
+  //! Characters of a string token without escape sequences
+  std::string_view chars(uint32_t _pos) const {
+    return m_input.substr(m_tape[_pos].offset + 1, m_tape[_pos].length - 2);
+  }
+  std::string decode_str(uint32_t _pos);
+  number decode_num(uint32_t _pos);
+  //! Position of the value of the given key of the object, 0 if the key does not exist
+  uint32_t find(uint32_t _obj, std::string_view _key);
+  //! Position of the element at the given index of the array
+  uint32_t element_at(uint32_t _arr, size_t _index);
+
+private:
+  uint32_t p_push(value_type _type, const char* _p);
+  void p_value();
+  void p_object();
+  void p_array();
+  void p_string();
+  void p_number();
+  void p_literal();
+};
+
+} // namespace json
+} // namespace sid
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Implementation of the tape
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void lazy_document::impl::reset_tape()
+{
+  m_tape.clear();
+  m_objects.clear();
+  m_arrays.clear();
+  m_keys.clear();
+}
+
+void lazy_document::impl::scan(std::string_view _input)
+{
+  if ( _input.length() >= UINT32_MAX )
+    throw sid::exception("Input of lazy document must be less than 4 GB");
+  reset_tape();
+  m_input = _input;
+  reset(_input.data(), _input.length());
+  // A token for about every 8 characters of typical json
+  m_tape.reserve(_input.length() / 8);
+
+  REMOVE_LEADING_SPACES(m_p);
+  const char ch = at(m_p);
+  if ( ch != '{' && ch != '[' )
+    root_error();
+  p_value();
+  REMOVE_LEADING_SPACES(m_p);
+  if ( at(m_p) != '\0' )
+    throw sid::exception(std::string("Invalid character [") + at(m_p) + "] " + loc_str()
+                         + " after the root is closed");
+}
+
+uint32_t lazy_document::impl::p_push(value_type _type, const char* _p)
+{
+  const uint32_t pos = static_cast<uint32_t>(m_tape.size());
+  token& t = m_tape.emplace_back();
+  t.offset = static_cast<uint32_t>(_p - m_begin);
+  t.length = 0;
+  t.next = pos + 1;
+  t.count = 0;
+  t.type = _type;
+  t.escaped = false;
+  return pos;
+}
+
+void lazy_document::impl::p_value()
+{
+  REMOVE_LEADING_SPACES(m_p);
+  const char ch = at(m_p);
+  if ( ch == '{' )
+    p_object();
+  else if ( ch == '[' )
+    p_array();
+  else if ( ch == '\"' )
+    p_string();
+  else if ( ch == '-' || (ch >= '0' && ch <= '9') )
+    p_number();
+  else if ( ch == 't' || ch == 'f' || ch == 'n' )
+    p_literal();
+  else if ( ch == '\0' )
+    throw sid::exception("End of data reached " + loc_str() + ". Expecting a value");
+  else
+    throw sid::exception("Expected value not found " + loc_str());
+}
+
+void lazy_document::impl::p_object()
+{
+  const char* start = m_p;
+  const uint32_t pos = p_push(value_type::object, start);
+  uint32_t count = 0;
+  ++m_p;
+  REMOVE_LEADING_SPACES(m_p);
+  if ( at(m_p) != '}' )
+  {
+    for ( ;; )
+    {
+      REMOVE_LEADING_SPACES(m_p);
+      // A comma before the end of the object is accepted, as by the parser
+      if ( at(m_p) == '}' && count > 0 )
+        break;
+      if ( at(m_p) != '\"' )
+        throw sid::exception("Expected \" for the key " + loc_str());
+      p_string();
+      REMOVE_LEADING_SPACES(m_p);
+      if ( at(m_p) != ':' )
+        throw sid::exception("Expected : after the key " + loc_str());
+      ++m_p;
+      p_value();
+      ++count;
+      REMOVE_LEADING_SPACES(m_p);
+      const char ch = at(m_p);
+      if ( ch == '}' )
+        break;
+      if ( ch != ',' )
+        throw sid::exception("Encountered " + std::string(1, ch) + ". Expected , or } " + loc_str());
+      ++m_p;
+    }
+  }
+  ++m_p;
+  token& t = m_tape[pos];
+  t.length = static_cast<uint32_t>(m_p - start);
+  t.next = static_cast<uint32_t>(m_tape.size());
+  t.count = count;
+}
+
+void lazy_document::impl::p_array()
+{
+  const char* start = m_p;
+  const uint32_t pos = p_push(value_type::array, start);
+  uint32_t count = 0;
+  ++m_p;
+  REMOVE_LEADING_SPACES(m_p);
+  if ( at(m_p) != ']' )
+  {
+    for ( ;; )
+    {
+      REMOVE_LEADING_SPACES(m_p);
+      if ( at(m_p) == ']' && count > 0 )
+        break;
+      p_value();
+      ++count;
+      REMOVE_LEADING_SPACES(m_p);
+      const char ch = at(m_p);
+      if ( ch == ']' )
+        break;
+      if ( ch != ',' )
+        throw sid::exception("Expected , or ] " + loc_str());
+      ++m_p;
+    }
+  }
+  ++m_p;
+  token& t = m_tape[pos];
+  t.length = static_cast<uint32_t>(m_p - start);
+  t.next = static_cast<uint32_t>(m_tape.size());
+  t.count = count;
+}
+
+void lazy_document::impl::p_string()
+{
+  // Only the end of the string is searched, and the escape sequences checked
+  const char* start = m_p;
+  const uint32_t pos = p_push(value_type::string, start);
+  bool escaped = false;
+  for ( ++m_p; ; )
+  {
+    m_p = simd::find_string_special(m_p, m_end);
+    const char ch = at(m_p);
+    if ( ch == '\"' )
+      break;
+    if ( ch == '\0' )
+      throw sid::exception("Missing \" for string starting " + loc_str(start));
+    escaped = true;
+    switch ( at(++m_p) )
+    {
+    case '/': case 'b': case 'f': case 'n': case 'r': case 't': case '\\': case '\"':
+      ++m_p;
+      break;
+    case 'u':
+      for ( int i = 0; i < 4; i++ )
+        if ( ! ::isxdigit(at(++m_p)) )
+          throw sid::exception("Missing hexadecimal character at " + loc_str());
+      ++m_p;
+      break;
+    case '\0':
+      throw sid::exception("Missing escape sequence characters at the end position " + loc_str());
+    default:
+      throw sid::exception("Invalid escape sequence (" + std::string(1, at(m_p)) +
+                           ") for string at " + loc_str());
+    }
+  }
+  ++m_p;
+  token& t = m_tape[pos];
+  t.length = static_cast<uint32_t>(m_p - start);
+  t.escaped = escaped;
+}
+
+void lazy_document::impl::p_number()
+{
+  // Only the syntax is checked here. The number is converted when it is read.
+  const char* start = m_p;
+  auto digits = [&]()->bool
+    {
+      const char* first = m_p;
+      while ( at(m_p) >= '0' && at(m_p) <= '9' )
+        ++m_p;
+      return ( m_p != first );
+    };
+  const bool isNegative = ( at(m_p) == '-' );
+  if ( isNegative )
+    ++m_p;
+  if ( at(m_p) == '0' )
+  {
+    ++m_p;
+    if ( at(m_p) >= '0' && at(m_p) <= '9' )
+      throw sid::exception("Invalid digit (" + std::string(1, at(m_p)) + ") after first 0 " + loc_str());
+  }
+  else if ( ! digits() )
+    throw sid::exception("Missing integer digit" + loc_str());
+  bool isDouble = false;
+  if ( at(m_p) == '.' )
+  {
+    ++m_p;
+    if ( ! digits() )
+      throw sid::exception("Invalid digit (" + std::string(1, at(m_p))
+                           + ") Expected a digit for fraction " + loc_str());
+    isDouble = true;
+  }
+  if ( at(m_p) == 'e' || at(m_p) == 'E' )
+  {
+    ++m_p;
+    if ( at(m_p) == '-' || at(m_p) == '+' )
+      ++m_p;
+    if ( ! digits() )
+      throw sid::exception("Invalid digit (" + std::string(1, at(m_p))
+                           + ") Expected a digit for exponent " + loc_str());
+    isDouble = true;
+  }
+  const value_type type = isDouble? value_type::_double
+    : isNegative? value_type::_signed : value_type::_unsigned;
+  const uint32_t pos = p_push(type, start);
+  m_tape[pos].length = static_cast<uint32_t>(m_p - start);
+}
+
+void lazy_document::impl::p_literal()
+{
+  const char* start = m_p;
+  const std::string_view rest(m_p, m_end - m_p);
+  value_type type = value_type::null;
+  if ( rest.starts_with("true") || rest.starts_with("null") )
+    m_p += 4;
+  else if ( rest.starts_with("false") )
+    m_p += 5;
+  else
+    throw sid::exception("Expected value not found " + loc_str());
+  if ( *start != 'n' )
+    type = value_type::boolean;
+  const uint32_t pos = p_push(type, start);
+  m_tape[pos].length = static_cast<uint32_t>(m_p - start);
+}
+
+std::string lazy_document::impl::decode_str(uint32_t _pos)
+{
+  const token& t = m_tape[_pos];
+  if ( ! t.escaped )
+    return std::string(chars(_pos));
+  // The lexer decodes the string the same way the parser does
+  reset(m_input.data() + t.offset, t.length);
+  m_containerStack.push(value_type::array);
+  std::string str;
+  parse_string(str, false);
+  return str;
+}
+
+lexer::number lazy_document::impl::decode_num(uint32_t _pos)
+{
+  const token& t = m_tape[_pos];
+  if ( t.type != value_type::_signed && t.type != value_type::_unsigned && t.type != value_type::_double )
+    throw sid::exception("Can be used only for number type");
+  reset(m_input.data() + t.offset, t.length);
+  m_containerStack.push(value_type::array);
+  number num;
+  parse_number(num, true);
+  return num;
+}
+
+uint32_t lazy_document::impl::find(uint32_t _obj, std::string_view _key)
+{
+  const token& obj = m_tape[_obj];
+  if ( obj.type != value_type::object )
+    throw sid::exception("Can be used only for object type");
+
+  if ( obj.count > index_threshold )
+  {
+    auto it = m_objects.find(_obj);
+    if ( it == m_objects.end() )
+    {
+      // Index the keys of the object the first time it is searched. A later duplicate
+      // key overwrites the earlier one.
+      std::unordered_map<std::string_view, uint32_t>& index = m_objects[_obj];
+      index.reserve(obj.count);
+      for ( uint32_t key = _obj + 1; key < obj.next; key = m_tape[key + 1].next )
+      {
+        std::string_view name = chars(key);
+        if ( m_tape[key].escaped )
+          name = m_keys.emplace_back(decode_str(key));
+        index[name] = key + 1;
+      }
+      it = m_objects.find(_obj);
+    }
+    auto found = it->second.find(_key);
+    return ( found != it->second.end() )? found->second : 0;
+  }
+
+  uint32_t pos = 0;
+  for ( uint32_t key = _obj + 1; key < obj.next; key = m_tape[key + 1].next )
+  {
+    const bool matches = m_tape[key].escaped? (decode_str(key) == _key) : (chars(key) == _key);
+    if ( matches )
+      pos = key + 1;
+  }
+  return pos;
+}
+
+uint32_t lazy_document::impl::element_at(uint32_t _arr, size_t _index)
+{
+  const token& arr = m_tape[_arr];
+  if ( arr.type != value_type::array )
+    throw sid::exception("Can be used only for array type");
+  if ( _index >= arr.count )
+    throw sid::exception("index(" + sid::to_str(_index) + ") out of range("
+                         + sid::to_str(arr.count) + ")");
+
+  if ( arr.count > index_threshold )
+  {
+    // Index the positions of the elements the first time the array is accessed
+    std::vector<uint32_t>& index = m_arrays[_arr];
+    if ( index.empty() )
+    {
+      index.reserve(arr.count);
+      for ( uint32_t pos = _arr + 1; pos < arr.next; pos = m_tape[pos].next )
+        index.push_back(pos);
+    }
+    return index[_index];
+  }
+
+  uint32_t pos = _arr + 1;
+  for ( size_t i = 0; i < _index; i++ )
+    pos = m_tape[pos].next;
+  return pos;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Implementation of lazy_document
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+lazy_document::lazy_document() : m_impl(new impl)
+{
+}
+
+lazy_document::~lazy_document()
+{
+}
+
+bool lazy_document::parse(std::string_view _value)
+{
+  try
+  {
+    m_impl->scan(_value);
+  }
+  catch (...)
+  {
+    clear();
+    throw;
+  }
+  return true;
+}
+
+bool lazy_document::parse_file(const std::string& _filePath)
+{
+  clear();
+  m_impl->m_file.open(_filePath);
+  return parse(m_impl->m_file.view());
+}
+
+void lazy_document::clear()
+{
+  m_impl->reset_tape();
+  m_impl->m_input = std::string_view();
+  m_impl->m_file.close();
+}
+
+bool lazy_document::empty() const
+{
+  return m_impl->m_tape.empty();
+}
+
+lazy_document::element lazy_document::root() const
+{
+  if ( empty() )
+    throw sid::exception("Lazy document is empty");
+  return element(this, 0);
+}
+
+size_t lazy_document::tape_size() const
+{
+  return m_impl->m_tape.size();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Implementation of lazy_document::element
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+value_type lazy_document::element::type() const
+{
+  return m_doc->m_impl->tok(m_pos).type;
+}
+
+size_t lazy_document::element::size() const
+{
+  const impl::token& t = m_doc->m_impl->tok(m_pos);
+  if ( t.type != value_type::object && t.type != value_type::array )
+    throw sid::exception(__func__ + std::string(": can be used only for object or array type"));
+  return t.count;
+}
+
+lazy_document::element lazy_document::element::operator[](const size_t _index) const
+{
+  return element(m_doc, m_doc->m_impl->element_at(m_pos, _index));
+}
+
+lazy_document::element lazy_document::element::operator[](std::string_view _key) const
+{
+  const uint32_t pos = m_doc->m_impl->find(m_pos, _key);
+  if ( pos == 0 )
+    throw sid::exception(__func__ + std::string(": key(") + std::string(_key) + ") not found");
+  return element(m_doc, pos);
+}
+
+std::optional<lazy_document::element> lazy_document::element::find(std::string_view _key) const
+{
+  const uint32_t pos = m_doc->m_impl->find(m_pos, _key);
+  if ( pos == 0 )
+    return std::nullopt;
+  return element(m_doc, pos);
+}
+
+int64_t lazy_document::element::get_int64() const
+{
+  const lexer::number num = m_doc->m_impl->decode_num(m_pos);
+  if ( num.type == value_type::_signed )
+    return num.i64;
+  if ( num.type == value_type::_unsigned && num.u64 <= static_cast<uint64_t>(INT64_MAX) )
+    return static_cast<int64_t>(num.u64);
+  if ( num.type == value_type::_double )
+    return static_cast<int64_t>(num.dbl);
+  throw sid::exception(__func__ + std::string(": ") + std::string(raw()) + " is out of range");
+}
+
+uint64_t lazy_document::element::get_uint64() const
+{
+  const lexer::number num = m_doc->m_impl->decode_num(m_pos);
+  if ( num.type == value_type::_unsigned )
+    return num.u64;
+  if ( num.type == value_type::_signed && num.i64 >= 0 )
+    return static_cast<uint64_t>(num.i64);
+  if ( num.type == value_type::_double )
+    return static_cast<uint64_t>(num.dbl);
+  throw sid::exception(__func__ + std::string(": ") + std::string(raw()) + " is out of range");
+}
+
+float_type lazy_document::element::get_double() const
+{
+  const lexer::number num = m_doc->m_impl->decode_num(m_pos);
+  if ( num.type == value_type::_signed )
+    return static_cast<float_type>(num.i64);
+  if ( num.type == value_type::_unsigned )
+    return static_cast<float_type>(num.u64);
+  return num.dbl;
+}
+
+bool lazy_document::element::get_bool() const
+{
+  if ( type() != value_type::boolean )
+    throw sid::exception(__func__ + std::string("() can be used only for boolean type"));
+  return raw()[0] == 't';
+}
+
+std::string lazy_document::element::get_str() const
+{
+  if ( type() != value_type::string )
+    throw sid::exception(__func__ + std::string("() can be used only for string type"));
+  return m_doc->m_impl->decode_str(m_pos);
+}
+
+std::string_view lazy_document::element::raw() const
+{
+  return m_doc->m_impl->text(m_pos);
+}
+
+void lazy_document::element::get(value& _jout) const
+{
+  switch ( type() )
+  {
+  case value_type::null:      _jout.clear(); break;
+  case value_type::boolean:   _jout = get_bool(); break;
+  case value_type::string:    _jout = get_str(); break;
+  case value_type::_signed:   _jout = get_int64(); break;
+  case value_type::_unsigned: _jout = get_uint64(); break;
+  case value_type::_double:   _jout = get_double(); break;
+  case value_type::object:
+  case value_type::array:
+    // The text of the container has already been validated
+    value::parse(_jout, raw());
+    break;
+  }
+}
+
+lazy_document::element::iterator lazy_document::element::begin() const
+{
+  const bool isObject = ( type() == value_type::object );
+  if ( ! isObject && type() != value_type::array )
+    throw sid::exception(__func__ + std::string(": can be used only for object or array type"));
+  return iterator(m_doc, m_pos + 1, isObject);
+}
+
+lazy_document::element::iterator lazy_document::element::end() const
+{
+  const bool isObject = ( type() == value_type::object );
+  if ( ! isObject && type() != value_type::array )
+    throw sid::exception(__func__ + std::string(": can be used only for object or array type"));
+  return iterator(m_doc, m_doc->m_impl->tok(m_pos).next, isObject);
+}
+
+lazy_document::element lazy_document::element::iterator::operator*() const
+{
+  return element(m_doc, m_isObject? m_pos + 1 : m_pos);
+}
+
+std::string lazy_document::element::iterator::key() const
+{
+  if ( ! m_isObject )
+    throw sid::exception(__func__ + std::string(": can be used only for object members"));
+  return m_doc->m_impl->decode_str(m_pos);
+}
+
+lazy_document::element::iterator& lazy_document::element::iterator::operator++()
+{
+  const uint32_t value = m_isObject? m_pos + 1 : m_pos;
+  m_pos = m_doc->m_impl->tok(value).next;
+  return *this;
+}
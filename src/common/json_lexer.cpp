@@ -0,0 +1,591 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@file json_lexer.cpp
+@brief Lexical scanner shared by the json parser and reader
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+/**
+ * @file  json_lexer.cpp
+ * @brief Implementation of the lexical scanner shared by the json parser and reader
+ */
+#include "json_lexer.h"
+#include <common/convert.hpp>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+using namespace sid;
+using namespace sid::json;
+
+void lexer::reset(const char* _data, size_t _len)
+{
+  m_p = m_begin = _data;
+  m_end = _data + _len;
+  m_lines = m_column = 0;
+  while ( ! m_containerStack.empty() )
+    m_containerStack.pop();
+}
+
+void lexer::consume()
+{
+  const char* lineBegin = nullptr;
+  for ( const char* q = m_begin;
+        q < m_p && (q = static_cast<const char*>(::memchr(q, '\n', m_p - q))) != nullptr;
+        q++ )
+  {
+    ++m_lines;
+    lineBegin = q + 1;
+  }
+  if ( lineBegin )
+    m_column = m_p - lineBegin;
+  else
+    m_column += m_p - m_begin;
+  m_begin = m_p;
+}
+
+char lexer::p_end_of_input() const
+{
+  if ( m_partial )
+    throw need_more();
+  return '\0';
+}
+
+std::string lexer::loc_str(const char* p) const
+{
+  if ( p > m_end ) p = m_end;
+  uint64_t lineCount = 1 + m_lines;
+  uint64_t column = m_column;
+  const char* lineBegin = m_begin;
+  for ( const char* q = m_begin;
+        q < p && (q = static_cast<const char*>(::memchr(q, '\n', p - q))) != nullptr;
+        q++ )
+  {
+    ++lineCount;
+    lineBegin = q + 1;
+    column = 0;
+  }
+  return std::string("@line:") + sid::to_str(lineCount) + ", @pos:" + sid::to_str(column+(p-lineBegin)+1);
+}
+
+void lexer::root_error() const
+{
+  const char ch = at(m_p);
+  if ( ch != '\0' )
+    throw sid::exception(std::string("Invalid character [") + ch + "] " + loc_str()
+                         + ". Expecting { or [");
+  throw sid::exception(std::string("End of data reached ") + loc_str() + ". Expecting { or [");
+}
+
+void lexer::range_error(const char* _begin, const char* _end) const
+{
+  throw sid::exception(ERANGE, sid::to_errno_str(ERANGE, "Failed to convert ["
+                                                 + std::string(_begin, _end-_begin)
+                                                 + "] to long double value " + loc_str(_begin)));
+}
+
+void lexer::p_skip_comments(const char*& _p)
+{
+  do
+  {
+    if ( at(_p+1) == '/' )
+    {
+      // C++ style comment encountered. Parse until end of line
+      const void* eol = ( _p < m_end )? ::memchr(_p, '\n', m_end - _p) : nullptr;
+      _p = ( eol )? static_cast<const char*>(eol) : m_end;
+    }
+    else if ( at(_p+1) == '*' )
+    {
+      const char* old_p = _p;
+      // C style comment encountered. Parse until */
+      do
+      {
+        for ( _p++; at(_p) != '*' && at(_p) != '\0'; _p++ );
+        if ( at(_p) != '*' )
+          throw sid::exception(std::string("Comments starting " + loc_str(old_p))
+                               + " is not closed");
+      }
+      while ( at(_p+1) != '/' );
+      _p += 2;
+    }
+    else
+      return; // Not a comment. Let the caller report the unexpected character.
+
+    if ( simd::is_space(at(_p)) )
+      _p = simd::skip_spaces(_p + 1, m_end);
+  }
+  while ( at(_p) == '/' );
+}
+
+void lexer::parse_string(std::string& _str, bool _isKey)
+{
+  _str.clear();
+  const char chContainer = container_end();
+  bool hasQuotes = true;
+  if ( ( _isKey && m_ctrl.mode.allowFlexibleKeys ) || ( ! _isKey && m_ctrl.mode.allowFlexibleStrings ) )
+    hasQuotes = (at(m_p) == '\"');
+  else if ( at(m_p) != '\"' )
+    throw sid::exception("Expected \" " + loc_str() + ", found \"" + std::string(1, at(m_p)) + "\"");
+
+  const char* old_p = m_p;
+
+  auto check_hex = [&](char ch)->char
+    {
+      if ( ch == '\0' )
+        throw sid::exception("Missing hexadecimal sequence characters at the end position "
+                             + loc_str());
+      if ( ! ::isxdigit(ch) )
+        throw sid::exception("Missing hexadecimal character at " + loc_str());
+      return ch;
+    };
+
+  char ch = 0;
+  if ( !hasQuotes )
+    --m_p;
+
+  while ( true )
+  {
+    if ( hasQuotes )
+    {
+      // Copy the run of plain characters up to the next quote, escape or end of data in one go
+      const char* run = m_p + 1;
+      m_p = simd::find_string_special(run, m_end);
+      _str.append(run, m_p - run);
+      ch = at(m_p);
+      if ( ch == '\"' ) break;
+      if ( ch == '\0' )
+        throw sid::exception("Missing \" for string starting " + loc_str(old_p));
+    }
+    else
+    {
+      ch = at(++m_p);
+      // Cannot have double-quotes, it must be escaped
+      if ( ch == '\"' ) throw sid::exception("Character \" must be escaped " + loc_str());
+      // A space character denotes end of the string
+      if ( simd::is_space(ch) )
+        break;
+      // For a key : denotes end of the key
+      // For a value , and the end of container key denotes end of the value
+      if ( ( _isKey && ch == ':' ) || ( ! _isKey && (ch == ',' || ch == chContainer) ) )
+        { --m_p; break; }
+      if ( ch == '\0' )
+        throw sid::exception("End of string character not found for string starting " + loc_str());
+      if ( ch != '\\' ) { _str += ch; continue; }
+    }
+    // We're encountered an escape character. Process it
+    {
+      ch = at(++m_p);
+      switch ( ch )
+      {
+      case '/':  _str += ch;   break;
+      case 'b':  _str += '\b'; break;
+      case 'f':  _str += '\f'; break;
+      case 'n':  _str += '\n'; break;
+      case 'r':  _str += '\r'; break;
+      case 't':  _str += '\t'; break;
+      case '\\': _str += ch;   break;
+      case '\"': _str += ch;   break;
+      case 'u':
+      {
+        const char* p = m_p;
+        // Must be followed by 4 hex digits
+        for ( int i = 0; i < 4; i++ )
+          check_hex(at(++m_p));
+        _str.append(p-1, 6);
+      }
+      break;
+      case '\0':
+        throw sid::exception("Missing escape sequence characters at the end position " + loc_str());
+      default:
+        throw sid::exception("Invalid escape sequence (" + std::string(1, ch) +
+                             ") for string at " + loc_str());
+      }
+    }
+  }
+  ++m_p;
+}
+
+namespace local
+{
+//! Largest exponent for which 10^e is exactly representable as a double.
+//! 10^e = 5^e * 2^e is exact while 5^e fits in the mantissa.
+constexpr int max_exact_pow10()
+{
+  double limit = 1;
+  for ( int i = 0; i < std::numeric_limits<double>::digits; i++ )
+    limit *= 2;
+  int e = 0;
+  for ( double p = 5; p < limit; p *= 5 )
+    ++e;
+  return e;
+}
+constexpr int max_pow10 = max_exact_pow10();
+
+//! Exact powers of 10 up to max_pow10
+struct pow10_table
+{
+  double v[max_pow10 + 1];
+  constexpr pow10_table() : v()
+  {
+    v[0] = 1;
+    for ( int i = 1; i <= max_pow10; i++ )
+      v[i] = v[i-1] * 10;
+  }
+};
+constexpr pow10_table pow10;
+
+//! Largest significand that is exactly representable as a double
+constexpr uint64_t max_exact_digits = uint64_t(1) << std::numeric_limits<double>::digits;
+} // namespace local
+
+void lexer::parse_number(number& _num, bool bFullCheck)
+{
+  _num.isLong = false;
+  REMOVE_LEADING_SPACES(m_p);
+  const char* p_start = m_p;
+  const char chContainer = container_end();
+
+  if ( ! bFullCheck )
+  {
+    bool isDouble = false;
+    const bool isNegative = (at(m_p) == '-');
+    for ( ; at(m_p) != '\0'; m_p++ )
+    {
+      if ( *m_p == ',' || simd::is_space(*m_p) ||  *m_p == chContainer )
+        break;
+      if ( !isDouble && (*m_p == '.' || *m_p == 'e' || *m_p == 'E') )
+        isDouble = true;
+    }
+
+    const char* p_end = m_p;
+    REMOVE_LEADING_SPACES(m_p);
+    char ch = at(m_p);
+    if ( ch != ',' && ch != '\0' && ch != chContainer )
+      throw sid::exception("Invalid character " + std::string(1, ch) + " Expected , or "
+                           + std::string(1, chContainer) + " " + loc_str());
+
+    // Not validated. Converted the way sid::to_num() does, which accepts other bases too
+    std::string numStr(p_start, p_end-p_start);
+    if ( isDouble )
+    {
+      _num.type = value_type::_double;
+      const long double ldbl = sid::to_num<long double>(numStr);
+      _num.dbl = static_cast<float_type>(ldbl);
+      if ( m_ctrl.longDouble )
+        _num.keep_long(ldbl);
+    }
+    else
+    {
+      std::string errStr;
+      if ( isNegative )
+      {
+        _num.type = value_type::_signed;
+        if ( ! sid::to_num(numStr, /*out*/ _num.i64, &errStr) )
+          throw sid::exception("Unable to convert (" + numStr + ") to numeric " + loc_str()
+                               + ": " + errStr);
+      }
+      else
+      {
+        _num.type = value_type::_unsigned;
+        if ( ! sid::to_num(numStr, /*out*/ _num.u64, &errStr) )
+          throw sid::exception("Unable to convert (" + numStr + ") to numeric " + loc_str()
+                               + ": " + errStr);
+      }
+    }
+    return;
+  }
+
+  // Perform full check and compute the number in the same scan.
+  // The digits are accumulated in a 64-bit significand. This gives the integers directly,
+  // and the doubles with a single multiplication or division by an exact power of 10 when
+  // the significand and the power are exactly representable, which is correctly rounded.
+  // Other doubles are converted with std::from_chars. Nothing is allocated unless there is an error.
+  uint64_t digits = 0;       // Significand
+  bool     overflow = false; // Significand does not fit in 64 bits
+  int64_t  exponent = 0;     // Decimal exponent of the significand
+  bool     isDouble = false;
+  auto add_digit = [&](char ch)
+    {
+      const uint64_t d = ch - '0';
+      if ( digits > (UINT64_MAX - d) / 10 )
+      {
+        // The digit is dropped, which keeps the magnitude in the exponent
+        overflow = true;
+        ++exponent;
+      }
+      else
+        digits = digits * 10 + d;
+    };
+
+  const bool isNegative = (at(m_p) == '-');
+  if ( isNegative )
+    ++m_p;
+  char ch = at(m_p);
+  if ( ch < '0' || ch > '9' )
+    throw sid::exception("Missing integer digit" + loc_str());
+
+  if ( ch == '0' )
+  {
+    ch = at(++m_p);
+    if ( ch >= '0' && ch <= '9' )
+      throw sid::exception("Invalid digit (" + std::string(1, ch) + ") after first 0 " + loc_str());
+  }
+  else
+  {
+    add_digit(ch);
+    while ( (ch = at(++m_p)) >= '0' && ch <= '9'  )
+      add_digit(ch);
+  }
+  // Check whether it has fraction and populate accordingly
+  if ( ch == '.' )
+  {
+    bool hasDigits = false;
+    while ( (ch = at(++m_p)) >= '0' && ch <= '9'  )
+    {
+      hasDigits = true;
+      add_digit(ch);
+      --exponent;
+    }
+    if ( !hasDigits )
+      throw sid::exception("Invalid digit (" + std::string(1, ch)
+                           + ") Expected a digit for fraction " + loc_str());
+    isDouble = true;
+  }
+  // Check whether it has an exponent and populate accordingly
+  if ( ch == 'e' || ch == 'E' )
+  {
+    ch = at(++m_p);
+    const bool isNegativeExp = (ch == '-');
+    if ( ch != '-' && ch != '+' )
+      --m_p;
+    bool hasDigits = false;
+    int64_t exp = 0;
+    while ( (ch = at(++m_p)) >= '0' && ch <= '9'  )
+    {
+      hasDigits = true;
+      // Large enough to send any significand out of range
+      if ( exp < 100000 )
+        exp = exp * 10 + (ch - '0');
+    }
+    if ( !hasDigits )
+      throw sid::exception("Invalid digit (" + std::string(1, ch)
+                           + ") Expected a digit for exponent " + loc_str());
+    exponent += isNegativeExp? -exp : exp;
+    isDouble = true;
+  }
+
+  const char* p_end = m_p;
+  REMOVE_LEADING_SPACES(m_p);
+  ch = at(m_p);
+  if ( ch != ',' && ch != '\0' && ch != chContainer )
+    throw sid::exception("Invalid character " + std::string(1, ch) + " Expected , or "
+                         + std::string(1, chContainer) + " " + loc_str());
+
+  // Integers beyond the range of the 64-bit types are read as doubles
+  if ( ! isDouble && ( overflow || (isNegative && digits > uint64_t(INT64_MAX) + 1) ) )
+    isDouble = true;
+  if ( isDouble )
+  {
+    _num.type = value_type::_double;
+    if ( ! overflow && digits <= local::max_exact_digits
+         && exponent >= -local::max_pow10 && exponent <= local::max_pow10 )
+    {
+      // Exact operands, so the result is correctly rounded in double and in long double
+      const float_type dbl = static_cast<float_type>(digits);
+      _num.dbl = ( exponent < 0 )? dbl / local::pow10.v[-exponent] : dbl * local::pow10.v[exponent];
+      if ( isNegative )
+        _num.dbl = -_num.dbl;
+    }
+    else
+    {
+      const auto res = std::from_chars(p_start, p_end, _num.dbl);
+      if ( res.ec == std::errc::result_out_of_range )
+      {
+        // A number too small for a double is read as zero. One too large for it is read as
+        // infinity if it is within the range of long double, in which the numbers were kept
+        // before: it is rejected only if it is out of that range too.
+        long double ldbl = 0;
+        if ( exponent >= 0 && std::from_chars(p_start, p_end, ldbl).ec != std::errc() )
+          range_error(p_start, p_end);
+        _num.dbl = ( exponent < 0 )? 0.0 : HUGE_VAL;
+        if ( isNegative )
+          _num.dbl = -_num.dbl;
+      }
+      else if ( res.ec != std::errc() )
+        range_error(p_start, p_end);
+    }
+    // A number too small for a long double too is kept as the zero of the double
+    long double ldbl = 0;
+    if ( m_ctrl.longDouble && std::from_chars(p_start, p_end, ldbl).ec == std::errc() )
+      _num.keep_long(ldbl);
+  }
+  else if ( isNegative )
+  {
+    _num.type = value_type::_signed;
+    if ( overflow || digits > uint64_t(INT64_MAX) + 1 )
+      throw sid::exception("Unable to convert (" + std::string(p_start, p_end-p_start) + ") to numeric "
+                           + loc_str() + ": " + sid::to_errno_str(ERANGE) + " : "
+                           + std::string(p_start, p_end-p_start));
+    _num.i64 = static_cast<int64_t>(0 - digits);
+  }
+  else
+  {
+    _num.type = value_type::_unsigned;
+    if ( overflow )
+      throw sid::exception("Unable to convert (" + std::string(p_start, p_end-p_start) + ") to numeric "
+                           + loc_str() + ": " + sid::to_errno_str(ERANGE) + " : "
+                           + std::string(p_start, p_end-p_start));
+    _num.u64 = digits;
+  }
+}
+
+value_type lexer::parse_literal(bool& _bval)
+{
+  const char chContainer = container_end();
+  const char* p_start = m_p;
+  for ( char ch; (ch = at(m_p)) != '\0'; ++m_p )
+  {
+    if ( ch == ',' || simd::is_space(ch) || ch == chContainer )
+      break;
+  }
+  if ( m_p == p_start )
+    throw sid::exception("Expected value not found " + loc_str());
+
+  const size_t len = m_p - p_start;
+  if ( len == 4 )
+  {
+    if ( ::strncmp(p_start, "null", len) == 0 )
+      return value_type::null;
+    if ( ::strncmp(p_start, "true", len) == 0 )
+      { _bval = true; return value_type::boolean; }
+    if ( m_ctrl.mode.allowNocaseValues )
+    {
+      if ( ::strncmp(p_start, "Null", len) == 0 || ::strncmp(p_start, "NULL", len) == 0 )
+        return value_type::null;
+      if ( ::strncmp(p_start, "True", len) == 0 || ::strncmp(p_start, "TRUE", len) == 0 )
+        { _bval = true; return value_type::boolean; }
+    }
+  }
+  else if ( len == 5 )
+  {
+    if ( ::strncmp(p_start, "false", len) == 0 )
+      { _bval = false; return value_type::boolean; }
+    if ( m_ctrl.mode.allowNocaseValues )
+    {
+      if ( ::strncmp(p_start, "False", len) == 0 || ::strncmp(p_start, "FALSE", len) == 0 )
+        { _bval = false; return value_type::boolean; }
+    }
+  }
+
+  if ( ! m_ctrl.mode.allowFlexibleStrings )
+    throw sid::exception("Invalid value [" + std::string(p_start, len) + "] " + loc_str()
+                         + ". Did you miss enclosing in \"\"?");
+  m_p = p_start;
+  return value_type::string;
+}
+
+void lexer::skip_value()
+{
+  // The containers being skipped are pushed on the container stack, which gives the scanner
+  // the end of the container of a scalar
+  const size_t depth = m_containerStack.size();
+  number num;
+  while ( true )
+  {
+    char ch = at(m_p);
+    if ( ch == '{' || ch == '[' )
+    {
+      m_containerStack.push(( ch == '{' )? value_type::object : value_type::array);
+      ++m_p;
+      REMOVE_LEADING_SPACES(m_p);
+      if ( at(m_p) != container_end() )
+      {
+        if ( ch == '{' )
+          p_skip_key();
+        continue;
+      }
+      ++m_p;
+      m_containerStack.pop();
+    }
+    else if ( ch == '\"' )
+      parse_string(m_skipped, false);
+    else if ( ch == '-' || ::isdigit(ch) )
+      parse_number(num, true);
+    else if ( ch == '\0' )
+      throw sid::exception("Unexpected end of data while expecting a value");
+    else
+    {
+      bool bval = false;
+      if ( parse_literal(bval) == value_type::string )
+        parse_string(m_skipped, false);
+    }
+
+    // The value is followed by the next member of its container, or by the end of it and
+    // of the containers it ends
+    while ( m_containerStack.size() > depth )
+    {
+      REMOVE_LEADING_SPACES(m_p);
+      const char chContainer = container_end();
+      ch = at(m_p);
+      if ( ch == ',' )
+      {
+        ++m_p;
+        REMOVE_LEADING_SPACES(m_p);
+        if ( at(m_p) != chContainer )
+        {
+          if ( chContainer == '}' )
+            p_skip_key();
+          break;
+        }
+      }
+      else if ( ch != chContainer )
+      {
+        if ( chContainer == '}' )
+          throw sid::exception("Encountered " + std::string(1, ch) + ". Expected , or } " + loc_str());
+        throw sid::exception("Expected , or ] " + loc_str());
+      }
+      ++m_p;
+      m_containerStack.pop();
+    }
+    if ( m_containerStack.size() == depth )
+      return;
+  }
+}
+
+void lexer::p_skip_key()
+{
+  parse_string(m_skipped, true);
+  REMOVE_LEADING_SPACES(m_p);
+  if ( at(m_p) != ':' )
+    throw sid::exception("Expected : " + loc_str());
+  ++m_p;
+  REMOVE_LEADING_SPACES(m_p);
+}
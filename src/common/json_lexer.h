@@ -0,0 +1,189 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@file json_lexer.h
+@brief Lexical scanner shared by the json parser and reader
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+/**
+ * @file  json_lexer.h
+ * @brief Lexical scanner shared by the json parser (tree builder) and the json reader (events).
+ *
+ * The scanner works in place on a character sequence that need not be NUL terminated.
+ * Characters beyond the end of the input read as '\0', unless the input is partial in which
+ * case reading beyond the end throws lexer::need_more.
+ */
+#pragma once
+
+#include <common/json.hpp>
+#include "json_simd.h"
+#include <stack>
+#include <cmath>
+#include <ctime>
+
+namespace sid {
+namespace json {
+
+/**
+ * @struct lexer
+ * @brief Scanning of the json tokens honouring the parser control flags
+ */
+struct lexer
+{
+  //! Number token
+  struct number
+  {
+    value_type type; //! value_type::_signed, value_type::_unsigned or value_type::_double
+    union
+    {
+      int64_t  i64;
+      uint64_t u64;
+      float_type dbl;
+    };
+    bool        isLong; //! Set if the number is kept as long double (parser_control::longDouble)
+    long double ldbl;   //! The number as long double, if isLong is set
+
+    //! Keep the double number as long double if the double does not hold it exactly
+    void keep_long(long double _ldbl) {
+      isLong = ( static_cast<long double>(dbl) != _ldbl && ! std::isnan(_ldbl) );
+      ldbl = _ldbl;
+    }
+  };
+
+  //! Thrown when a partial input ends in the middle of a token
+  struct need_more {};
+
+  parser_control         m_ctrl;           //! Parser control flags
+  std::stack<value_type> m_containerStack; //! Container stack
+
+  lexer() : m_p(nullptr), m_begin(nullptr), m_end(nullptr), m_partial(false), m_lines(0), m_column(0),
+            m_index(nullptr) {}
+
+  //! Set the character sequence to scan
+  void reset(const char* _data, size_t _len);
+
+  //! Continue scanning on the given character sequence, which follows the consumed input
+  void resume(const char* _data, size_t _len) { m_p = m_begin = _data; m_end = _data + _len; }
+  //! Mark the input up to the current position as consumed. Locations reported in errors
+  //! keep counting from there when the input is continued with resume().
+  void consume();
+
+  //! Monotonic clock in nanoseconds, for the statistics of the parsers
+  static uint64_t now_ns()
+  {
+    struct timespec ts = {0};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+  }
+
+protected:
+  const char* m_p;       //! Current position
+  const char* m_begin;   //! First character of the input
+  const char* m_end;     //! One past the last character of the input
+  bool        m_partial; //! More input follows the end of the current input
+  uint64_t    m_lines;   //! Lines consumed before m_begin
+  uint64_t    m_column;  //! Column of m_begin in its line
+  //! Index of the tokens of the input, or nullptr if the input is scanned. It is used in place of
+  //! the scanner where it is built (see simd::structural_index).
+  simd::structural_index* m_index;
+
+  //! get the character at the given position. Returns '\0' beyond the end of input
+  char at(const char* _p) const { return ( _p < m_end )? *_p : p_end_of_input(); }
+
+  //! get the location of the given position in the string.
+  //! Line numbers are not tracked while parsing; they are computed only when reporting an error.
+  std::string loc_str(const char* p) const;
+  std::string loc_str() const { return loc_str(m_p); }
+  //! Throw the error of a root that is not an object or an array at the current position
+  [[noreturn]] void root_error() const;
+  //! Throw the error of the number [_begin, _end) that is out of the range of long double
+  [[noreturn]] void range_error(const char* _begin, const char* _end) const;
+
+  //! Character that ends the current container
+  char container_end() const {
+    return (m_containerStack.top() == value_type::object)? '}' : ']';
+  }
+
+  //! remove leading spaces and comments
+  void REMOVE_LEADING_SPACES(const char*& _p)
+  {
+    if ( simd::is_space(at(_p)) )
+    {
+      const char* p = ( m_index != nullptr )? m_index->next(_p + 1) : nullptr;
+      _p = ( p != nullptr )? p : simd::skip_spaces(_p + 1, m_end);
+    }
+    if ( at(_p) == '/' )
+      p_skip_comments(_p);
+  }
+
+  //! parse string (or key)
+  void parse_string(std::string& _str, bool _isKey);
+  //! parse string (or key). A string without escape sequences found in the index is returned
+  //! as it is in the input. Any other string is parsed into _buf, which is returned.
+  std::string_view parse_string_view(std::string& _buf, bool _isKey)
+  {
+    if ( m_index != nullptr && at(m_p) == '\"' )
+    {
+      const char* close = m_index->string_end(m_p);
+      if ( close != nullptr )
+      {
+        const char* open = m_p;
+        m_p = close + 1;
+        return std::string_view(open + 1, close - open - 1);
+      }
+    }
+    parse_string(_buf, _isKey);
+    return _buf;
+  }
+  //! parse number
+  void parse_number(number& _num, bool bFullCheck);
+  //! parse the literals null, true and false. Returns value_type::null or value_type::boolean
+  //! (with _bval set). If the word is not a literal and flexible strings are allowed it returns
+  //! value_type::string, leaving the position at the beginning of the word.
+  value_type parse_literal(bool& _bval);
+  //! skip the value at the current position without converting it. It is checked as the
+  //! parser checks it: the grammar, the strings, the numbers and the literals, honouring the
+  //! parse mode. Only the duplicates of its keys are not detected.
+  void skip_value();
+
+private:
+  //! Characters of the strings being skipped. It is reused by every skip.
+  std::string m_skipped;
+
+  //! skip comments and the spaces following them
+  void p_skip_comments(const char*& _p);
+  //! skip a key of an object being skipped, its colon and the spaces following them
+  void p_skip_key();
+  //! character beyond the end of the input
+  char p_end_of_input() const;
+};
+
+} // namespace json
+} // namespace sid
@@ -0,0 +1,381 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@file json_lines.cpp
+@brief Parallel parsing of newline delimited json (JSON Lines / NDJSON)
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+/**
+ * @file  json_lines.cpp
+ * @brief Implementation of the parallel json lines parser
+ */
+#include <common/json_lines.hpp>
+#include <common/util.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+using namespace sid;
+using namespace sid::json;
+
+namespace local
+{
+//! Number of new lines in the given data
+uint64_t count_lines(std::string_view _data)
+{
+  uint64_t count = 0;
+  const char* p = _data.data();
+  const char* end = p + _data.length();
+  while ( (p = static_cast<const char*>(::memchr(p, '\n', end - p))) != nullptr )
+  {
+    ++count;
+    ++p;
+  }
+  return count;
+}
+
+//! Whether the given line has only white spaces
+bool is_blank(std::string_view _line)
+{
+  for ( const char ch : _line )
+    if ( ch != ' ' && ch != '\t' && ch != '\r' )
+      return false;
+  return true;
+}
+} // namespace local
+
+/**
+ * @struct lines_parser::impl
+ * @brief Pool of workers parsing the chunks of the input, and the chunks in flight
+ */
+struct lines_parser::impl
+{
+  /**
+   * @struct chunk
+   * @brief Lines of the input given to a worker
+   */
+  struct chunk
+  {
+    std::string              buffer;    //! Copy of the lines if the input is fed in pieces
+    std::string_view         data;      //! Lines of the chunk
+    uint64_t                 firstLine; //! Line number of the first line of the chunk
+    std::vector<line_record> records;   //! Parsed records, kept in the ordered mode until
+                                        //!   they are delivered
+    bool                     done;      //! Set by the worker once the chunk is parsed
+
+    chunk() : firstLine(0), done(false) {}
+  };
+
+  line_callback                     m_callback;
+  lines_control                     m_lctrl;
+  size_t                            m_maxChunks; //! Maximum number of chunks in flight
+  std::vector<std::thread>          m_workers;
+  std::mutex                        m_mutex;     //! Protects the members below
+  std::condition_variable           m_workCv;    //! Signalled when a chunk is queued
+  std::condition_variable           m_doneCv;    //! Signalled when a chunk is parsed
+  std::deque<std::unique_ptr<chunk>> m_chunks;   //! Chunks in flight, in input order
+  std::deque<chunk*>                m_queue;     //! Chunks waiting for a worker
+  std::exception_ptr                m_error;     //! First exception thrown in a worker
+  bool                              m_quit;      //! Workers must exit
+  std::atomic<bool>                 m_stop;      //! Parsing is stopped, remaining chunks are skipped
+  // Used only by the thread parsing the input
+  std::string                       m_pending;   //! Incomplete line of the pieces fed so far
+  uint64_t                          m_line;      //! Line number of the next chunk
+
+  impl(const line_callback& _callback, const lines_control& _lctrl);
+  ~impl();
+
+  //! Queue the given lines to be parsed. The data must stay alive until it is parsed.
+  void submit(std::string_view _data, std::string&& _buffer = std::string());
+  //! Wait for the chunks to be parsed until at most _maxChunks are in flight
+  void drain(size_t _maxChunks);
+  //! Rethrow the exception of a worker, if any, and return false if the parsing is stopped
+  bool status();
+
+private:
+  void p_worker();
+  void p_parse(chunk& _chunk);
+  bool p_deliver(line_record& _record);
+};
+
+lines_parser::impl::impl(
+  const line_callback& _callback,
+  const lines_control& _lctrl
+  ) : m_callback(_callback), m_lctrl(_lctrl), m_quit(false), m_stop(false), m_line(1)
+{
+  if ( m_lctrl.chunkSize == 0 )
+    throw sid::exception("Chunk size of json lines parser cannot be 0");
+  uint32_t threads = m_lctrl.threads;
+  if ( threads == 0 )
+    threads = std::max(std::thread::hardware_concurrency(), 1U);
+  // Enough chunks to keep the workers busy while the first one is being delivered
+  m_maxChunks = 2 * threads;
+  m_workers.reserve(threads);
+  for ( uint32_t i = 0; i < threads; i++ )
+    m_workers.emplace_back(&impl::p_worker, this);
+}
+
+lines_parser::impl::~impl()
+{
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_quit = true;
+    m_stop = true;
+  }
+  m_workCv.notify_all();
+  for ( std::thread& worker : m_workers )
+    worker.join();
+}
+
+void lines_parser::impl::submit(std::string_view _data, std::string&& _buffer/* = std::string()*/)
+{
+  std::unique_ptr<chunk> c(new chunk);
+  c->buffer = std::move(_buffer);
+  c->data = c->buffer.empty()? _data : std::string_view(c->buffer);
+  c->firstLine = m_line;
+  m_line += local::count_lines(c->data);
+
+  // Bound the memory held by the chunks in flight
+  drain(m_maxChunks - 1);
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_queue.push_back(c.get());
+    m_chunks.push_back(std::move(c));
+  }
+  m_workCv.notify_one();
+}
+
+void lines_parser::impl::drain(size_t _maxChunks)
+{
+  std::unique_lock<std::mutex> lock(m_mutex);
+  for ( ;; )
+  {
+    // Release the parsed chunks. In the ordered mode their records are delivered here,
+    // which needs the chunks to be released in input order.
+    while ( ! m_chunks.empty() && m_chunks.front()->done )
+    {
+      std::unique_ptr<chunk> c = std::move(m_chunks.front());
+      m_chunks.pop_front();
+      if ( ! m_lctrl.ordered || m_stop )
+        continue;
+      lock.unlock();
+      for ( line_record& record : c->records )
+        if ( ! p_deliver(record) )
+          break;
+      lock.lock();
+    }
+    if ( ! m_lctrl.ordered )
+      std::erase_if(m_chunks, [](const std::unique_ptr<chunk>& _c) { return _c->done; });
+    if ( m_chunks.size() <= _maxChunks )
+      break;
+    m_doneCv.wait(lock);
+  }
+}
+
+bool lines_parser::impl::status()
+{
+  std::lock_guard<std::mutex> lock(m_mutex);
+  if ( m_error )
+    std::rethrow_exception(std::exchange(m_error, nullptr));
+  return ! m_stop;
+}
+
+void lines_parser::impl::p_worker()
+{
+  for ( ;; )
+  {
+    chunk* c = nullptr;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_workCv.wait(lock, [this]() { return m_quit || ! m_queue.empty(); });
+      if ( m_queue.empty() )
+        return;
+      c = m_queue.front();
+      m_queue.pop_front();
+    }
+    try
+    {
+      if ( ! m_stop )
+        p_parse(*c);
+    }
+    catch (...)
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      if ( ! m_error )
+        m_error = std::current_exception();
+      m_stop = true;
+    }
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      c->done = true;
+    }
+    m_doneCv.notify_one();
+  }
+}
+
+void lines_parser::impl::p_parse(chunk& _chunk)
+{
+  line_record unordered;
+  const char* p = _chunk.data.data();
+  const char* end = p + _chunk.data.length();
+  for ( uint64_t line = _chunk.firstLine; p < end && ! m_stop; ++line )
+  {
+    const char* eol = static_cast<const char*>(::memchr(p, '\n', end - p));
+    if ( eol == nullptr )
+      eol = end;
+    const std::string_view text(p, eol - p);
+    p = eol + 1;
+    if ( local::is_blank(text) )
+      continue;
+
+    line_record& record = m_lctrl.ordered? _chunk.records.emplace_back() : unordered;
+    record.line = line;
+    record.error.clear();
+    try
+    {
+      value::parse(record.jval, text.data(), text.length(), m_lctrl.ctrl);
+    }
+    catch (const sid::exception& _e)
+    {
+      record.jval.clear();
+      record.error = _e.message();
+    }
+    // In the unordered mode the record is delivered right away from the worker
+    if ( ! m_lctrl.ordered && ! p_deliver(record) )
+      break;
+  }
+}
+
+bool lines_parser::impl::p_deliver(line_record& _record)
+{
+  try
+  {
+    if ( m_callback(_record) )
+      return true;
+  }
+  catch (...)
+  {
+    m_stop = true;
+    throw;
+  }
+  m_stop = true;
+  return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Implementation of lines_parser
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+lines_parser::lines_parser(
+  const line_callback& _callback,
+  const lines_control& _lctrl/* = lines_control()*/
+  ) : m_impl(new impl(_callback, _lctrl))
+{
+}
+
+lines_parser::~lines_parser()
+{
+}
+
+bool lines_parser::feed(const char* _data, size_t _len)
+{
+  if ( ! m_impl->status() )
+    return false;
+  std::string& pending = m_impl->m_pending;
+  pending.append(_data, _len);
+  if ( pending.length() >= m_impl->m_lctrl.chunkSize )
+  {
+    // Hand over the complete lines, keep the incomplete one. The earlier pieces were already
+    // searched if they reached the chunk size on their own.
+    const size_t before = pending.length() - _len;
+    const char* eol = static_cast<const char*>(::memrchr(pending.data() + before, '\n', _len));
+    if ( eol == nullptr && before < m_impl->m_lctrl.chunkSize )
+      eol = static_cast<const char*>(::memrchr(pending.data(), '\n', before));
+    if ( eol != nullptr )
+    {
+      const size_t len = eol - pending.data() + 1;
+      std::string lines = std::move(pending);
+      pending.assign(lines, len);
+      lines.resize(len);
+      m_impl->submit(std::string_view(), std::move(lines));
+    }
+  }
+  return m_impl->status();
+}
+
+bool lines_parser::finish()
+{
+  if ( ! m_impl->m_pending.empty() && m_impl->status() )
+    m_impl->submit(std::string_view(), std::move(m_impl->m_pending));
+  m_impl->m_pending.clear();
+  m_impl->drain(0);
+  return m_impl->status();
+}
+
+bool sid::json::parse_lines(
+  std::string_view     _input,
+  const line_callback& _callback,
+  const lines_control& _lctrl/* = lines_control()*/
+  )
+{
+  lines_parser jparser(_callback, _lctrl);
+  lines_parser::impl& impl = *jparser.m_impl;
+  // The chunks are parsed in place
+  size_t start = 0;
+  while ( start < _input.length() && impl.status() )
+  {
+    size_t end = start + _lctrl.chunkSize;
+    if ( end < _input.length() )
+    {
+      const size_t eol = _input.find('\n', end);
+      end = ( eol == std::string_view::npos )? _input.length() : eol + 1;
+    }
+    else
+      end = _input.length();
+    impl.submit(_input.substr(start, end - start));
+    start = end;
+  }
+  impl.drain(0);
+  return impl.status();
+}
+
+bool sid::json::parse_lines_file(
+  const std::string&   _filePath,
+  const line_callback& _callback,
+  const lines_control& _lctrl/* = lines_control()*/
+  )
+{
+  util::mapped_file file(_filePath);
+  return parse_lines(file.view(), _callback, _lctrl);
+}
@@ -0,0 +1,474 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@file json_path.cpp
+@brief Compiled json paths (JSON Pointer and simple JSONPath)
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+/**
+ * @file  json_path.cpp
+ * @brief Implementation of json path
+ */
+#include <common/json_path.hpp>
+#include <common/convert.hpp>
+#include "json_projection.h"
+#include <algorithm>
+#include <charconv>
+
+using namespace sid;
+using namespace sid::json;
+
+namespace local
+{
+//! Convert the whole of the given string to an integer. Returns false if it is not one.
+bool to_index(std::string_view _str, int64_t& _index)
+{
+  const char* end = _str.data() + _str.length();
+  const auto res = std::from_chars(_str.data(), end, _index);
+  return ( res.ec == std::errc() && res.ptr == end );
+}
+} // namespace local
+
+path::path() : m_single(true)
+{
+}
+
+path::path(std::string_view _path) : path()
+{
+  set(_path);
+}
+
+void path::set(std::string_view _path)
+{
+  m_path.clear();
+  m_steps.clear();
+  m_single = true;
+  if ( ! _path.empty() && _path[0] == '$' )
+    p_jsonpath(_path);
+  else
+    p_pointer(_path);
+  m_path = _path;
+}
+
+void path::p_key(std::string _key, bool _hasIndex)
+{
+  step s = {};
+  s.type = step::kind::key;
+  s.hash = value::object::hash(_key);
+  s.key = std::move(_key);
+  // An array index has no leading zeros (RFC 6901)
+  s.hasIndex = _hasIndex && ( s.key == "0" || ( s.key[0] != '0' && s.key[0] != '-' ) )
+    && local::to_index(s.key, s.index);
+  m_steps.push_back(std::move(s));
+}
+
+void path::p_pointer(std::string_view _path)
+{
+  if ( _path.empty() )
+    return;
+  if ( _path[0] != '/' )
+    throw sid::exception("Json pointer must start with / or the path with $: " + std::string(_path));
+
+  size_t pos = 1;
+  while ( true )
+  {
+    size_t next = _path.find('/', pos);
+    if ( next == std::string_view::npos )
+      next = _path.length();
+    std::string_view token = _path.substr(pos, next - pos);
+    if ( token == "*" )
+    {
+      step s = {};
+      s.type = step::kind::wildcard;
+      m_steps.push_back(s);
+      m_single = false;
+    }
+    else
+    {
+      std::string key;
+      key.reserve(token.length());
+      for ( size_t i = 0; i < token.length(); i++ )
+      {
+        if ( token[i] != '~' )
+          key += token[i];
+        else if ( i+1 < token.length() && ( token[i+1] == '0' || token[i+1] == '1' ) )
+          key += ( token[++i] == '0' )? '~' : '/';
+        else
+          throw sid::exception("Invalid escape sequence in json pointer at position "
+                               + sid::to_str(pos + i) + ": " + std::string(_path));
+      }
+      p_key(std::move(key), true);
+    }
+    if ( next == _path.length() )
+      break;
+    pos = next + 1;
+  }
+}
+
+void path::p_jsonpath(std::string_view _path)
+{
+  auto error = [&](size_t _pos, const std::string& _msg)
+    {
+      return sid::exception(_msg + " at position " + sid::to_str(_pos) + ": " + std::string(_path));
+    };
+  // Integer in a bracket. Returns false if there is none at the position.
+  auto parse_int = [&](size_t& _pos, int64_t& _val)->bool
+    {
+      size_t end = _pos;
+      if ( end < _path.length() && _path[end] == '-' )
+        ++end;
+      while ( end < _path.length() && ::isdigit(_path[end]) )
+        ++end;
+      if ( end == _pos )
+        return false;
+      if ( ! local::to_index(_path.substr(_pos, end - _pos), _val) )
+        throw error(_pos, "Invalid index");
+      _pos = end;
+      return true;
+    };
+
+  size_t pos = 1;
+  while ( pos < _path.length() )
+  {
+    const char ch = _path[pos];
+    if ( ch == '.' )
+    {
+      ++pos;
+      if ( pos < _path.length() && _path[pos] == '.' )
+        throw error(pos, "Recursive descent is not supported");
+      if ( pos < _path.length() && _path[pos] == '*' )
+      {
+        step s = {};
+        s.type = step::kind::wildcard;
+        m_steps.push_back(s);
+        m_single = false;
+        ++pos;
+        continue;
+      }
+      const size_t end = std::min(_path.find_first_of(".[", pos), _path.length());
+      if ( end == pos )
+        throw error(pos, "Missing key");
+      p_key(std::string(_path.substr(pos, end - pos)), false);
+      pos = end;
+    }
+    else if ( ch == '[' )
+    {
+      ++pos;
+      const char quote = ( pos < _path.length() )? _path[pos] : '\0';
+      if ( quote == '\'' || quote == '\"' )
+      {
+        std::string key;
+        for ( ++pos; pos < _path.length() && _path[pos] != quote; pos++ )
+        {
+          if ( _path[pos] == '\\' && pos+1 < _path.length() )
+            ++pos;
+          key += _path[pos];
+        }
+        if ( pos == _path.length() )
+          throw error(pos, "Missing end of key");
+        ++pos;
+        p_key(std::move(key), false);
+      }
+      else if ( quote == '*' )
+      {
+        step s = {};
+        s.type = step::kind::wildcard;
+        m_steps.push_back(s);
+        m_single = false;
+        ++pos;
+      }
+      else if ( quote == '?' || quote == '(' )
+        throw error(pos, "Filter and script expressions are not supported");
+      else
+      {
+        step s = {};
+        s.type = step::kind::index;
+        s.hasStart = parse_int(pos, s.index);
+        if ( pos < _path.length() && _path[pos] == ':' )
+        {
+          // [start:end:stride]
+          s.type = step::kind::slice;
+          s.stride = 1;
+          ++pos;
+          s.hasEnd = parse_int(pos, s.end);
+          if ( pos < _path.length() && _path[pos] == ':' )
+          {
+            ++pos;
+            if ( parse_int(pos, s.stride) && s.stride == 0 )
+              throw error(pos, "Slice step cannot be 0");
+          }
+          m_single = false;
+        }
+        else if ( ! s.hasStart )
+          throw error(pos, "Invalid subscript");
+        m_steps.push_back(s);
+      }
+      if ( pos >= _path.length() || _path[pos] != ']' )
+        throw error(pos, "Expected ]");
+      ++pos;
+    }
+    else
+      throw error(pos, "Expected . or [");
+  }
+}
+
+template <typename F>
+bool path::p_eval(const value& _val, size_t _step, F& _match) const
+{
+  if ( _step == m_steps.size() )
+    return _match(_val);
+
+  const step& s = m_steps[_step];
+  switch ( s.type )
+  {
+  case step::kind::key:
+    if ( _val.is_object() )
+    {
+      const value* pval = _val.m_data._map->find(s.key, s.hash);
+      return ( pval == nullptr ) || p_eval(*pval, _step+1, _match);
+    }
+    if ( _val.is_array() && s.hasIndex && static_cast<uint64_t>(s.index) < _val.m_data._arr->size() )
+      return p_eval((*_val.m_data._arr)[s.index], _step+1, _match);
+    break;
+  case step::kind::index:
+    if ( _val.is_array() )
+    {
+      const int64_t size = static_cast<int64_t>(_val.m_data._arr->size());
+      const int64_t index = ( s.index < 0 )? s.index + size : s.index;
+      if ( index >= 0 && index < size )
+        return p_eval((*_val.m_data._arr)[index], _step+1, _match);
+    }
+    break;
+  case step::kind::wildcard:
+    if ( _val.is_object() )
+    {
+      for ( const auto& entry : *_val.m_data._map )
+        if ( ! p_eval(entry.second, _step+1, _match) )
+          return false;
+    }
+    else if ( _val.is_array() )
+    {
+      for ( const value& jelem : *_val.m_data._arr )
+        if ( ! p_eval(jelem, _step+1, _match) )
+          return false;
+    }
+    break;
+  case step::kind::slice:
+    if ( _val.is_array() )
+    {
+      const auto& arr = *_val.m_data._arr;
+      const int64_t size = static_cast<int64_t>(arr.size());
+      // Bounds are clamped the way Python does
+      auto bound = [&](bool _has, int64_t _bound, int64_t _default, int64_t _min, int64_t _max)
+        {
+          if ( ! _has )
+            return _default;
+          if ( _bound < 0 )
+            _bound += size;
+          return std::clamp(_bound, _min, _max);
+        };
+      if ( s.stride > 0 )
+      {
+        const int64_t stop = bound(s.hasEnd, s.end, size, 0, size);
+        for ( int64_t i = bound(s.hasStart, s.index, 0, 0, size); i < stop; i += s.stride )
+          if ( ! p_eval(arr[i], _step+1, _match) )
+            return false;
+      }
+      else
+      {
+        const int64_t stop = bound(s.hasEnd, s.end, -1, -1, size - 1);
+        for ( int64_t i = bound(s.hasStart, s.index, size - 1, -1, size - 1); i > stop; i += s.stride )
+          if ( ! p_eval(arr[i], _step+1, _match) )
+            return false;
+      }
+    }
+    break;
+  }
+  return true;
+}
+
+std::vector<const value*> path::eval(const value& _root) const
+{
+  std::vector<const value*> out;
+  eval(_root, out);
+  return out;
+}
+
+void path::eval(const value& _root, std::vector<const value*>& _out) const
+{
+  auto match = [&](const value& _val) { _out.push_back(&_val); return true; };
+  p_eval(_root, 0, match);
+}
+
+const value* path::find(const value& _root) const
+{
+  const value* pval = nullptr;
+  auto match = [&](const value& _val) { pval = &_val; return false; };
+  p_eval(_root, 0, match);
+  return pval;
+}
+
+const value* path::find(const value& _root, std::vector<const value*>& _trail) const
+{
+  if ( ! m_single )
+    throw sid::exception("json::path: " + m_path + " can match more than one value");
+  _trail.clear();
+  const value* pval = &_root;
+  for ( const step& s : m_steps )
+  {
+    _trail.push_back(pval);
+    const value* pnext = nullptr;
+    if ( pval->is_object() )
+    {
+      if ( s.type == step::kind::key )
+        pnext = pval->m_data._map->find(s.key, s.hash);
+    }
+    else if ( pval->is_array() )
+    {
+      const int64_t size = static_cast<int64_t>(pval->m_data._arr->size());
+      int64_t index = -1;
+      if ( s.type == step::kind::index )
+        index = ( s.index < 0 )? s.index + size : s.index;
+      else if ( s.hasIndex )
+        index = s.index;
+      if ( index >= 0 && index < size )
+        pnext = &(*pval->m_data._arr)[index];
+    }
+    if ( pnext == nullptr )
+      return nullptr;
+    pval = pnext;
+  }
+  return pval;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Implementation of projection
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+namespace local
+{
+using proj_node = projection::node;
+
+//! Deep copy of the node
+std::unique_ptr<proj_node> clone(const proj_node& _node)
+{
+  std::unique_ptr<proj_node> copy(new proj_node);
+  copy->whole = _node.whole;
+  for ( const auto& key : _node.keys )
+    copy->keys.emplace(key.first, clone(*key.second));
+  for ( const auto& index : _node.indexes )
+    copy->indexes.emplace(index.first, clone(*index.second));
+  if ( _node.any )
+    copy->any = clone(*_node.any);
+  return copy;
+}
+
+//! The child for the given key or index, which starts with the paths of the wildcard
+template <typename Map, typename Key>
+proj_node& child(proj_node& _node, Map& _map, const Key& _key)
+{
+  auto it = _map.find(_key);
+  if ( it == _map.end() )
+    it = _map.emplace(_key, _node.any? clone(*_node.any) : std::make_unique<proj_node>()).first;
+  return *it->second;
+}
+} // namespace local
+
+projection::projection() : m_root(new node), m_size(0)
+{
+}
+
+projection::projection(std::initializer_list<std::string_view> _paths) : projection()
+{
+  for ( std::string_view p : _paths )
+    add(p);
+}
+
+projection::projection(const std::vector<std::string>& _paths) : projection()
+{
+  for ( const std::string& p : _paths )
+    add(p);
+}
+
+projection::~projection()
+{
+}
+
+projection::projection(projection&&) noexcept = default;
+projection& projection::operator=(projection&&) noexcept = default;
+
+void projection::add(std::string_view _path)
+{
+  const path jpath(_path);
+  for ( const path::step& s : jpath.m_steps )
+  {
+    if ( s.type == path::step::kind::slice )
+      throw sid::exception("A projection cannot have a slice: " + std::string(_path));
+    if ( s.type == path::step::kind::index && s.index < 0 )
+      throw sid::exception("A projection cannot have a negative index: " + std::string(_path));
+  }
+
+  // Add the remaining steps below the given node
+  const auto add_steps = [&](auto& _self, node& _node, size_t _step) -> void
+    {
+      if ( _step == jpath.m_steps.size() )
+      {
+        _node.whole = true;
+        return;
+      }
+      const path::step& s = jpath.m_steps[_step];
+      switch ( s.type )
+      {
+      case path::step::kind::key:
+        _self(_self, local::child(_node, _node.keys, s.key), _step + 1);
+        if ( s.hasIndex )
+          _self(_self, local::child(_node, _node.indexes, static_cast<uint64_t>(s.index)), _step + 1);
+        break;
+      case path::step::kind::index:
+        _self(_self, local::child(_node, _node.indexes, static_cast<uint64_t>(s.index)), _step + 1);
+        break;
+      case path::step::kind::wildcard:
+        if ( ! _node.any )
+          _node.any.reset(new node);
+        _self(_self, *_node.any, _step + 1);
+        // The keys and indexes of the value are matched by the wildcard too
+        for ( auto& key : _node.keys )
+          _self(_self, *key.second, _step + 1);
+        for ( auto& index : _node.indexes )
+          _self(_self, *index.second, _step + 1);
+        break;
+      case path::step::kind::slice:
+        break;
+      }
+    };
+  add_steps(add_steps, *m_root, 0);
+  m_size++;
+}
@@ -0,0 +1,74 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@file json_projection.h
+@brief Paths of a json projection
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+/**
+ * @file  json_projection.h
+ * @brief Tree of the steps of the paths of a projection, followed by the parser.
+ */
+#pragma once
+
+#include <common/json_path.hpp>
+#include <map>
+
+namespace sid {
+namespace json {
+
+/**
+ * @struct projection::node
+ * @brief Paths going on below a value of the document.
+ *
+ * The paths following a wildcard are also added below each key and index of the same
+ * value, so that the parser looks up a single node for each member.
+ */
+struct projection::node
+{
+  bool                                                     whole = false; //! A path ends here
+  std::map<std::string, std::unique_ptr<node>, std::less<>> keys;          //! Keys of an object
+  std::map<uint64_t, std::unique_ptr<node>>                indexes;       //! Indexes of an array
+  std::unique_ptr<node>                                    any;           //! Wildcard
+
+  //! Paths below the value of the given key. Returns nullptr if there is none.
+  const node* key(std::string_view _key) const {
+    const auto it = keys.find(_key);
+    return ( it != keys.end() )? it->second.get() : any.get();
+  }
+  //! Paths below the element at the given index. Returns nullptr if there is none.
+  const node* index(uint64_t _index) const {
+    const auto it = indexes.find(_index);
+    return ( it != indexes.end() )? it->second.get() : any.get();
+  }
+};
+
+} // namespace json
+} // namespace sid
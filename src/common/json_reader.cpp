@@ -0,0 +1,817 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@file json_reader.cpp
+@brief Event based json reader
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+/**
+ * @file  json_reader.cpp
+ * @brief Implementation of the event based json reader
+ */
+#include <common/json_reader.hpp>
+#include <common/util.hpp>
+#include "json_lexer.h"
+#include <unordered_set>
+#include <ctime>
+
+using namespace sid;
+using namespace sid::json;
+
+/**
+ * @struct reader::impl
+ * @brief State machine producing one event per step, following the grammar of the parser
+ *
+ * A step reads all of its input before it changes the state, so that a step interrupted by
+ * lexer::need_more on a partial input can be repeated from the same position.
+ */
+struct reader::impl : public lexer
+{
+  //! Position in the grammar
+  enum class state : uint8_t {
+    start,       //! Before the root container
+    member,      //! At { or , of an object
+    element,     //! At [ or , of an array
+    value,       //! At the value of a key or an array element
+    after_value, //! After a value, expecting , or the end of the container
+    done         //! After the root container
+  };
+
+  state             m_state;
+  event_type        m_event;
+  bool              m_bval;  //! Value of the boolean event
+  number            m_num;   //! Value of the number event
+  std::string       m_str;   //! Value of the key and string events
+  parser_stats      m_stats;
+  util::mapped_file m_file;  //! Input of open_file()
+  size_t            m_discarded; //! Number of bytes of m_file released from memory
+  size_t            m_skipDepth; //! Depth of the value being ignored (0 if none)
+  //! Keys of the open objects. Used only for dup_key::reject and dup_key::ignore modes.
+  std::vector<std::unordered_set<std::string>> m_keys;
+
+  impl() : m_state(state::done), m_event(event_type::none), m_bval(false), m_discarded(0), m_skipDepth(0) {}
+
+  //! Pages of a mapped file that have been read are released once in a while so that
+  //! the memory used does not grow with the size of the file
+  static constexpr size_t discard_size = 32 * 1024 * 1024;
+  void discard()
+  {
+    const size_t offset = m_p - m_begin;
+    if ( m_file.is_open() && offset - m_discarded >= discard_size )
+    {
+      m_file.discard(offset);
+      m_discarded = offset;
+    }
+  }
+
+  void open(const char* _data, size_t _len, const parser_control& _ctrl);
+  //! Produce the next event. Returns false if a step produced no event
+  bool step()
+  {
+    if ( ! p_step() )
+      return false;
+    if ( m_skipDepth == 0 )
+      return true;
+    // The value of an ignored duplicate key ends when we are back at its depth
+    if ( m_containerStack.size() == m_skipDepth && m_state == state::after_value )
+      m_skipDepth = 0;
+    return false;
+  }
+  //! Consume the value at state::value without reporting it
+  void skip_value();
+  //! Build the json tree of the current event
+  void build(value& _jval);
+  //! Report the current event to the handler
+  bool dispatch(handler& _handler);
+  //! Make sure that only spaces and comments follow the root container
+  void check_trailing(value_type _rootType);
+
+  bool track_keys() const {
+    return ( m_ctrl.dupKey == parser_control::dup_key::reject ||
+             m_ctrl.dupKey == parser_control::dup_key::ignore );
+  }
+
+private:
+  bool p_step();
+  bool p_begin(value_type _type);
+  bool p_end();
+  bool p_key();
+  bool p_value();
+};
+
+void reader::impl::open(const char* _data, size_t _len, const parser_control& _ctrl)
+{
+  m_ctrl = _ctrl;
+  reset(_data, _len);
+  m_keys.clear();
+  m_stats.clear();
+  m_discarded = 0;
+  m_skipDepth = 0;
+  m_event = event_type::none;
+  m_state = state::start;
+}
+
+bool reader::impl::p_step()
+{
+  char ch = 0;
+  switch ( m_state )
+  {
+  case state::start:
+    REMOVE_LEADING_SPACES(m_p);
+    ch = at(m_p);
+    if ( ch == '{' )
+      return p_begin(value_type::object);
+    if ( ch == '[' )
+      return p_begin(value_type::array);
+    root_error();
+
+  case state::member:
+    ++m_p;
+    // "string" : value
+    REMOVE_LEADING_SPACES(m_p);
+    // This is the case where there are no elements in the object (An empty object)
+    if ( at(m_p) == '}' ) { ++m_p; return p_end(); }
+    return p_key();
+
+  case state::element:
+    ++m_p;
+    REMOVE_LEADING_SPACES(m_p);
+    // This is the case where there are no elements in the array (An empty array)
+    if ( at(m_p) == ']' ) { ++m_p; return p_end(); }
+    return p_value();
+
+  case state::value:
+    return p_value();
+
+  case state::after_value:
+    REMOVE_LEADING_SPACES(m_p);
+    ch = at(m_p);
+    if ( m_containerStack.top() == value_type::object )
+    {
+      // Can have a ,
+      // Must end with }
+      if ( ch == '}' ) { ++m_p; return p_end(); }
+      if ( ch != ',' )
+        throw sid::exception("Encountered " + std::string(1, ch) + ". Expected , or } " + loc_str());
+      m_state = state::member;
+    }
+    else
+    {
+      // Can have a ,
+      // Must end with ]
+      if ( ch == ']' ) { ++m_p; return p_end(); }
+      if ( ch != ',' )
+        throw sid::exception("Expected , or ] " + loc_str());
+      m_state = state::element;
+    }
+    return false;
+
+  case state::done:
+    break;
+  }
+  return false;
+}
+
+bool reader::impl::p_begin(value_type _type)
+{
+  m_containerStack.push(_type);
+  if ( m_containerStack.size() > m_stats.maxDepth )
+    m_stats.maxDepth = m_containerStack.size();
+  if ( _type == value_type::object )
+  {
+    m_stats.objects++;
+    if ( track_keys() )
+      m_keys.emplace_back();
+    m_event = event_type::start_object;
+    m_state = state::member;
+  }
+  else
+  {
+    m_stats.arrays++;
+    m_event = event_type::start_array;
+    m_state = state::element;
+  }
+  return true;
+}
+
+bool reader::impl::p_end()
+{
+  const value_type type = m_containerStack.top();
+  // With a partial input the rest of the input is checked as it arrives
+  if ( m_containerStack.size() == 1 && ! m_partial )
+    check_trailing(type);
+
+  m_containerStack.pop();
+  if ( type == value_type::object )
+  {
+    if ( track_keys() )
+      m_keys.pop_back();
+    m_event = event_type::end_object;
+  }
+  else
+    m_event = event_type::end_array;
+
+  m_state = ( m_containerStack.empty() )? state::done : state::after_value;
+  return true;
+}
+
+void reader::impl::check_trailing(value_type _rootType)
+{
+  REMOVE_LEADING_SPACES(m_p);
+  const char ch = at(m_p);
+  if ( ch != '\0' )
+    throw sid::exception(std::string("Invalid character [") + ch + "] " + loc_str()
+                         + " after the root " + (_rootType == value_type::object? "object" : "array")
+                         + " is closed");
+}
+
+bool reader::impl::p_key()
+{
+  parse_string(m_str, true);
+  bool ignore = false;
+  if ( track_keys() && m_keys.back().contains(m_str) )
+  {
+    // Handle duplicate key scenario
+    if ( m_ctrl.dupKey == parser_control::dup_key::reject )
+      throw sid::exception("Duplicate key \"" + m_str + "\" encountered");
+    ignore = true;
+  }
+
+  REMOVE_LEADING_SPACES(m_p);
+  if ( at(m_p) != ':' )
+    throw sid::exception("Expected : " + loc_str());
+  m_p++;
+  REMOVE_LEADING_SPACES(m_p);
+
+  m_stats.keys++;
+  m_state = state::value;
+  if ( ignore )
+  {
+    // Parse the value, but ignore it (unless we are already in an ignored value)
+    if ( m_skipDepth == 0 )
+      m_skipDepth = m_containerStack.size();
+    return false;
+  }
+  if ( track_keys() )
+    m_keys.back().insert(m_str);
+  m_event = event_type::key;
+  return true;
+}
+
+bool reader::impl::p_value()
+{
+  const char ch = at(m_p);
+  if ( ch == '{' )
+    return p_begin(value_type::object);
+  if ( ch == '[' )
+    return p_begin(value_type::array);
+
+  if ( ch == '\"' )
+  {
+    parse_string(m_str, false);
+    m_event = event_type::string;
+    m_stats.strings++;
+  }
+  else if ( ch == '-' || ::isdigit(ch) )
+  {
+    parse_number(m_num, true);
+    m_event = event_type::number;
+    m_stats.numbers++;
+  }
+  else if ( ch == '\0' )
+    throw sid::exception("Unexpected end of data while expecting a value");
+  else
+  {
+    const value_type type = parse_literal(m_bval);
+    if ( type == value_type::null )
+    {
+      m_event = event_type::null;
+      m_stats.nulls++;
+    }
+    else if ( type == value_type::boolean )
+    {
+      m_event = event_type::boolean;
+      m_stats.booleans++;
+    }
+    else
+    {
+      parse_string(m_str, false);
+      m_event = event_type::string;
+      m_stats.strings++;
+    }
+  }
+  m_state = state::after_value;
+  return true;
+}
+
+void reader::impl::skip_value()
+{
+  const size_t depth = m_containerStack.size();
+  step();
+  while ( m_containerStack.size() > depth )
+    step();
+}
+
+void reader::impl::build(value& _jval)
+{
+  switch ( m_event )
+  {
+  case event_type::start_object:
+  {
+    _jval = value(value_type::object);
+    const size_t depth = m_containerStack.size();
+    while ( true )
+    {
+      while ( ! step() );
+      if ( m_containerStack.size() < depth )
+        break; // end_object
+      // key
+      std::string key(m_str);
+      while ( ! step() );
+      value* jexisting = _jval.find(key);
+      if ( jexisting == nullptr )
+        build(_jval[key]);
+      else if ( m_ctrl.dupKey != parser_control::dup_key::append )
+        build(*jexisting);
+      else
+      {
+        // make it as an array and append the duplicate keys
+        if ( ! jexisting->is_array() )
+        {
+          value jfirst(std::move(*jexisting));
+          *jexisting = value(value_type::array);
+          jexisting->append(std::move(jfirst));
+        }
+        build(jexisting->append());
+      }
+    }
+  }
+  break;
+  case event_type::start_array:
+  {
+    _jval = value(value_type::array);
+    const size_t depth = m_containerStack.size();
+    while ( true )
+    {
+      while ( ! step() );
+      if ( m_containerStack.size() < depth )
+        break; // end_array
+      build(_jval.append());
+    }
+  }
+  break;
+  case event_type::null:    _jval = value(); break;
+  case event_type::boolean: _jval = m_bval; break;
+  case event_type::string:  _jval = m_str; break;
+  case event_type::number:
+    if ( m_num.isLong )
+      _jval = m_num.ldbl;
+    else if ( m_num.type == value_type::_double )
+      _jval = m_num.dbl;
+    else if ( m_num.type == value_type::_signed )
+      _jval = m_num.i64;
+    else
+      _jval = m_num.u64;
+    break;
+  default:
+    throw sid::exception("Current event is not the beginning of a value");
+  }
+}
+
+bool reader::impl::dispatch(handler& _handler)
+{
+  switch ( m_event )
+  {
+  case event_type::start_object: return _handler.start_object();
+  case event_type::end_object:   return _handler.end_object();
+  case event_type::start_array:  return _handler.start_array();
+  case event_type::end_array:    return _handler.end_array();
+  case event_type::key:          return _handler.key(m_str);
+  case event_type::null:         return _handler.null();
+  case event_type::boolean:      return _handler.boolean(m_bval);
+  case event_type::string:       return _handler.string(m_str);
+  case event_type::number:
+    if ( m_num.isLong )
+      return _handler.number(value(m_num.ldbl));
+    if ( m_num.type == value_type::_double )
+      return _handler.number(value(m_num.dbl));
+    if ( m_num.type == value_type::_signed )
+      return _handler.number(value(m_num.i64));
+    return _handler.number(value(m_num.u64));
+  default: break;
+  }
+  return true;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Implementation of reader
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+reader::reader() : m_impl(new impl)
+{
+}
+
+reader::reader(std::string_view _input, const parser_control& _ctrl/* = parser_control()*/)
+  : m_impl(new impl)
+{
+  open(_input, _ctrl);
+}
+
+reader::~reader()
+{
+}
+
+void reader::open(std::string_view _input, const parser_control& _ctrl/* = parser_control()*/)
+{
+  m_impl->m_file.close();
+  m_impl->open(_input.data(), _input.length(), _ctrl);
+}
+
+void reader::open_file(const std::string& _filePath, const parser_control& _ctrl/* = parser_control()*/)
+{
+  m_impl->m_file.open(_filePath);
+  m_impl->open(m_impl->m_file.data(), m_impl->m_file.size(), _ctrl);
+}
+
+bool reader::next()
+{
+  try
+  {
+    while ( m_impl->m_state != impl::state::done )
+    {
+      if ( m_impl->step() )
+      {
+        m_impl->discard();
+        return true;
+      }
+    }
+  }
+  catch (...)
+  {
+    // The reader cannot continue after an error
+    m_impl->m_state = impl::state::done;
+    m_impl->m_event = event_type::none;
+    throw;
+  }
+  m_impl->m_event = event_type::none;
+  return false;
+}
+
+event_type reader::event() const
+{
+  return m_impl->m_event;
+}
+
+value_type reader::type() const
+{
+  switch ( m_impl->m_event )
+  {
+  case event_type::start_object:
+  case event_type::end_object:   return value_type::object;
+  case event_type::start_array:
+  case event_type::end_array:    return value_type::array;
+  case event_type::key:
+  case event_type::string:       return value_type::string;
+  case event_type::boolean:      return value_type::boolean;
+  case event_type::number:       return m_impl->m_num.type;
+  default:                       return value_type::null;
+  }
+}
+
+size_t reader::depth() const
+{
+  return m_impl->m_containerStack.size();
+}
+
+std::string_view reader::get_str() const
+{
+  if ( m_impl->m_event != event_type::key && m_impl->m_event != event_type::string )
+    throw sid::exception(__func__ + std::string("() can be used only for key and string events"));
+  return m_impl->m_str;
+}
+
+bool reader::get_bool() const
+{
+  if ( m_impl->m_event != event_type::boolean )
+    throw sid::exception(__func__ + std::string("() can be used only for boolean event"));
+  return m_impl->m_bval;
+}
+
+int64_t reader::get_int64() const
+{
+  if ( m_impl->m_event != event_type::number )
+    throw sid::exception(__func__ + std::string("() can be used only for number event"));
+  const lexer::number& num = m_impl->m_num;
+  return ( num.type == value_type::_double )? static_cast<int64_t>(num.dbl) : num.i64;
+}
+
+uint64_t reader::get_uint64() const
+{
+  if ( m_impl->m_event != event_type::number )
+    throw sid::exception(__func__ + std::string("() can be used only for number event"));
+  const lexer::number& num = m_impl->m_num;
+  return ( num.type == value_type::_double )? static_cast<uint64_t>(num.dbl) : num.u64;
+}
+
+float_type reader::get_double() const
+{
+  if ( m_impl->m_event != event_type::number )
+    throw sid::exception(__func__ + std::string("() can be used only for number event"));
+  const lexer::number& num = m_impl->m_num;
+  if ( num.type == value_type::_signed )
+    return static_cast<float_type>(num.i64);
+  if ( num.type == value_type::_unsigned )
+    return static_cast<float_type>(num.u64);
+  return num.dbl;
+}
+
+void reader::skip()
+{
+  const event_type evt = m_impl->m_event;
+  if ( evt == event_type::key )
+    m_impl->skip_value();
+  else if ( evt == event_type::start_object || evt == event_type::start_array )
+  {
+    const size_t depth = m_impl->m_containerStack.size();
+    while ( m_impl->m_containerStack.size() >= depth )
+      m_impl->step();
+  }
+}
+
+void reader::read(value& _jval)
+{
+  if ( m_impl->m_event == event_type::key )
+    while ( ! m_impl->step() );
+  m_impl->build(_jval);
+}
+
+bool reader::parse(handler& _handler)
+{
+  const uint64_t start = lexer::now_ns();
+  bool result = true;
+  while ( result && next() )
+    result = m_impl->dispatch(_handler);
+  m_impl->m_stats.time_ns = lexer::now_ns() - start;
+  m_impl->m_stats.time_ms = m_impl->m_stats.time_ns / 1000000;
+  return result;
+}
+
+const parser_stats& reader::stats() const
+{
+  return m_impl->m_stats;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Implementation of push_parser
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+/**
+ * @struct push_parser::impl
+ * @brief Reader steps run on the pieces of the input. A step that reaches the end of a piece is
+ *        undone and repeated once the rest of the input has arrived.
+ */
+struct push_parser::impl : public reader::impl
+{
+  reader::handler*    m_handler; //! Handler of the events. nullptr to build the json tree
+  bool                m_stopped; //! No more input is parsed
+  bool                m_failed;  //! Parsing stopped on an error
+  std::string         m_pending; //! Tail of the input with an incomplete token
+  size_t              m_retry;   //! Length m_pending must reach before it is parsed again
+  value               m_root;    //! Json tree built without a handler
+  std::vector<value*> m_path;    //! Containers of m_root that are open
+  std::string         m_key;     //! Key of the value that follows
+
+  impl(reader::handler* _handler) : m_handler(_handler), m_stopped(false), m_failed(false), m_retry(0) {}
+
+  void start();
+  //! Parse the given input. Returns the number of bytes consumed.
+  size_t run(const char* _data, size_t _len);
+  //! Parse the rest of the input as complete
+  void finish();
+  //! Add the current event to the json tree
+  bool build_tree();
+};
+
+void push_parser::impl::start()
+{
+  open(nullptr, 0, m_ctrl);
+  m_partial = true;
+  m_stopped = m_failed = false;
+  m_pending.clear();
+  m_retry = 0;
+  m_root = value();
+  m_path.clear();
+  m_key.clear();
+}
+
+size_t push_parser::impl::run(const char* _data, size_t _len)
+{
+  resume(_data, _len);
+  const char* p = m_p;
+  try
+  {
+    while ( ! m_stopped )
+    {
+      p = m_p;
+      if ( m_state == state::done )
+      {
+        check_trailing(m_event == event_type::end_object? value_type::object : value_type::array);
+        break;
+      }
+      if ( step() )
+        m_stopped = ! ( m_handler? dispatch(*m_handler) : build_tree() );
+    }
+  }
+  catch ( const need_more& )
+  {
+    // Wait for the rest of the token
+    m_p = p;
+  }
+  catch (...)
+  {
+    m_stopped = m_failed = true;
+    throw;
+  }
+  const size_t used = m_p - m_begin;
+  consume();
+  return used;
+}
+
+void push_parser::impl::finish()
+{
+  if ( m_stopped )
+    return;
+  m_partial = false;
+  run(m_pending.data(), m_pending.length());
+  m_pending.clear();
+  m_stopped = true;
+}
+
+bool push_parser::impl::build_tree()
+{
+  switch ( m_event )
+  {
+  case event_type::end_object:
+  case event_type::end_array:
+    m_path.pop_back();
+    return true;
+  case event_type::key:
+    m_key = m_str;
+    return true;
+  default:
+    break;
+  }
+
+  // Find where the value goes
+  value* jval = nullptr;
+  if ( m_path.empty() )
+    jval = &m_root;
+  else if ( m_path.back()->is_array() )
+    jval = &m_path.back()->append();
+  else
+  {
+    value& jobj = *m_path.back();
+    value* jexisting = jobj.find(m_key);
+    if ( jexisting == nullptr )
+      jval = &jobj[m_key];
+    else if ( m_ctrl.dupKey != parser_control::dup_key::append )
+      jval = jexisting;
+    else
+    {
+      // make it as an array and append the duplicate keys
+      if ( ! jexisting->is_array() )
+      {
+        value jfirst(std::move(*jexisting));
+        *jexisting = value(value_type::array);
+        jexisting->append(std::move(jfirst));
+      }
+      jval = &jexisting->append();
+    }
+  }
+
+  switch ( m_event )
+  {
+  case event_type::start_object: *jval = value(value_type::object); m_path.push_back(jval); break;
+  case event_type::start_array:  *jval = value(value_type::array); m_path.push_back(jval); break;
+  case event_type::null:         *jval = value(); break;
+  case event_type::boolean:      *jval = m_bval; break;
+  case event_type::string:       *jval = m_str; break;
+  case event_type::number:
+    if ( m_num.isLong )
+      *jval = m_num.ldbl;
+    else if ( m_num.type == value_type::_double )
+      *jval = m_num.dbl;
+    else if ( m_num.type == value_type::_signed )
+      *jval = m_num.i64;
+    else
+      *jval = m_num.u64;
+    break;
+  default:
+    break;
+  }
+  return true;
+}
+
+push_parser::push_parser(const parser_control& _ctrl/* = parser_control()*/)
+  : m_impl(new impl(nullptr))
+{
+  m_impl->m_ctrl = _ctrl;
+  reset();
+}
+
+push_parser::push_parser(reader::handler& _handler, const parser_control& _ctrl/* = parser_control()*/)
+  : m_impl(new impl(&_handler))
+{
+  m_impl->m_ctrl = _ctrl;
+  reset();
+}
+
+push_parser::~push_parser()
+{
+}
+
+void push_parser::reset()
+{
+  m_impl->start();
+}
+
+bool push_parser::feed(const char* _data, size_t _len)
+{
+  impl& p = *m_impl;
+  if ( p.m_stopped )
+    return false;
+  p.m_stats.bytes += _len;
+
+  if ( p.m_pending.empty() )
+  {
+    // Parse in place, keeping only the incomplete tail
+    const size_t used = p.run(_data, _len);
+    p.m_pending.assign(_data + used, _len - used);
+  }
+  else
+  {
+    p.m_pending.append(_data, _len);
+    // A token longer than the pieces is scanned again only after the pending bytes have
+    // doubled, so that the time spent on it stays linear in its length
+    if ( p.m_pending.length() < p.m_retry )
+      return true;
+    const size_t used = p.run(p.m_pending.data(), p.m_pending.length());
+    p.m_pending.erase(0, used);
+  }
+  p.m_retry = 2 * p.m_pending.length();
+  return ! p.m_stopped;
+}
+
+void push_parser::finish()
+{
+  m_impl->finish();
+}
+
+bool push_parser::is_complete() const
+{
+  return ( m_impl->m_state == impl::state::done && ! m_impl->m_failed );
+}
+
+size_t push_parser::pending() const
+{
+  return m_impl->m_pending.length();
+}
+
+value& push_parser::root()
+{
+  return m_impl->m_root;
+}
+
+const parser_stats& push_parser::stats() const
+{
+  return m_impl->m_stats;
+}
@@ -39,6 +39,9 @@ LICENSE: END
 #include <common/json.hpp>
 #include <common/convert.hpp>
 #include <common/opt.hpp>
+#include "json_validator.h"
+#include <cmath>
+#include <charconv>
 #include <fstream>
 #include <stack>
 #include <iomanip>
@@ -127,21 +130,9 @@ bool schema::empty() const
 /*static*/
 schema schema::parse_file(const std::string& _schemaFile)
 {
-  std::ifstream in;
-  in.open(_schemaFile);
-  if ( ! in.is_open() )
-    throw sid::exception("Failed to open schema file: ") + _schemaFile;
-  char buf[8096] = {0};
-  std::string jsonStr;
-  while ( ! in.eof() )
-  {
-    ::memset(buf, 0, sizeof(buf));
-    in.read(buf, sizeof(buf)-1);
-    if ( in.bad() )
-      throw sid::exception(sid::to_errno_str("Failed to read schema file"));
-    jsonStr += buf;
-  }
-  return parse(jsonStr);
+  value jroot;
+  value::parse_file(jroot, _schemaFile);
+  return parse(jroot);
 }
 
 /*static*/
@@ -156,21 +147,21 @@ schema schema::parse(const std::string& _schemaData)
 schema schema::parse(const value& _jroot)
 {
   schema schema;
-  value jval;
-  if ( _jroot.has_key("$schema", jval) && !jval.is_null() )
-    schema._schema = jval.get_str();
-  if ( _jroot.has_key("$id", jval) && !jval.is_null() )
-    schema._id = jval.get_str();
-  if ( _jroot.has_key("title", jval) && !jval.is_null() )
-    schema.title = jval.get_str();
-  if ( _jroot.has_key("description", jval) && !jval.is_null() )
-    schema.description = jval.get_str();
-
-  if ( !_jroot.has_key("type", jval) )
+  const value* jval = nullptr;
+  if ( (jval = _jroot.find("$schema")) != nullptr && !jval->is_null() )
+    schema._schema = jval->get_str();
+  if ( (jval = _jroot.find("$id")) != nullptr && !jval->is_null() )
+    schema._id = jval->get_str();
+  if ( (jval = _jroot.find("title")) != nullptr && !jval->is_null() )
+    schema.title = jval->get_str();
+  if ( (jval = _jroot.find("description")) != nullptr && !jval->is_null() )
+    schema.description = jval->get_str();
+
+  if ( (jval = _jroot.find("type")) == nullptr )
     throw sid::exception("type missing in schema");
 
   // set the schema type
-  schema.type.add(jval);
+  schema.type.add(*jval);
   // Top level type must be an object or an array
   {
     schema_types type = schema.type;
@@ -180,21 +171,21 @@ schema schema::parse(const value& _jroot)
       throw sid::exception("Top-level schema type must be an object or an array");
   }
 
-  const bool hasProperties = _jroot.has_key("properties", jval);
+  const bool hasProperties = ( (jval = _jroot.find("properties")) != nullptr );
   if ( schema.type.exists(schema_type::object) )
   {
     if ( ! hasProperties )
       throw sid::exception("properties missing in schema");
-    schema.properties.set(jval);
+    schema.properties.set(*jval);
   }
   else if ( hasProperties )
     throw sid::exception("properties is applicable only for object type schema");
 
-  if ( _jroot.has_key("required", jval) )
+  if ( (jval = _jroot.find("required")) != nullptr )
   {
     if ( ! schema.type.exists(schema_type::object) )
       throw sid::exception("required is applicable only for object type schema");
-    local::fill_required(schema.required, jval, schema.properties);
+    local::fill_required(schema.required, *jval, schema.properties);
   }
   return schema;
 }
@@ -215,128 +206,128 @@ void schema::property_vec::set(const value& _jproperties)
 void schema::property::set(const value& _jproperties, const std::string& _key)
 {
   const value& jproperty = _jproperties[_key];
-  value jval;
+  const value* jval = nullptr;
 
   this->key = _key;
-  if ( ! jproperty.has_key("type", jval) )
+  if ( (jval = jproperty.find("type")) == nullptr )
     throw sid::exception("property type missing for ") + this->key;
-  this->type.add(jval);
-  if ( jproperty.has_key("description", jval) && !jval.is_null() )
-    this->description = jval.get_str();
+  this->type.add(*jval);
+  if ( (jval = jproperty.find("description")) != nullptr && !jval->is_null() )
+    this->description = jval->get_str();
 
   if ( this->type.exists(schema_type::number) || this->type.exists(schema_type::integer) )
   {
-    if ( jproperty.has_key("minimum", jval) )
+    if ( (jval = jproperty.find("minimum")) != nullptr )
     {
-      if ( ! jval.is_decimal() )
+      if ( ! jval->is_decimal() )
         throw sid::exception("minimum must be a decimal value");
-      this->minimum = jval.get_int64();
+      this->minimum = jval->get_int64();
     }
-    if ( jproperty.has_key("exclusiveMinimum", jval) )
+    if ( (jval = jproperty.find("exclusiveMinimum")) != nullptr )
     {
-      if ( ! jval.is_decimal() )
+      if ( ! jval->is_decimal() )
         throw sid::exception("exclusiveMinimum must be a decimal value");
-      this->minimum = jval.get_int64();
+      this->exclusiveMinimum = jval->get_int64();
     }
-    if ( jproperty.has_key("maximum", jval) )
+    if ( (jval = jproperty.find("maximum")) != nullptr )
     {
-      if ( ! jval.is_decimal() )
+      if ( ! jval->is_decimal() )
         throw sid::exception("maximum must be a decimal value");
-      this->minimum = jval.get_int64();
+      this->maximum = jval->get_int64();
     }
-    if ( jproperty.has_key("exclusiveMaximum", jval) )
+    if ( (jval = jproperty.find("exclusiveMaximum")) != nullptr )
     {
-      if ( ! jval.is_decimal() )
+      if ( ! jval->is_decimal() )
         throw sid::exception("exclusiveMaximum must be a decimal value");
-      this->minimum = jval.get_int64();
+      this->exclusiveMaximum = jval->get_int64();
     }
-    if ( jproperty.has_key("multipleOf", jval) )
+    if ( (jval = jproperty.find("multipleOf")) != nullptr )
     {
-      if ( ! jval.is_decimal() )
+      if ( ! jval->is_decimal() )
         throw sid::exception("multipleOf must be a decimal value");
-      this->minimum = jval.get_int64();
+      this->multipleOf = jval->get_int64();
     }
   }
   if ( this->type.exists(schema_type::string) )
   {
-    if ( jproperty.has_key("minLength", jval) )
+    if ( (jval = jproperty.find("minLength")) != nullptr )
     {
-      if ( ! jval.is_unsigned() )
+      if ( ! jval->is_unsigned() )
         throw sid::exception("minLength must be an unsigned value");
-      this->minLength = jval.get_uint64();
+      this->minLength = jval->get_uint64();
     }
-    if ( jproperty.has_key("maxLength", jval) )
+    if ( (jval = jproperty.find("maxLength")) != nullptr )
     {
-      if ( ! jval.is_unsigned() )
+      if ( ! jval->is_unsigned() )
         throw sid::exception("maxLength must be an unsigned value");
-      this->maxLength = jval.get_uint64();
+      this->maxLength = jval->get_uint64();
     }
-    if ( jproperty.has_key("pattern", jval) )
+    if ( (jval = jproperty.find("pattern")) != nullptr )
     {
-      if ( ! jval.is_string() )
+      if ( ! jval->is_string() )
         throw sid::exception("pattern must be a string");
-      this->pattern = jval.get_str();
+      this->pattern = jval->get_str();
     }
   }
   if ( this->type.exists(schema_type::array) )
   {
-    if ( jproperty.has_key("minItems", jval) )
+    if ( (jval = jproperty.find("minItems")) != nullptr )
     {
-      if ( ! jval.is_unsigned() )
+      if ( ! jval->is_unsigned() )
         throw sid::exception("minItems must be an unsigned value");
-      this->minItems = jval.get_uint64();
+      this->minItems = jval->get_uint64();
     }
-    if ( jproperty.has_key("maxItems", jval) )
+    if ( (jval = jproperty.find("maxItems")) != nullptr )
     {
-      if ( ! jval.is_unsigned() )
+      if ( ! jval->is_unsigned() )
         throw sid::exception("maxItems must be an unsigned value");
-      this->maxItems = jval.get_uint64();
+      this->maxItems = jval->get_uint64();
     }
-    if ( jproperty.has_key("uniqueItems", jval) )
+    if ( (jval = jproperty.find("uniqueItems")) != nullptr )
     {
-      if ( ! jval.is_bool() )
+      if ( ! jval->is_bool() )
         throw sid::exception("uniqueItems must be a boolean value");
-      this->uniqueItems = jval.get_bool();
+      this->uniqueItems = jval->get_bool();
     }
-    if ( jproperty.has_key("minContains", jval) )
+    if ( (jval = jproperty.find("minContains")) != nullptr )
     {
-      if ( ! jval.is_unsigned() )
+      if ( ! jval->is_unsigned() )
         throw sid::exception("minContains must be an unsigned value");
-      this->minContains = jval.get_uint64();
+      this->minContains = jval->get_uint64();
     }
-    if ( jproperty.has_key("maxContains", jval) )
+    if ( (jval = jproperty.find("maxContains")) != nullptr )
     {
-      if ( ! jval.is_unsigned() )
+      if ( ! jval->is_unsigned() )
         throw sid::exception("maxContains must be an unsigned value");
-      this->maxContains = jval.get_uint64();
+      this->maxContains = jval->get_uint64();
     }
   }
   if ( this->type.exists(schema_type::object) )
   {
-    if ( jproperty.has_key("minProperties", jval) )
+    if ( (jval = jproperty.find("minProperties")) != nullptr )
     {
-      if ( ! jval.is_unsigned() )
+      if ( ! jval->is_unsigned() )
         throw sid::exception("minProperties must be an unsigned value");
-      this->minProperties = jval.get_uint64();
+      this->minProperties = jval->get_uint64();
     }
-    if ( jproperty.has_key("maxProperties", jval) )
+    if ( (jval = jproperty.find("maxProperties")) != nullptr )
     {
-      if ( ! jval.is_unsigned() )
+      if ( ! jval->is_unsigned() )
         throw sid::exception("maxProperties must be an unsigned value");
-      this->maxProperties = jval.get_uint64();
+      this->maxProperties = jval->get_uint64();
     }
   }
-  if ( jproperty.has_key("properties", jval) )
+  if ( (jval = jproperty.find("properties")) != nullptr )
   {
     if ( ! this->type.exists(schema_type::object) )
       throw sid::exception("properties is applicable only for object types. Key: ") + this->key;
-    this->properties.set(jval);
+    this->properties.set(*jval);
   }
-  if ( jproperty.has_key("required", jval) )
+  if ( (jval = jproperty.find("required")) != nullptr )
   {
     if ( ! this->type.exists(schema_type::object) )
       throw sid::exception("required is applicable only for object types for key ") + this->key;
-    local::fill_required(this->required, jval, this->properties);
+    local::fill_required(this->required, *jval, this->properties);
   }
 }
 
@@ -407,7 +398,7 @@ value schema::property::to_json() const
     if ( this->exclusiveMaximum )
       jroot["exclusiveMaximum"] = this->exclusiveMaximum();
     if ( this->multipleOf )
-      jroot["multipleOf"] = this->maximum();
+      jroot["multipleOf"] = this->multipleOf();
   }
   if ( this->type.exists(schema_type::string) )
   {
@@ -438,7 +429,7 @@ value schema::property::to_json() const
     if ( this->maxProperties )
       jroot["maxProperties"] = this->maxProperties();
     if ( ! this->properties.empty() )
-      jroot["jproperties"] = this->properties.to_json();
+      jroot["properties"] = this->properties.to_json();
     for ( const std::string& req : this->required )
       jroot["required"].append(req);
   }
@@ -538,6 +529,319 @@ void schema_types::add(const value& _value)
     throw sid::exception("type parameter must be string or an array of unique string");
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Implementation of validator
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+namespace local
+{
+//! Bit of the given schema type in validator::node::types
+constexpr uint8_t type_bit(schema_type::ID _id) { return static_cast<uint8_t>(1 << _id); }
+
+//! Names of the types in the given bit mask
+std::string type_names(uint8_t _types)
+{
+  std::string names;
+  for ( uint8_t id = schema_type::null; id <= schema_type::integer; id++ )
+  {
+    if ( _types & type_bit(static_cast<schema_type::ID>(id)) )
+      names += ( names.empty()? "" : " or " ) + schema_type(static_cast<schema_type::ID>(id)).name();
+  }
+  return names;
+}
+
+//! Compare a number with an integer. Returns <0, 0 or >0.
+int compare(const value& _num, int64_t _bound)
+{
+  if ( _num.is_signed() )
+  {
+    const int64_t i64 = _num.get_int64();
+    return ( i64 < _bound )? -1 : ( i64 > _bound );
+  }
+  if ( _num.is_unsigned() )
+  {
+    const uint64_t u64 = _num.get_uint64();
+    return ( _bound < 0 || u64 > static_cast<uint64_t>(_bound) )? 1 : ( u64 < static_cast<uint64_t>(_bound) )? -1 : 0;
+  }
+  const long double dbl = _num.get_long_double();
+  return ( dbl < _bound )? -1 : ( dbl > _bound );
+}
+
+//! Mix a hash value into a seed
+inline uint64_t mix(uint64_t _seed, uint64_t _hash)
+{
+  return (_seed ^ _hash) * 0x100000001b3ULL + 0x9e3779b97f4a7c15ULL;
+}
+} // namespace local
+
+validator::validator(const schema& _schema) : m_root(new node)
+{
+  if ( _schema.empty() )
+    throw sid::exception("Invalid schema given for validation");
+  for ( const schema_type& type : _schema.type )
+    m_root->types |= local::type_bit(type.id());
+  m_root->set(_schema.properties, _schema.required);
+}
+
+validator::~validator()
+{
+}
+
+/*static*/
+uint64_t validator::p_hash(const value& _val)
+{
+  uint64_t hash = _val.is_num()? value_type::_double : _val.type();
+  switch ( _val.type() )
+  {
+  case value_type::null:
+    break;
+  case value_type::boolean:
+    hash = local::mix(hash, _val.m_data._bval);
+    break;
+  case value_type::string:
+    hash = local::mix(hash, std::hash<std::string_view>()(_val.p_str()));
+    break;
+  case value_type::array:
+    for ( const value& jelem : *_val.m_data._arr )
+      hash = local::mix(hash, p_hash(jelem));
+    break;
+  case value_type::object:
+  {
+    // The keys are not ordered, so the hashes of the members are combined by a sum
+    uint64_t sum = 0;
+    for ( const auto& entry : *_val.m_data._map )
+      sum += local::mix(std::hash<std::string_view>()(entry.first.p_str()), p_hash(entry.second));
+    hash = local::mix(hash, sum);
+  }
+  break;
+  default:
+    // Numbers that are equal have the same hash whatever their type
+    hash = local::mix(hash, std::hash<long double>()(_val.get_long_double()));
+    break;
+  }
+  return hash;
+}
+
+/*static*/
+bool validator::p_equal(const value& _lhs, const value& _rhs)
+{
+  if ( _lhs.is_num() && _rhs.is_num() )
+  {
+    if ( _lhs.is_double() || _rhs.is_double() )
+      return ( _lhs.get_long_double() == _rhs.get_long_double() );
+    if ( _lhs.is_signed() && _lhs.m_data._i64 < 0 )
+      return ( _rhs.is_signed() && _lhs.m_data._i64 == _rhs.m_data._i64 );
+    return ( ! _rhs.is_signed() || _rhs.m_data._i64 >= 0 ) && _lhs.m_data._u64 == _rhs.m_data._u64;
+  }
+  if ( _lhs.type() != _rhs.type() )
+    return false;
+  switch ( _lhs.type() )
+  {
+  case value_type::null:    return true;
+  case value_type::boolean: return ( _lhs.m_data._bval == _rhs.m_data._bval );
+  case value_type::string:  return ( _lhs.p_str() == _rhs.p_str() );
+  case value_type::array:
+  {
+    const auto& lhs = *_lhs.m_data._arr;
+    const auto& rhs = *_rhs.m_data._arr;
+    if ( lhs.size() != rhs.size() )
+      return false;
+    for ( size_t i = 0; i < lhs.size(); i++ )
+      if ( ! p_equal(lhs[i], rhs[i]) )
+        return false;
+    return true;
+  }
+  case value_type::object:
+  {
+    if ( _lhs.m_data._map->size() != _rhs.m_data._map->size() )
+      return false;
+    for ( const auto& entry : *_lhs.m_data._map )
+    {
+      const value* pval = _rhs.m_data._map->find(entry.first.p_str());
+      if ( pval == nullptr || ! p_equal(entry.second, *pval) )
+        return false;
+    }
+    return true;
+  }
+  default:
+    return false;
+  }
+}
+
+void validator::node::set(const schema::property& _property, const std::string& _name)
+{
+  name = _name;
+  for ( const schema_type& type : _property.type )
+    types |= local::type_bit(type.id());
+  minimum = _property.minimum;
+  exclusiveMinimum = _property.exclusiveMinimum;
+  maximum = _property.maximum;
+  exclusiveMaximum = _property.exclusiveMaximum;
+  multipleOf = _property.multipleOf;
+  if ( multipleOf && multipleOf() <= 0 )
+    throw sid::exception("multipleOf must be greater than 0 for " + _name);
+  minLength = _property.minLength;
+  maxLength = _property.maxLength;
+  if ( ! _property.pattern.empty() )
+  {
+    pattern.reset(new sid::regex(_property.pattern.c_str(), REG_EXTENDED | REG_NOSUB));
+    if ( ! pattern->is_initialized() )
+      throw sid::exception("Invalid pattern \"" + _property.pattern + "\" for " + _name + ": "
+                           + pattern->error());
+  }
+  minItems = _property.minItems;
+  maxItems = _property.maxItems;
+  uniqueItems = _property.uniqueItems(false);
+  minProperties = _property.minProperties;
+  maxProperties = _property.maxProperties;
+  set(_property.properties, _property.required);
+}
+
+void validator::node::set(
+  const schema::property_vec&  _properties,
+  const std::set<std::string>& _required
+  )
+{
+  required.assign(_required.begin(), _required.end());
+  for ( const schema::property& property : _properties )
+    properties[property.key].set(property, name + "/" + property.key);
+}
+
+std::string validator::node::check_start(value_type _type) const
+{
+  const schema_type::ID id = ( _type == value_type::object )? schema_type::object : schema_type::array;
+  if ( types & local::type_bit(id) )
+    return std::string();
+  return "Expected " + local::type_names(types) + ", found " + schema_type(id).name();
+}
+
+std::string validator::node::check_count(value_type _type, size_t _count) const
+{
+  if ( _type == value_type::array && maxItems && _count > maxItems() )
+    return "Number of items is more than maxItems " + sid::to_str(maxItems());
+  if ( _type == value_type::object && maxProperties && _count > maxProperties() )
+    return "Number of properties is more than maxProperties " + sid::to_str(maxProperties());
+  return std::string();
+}
+
+std::string validator::node::check_end(const value& _val) const
+{
+  const size_t count = _val.size();
+  if ( _val.is_array() )
+  {
+    if ( minItems && count < minItems() )
+      return "Number of items " + sid::to_str(count) + " is less than minItems " + sid::to_str(minItems());
+    return check_count(value_type::array, count);
+  }
+  if ( minProperties && count < minProperties() )
+    return "Number of properties " + sid::to_str(count) + " is less than minProperties "
+      + sid::to_str(minProperties());
+  for ( const std::string& key : required )
+    if ( _val.m_data._map->find(key) == nullptr )
+      return "Required property \"" + key + "\" is missing";
+  return check_count(value_type::object, count);
+}
+
+std::string validator::node::check_string(std::string_view _str) const
+{
+  if ( ! (types & local::type_bit(schema_type::string)) )
+    return "Expected " + local::type_names(types) + ", found string";
+  if ( minLength || maxLength )
+  {
+    // The length is the number of characters, not of bytes. The strings keep their \uXXXX
+    // escapes: each is one character, and the two escapes of a surrogate pair are one.
+    size_t length = 0;
+    for ( size_t i = 0; i < _str.length(); i++ )
+    {
+      uint16_t code = 0;
+      if ( _str[i] == '\\' && i + 5 < _str.length() && _str[i + 1] == 'u'
+           && std::from_chars(&_str[i + 2], &_str[i + 6], code, 16).ptr == &_str[i + 6] )
+      {
+        // The low half of a surrogate pair is part of the character of the high half
+        length += ( code < 0xDC00 || code > 0xDFFF );
+        i += 5;
+      }
+      else
+        length += ( (static_cast<uint8_t>(_str[i]) & 0xC0) != 0x80 );
+    }
+    if ( minLength && length < minLength() )
+      return "Length " + sid::to_str(length) + " is less than minLength " + sid::to_str(minLength());
+    if ( maxLength && length > maxLength() )
+      return "Length " + sid::to_str(length) + " is more than maxLength " + sid::to_str(maxLength());
+  }
+  // The regular expression needs a NUL terminated string
+  if ( pattern && ! pattern->exec(std::string(_str).c_str()) )
+    return "Value does not match the pattern \"" + pattern->pattern() + "\"";
+  return std::string();
+}
+
+std::string validator::node::check_scalar(const value& _val) const
+{
+  schema_type::ID id = schema_type::null;
+  if ( _val.is_bool() )
+    id = schema_type::boolean;
+  else if ( _val.is_decimal() )
+    id = schema_type::integer;
+  else if ( _val.is_double() )
+  {
+    // A number with a zero fraction is an integer too
+    const long double dbl = _val.get_long_double();
+    id = ( std::trunc(dbl) == dbl )? schema_type::integer : schema_type::number;
+  }
+  // An integer is a number too
+  uint8_t mask = local::type_bit(id);
+  if ( id == schema_type::integer )
+    mask |= local::type_bit(schema_type::number);
+  if ( ! (types & mask) )
+    return "Expected " + local::type_names(types) + ", found " + schema_type(id).name();
+  if ( ! _val.is_num() )
+    return std::string();
+
+  if ( minimum && local::compare(_val, minimum()) < 0 )
+    return "Value " + _val.as_str() + " is less than minimum " + sid::to_str(minimum());
+  if ( exclusiveMinimum && local::compare(_val, exclusiveMinimum()) <= 0 )
+    return "Value " + _val.as_str() + " is not more than exclusiveMinimum "
+      + sid::to_str(exclusiveMinimum());
+  if ( maximum && local::compare(_val, maximum()) > 0 )
+    return "Value " + _val.as_str() + " is more than maximum " + sid::to_str(maximum());
+  if ( exclusiveMaximum && local::compare(_val, exclusiveMaximum()) >= 0 )
+    return "Value " + _val.as_str() + " is not less than exclusiveMaximum "
+      + sid::to_str(exclusiveMaximum());
+  if ( multipleOf )
+  {
+    const uint64_t divisor = static_cast<uint64_t>(multipleOf());
+    bool isMultiple = false;
+    if ( _val.is_signed() )
+    {
+      const int64_t i64 = _val.get_int64();
+      isMultiple = ( (( i64 < 0 )? (0 - static_cast<uint64_t>(i64)) : static_cast<uint64_t>(i64)) % divisor == 0 );
+    }
+    else if ( _val.is_unsigned() )
+      isMultiple = ( _val.get_uint64() % divisor == 0 );
+    else
+      isMultiple = ( std::fmod(_val.get_long_double(), static_cast<long double>(divisor)) == 0 );
+    if ( ! isMultiple )
+      return "Value " + _val.as_str() + " is not a multiple of " + sid::to_str(multipleOf());
+  }
+  return std::string();
+}
+
+std::string validator::node::unique_items::add(const value& _jarr, size_t _index)
+{
+  const value& jelem = _jarr[_index];
+  const uint64_t hash = validator::p_hash(jelem);
+  auto range = m_hashes.equal_range(hash);
+  for ( auto it = range.first; it != range.second; ++it )
+  {
+    if ( validator::p_equal(_jarr[it->second], jelem) )
+      return "Items " + sid::to_str(it->second) + " and " + sid::to_str(_index)
+        + " are the same, which uniqueItems does not allow";
+  }
+  m_hashes.emplace(hash, _index);
+  return std::string();
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 //
 // Implementation of local namespace
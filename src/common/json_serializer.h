@@ -0,0 +1,118 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@file json_serializer.h
+@brief Internal json serializer
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+/**
+ * @file  json_serializer.h
+ * @brief Serializer shared by value::to_str(), the json bindings and the json writer.
+ */
+#pragma once
+
+#include <common/json.hpp>
+#include <cstring>
+#include <string>
+
+namespace sid {
+namespace json {
+
+/**
+ * @struct serializer
+ * @brief Internal json serializer. Appends the json text of a value to a string buffer.
+ *
+ * The buffer is grown ahead of the writes, without initializing the new space, and the
+ * characters are stored through a pointer. The buffer is trimmed to what was written
+ * when the serializer goes out of scope. The capacity the buffer already has is used before
+ * it is grown, so serializers can be made in turn over the same buffer.
+ *
+ * The layout of the objects and the arrays (begin_entry(), write_key(), end_container()) is
+ * also used by the writers that build a container a piece at a time (json::writer and
+ * json::cached_value), so that their text is the one of value::to_str().
+ */
+struct serializer
+{
+  std::string&  m_out;     //! Output buffer
+  const format& m_format;  //! Output format
+  const bool    m_pretty;  //! Pretty format with new lines
+  char*         m_p;       //! Write position in m_out
+  char*         m_end;     //! End of the space available in m_out
+
+  serializer(std::string& _out, const format& _format)
+    : m_out(_out), m_format(_format), m_pretty(_format.type == format_type::pretty),
+      m_p(nullptr), m_end(nullptr) {}
+  ~serializer() { if ( m_p ) m_out.resize(m_p - m_out.data()); }
+
+  //! write the value at the given level of nesting
+  void write(const value& _jval, uint32_t _level);
+  //! write the string in quotes (see json_bind.hpp)
+  void write_quoted(std::string_view _str) { put('\"'); write_string(_str); put('\"'); }
+  //! write a string value, in quotes unless the format leaves them out
+  void write_text(std::string_view _str);
+
+  //! start an entry of an object or an array at the given level of nesting: the comma after
+  //! the previous entry and, in the pretty format, the new line
+  void begin_entry(bool _isFirst, uint32_t _level) {
+    if ( ! _isFirst )
+      put(',');
+    if ( m_pretty )
+      new_line(_level);
+  }
+  //! write the key of an object entry and the colon following it. The key is escaped only
+  //! if _escape is set, as the keys of a value are stored escaped.
+  void write_key(std::string_view _key, bool _escape = false);
+  //! end an object or an array at the given level of nesting with _close, which is on a line
+  //! of its own in the pretty format if the container has entries
+  void end_container(bool _hasEntries, uint32_t _level, char _close) {
+    if ( _hasEntries && m_pretty )
+      new_line(_level);
+    put(_close);
+  }
+
+private:
+  //! make room for _len more characters
+  void reserve(size_t _len) { if ( static_cast<size_t>(m_end - m_p) < _len ) p_grow(_len); }
+  void put(char _ch) { reserve(1); *m_p++ = _ch; }
+  void put(const char* _str, size_t _len) { reserve(_len); ::memcpy(m_p, _str, _len); m_p += _len; }
+  void p_grow(size_t _len);
+
+  //! write the string escaping the special characters, those of a string without quotes too
+  //! if _noQuotes is set
+  void write_string(std::string_view _str, bool _noQuotes);
+  void write_string(std::string_view _str) { write_string(_str, m_format.string_no_quotes); }
+  //! write the number using the shortest buffer possible
+  void write_number(const value& _jnum);
+  //! start a new line indented for the given level
+  void new_line(uint32_t _level);
+};
+
+} // namespace json
+} // namespace sid
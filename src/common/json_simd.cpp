@@ -0,0 +1,518 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@file json_simd.cpp
+@brief Vectorized scanning routines used by the json parser
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+/**
+ * @file  json_simd.cpp
+ * @brief Implementation of the vectorized scanning routines used by the json parser and serializer
+ */
+#include "json_simd.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SID_JSON_SIMD_X86
+#endif
+
+using namespace sid::json;
+
+const uint8_t simd::space_table[256] =
+{
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 0, 0, // 0x00 (\t \n \v \f \r)
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x10
+  1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x20 (space)
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x30
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x40
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x50
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x60
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x70
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x80
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x90
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0xA0
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0xB0
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0xC0
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0xD0
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0xE0
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0  // 0xF0
+};
+
+const uint8_t simd::escape_table[256] =
+{
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 0x00 (control characters)
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, // 0x10 (control characters)
+  0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x20 (")
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x30
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x40
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, // 0x50 (\)
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x60
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x70
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x80
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x90
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0xA0
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0xB0
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0xC0
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0xD0
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0xE0
+  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0  // 0xF0
+};
+
+namespace local
+{
+using scan_fn = const char* (*)(const char*, const char*);
+
+//! Bitmaps of the characters of a block of 64 bytes. Bit i is for the character i of the block.
+struct block_masks
+{
+  uint64_t quote;
+  uint64_t backslash;
+  uint64_t space;
+  uint64_t slash;
+  uint64_t nul;
+};
+using index_fn = size_t (*)(const char*, const char*, simd::structural_index::carry&, uint16_t*);
+
+//! Set of scanning routines for one instruction set
+struct kernels
+{
+  scan_fn     skip_spaces;
+  scan_fn     find_string_special;
+  scan_fn     find_escape;
+  index_fn    index;
+  const char* name;
+};
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// Scalar implementation
+const char* scalar_skip_spaces(const char* _p, const char* _end)
+{
+  for ( ; _p < _end && simd::is_space(*_p); _p++ );
+  return _p;
+}
+
+const char* scalar_find_string_special(const char* _p, const char* _end)
+{
+  for ( ; _p < _end && *_p != '\"' && *_p != '\\' && *_p != '\0'; _p++ );
+  return _p;
+}
+
+const char* scalar_find_escape(const char* _p, const char* _end)
+{
+  for ( ; _p < _end && ! simd::is_escape(*_p); _p++ );
+  return _p;
+}
+
+//! Bit i is the xor of the bits 0 to i. Of the quote bitmap, it is the characters in a string.
+inline uint64_t prefix_xor(uint64_t _bits)
+{
+  _bits ^= _bits << 1;
+  _bits ^= _bits << 2;
+  _bits ^= _bits << 4;
+  _bits ^= _bits << 8;
+  _bits ^= _bits << 16;
+  _bits ^= _bits << 32;
+  return _bits;
+}
+
+//! Add the positions of the block of _len (up to 64) bytes at _base in the window, from its
+//! bitmaps. Returns the number of positions added.
+__attribute__((always_inline))
+inline size_t index_block(const block_masks& _b, size_t _len, uint16_t _base,
+                          simd::structural_index::carry& _carry, uint16_t* _pos)
+{
+  // A backslash that is not escaped escapes the next character. The runs of backslashes are
+  // rare, so they are followed one at a time.
+  uint64_t escaped = _carry.escaped;
+  uint64_t escapes = 0;
+  _carry.escaped = 0;
+  for ( uint64_t bits = _b.backslash; bits != 0; bits &= bits - 1 )
+  {
+    const int i = __builtin_ctzll(bits);
+    if ( (escaped >> i) & 1 )
+      continue;
+    escapes |= uint64_t(1) << i;
+    if ( i == 63 )
+      _carry.escaped = 1;
+    else
+      escaped |= uint64_t(1) << (i + 1);
+  }
+  const uint64_t quote = _b.quote & ~escaped;
+  // The opening quote and the characters of a string are set, its closing quote is not
+  const uint64_t inString = prefix_xor(quote) ^ _carry.inString;
+  _carry.inString = static_cast<uint64_t>(static_cast<int64_t>(inString) >> 63);
+  if ( (_b.slash & ~inString) != 0 )
+  {
+    // A comment, whose quotes do not pair. The rest of the input is scanned.
+    _carry.stopped = true;
+    return 0;
+  }
+  const uint64_t afterSpace = (_b.space << 1) | _carry.afterSpace;
+  _carry.afterSpace = _b.space >> 63;
+  uint64_t bits = quote | escapes | _b.nul | (~_b.space & afterSpace & ~inString);
+  // The padding of the last block is not part of the input
+  if ( _len < 64 )
+    bits &= (uint64_t(1) << _len) - 1;
+  size_t count = 0;
+  for ( ; bits != 0; bits &= bits - 1 )
+    _pos[count++] = _base + __builtin_ctzll(bits);
+  return count;
+}
+
+//! Index the window [_p, _end) with the classification of the instruction set. It is inlined
+//! in the routine of each instruction set, so that the classification is inlined as well.
+template <typename Classify>
+__attribute__((always_inline))
+inline size_t index_window(const char* _p, const char* _end, simd::structural_index::carry& _carry,
+                           uint16_t* _pos, Classify _classify)
+{
+  // The state is kept in registers while the window is indexed
+  simd::structural_index::carry carry = _carry;
+  size_t count = 0;
+  block_masks b;
+  for ( const char* p = _p; p < _end && ! carry.stopped; p += 64 )
+  {
+    const size_t len = std::min(static_cast<size_t>(_end - p), size_t(64));
+    if ( len == 64 )
+      _classify(p, b);
+    else
+    {
+      // The last block is padded with spaces, which are not indexed
+      char tail[64];
+      ::memset(tail, ' ', sizeof(tail));
+      ::memcpy(tail, p, len);
+      _classify(tail, b);
+    }
+    count += index_block(b, len, static_cast<uint16_t>(p - _p), carry, _pos + count);
+  }
+  _carry = carry;
+  return count;
+}
+
+__attribute__((always_inline))
+inline void scalar_classify(const char* _p, block_masks& _b)
+{
+  _b = block_masks{};
+  for ( size_t i = 0; i < 64; i++ )
+  {
+    const uint64_t bit = uint64_t(1) << i;
+    switch ( _p[i] )
+    {
+    case '\"':  _b.quote |= bit;     break;
+    case '\\':  _b.backslash |= bit; break;
+    case '/':   _b.slash |= bit;     break;
+    case '\0':  _b.nul |= bit;       break;
+    default:
+      if ( simd::is_space(_p[i]) )
+        _b.space |= bit;
+    }
+  }
+}
+
+size_t scalar_index(const char* _p, const char* _end, simd::structural_index::carry& _carry,
+                    uint16_t* _pos)
+{
+  return index_window(_p, _end, _carry, _pos, scalar_classify);
+}
+
+#if defined(SID_JSON_SIMD_X86)
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// SSE2 implementation (16 bytes at a time)
+__attribute__((target("sse2")))
+const char* sse2_skip_spaces(const char* _p, const char* _end)
+{
+  const __m128i space = _mm_set1_epi8(' ');
+  const __m128i tab = _mm_set1_epi8('\t');
+  const __m128i range = _mm_set1_epi8('\r' - '\t');
+  for ( ; (_end - _p) >= 16; _p += 16 )
+  {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(_p));
+    // \t, \n, \v, \f and \r are a contiguous range. (v - \t) <= (\r - \t) as unsigned values
+    const __m128i t = _mm_sub_epi8(v, tab);
+    const __m128i ws = _mm_or_si128(_mm_cmpeq_epi8(v, space),
+                                    _mm_cmpeq_epi8(_mm_min_epu8(t, range), t));
+    const uint32_t mask = ~static_cast<uint32_t>(_mm_movemask_epi8(ws)) & 0xFFFF;
+    if ( mask != 0 )
+      return _p + __builtin_ctz(mask);
+  }
+  return scalar_skip_spaces(_p, _end);
+}
+
+__attribute__((target("sse2")))
+const char* sse2_find_string_special(const char* _p, const char* _end)
+{
+  const __m128i quote = _mm_set1_epi8('\"');
+  const __m128i escape = _mm_set1_epi8('\\');
+  const __m128i zero = _mm_setzero_si128();
+  for ( ; (_end - _p) >= 16; _p += 16 )
+  {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(_p));
+    const __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote),
+                                                      _mm_cmpeq_epi8(v, escape)),
+                                         _mm_cmpeq_epi8(v, zero));
+    const uint32_t mask = _mm_movemask_epi8(special);
+    if ( mask != 0 )
+      return _p + __builtin_ctz(mask);
+  }
+  return scalar_find_string_special(_p, _end);
+}
+
+__attribute__((target("sse2")))
+const char* sse2_find_escape(const char* _p, const char* _end)
+{
+  const __m128i quote = _mm_set1_epi8('\"');
+  const __m128i escape = _mm_set1_epi8('\\');
+  const __m128i control = _mm_set1_epi8(0x1F);
+  for ( ; (_end - _p) >= 16; _p += 16 )
+  {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(_p));
+    // v <= 0x1F as unsigned values
+    const __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote),
+                                                      _mm_cmpeq_epi8(v, escape)),
+                                         _mm_cmpeq_epi8(_mm_max_epu8(v, control), control));
+    const uint32_t mask = _mm_movemask_epi8(special);
+    if ( mask != 0 )
+      return _p + __builtin_ctz(mask);
+  }
+  return scalar_find_escape(_p, _end);
+}
+
+__attribute__((target("sse2"), always_inline))
+inline void sse2_classify(const char* _p, block_masks& _b)
+{
+  const __m128i quote = _mm_set1_epi8('\"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i slash = _mm_set1_epi8('/');
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i space = _mm_set1_epi8(' ');
+  const __m128i tab = _mm_set1_epi8('\t');
+  const __m128i range = _mm_set1_epi8('\r' - '\t');
+  _b = block_masks{};
+  for ( int i = 0; i < 64; i += 16 )
+  {
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(_p + i));
+    const __m128i t = _mm_sub_epi8(v, tab);
+    const __m128i ws = _mm_or_si128(_mm_cmpeq_epi8(v, space),
+                                    _mm_cmpeq_epi8(_mm_min_epu8(t, range), t));
+    _b.quote |= uint64_t(uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, quote)))) << i;
+    _b.backslash |= uint64_t(uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, backslash)))) << i;
+    _b.space |= uint64_t(uint32_t(_mm_movemask_epi8(ws))) << i;
+    _b.slash |= uint64_t(uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, slash)))) << i;
+    _b.nul |= uint64_t(uint32_t(_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero)))) << i;
+  }
+}
+
+__attribute__((target("sse2")))
+size_t sse2_index(const char* _p, const char* _end, simd::structural_index::carry& _carry,
+                  uint16_t* _pos)
+{
+  return index_window(_p, _end, _carry, _pos, sse2_classify);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+// AVX2 implementation (32 bytes at a time)
+__attribute__((target("avx2")))
+const char* avx2_skip_spaces(const char* _p, const char* _end)
+{
+  const __m256i space = _mm256_set1_epi8(' ');
+  const __m256i tab = _mm256_set1_epi8('\t');
+  const __m256i range = _mm256_set1_epi8('\r' - '\t');
+  for ( ; (_end - _p) >= 32; _p += 32 )
+  {
+    const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(_p));
+    const __m256i t = _mm256_sub_epi8(v, tab);
+    const __m256i ws = _mm256_or_si256(_mm256_cmpeq_epi8(v, space),
+                                       _mm256_cmpeq_epi8(_mm256_min_epu8(t, range), t));
+    const uint32_t mask = ~static_cast<uint32_t>(_mm256_movemask_epi8(ws));
+    if ( mask != 0 )
+      return _p + __builtin_ctz(mask);
+  }
+  return sse2_skip_spaces(_p, _end);
+}
+
+__attribute__((target("avx2")))
+const char* avx2_find_string_special(const char* _p, const char* _end)
+{
+  const __m256i quote = _mm256_set1_epi8('\"');
+  const __m256i escape = _mm256_set1_epi8('\\');
+  const __m256i zero = _mm256_setzero_si256();
+  for ( ; (_end - _p) >= 32; _p += 32 )
+  {
+    const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(_p));
+    const __m256i special = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, quote),
+                                                            _mm256_cmpeq_epi8(v, escape)),
+                                            _mm256_cmpeq_epi8(v, zero));
+    const uint32_t mask = _mm256_movemask_epi8(special);
+    if ( mask != 0 )
+      return _p + __builtin_ctz(mask);
+  }
+  return sse2_find_string_special(_p, _end);
+}
+
+__attribute__((target("avx2")))
+const char* avx2_find_escape(const char* _p, const char* _end)
+{
+  const __m256i quote = _mm256_set1_epi8('\"');
+  const __m256i escape = _mm256_set1_epi8('\\');
+  const __m256i control = _mm256_set1_epi8(0x1F);
+  for ( ; (_end - _p) >= 32; _p += 32 )
+  {
+    const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(_p));
+    const __m256i special = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, quote),
+                                                            _mm256_cmpeq_epi8(v, escape)),
+                                            _mm256_cmpeq_epi8(_mm256_max_epu8(v, control), control));
+    const uint32_t mask = _mm256_movemask_epi8(special);
+    if ( mask != 0 )
+      return _p + __builtin_ctz(mask);
+  }
+  return sse2_find_escape(_p, _end);
+}
+
+__attribute__((target("avx2"), always_inline))
+inline void avx2_classify(const char* _p, block_masks& _b)
+{
+  const __m256i quote = _mm256_set1_epi8('\"');
+  const __m256i backslash = _mm256_set1_epi8('\\');
+  const __m256i slash = _mm256_set1_epi8('/');
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i space = _mm256_set1_epi8(' ');
+  const __m256i tab = _mm256_set1_epi8('\t');
+  const __m256i range = _mm256_set1_epi8('\r' - '\t');
+  _b = block_masks{};
+  for ( int i = 0; i < 64; i += 32 )
+  {
+    const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(_p + i));
+    const __m256i t = _mm256_sub_epi8(v, tab);
+    const __m256i ws = _mm256_or_si256(_mm256_cmpeq_epi8(v, space),
+                                       _mm256_cmpeq_epi8(_mm256_min_epu8(t, range), t));
+    _b.quote |= uint64_t(uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, quote)))) << i;
+    _b.backslash |= uint64_t(uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, backslash)))) << i;
+    _b.space |= uint64_t(uint32_t(_mm256_movemask_epi8(ws))) << i;
+    _b.slash |= uint64_t(uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, slash)))) << i;
+    _b.nul |= uint64_t(uint32_t(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, zero)))) << i;
+  }
+}
+
+__attribute__((target("avx2")))
+size_t avx2_index(const char* _p, const char* _end, simd::structural_index::carry& _carry,
+                  uint16_t* _pos)
+{
+  return index_window(_p, _end, _carry, _pos, avx2_classify);
+}
+#endif // SID_JSON_SIMD_X86
+
+//! Select the best implementation supported by the CPU
+kernels select_kernels()
+{
+#if defined(SID_JSON_SIMD_X86)
+  __builtin_cpu_init();
+  if ( __builtin_cpu_supports("avx2") )
+    return kernels{avx2_skip_spaces, avx2_find_string_special, avx2_find_escape,
+                   avx2_index, "avx2"};
+  if ( __builtin_cpu_supports("sse2") )
+    return kernels{sse2_skip_spaces, sse2_find_string_special, sse2_find_escape,
+                   sse2_index, "sse2"};
+#endif
+  return kernels{scalar_skip_spaces, scalar_find_string_special, scalar_find_escape,
+                 scalar_index, "scalar"};
+}
+
+const kernels& get_kernels()
+{
+  static const kernels s_kernels = select_kernels();
+  return s_kernels;
+}
+} // namespace local
+
+const char* simd::skip_spaces(const char* _p, const char* _end)
+{
+  return local::get_kernels().skip_spaces(_p, _end);
+}
+
+const char* simd::find_string_special(const char* _p, const char* _end)
+{
+  return local::get_kernels().find_string_special(_p, _end);
+}
+
+const char* simd::find_escape(const char* _p, const char* _end)
+{
+  return local::get_kernels().find_escape(_p, _end);
+}
+
+
+const char* simd::implementation()
+{
+  return local::get_kernels().name;
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Implementation of structural_index
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void simd::structural_index::reset(const char* _begin, const char* _end)
+{
+  m_window = m_next = m_floor = _begin;
+  m_end = _end;
+  // The first character of the input is where a token may start
+  m_carry = carry{0, 0, 1, false};
+  m_count = m_cur = 0;
+}
+
+const char* simd::structural_index::p_next(const char* _p)
+{
+  if ( _p < m_floor )
+    return nullptr;
+  m_floor = _p;
+  while ( true )
+  {
+    for ( ; m_cur < m_count; m_cur++ )
+    {
+      const char* p = m_window + m_pos[m_cur];
+      if ( p >= _p )
+        return p;
+    }
+    if ( ! p_build() )
+      return m_carry.stopped? nullptr : m_end;
+  }
+}
+
+bool simd::structural_index::p_build()
+{
+  m_count = m_cur = 0;
+  if ( m_carry.stopped || m_next == m_end )
+    return false;
+  m_window = m_next;
+  m_next = m_window + std::min(window, static_cast<size_t>(m_end - m_window));
+  m_count = local::get_kernels().index(m_window, m_next, m_carry, m_pos);
+  return true;
+}
@@ -0,0 +1,163 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@file json_simd.h
+@brief Vectorized scanning routines used by the json parser
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+/**
+ * @file  json_simd.h
+ * @brief Vectorized scanning routines used by the json parser and serializer.
+ *
+ * The routines classify 32 bytes (AVX2) or 16 bytes (SSE2) of input at a time.
+ * The implementation is selected once at runtime based on the CPU features,
+ * with a scalar fallback for CPUs (and architectures) without them.
+ *
+ * The structural_index classifies the input 64 bytes at a time into bitmaps, from which the
+ * parser finds the tokens without scanning the characters again.
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace sid {
+namespace json {
+namespace simd {
+
+//! Character class table. Non-zero for the space characters accepted by ::isspace()
+extern const uint8_t space_table[256];
+
+//! check for space character (' ', \t, \n, \v, \f, \r)
+inline bool is_space(char _ch) { return space_table[static_cast<uint8_t>(_ch)] != 0; }
+
+//! Character class table. Non-zero for '"', '\\' and the control characters (< 0x20)
+extern const uint8_t escape_table[256];
+
+//! check for a character that may need escaping when writing a string
+inline bool is_escape(char _ch) { return escape_table[static_cast<uint8_t>(_ch)] != 0; }
+
+//! Returns the first non-space character position in [_p, _end), or _end if there is none
+const char* skip_spaces(const char* _p, const char* _end);
+//! Returns the first '"', '\\' or '\0' position in [_p, _end), or _end if there is none
+const char* find_string_special(const char* _p, const char* _end);
+//! Returns the first '"', '\\' or control character (< 0x20) position in [_p, _end), or _end
+//! if there is none. These are the characters that may need escaping when writing a string.
+const char* find_escape(const char* _p, const char* _end);
+
+//! Name of the implementation selected at runtime (avx2, sse2 or scalar)
+const char* implementation();
+
+/**
+ * @class structural_index
+ * @brief Positions of the tokens of a json text, found before the text is parsed.
+ *
+ * Each block of 64 bytes is classified into bitmaps of the quotes, the backslashes, the spaces,
+ * the '/' and the '\0' characters. The backslashes that start an escape sequence are found
+ * from the runs of backslashes, and the characters inside the strings with a prefix xor of the
+ * quotes that are not escaped. The index holds the positions of:
+ *   - the quotes that are not escaped, which open and close the strings,
+ *   - the backslashes that start an escape sequence, and the '\0' characters,
+ *   - the first character after a run of spaces outside the strings.
+ * From these the parser jumps over the spaces between the tokens, and finds the end of a
+ * string without escape sequences, which it takes as it is in the input.
+ *
+ * The index is built a window at a time as the parser reaches it. It is valid for the strict
+ * grammar only: the quotes of a comment do not pair, nor do those of the unquoted keys and
+ * strings of parse_mode. The index is not built for the flexible modes, and it stops at the
+ * block of the first '/' outside the strings. next() returns nullptr for the input that is
+ * not indexed, which the parser scans instead.
+ */
+class structural_index
+{
+public:
+  //! State carried from one block of 64 bytes to the next
+  struct carry
+  {
+    uint64_t inString;   //! All ones if the previous block ended inside a string
+    uint64_t escaped;    //! 1 if the first character of the next block is escaped
+    uint64_t afterSpace; //! 1 if the previous block ended with a space
+    bool     stopped;    //! A '/' outside the strings stopped the index
+  };
+
+  structural_index() { reset(nullptr, nullptr); }
+
+  //! Index the character sequence [_begin, _end)
+  void reset(const char* _begin, const char* _end);
+
+  //! First indexed position at or after _p, _end if there is none (the rest of the input is
+  //! spaces), or nullptr if the input from _p is not indexed. The positions asked for must
+  //! not decrease, as the positions passed are dropped.
+  const char* next(const char* _p)
+  {
+    // The next position is most often one of the first positions not passed yet
+    if ( _p >= m_floor )
+    {
+      m_floor = _p;
+      for ( ; m_cur < m_count; m_cur++ )
+      {
+        const char* p = m_window + m_pos[m_cur];
+        if ( p >= _p )
+          return p;
+      }
+    }
+    return p_next(_p);
+  }
+
+  //! The closing quote of the string opened at _open, if the string has no escape sequence
+  //! nor '\0' character. Otherwise nullptr.
+  const char* string_end(const char* _open)
+  {
+    const char* p = next(_open + 1);
+    return ( p != nullptr && p != m_end && *p == '\"' )? p : nullptr;
+  }
+
+private:
+  //! Bytes indexed at a time. The positions are relative to the start of the window.
+  static constexpr size_t window = 4096;
+
+  const char* m_end;       //! One past the last character of the input
+  const char* m_window;    //! First character of the current window
+  const char* m_next;      //! First character of the next window
+  const char* m_floor;     //! Last position asked for. The positions before it are dropped.
+  carry       m_carry;     //! State at the end of the indexed input
+  size_t      m_count;     //! Positions in the current window
+  size_t      m_cur;       //! First position of the current window not passed yet
+  uint16_t    m_pos[window]; //! Positions of the current window
+
+  //! next() once the positions of the current window are passed
+  const char* p_next(const char* _p);
+  //! Index the next window. Returns false at the end of the input, or if the index stopped.
+  bool p_build();
+};
+
+} // namespace simd
+} // namespace json
+} // namespace sid
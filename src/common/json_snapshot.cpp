@@ -0,0 +1,588 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@file json_snapshot.cpp
+@brief Memory mappable binary snapshot of json
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+/**
+ * @file  json_snapshot.cpp
+ * @brief Implementation of the memory mappable binary snapshot of json
+ *
+ * Layout of the image:
+ *
+ *   header   : magic, version, byte order, size and the node of the root value
+ *   strings  : characters of each distinct string, not terminated
+ *   nodes    : blocks of the members of the arrays and objects, aligned to 8 bytes
+ *
+ * A node is 16 bytes: the type, a count and 8 bytes of data. Numbers and booleans are in
+ * the data. A string has its length as the count and the offset of its characters as the
+ * data. An array or an object has the number of its members as the count and the offset of
+ * its block as the data. The block of an array is its element nodes. The block of an object
+ * is a key node and a value node for each member, in the order of the value written,
+ * followed by the positions of the members sorted by key.
+ * All the offsets are from the start of the image.
+ */
+#include <common/json_snapshot.hpp>
+#include <common/convert.hpp>
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace sid;
+using namespace sid::json;
+
+namespace sid {
+namespace json {
+
+/**
+ * @struct snapshot::node
+ * @brief A value of the image
+ */
+struct snapshot::node
+{
+  value_type type;        //! Type of the value
+  uint8_t    reserved[3];
+  uint32_t   count;       //! Length of a string, number of members of an array or an object
+  uint64_t   data;        //! Number, boolean, or offset of the characters or the members
+};
+
+static_assert(sizeof(snapshot::node) == 16, "snapshot node must be 16 bytes");
+
+/**
+ * @struct snapshot::writer
+ * @brief Builds the image of a value in memory
+ */
+struct snapshot::writer
+{
+  std::string m_image;
+  //! Offsets of the strings already in the image
+  std::unordered_map<std::string_view, uint64_t> m_strings;
+  //! Offset of each string of the value, in the order fill() visits them
+  std::vector<uint64_t> m_offsets;
+  size_t                m_next = 0;
+
+  //! Add the strings of the value, each one once
+  void strings(const value& _jval);
+  //! Write the node of the value at the given offset, adding the blocks of its members.
+  //! The members are visited in the order of strings().
+  void fill(uint64_t _pos, const value& _jval);
+
+private:
+  void p_string(std::string_view _str);
+  //! Node of the next string visited
+  node p_string_node(std::string_view _str);
+  //! Add a zeroed block of the given size, returning its offset
+  uint64_t p_alloc(size_t _size);
+  void p_put(uint64_t _pos, const node& _node) {
+    ::memcpy(m_image.data() + _pos, &_node, sizeof(node));
+  }
+};
+
+} // namespace json
+} // namespace sid
+
+namespace local
+{
+//! Identifies a snapshot image
+constexpr char snapshot_magic[8] = { 'S', 'I', 'D', 'J', 'S', 'N', 'A', 'P' };
+//! Version of the layout of the image
+constexpr uint32_t snapshot_version = 1;
+//! Written in the byte order of the host, so that an image of the other order is detected
+constexpr uint32_t snapshot_order = 0x01020304;
+
+/**
+ * @struct snapshot_header
+ * @brief Start of the image
+ */
+struct snapshot_header
+{
+  char           magic[8];
+  uint32_t       version;
+  uint32_t       order;
+  uint64_t       size;     //! Size of the image in bytes
+  uint64_t       strings;  //! Number of distinct strings
+  snapshot::node root;     //! Node of the root value
+};
+
+static_assert(sizeof(snapshot_header) % 8 == 0, "snapshot header must keep the nodes aligned");
+
+//! Round the given size up to a multiple of 8
+constexpr size_t align8(size_t _size) { return ( _size + 7 ) & ~size_t(7); }
+
+//! Number of members that can be counted by a node
+uint32_t to_count(size_t _count)
+{
+  if ( _count > UINT32_MAX )
+    throw sid::exception("snapshot: " + sid::to_str(_count) + " is too many members or characters");
+  return static_cast<uint32_t>(_count);
+}
+} // namespace local
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Implementation of snapshot::writer
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void snapshot::writer::strings(const value& _jval)
+{
+  switch ( _jval.type() )
+  {
+  case value_type::string:
+    p_string(_jval.p_str());
+    break;
+  case value_type::array:
+    for ( const value& jelem : *_jval.m_data._arr )
+      strings(jelem);
+    break;
+  case value_type::object:
+    for ( const auto& entry : *_jval.m_data._map )
+    {
+      p_string(entry.first.p_str());
+      strings(entry.second);
+    }
+    break;
+  default:
+    break;
+  }
+}
+
+void snapshot::writer::p_string(std::string_view _str)
+{
+  const auto res = m_strings.emplace(_str, m_image.size());
+  if ( res.second )
+  {
+    local::to_count(_str.length());
+    m_image.append(_str);
+  }
+  // Kept so that fill() does not look the string up again
+  m_offsets.push_back(res.first->second);
+}
+
+snapshot::node snapshot::writer::p_string_node(std::string_view _str)
+{
+  node n{};
+  n.type = value_type::string;
+  n.count = static_cast<uint32_t>(_str.length());
+  n.data = m_offsets[m_next++];
+  return n;
+}
+
+uint64_t snapshot::writer::p_alloc(size_t _size)
+{
+  const uint64_t pos = m_image.size();
+  m_image.resize(pos + _size);
+  return pos;
+}
+
+void snapshot::writer::fill(uint64_t _pos, const value& _jval)
+{
+  node n{};
+  n.type = _jval.type();
+  switch ( _jval.type() )
+  {
+  case value_type::null:
+    break;
+  case value_type::boolean:
+    n.data = _jval.m_data._bval? 1 : 0;
+    break;
+  case value_type::_signed:
+  case value_type::_unsigned:
+    n.data = _jval.m_data._u64;
+    break;
+  case value_type::_double:
+    n.data = std::bit_cast<uint64_t>(_jval.p_double());
+    break;
+  case value_type::string:
+    n = p_string_node(_jval.p_str());
+    break;
+  case value_type::array:
+  {
+    const value::array& arr = *_jval.m_data._arr;
+    n.count = local::to_count(arr.size());
+    n.data = p_alloc(arr.size() * sizeof(node));
+    // The node is written before its members grow the image
+    p_put(_pos, n);
+    for ( size_t i = 0; i < arr.size(); i++ )
+      fill(n.data + i * sizeof(node), arr[i]);
+    return;
+  }
+  case value_type::object:
+  {
+    const value::object& obj = *_jval.m_data._map;
+    const size_t count = obj.size();
+    n.count = local::to_count(count);
+    n.data = p_alloc(count * 2 * sizeof(node) + local::align8(count * sizeof(uint32_t)));
+    p_put(_pos, n);
+
+    std::vector<uint32_t> sorted(count);
+    std::iota(sorted.begin(), sorted.end(), 0);
+    std::stable_sort(sorted.begin(), sorted.end(), [&](uint32_t _a, uint32_t _b) {
+        return obj.at(_a).first.p_str() < obj.at(_b).first.p_str();
+      });
+    if ( count )
+      ::memcpy(m_image.data() + n.data + count * 2 * sizeof(node), sorted.data(),
+               count * sizeof(uint32_t));
+
+    uint64_t pos = n.data;
+    for ( const auto& entry : obj )
+    {
+      p_put(pos, p_string_node(entry.first.p_str()));
+      fill(pos + sizeof(node), entry.second);
+      pos += 2 * sizeof(node);
+    }
+    return;
+  }
+  }
+  p_put(_pos, n);
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Implementation of snapshot
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+void snapshot::write(const value& _jval, const std::string& _filePath)
+{
+  writer w;
+  w.m_image.resize(sizeof(local::snapshot_header));
+  w.strings(_jval);
+  w.m_image.resize(local::align8(w.m_image.size()));
+
+  local::snapshot_header header{};
+  ::memcpy(header.magic, local::snapshot_magic, sizeof(header.magic));
+  header.version = local::snapshot_version;
+  header.order = local::snapshot_order;
+  header.strings = w.m_strings.size();
+  // The root node is filled at the start of the image and the header is written over it
+  w.fill(0, _jval);
+  ::memcpy(&header.root, w.m_image.data(), sizeof(node));
+  header.size = w.m_image.size();
+  ::memcpy(w.m_image.data(), &header, sizeof(header));
+
+  // Written aside and renamed, so that the image is replaced as a whole
+  const std::string tmpPath = _filePath + ".tmp." + sid::to_str(::getpid());
+  const int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if ( fd == -1 )
+    throw sid::exception(errno, sid::to_errno_str("Failed to create file " + tmpPath));
+  const char* p = w.m_image.data();
+  size_t remaining = w.m_image.size();
+  while ( remaining > 0 )
+  {
+    const ssize_t written = ::write(fd, p, remaining);
+    if ( written == -1 && errno == EINTR )
+      continue;
+    if ( written == -1 )
+    {
+      const int err = errno;
+      ::close(fd);
+      ::unlink(tmpPath.c_str());
+      throw sid::exception(err, sid::to_errno_str(err, "Failed to write file " + tmpPath));
+    }
+    p += written;
+    remaining -= written;
+  }
+  ::close(fd);
+  if ( ::rename(tmpPath.c_str(), _filePath.c_str()) == -1 )
+  {
+    const int err = errno;
+    ::unlink(tmpPath.c_str());
+    throw sid::exception(err, sid::to_errno_str(err, "Failed to rename " + tmpPath + " to " + _filePath));
+  }
+}
+
+snapshot snapshot::open(const std::string& _filePath)
+{
+  snapshot snap;
+  snap.m_file.open(_filePath);
+  const auto fail = [&](const std::string& _msg) {
+    snap.close();
+    throw sid::exception("Snapshot " + _filePath + ": " + _msg);
+  };
+  if ( snap.m_file.size() < sizeof(local::snapshot_header) )
+    fail("not a snapshot file");
+  const local::snapshot_header* header =
+    reinterpret_cast<const local::snapshot_header*>(snap.m_file.data());
+  if ( ::memcmp(header->magic, local::snapshot_magic, sizeof(header->magic)) != 0 )
+    fail("not a snapshot file");
+  if ( header->order != local::snapshot_order )
+    fail("written in the other byte order");
+  if ( header->version != local::snapshot_version )
+    fail("unsupported version " + sid::to_str(header->version));
+  if ( header->size != snap.m_file.size() )
+    fail("truncated to " + sid::to_str(snap.m_file.size()) + " of " + sid::to_str(header->size) + " bytes");
+  // The nodes are looked up rather than scanned
+  if ( snap.m_file.is_mapped() )
+    ::madvise(const_cast<char*>(snap.m_file.data()), snap.m_file.size(), MADV_RANDOM);
+  return snap;
+}
+
+snapshot::snapshot()
+{
+}
+
+snapshot::~snapshot()
+{
+}
+
+snapshot::snapshot(snapshot&& _obj) noexcept : m_file(std::move(_obj.m_file))
+{
+}
+
+snapshot& snapshot::operator=(snapshot&& _obj) noexcept
+{
+  m_file = std::move(_obj.m_file);
+  return *this;
+}
+
+void snapshot::close()
+{
+  m_file.close();
+}
+
+bool snapshot::empty() const
+{
+  return ! m_file.is_open();
+}
+
+snapshot::element snapshot::root() const
+{
+  if ( empty() )
+    throw sid::exception("Snapshot is not open");
+  const local::snapshot_header* header =
+    reinterpret_cast<const local::snapshot_header*>(m_file.data());
+  return element(m_file.data(), &header->root);
+}
+
+size_t snapshot::image_size() const
+{
+  return m_file.size();
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////
+//
+// Implementation of snapshot::element
+//
+///////////////////////////////////////////////////////////////////////////////////////////////////
+namespace local
+{
+//! Nodes of the members of the container
+inline const snapshot::node* members(const char* _image, const snapshot::node* _node)
+{
+  return reinterpret_cast<const snapshot::node*>(_image + _node->data);
+}
+
+//! Characters of the string node
+inline std::string_view chars(const char* _image, const snapshot::node* _node)
+{
+  return std::string_view(_image + _node->data, _node->count);
+}
+} // namespace local
+
+value_type snapshot::element::type() const
+{
+  return m_node->type;
+}
+
+size_t snapshot::element::size() const
+{
+  if ( ! is_complex_type() )
+    throw sid::exception(__func__ + std::string("() can be used only for array and object types"));
+  return m_node->count;
+}
+
+bool snapshot::element::has_index(const size_t _index) const
+{
+  if ( ! is_array() )
+    throw sid::exception(__func__ + std::string("() can be used only for array type"));
+  return ( _index < m_node->count );
+}
+
+snapshot::element snapshot::element::operator[](const size_t _index) const
+{
+  if ( ! has_index(_index) )
+    throw sid::exception(__func__ + std::string(": index(") + sid::to_str(_index) + ") out of range");
+  return element(m_image, local::members(m_image, m_node) + _index);
+}
+
+snapshot::element snapshot::element::operator[](std::string_view _key) const
+{
+  const std::optional<element> elem = find(_key);
+  if ( ! elem )
+    throw sid::exception(__func__ + std::string(": key(") + std::string(_key) + ") not found");
+  return *elem;
+}
+
+std::optional<snapshot::element> snapshot::element::find(std::string_view _key) const
+{
+  if ( ! is_object() )
+    throw sid::exception(__func__ + std::string("() can be used only for object type"));
+  const node* members = local::members(m_image, m_node);
+  const uint32_t count = m_node->count;
+  const uint32_t* sorted = reinterpret_cast<const uint32_t*>(members + 2 * size_t(count));
+  // Binary search of the first member whose key is not less than the given one
+  uint32_t lo = 0, hi = count;
+  while ( lo < hi )
+  {
+    const uint32_t mid = lo + ( hi - lo ) / 2;
+    if ( local::chars(m_image, members + 2 * size_t(sorted[mid])) < _key )
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  if ( lo == count )
+    return std::nullopt;
+  const node* member = members + 2 * size_t(sorted[lo]);
+  if ( local::chars(m_image, member) != _key )
+    return std::nullopt;
+  return element(m_image, member + 1);
+}
+
+std::vector<std::string> snapshot::element::get_keys() const
+{
+  if ( ! is_object() )
+    throw sid::exception(__func__ + std::string("() can be used only for object type"));
+  std::vector<std::string> keys;
+  keys.reserve(m_node->count);
+  for ( auto it = begin(); it != end(); ++it )
+    keys.emplace_back(it.key());
+  return keys;
+}
+
+int64_t snapshot::element::get_int64() const
+{
+  if ( is_decimal() )
+    return static_cast<int64_t>(m_node->data);
+  else if ( is_double() )
+    return static_cast<int64_t>(std::bit_cast<double>(m_node->data));
+  throw sid::exception(__func__ + std::string("() can be used only for number type"));
+}
+
+uint64_t snapshot::element::get_uint64() const
+{
+  if ( is_decimal() )
+    return m_node->data;
+  else if ( is_double() )
+    return static_cast<uint64_t>(std::bit_cast<double>(m_node->data));
+  throw sid::exception(__func__ + std::string("() can be used only for number type"));
+}
+
+double snapshot::element::get_double() const
+{
+  if ( is_double() )
+    return std::bit_cast<double>(m_node->data);
+  else if ( is_signed() )
+    return static_cast<double>(static_cast<int64_t>(m_node->data));
+  else if ( is_unsigned() )
+    return static_cast<double>(m_node->data);
+  throw sid::exception(__func__ + std::string("() can be used only for number type"));
+}
+
+bool snapshot::element::get_bool() const
+{
+  if ( is_bool() )
+    return m_node->data != 0;
+  throw sid::exception(__func__ + std::string("() can be used only for boolean type"));
+}
+
+std::string snapshot::element::get_str() const
+{
+  return std::string(get_view());
+}
+
+std::string_view snapshot::element::get_view() const
+{
+  if ( is_string() )
+    return local::chars(m_image, m_node);
+  throw sid::exception(__func__ + std::string("() can be used only for string type"));
+}
+
+void snapshot::element::get(value& _jout) const
+{
+  switch ( type() )
+  {
+  case value_type::null:      _jout.clear(); break;
+  case value_type::boolean:   _jout = get_bool(); break;
+  case value_type::string:    _jout = get_view(); break;
+  case value_type::_signed:   _jout = get_int64(); break;
+  case value_type::_unsigned: _jout = get_uint64(); break;
+  case value_type::_double:   _jout = std::bit_cast<double>(m_node->data); break;
+  case value_type::array:
+    _jout = value(value_type::array);
+    _jout.reserve(m_node->count);
+    for ( const element elem : *this )
+      elem.get(_jout.append());
+    break;
+  case value_type::object:
+    _jout = value(value_type::object);
+    _jout.reserve(m_node->count);
+    for ( auto it = begin(); it != end(); ++it )
+      (*it).get(_jout[it.key()]);
+    break;
+  }
+}
+
+snapshot::element::iterator snapshot::element::begin() const
+{
+  if ( ! is_complex_type() )
+    throw sid::exception(__func__ + std::string("() can be used only for array and object types"));
+  return iterator(m_image, local::members(m_image, m_node), is_object());
+}
+
+snapshot::element::iterator snapshot::element::end() const
+{
+  if ( ! is_complex_type() )
+    throw sid::exception(__func__ + std::string("() can be used only for array and object types"));
+  const size_t stride = is_object()? 2 : 1;
+  return iterator(m_image, local::members(m_image, m_node) + stride * m_node->count, is_object());
+}
+
+snapshot::element snapshot::element::iterator::operator*() const
+{
+  return element(m_image, m_isObject? m_pos + 1 : m_pos);
+}
+
+std::string_view snapshot::element::iterator::key() const
+{
+  if ( ! m_isObject )
+    throw sid::exception(__func__ + std::string(": can be used only for object members"));
+  return local::chars(m_image, m_pos);
+}
+
+snapshot::element::iterator& snapshot::element::iterator::operator++()
+{
+  m_pos += m_isObject? 2 : 1;
+  return *this;
+}
@@ -0,0 +1,118 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@file json_validator.h
+@brief Json schema validation while parsing
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+/**
+ * @file  json_validator.h
+ * @brief Compiled checks of a json schema, run by the parser as the values are produced.
+ *
+ * Each check returns an empty string if the value conforms to the schema, and the reason
+ * of the violation otherwise. The parser adds the location of the value to the reason.
+ */
+#pragma once
+
+#include <common/json.hpp>
+#include <common/regex.hpp>
+#include <map>
+#include <unordered_map>
+
+namespace sid {
+namespace json {
+
+/**
+ * @struct validator::node
+ * @brief Checks of a value: the root of the schema or one of its properties
+ */
+struct validator::node
+{
+  std::string                 name;       //! Json pointer of the value, for the messages
+  uint8_t                     types;      //! Bit mask of the allowed schema_type::ID (1 << ID)
+  // For numbers
+  sid::opt<int64_t>           minimum;
+  sid::opt<int64_t>           exclusiveMinimum;
+  sid::opt<int64_t>           maximum;
+  sid::opt<int64_t>           exclusiveMaximum;
+  sid::opt<int64_t>           multipleOf;
+  // For strings
+  sid::opt<size_t>            minLength;
+  sid::opt<size_t>            maxLength;
+  std::unique_ptr<sid::regex> pattern;    //! Compiled once
+  // For arrays
+  sid::opt<size_t>            minItems;
+  sid::opt<size_t>            maxItems;
+  bool                        uniqueItems;
+  // For objects
+  sid::opt<size_t>            minProperties;
+  sid::opt<size_t>            maxProperties;
+  std::vector<std::string>    required;
+  std::map<std::string, node, std::less<>> properties;
+
+  node() : types(0), uniqueItems(false) {}
+  //! Compile the checks of the given property
+  void set(const schema::property& _property, const std::string& _name);
+  //! Compile the checks of the given properties
+  void set(const schema::property_vec& _properties, const std::set<std::string>& _required);
+
+  //! Check the type of an object or an array, before its members are parsed
+  std::string check_start(value_type _type) const;
+  //! Check the number of members of an object or an array while it is parsed
+  std::string check_count(value_type _type, size_t _count) const;
+  //! Check an object or an array once it is parsed
+  std::string check_end(const value& _val) const;
+  //! Check a string before it is stored. It is copied only to be matched against the pattern.
+  std::string check_string(std::string_view _str) const;
+  //! Check a number, a boolean or a null
+  std::string check_scalar(const value& _val) const;
+  //! Checks of the value of the given key. Returns nullptr if the key has no checks.
+  const node* property(std::string_view _key) const {
+    auto it = properties.find(_key);
+    return ( it != properties.end() )? &it->second : nullptr;
+  }
+
+  /**
+   * @class unique_items
+   * @brief uniqueItems check of an array, fed with the elements as they are parsed.
+   *        The elements are hashed, and compared only when their hashes are the same.
+   */
+  class unique_items
+  {
+  public:
+    //! Add the element at _index of the array _jarr. Returns the violation, if any.
+    std::string add(const value& _jarr, size_t _index);
+  private:
+    std::unordered_multimap<uint64_t, size_t> m_hashes; //! Hash -> index of the element
+  };
+};
+
+} // namespace json
+} // namespace sid
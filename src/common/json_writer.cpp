@@ -0,0 +1,255 @@
+/*
+LICENSE: BEGIN
+===============================================================================
+@author Shan Anand
+@email anand.gs@gmail.com
+@source https://github.com/shan-anand
+@file json_writer.cpp
+@brief Streaming json writer
+===============================================================================
+MIT License
+
+Copyright (c) 2017 Shanmuga (Anand) Gunasekaran
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+===============================================================================
+LICENSE: END
+*/
+
+/**
+ * @file  json_writer.cpp
+ * @brief Implementation of the streaming json writer
+ */
+#include <common/json_writer.hpp>
+#include "json_serializer.h"
+#include <algorithm>
+
+using namespace sid;
+using namespace sid::json;
+
+writer::writer(const write_sink& _sink, const format& _format/* = format()*/,
+               size_t _bufferSize/* = default_buffer_size*/)
+  : m_sink(_sink), m_format(_format), m_bufferSize(_bufferSize), m_isKeyed(false),
+    m_isComplete(false), m_flushed(0)
+{
+  if ( ! m_sink )
+    throw sid::exception("json::writer: sink is not set");
+  // Room for the buffer size and the value that fills it, before it is flushed
+  m_buffer.reserve(2 * std::max(_bufferSize, static_cast<size_t>(256)));
+}
+
+writer& writer::begin_object()
+{
+  p_begin(true, '{');
+  return *this;
+}
+
+writer& writer::end_object()
+{
+  p_end(true, '}');
+  return *this;
+}
+
+writer& writer::begin_array()
+{
+  p_begin(false, '[');
+  return *this;
+}
+
+writer& writer::end_array()
+{
+  p_end(false, ']');
+  return *this;
+}
+
+writer& writer::key(std::string_view _key)
+{
+  if ( m_levels.empty() || ! m_levels.back().isObject )
+    throw sid::exception("json::writer: key " + std::string(_key) + " is not in an object");
+  if ( m_isKeyed )
+    throw sid::exception("json::writer: key " + std::string(_key) + " follows a key without a value");
+  p_key(_key, true);
+  return *this;
+}
+
+writer& writer::value(std::nullptr_t)
+{
+  p_begin_value();
+  m_buffer.append("null", 4);
+  p_end_value();
+  return *this;
+}
+
+writer& writer::value(bool _val)
+{
+  p_begin_value();
+  if ( _val )
+    m_buffer.append("true", 4);
+  else
+    m_buffer.append("false", 5);
+  p_end_value();
+  return *this;
+}
+
+writer& writer::value(int64_t _val)
+{
+  p_begin_value();
+  p_write_scalar(json::value(_val));
+  p_end_value();
+  return *this;
+}
+
+writer& writer::value(uint64_t _val)
+{
+  p_begin_value();
+  p_write_scalar(json::value(_val));
+  p_end_value();
+  return *this;
+}
+
+writer& writer::value(double _val)
+{
+  p_begin_value();
+  p_write_scalar(json::value(_val));
+  p_end_value();
+  return *this;
+}
+
+writer& writer::value(std::string_view _val)
+{
+  p_begin_value();
+  serializer(m_buffer, m_format).write_text(_val);
+  p_end_value();
+  return *this;
+}
+
+writer& writer::value(const json::value& _jval)
+{
+  p_write(_jval);
+  return *this;
+}
+
+void writer::flush()
+{
+  if ( m_buffer.empty() )
+    return;
+  m_sink(m_buffer.data(), m_buffer.length());
+  m_flushed += m_buffer.length();
+  m_buffer.clear();
+}
+
+void writer::finish()
+{
+  if ( ! m_isComplete )
+    throw sid::exception("json::writer: the json is not complete, "
+                         + ( m_levels.empty()? std::string("there is no root value")
+                             : std::to_string(m_levels.size()) + " level(s) are open" ));
+  flush();
+}
+
+void writer::p_begin_value()
+{
+  if ( m_levels.empty() )
+  {
+    if ( m_isComplete )
+      throw sid::exception("json::writer: the root value is already written");
+    return;
+  }
+  level& top = m_levels.back();
+  if ( top.isObject )
+  {
+    if ( ! m_isKeyed )
+      throw sid::exception("json::writer: a value of an object must follow its key");
+    m_isKeyed = false;
+    return;
+  }
+  serializer(m_buffer, m_format).begin_entry(! top.hasEntries, m_levels.size());
+  top.hasEntries = true;
+}
+
+void writer::p_end_value()
+{
+  if ( m_levels.empty() )
+    m_isComplete = true;
+  if ( m_buffer.length() >= m_bufferSize )
+    flush();
+}
+
+void writer::p_begin(bool _isObject, char _ch)
+{
+  p_begin_value();
+  m_buffer += _ch;
+  m_levels.push_back(level{_isObject, false});
+}
+
+void writer::p_end(bool _isObject, char _ch)
+{
+  if ( m_levels.empty() || m_levels.back().isObject != _isObject )
+    throw sid::exception(std::string("json::writer: end of ") + (_isObject? "an object" : "an array")
+                         + " that was not begun");
+  if ( m_isKeyed )
+    throw sid::exception("json::writer: the last key of the object has no value");
+  const bool hasEntries = m_levels.back().hasEntries;
+  m_levels.pop_back();
+  serializer(m_buffer, m_format).end_container(hasEntries, m_levels.size(), _ch);
+  p_end_value();
+}
+
+void writer::p_key(std::string_view _key, bool _escape)
+{
+  level& top = m_levels.back();
+  serializer out(m_buffer, m_format);
+  out.begin_entry(! top.hasEntries, m_levels.size());
+  top.hasEntries = true;
+  out.write_key(_key, _escape);
+  m_isKeyed = true;
+}
+
+void writer::p_write(const json::value& _jval)
+{
+  switch ( _jval.type() )
+  {
+  case value_type::object:
+    begin_object();
+    for ( const auto& entry : *_jval.m_data._map )
+    {
+      // The keys are written as the serializer does, without escaping
+      p_key(entry.first.p_str(), false);
+      p_write(entry.second);
+    }
+    end_object();
+    break;
+  case value_type::array:
+    begin_array();
+    for ( const json::value& jelem : *_jval.m_data._arr )
+      p_write(jelem);
+    end_array();
+    break;
+  default:
+    p_begin_value();
+    p_write_scalar(_jval);
+    p_end_value();
+    break;
+  }
+}
+
+void writer::p_write_scalar(const json::value& _jval)
+{
+  serializer(m_buffer, m_format).write(_jval, 0);
+}
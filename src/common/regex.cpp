@@ -201,7 +201,9 @@ int regex::p_exec(const char* _input, result* _result)
 
   // we limit the match enties to 1000 (as defined in REGEX_MATCH_SIZE in regex.hpp)
   regmatch_t match[REGEX_MATCH_SIZE];
-  ::memset(match, 0, sizeof(match));
+  // The matches are filled only if the result is requested
+  if ( _result )
+    ::memset(match, 0, sizeof(match));
 
   // call the library function to check the input string against the regular expression
   m_errorCode = ::regexec(&m_buffer, _input, (_result? REGEX_MATCH_SIZE:0), match, 0);
@@ -3,16 +3,33 @@
 #include <string>
 #include <cstring>
 #include <vector>
+#include <functional>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
 #include <limits>
+#include <optional>
+#include <cmath>
 #include <iomanip>
 #include <stdlib.h>
+#include <unistd.h>
+#include <sys/wait.h>
 #include "common/opt.hpp"
 #include "common/uuid.hpp"
 #include "common/json.hpp"
+#include "common/json_lazy.hpp"
+#include "common/json_lines.hpp"
+#include "common/json_path.hpp"
+#include "common/json_cache.hpp"
+#include "common/json_bind.hpp"
+#include "common/json_reader.hpp"
+#include "common/json_snapshot.hpp"
+#include "common/json_writer.hpp"
 #include "common/convert.hpp"
 #include "common/uuid.hpp"
 #include "common/regex.hpp"
 #include "common/simple_types.hpp"
+#include "common/util.hpp"
 
 #include <jsoncpp/json/json.h>
 
@@ -20,23 +37,10 @@ using namespace std;
 using namespace sid;
 
 
-std::string get_file_contents(const std::string& filePath)
+sid::util::mapped_file get_file_contents(const std::string& filePath)
 {
-  std::ifstream in;
-  in.open(filePath);
-  if ( ! in.is_open() )
-    throw sid::exception("Failed to open file: " + filePath);
-  char buf[8096] = {0};
-  std::string jsonStr;
-  while ( ! in.eof() )
-  {
-    ::memset(buf, 0, sizeof(buf));
-    in.read(buf, sizeof(buf)-1);
-    if ( in.bad() )
-      throw sid::exception(sid::to_errno_str("Failed to read data"));
-    jsonStr += buf;
-  }
-  return jsonStr;
+  // The file is mapped in memory and used in place, without copying it to a string
+  return sid::util::mapped_file(filePath);
 }
 
 void parser_test(std::string jsonStr)
@@ -232,6 +236,1897 @@ void json_schema_test(const std::string& schemaFile)
   return;
 }
 
+//! Time since _start in micro seconds
+uint64_t elapsed_us(const struct timespec& _start)
+{
+  struct timespec t_end = {0};
+  clock_gettime(CLOCK_REALTIME, &t_end);
+  return (t_end.tv_sec - _start.tv_sec) * 1000000 + (t_end.tv_nsec - _start.tv_nsec) / 1000;
+}
+
+//! Compare the size and the speed of the given binary encoding with the text json
+void binary_test(const json::value& _jroot, bool _isCbor)
+{
+  const std::string name = _isCbor? "cbor" : "msgpack";
+  struct timespec t_start = {0};
+  auto show = [&](const std::string& _what, size_t _size, uint64_t _us)
+    {
+      cout << std::left << std::setw(16) << std::setfill('.') << (_what + " ") << ": "
+           << sid::get_sep(_size) << " bytes, " << sid::get_sep(_us) << " us" << endl;
+    };
+
+  std::string text;
+  clock_gettime(CLOCK_REALTIME, &t_start);
+  _jroot.write(text);
+  show("to_str", text.length(), elapsed_us(t_start));
+
+  json::value jtext;
+  clock_gettime(CLOCK_REALTIME, &t_start);
+  json::value::parse(jtext, text);
+  show("parse", text.length(), elapsed_us(t_start));
+
+  io_buffer data;
+  clock_gettime(CLOCK_REALTIME, &t_start);
+  _isCbor? _jroot.to_cbor(data) : _jroot.to_msgpack(data);
+  show("to_" + name, data.length(), elapsed_us(t_start));
+
+  json::value jdata;
+  clock_gettime(CLOCK_REALTIME, &t_start);
+  _isCbor? json::value::from_cbor(jdata, data) : json::value::from_msgpack(jdata, data);
+  show("from_" + name, data.length(), elapsed_us(t_start));
+
+  if ( jdata.to_str() != text )
+    throw sid::exception(name + " round trip does not match the input");
+}
+
+//! Decode the given binary data, which is expected to be rejected when _isRejected is set
+void binary_decode_check(const std::string& _name, const std::string& _data, bool _isCbor, bool _isRejected)
+{
+  json::value jdata;
+  try
+  {
+    _isCbor? json::value::from_cbor(jdata, _data.data(), _data.length())
+      : json::value::from_msgpack(jdata, _data.data(), _data.length());
+  }
+  catch ( const sid::exception& e )
+  {
+    if ( ! _isRejected )
+      throw;
+    cout << _name << ": rejected: " << e.what() << endl;
+    return;
+  }
+  if ( _isRejected )
+    throw sid::exception(_name + ": nesting deeper than the limit was accepted");
+  cout << _name << ": decoded" << endl;
+}
+
+//! Deeply nested binary input must be rejected rather than overflow the stack
+void binary_depth_test()
+{
+  struct nesting { std::string name; bool isCbor; std::string level; };
+  const nesting nestings[] = {
+    { "cbor arrays",    true,  "\x81" },
+    { "cbor maps",      true,  "\xA1\x61k" },
+    { "cbor tags",      true,  "\xC6" },
+    { "msgpack arrays", false, "\x91" },
+    { "msgpack maps",   false, "\x81\xA1k" }
+  };
+  for ( const nesting& n : nestings )
+  {
+    auto nested = [&](size_t _levels)
+      {
+        std::string data;
+        data.reserve(_levels * n.level.length() + 1);
+        for ( size_t i = 0; i < _levels; i++ )
+          data += n.level;
+        data += '\x01';
+        return data;
+      };
+    binary_decode_check(n.name + " nested 1000000 deep", nested(1000000), n.isCbor, true);
+    binary_decode_check(n.name + " nested " + sid::to_str(json::value::max_binary_depth + 1) + " deep",
+                        nested(json::value::max_binary_depth + 1), n.isCbor, true);
+    binary_decode_check(n.name + " nested " + sid::to_str(json::value::max_binary_depth) + " deep",
+                        nested(json::value::max_binary_depth), n.isCbor, false);
+  }
+}
+
+//! The numbers are written with the shortest digits, laid out as the earlier 18-digit format
+void number_format_test()
+{
+  struct number { std::string input; std::string expected; };
+  const number numbers[] = {
+    { "0", "0" }, { "-0.0", "-0" }, { "0.1", "0.1" }, { "-2.5", "-2.5" },
+    { "3.14159", "3.14159" }, { "100.5", "100.5" }, { "123456.789e3", "123456789" },
+    { "0.0001", "0.0001" }, { "0.00001", "1e-05" }, { "1.5e-7", "1.5e-07" },
+    { "5e-324", "5e-324" }, { "1e17", "100000000000000000" },
+    { "123456789012345678.0", "123456789012345680" },
+    { "1e18", "1e+18" }, { "1.5e18", "1.5e+18" },
+    { "123456789012345683968", "1.2345678901234568e+20" },
+    { "1.2345678901234568e+20", "1.2345678901234568e+20" }, { "1e300", "1e+300" },
+    { "1.7976931348623157e308", "1.7976931348623157e+308" },
+    { "3.14159265358979323846264", "3.141592653589793" },
+    { "-9223372036854775808", "-9223372036854775808" },
+    { "18446744073709551615", "18446744073709551615" },
+    // Too small for a double, read as zero
+    { "1e-99999", "0" }, { "-0.1e-99999", "-0" }
+  };
+  for ( const number& n : numbers )
+  {
+    json::value jroot;
+    json::value::parse(jroot, "[" + n.input + "]");
+    const std::string text = jroot.to_str();
+    if ( text != "[" + n.expected + "]" )
+      throw sid::exception("Number " + n.input + " is written as " + text + " instead of " + n.expected);
+    if ( jroot[0].as_str() != n.expected )
+      throw sid::exception("Number " + n.input + " is formatted as " + jroot[0].as_str()
+                           + " instead of " + n.expected);
+  }
+  // Too large for a double but not for a long double, read as an infinity that is written
+  // back as a number that reads as it
+  const number infinities[] = {
+    { "1e400", "1e999" }, { "-1.5e400", "-1e999" }, { "1e999", "1e999" }, { "-1e4000", "-1e999" }
+  };
+  for ( const number& n : infinities )
+  {
+    json::value jroot;
+    json::value::parse(jroot, "[" + n.input + "]");
+    const std::string text = jroot.to_str();
+    if ( ! std::isinf(jroot[0].get_double()) || text != "[" + n.expected + "]" )
+      throw sid::exception("Number " + n.input + " is written as " + text + " instead of " + n.expected);
+    json::value::parse(jroot, text);
+    if ( ! std::isinf(jroot[0].get_double()) || jroot.to_str() != text )
+      throw sid::exception("Number " + n.input + " does not read back as " + n.expected);
+  }
+  // Too large for a long double too, rejected with the location of the number
+  try
+  {
+    json::value jroot;
+    json::value::parse(jroot, "[1,\n 1e99999]");
+    throw sid::exception("Number 1e99999 was parsed");
+  }
+  catch ( const sid::exception& e )
+  {
+    if ( e.message().find("Failed to convert [1e99999]") != 0
+         || e.message().find("@line:2, @pos:2") == std::string::npos )
+      throw;
+  }
+  // Kept as long double with parser_control::longDouble, in the same cell size
+  static_assert(sizeof(json::value) == json::value::cell_size);
+  struct long_number { std::string input; std::string expected; long double ldbl; bool isLong; };
+  const long_number longNumbers[] = {
+    { "1e400", "1e+400", 1e400L, true }, { "-1.5e400", "-1.5e+400", -1.5e400L, true },
+    { "1e-400", "1e-400", 1e-400L, true }, { "0.1", "0.1", 0.1L, true },
+    { "3.14159265358979323846264", "3.1415926535897932385", 3.14159265358979323846264L, true },
+    { "123456789012345678.0", "123456789012345678", 123456789012345678.0L, true },
+    { "0.5", "0.5", 0.5L, false }, { "1e22", "1e+22", 1e22L, false },
+    { "1e-99999", "0", 0.0L, false }, { "7", "7", 7.0L, false }
+  };
+  json::parser_control ctrl;
+  ctrl.longDouble = true;
+  for ( const long_number& n : longNumbers )
+  {
+    const std::string input = "[" + n.input + "]";
+    json::value jroot;
+    json::value::parse(jroot, input, ctrl);
+    json::value jread;
+    json::reader jreader(input, ctrl);
+    jreader.next();
+    jreader.read(jread);
+    const json::value jcopy = jroot;
+    const json::value* values[] = { &jroot, &jread, &jcopy };
+    for ( const json::value* jval : values )
+    {
+      const json::value& jnum = (*jval)[0];
+      if ( jnum.is_long_double() != n.isLong || jnum.get_long_double() != n.ldbl
+           || jnum.get_double() != static_cast<double>(n.ldbl) || jval->to_str() != "[" + n.expected + "]"
+           || jnum.as_str() != n.expected )
+        throw sid::exception("Number " + n.input + " is kept as " + jval->to_str() + " instead of " + n.expected);
+    }
+    // Written back with the digits that read as the same long double
+    json::value::parse(jroot, jcopy.to_str(), ctrl);
+    if ( jroot[0].get_long_double() != n.ldbl )
+      throw sid::exception("Number " + n.input + " does not read back as " + n.expected);
+    // Without the flag the number is a double, as before
+    json::value::parse(jroot, input);
+    if ( jroot[0].is_long_double() )
+      throw sid::exception("Number " + n.input + " is kept as long double without the flag");
+  }
+  // A value made from a long double keeps it too, and is released as a value of any type
+  json::value jlong = 0.1L;
+  if ( ! jlong.is_long_double() || jlong.get_long_double() != 0.1L )
+    throw sid::exception("Long double 0.1 is not kept as long double");
+  jlong = 0.5L;
+  if ( jlong.is_long_double() || jlong.get_double() != 0.5 )
+    throw sid::exception("Long double 0.5 is not kept as a double");
+  cout << "numbers: " << std::size(numbers) + std::size(infinities) + std::size(longNumbers)
+       << " formats checked" << endl;
+}
+
+//! Message of the exception thrown by the given function, empty if it does not throw
+template <typename F>
+std::string error_of(F _fn)
+{
+  try
+  {
+    _fn();
+  }
+  catch ( const sid::exception& e )
+  {
+    return e.message();
+  }
+  return std::string();
+}
+
+//! The parsers report the same error for a root that is not an object or an array
+void root_error_test()
+{
+  const std::string inputs[] = { "", "   ", " \n\t ", "// comment\n", "x", "  1", "\"str\"" };
+  for ( const std::string& input : inputs )
+  {
+    json::value jroot;
+    const std::string expected = error_of([&]() { json::value::parse(jroot, input); });
+    if ( expected.empty() )
+      throw sid::exception("Input [" + input + "] was parsed");
+    const std::string errors[] = {
+      error_of([&]() { json::reader jreader(input); while ( jreader.next() ); }),
+      error_of([&]() { json::lazy_document jdoc; jdoc.parse(input); })
+    };
+    for ( const std::string& error : errors )
+      if ( error != expected )
+        throw sid::exception("Input [" + input + "] fails with [" + error + "] instead of ["
+                             + expected + "]");
+    cout << "errors: [" << input << "]: " << expected << endl;
+  }
+}
+
+//! Text of any value, the scalars included
+std::string text_of(const json::value& _jval)
+{
+  if ( _jval.is_object() || _jval.is_array() )
+    return _jval.to_str();
+  return _jval.is_null()? "null" : _jval.as_str();
+}
+
+//! JSON Pointers and JSONPaths: the values matched, the missing members and the invalid paths
+void path_test()
+{
+  json::value jroot;
+  json::value::parse(jroot, R"({"devices": [
+      {"name": "sda", "size": 10, "children": [{"name": "sda1", "mp": "/"}, {"name": "sda2"}]},
+      {"name": "sdb", "size": 20, "children": []},
+      {"name": "sr0", "size": 0}],
+    "a/b": 1, "m~n": 2, "0": "zero"})");
+
+  struct match { std::string path; std::string expected; };
+  const match matches[] = {
+    { "/devices/0/name", "sda" },
+    { "$.devices[0].name", "sda" },
+    { "$['devices'][1][\"name\"]", "sdb" },
+    { "/devices/*/name", "sda,sdb,sr0" },
+    { "$.devices[*].children[*].name", "sda1,sda2" },
+    { "/devices/*/children/*/mp", "/" },
+    { "$.devices[-1].name", "sr0" },
+    { "$.devices[0:2].size", "10,20" },
+    { "$.devices[1:].name", "sdb,sr0" },
+    { "$.devices[::-1].name", "sr0,sdb,sda" },
+    { "$.devices[2].*", "sr0,0" },
+    { "/a~1b", "1" },
+    { "/m~0n", "2" },
+    { "/0", "zero" },
+    // Steps that do not apply yield no match
+    { "/devices/5/name", "" },
+    { "/devices/name", "" },
+    { "$.devices[-4]", "" },
+    { "$.nothing.deeper", "" },
+    { "$.devices[0].size.x", "" },
+    { "/devices/*/children/*/missing", "" }
+  };
+  for ( const match& m : matches )
+  {
+    const json::path jpath(m.path);
+    std::string found;
+    for ( const json::value* pval : jpath.eval(jroot) )
+      found += ( found.empty()? "" : "," ) + text_of(*pval);
+    if ( found != m.expected )
+      throw sid::exception("Path " + m.path + " matches [" + found + "] instead of [" + m.expected + "]");
+    const json::value* first = jpath.find(jroot);
+    if ( ( first == nullptr ) != m.expected.empty()
+         || ( first && m.expected.find(text_of(*first)) != 0 ) )
+      throw sid::exception("Path " + m.path + " does not find its first match");
+  }
+
+  std::vector<const json::value*> trail;
+  const json::path single("$.devices[0].children[1].name");
+  const json::value* pval = single.find(jroot, trail);
+  if ( ! single.is_single() || ! pval || pval->as_str() != "sda2" || trail.size() != 5
+       || trail[0] != &jroot || trail[4] != &jroot["devices"][0]["children"][1] )
+    throw sid::exception("Path " + single.to_str() + " does not find its trail");
+  if ( json::path("/devices/*").is_single()
+       || error_of([&]() { json::path("/devices/*").find(jroot, trail); }).empty() )
+    throw sid::exception("A wildcard path is taken for a single path");
+
+  struct invalid { std::string path; std::string error; };
+  const invalid invalids[] = {
+    { "devices", "Json pointer must start with / or the path with $" },
+    { "/a~2", "Invalid escape sequence in json pointer" },
+    { "$..name", "Recursive descent is not supported" },
+    { "$.devices[?(@.size)]", "Filter and script expressions are not supported" },
+    { "$.devices[0", "Expected ]" },
+    { "$.devices[::0]", "Slice step cannot be 0" },
+    { "$.devices[abc]", "Invalid subscript" },
+    { "$['key", "Missing end of key" },
+    { "$.", "Missing key" },
+    { "$devices", "Expected . or [" }
+  };
+  for ( const invalid& i : invalids )
+  {
+    const std::string error = error_of([&]() { json::path jpath(i.path); });
+    if ( error.find(i.error) != 0 )
+      throw sid::exception("Path " + i.path + " fails with [" + error + "] instead of [" + i.error + "]");
+  }
+  cout << "path: " << std::size(matches) << " paths evaluated, " << std::size(invalids)
+       << " invalid paths rejected" << endl;
+}
+
+//! json::projection: the values kept and the nulls in their place, the paths merged whatever the
+//! order in which they are added, and the errors of the values that are skipped
+void projection_test()
+{
+  const std::string doc = R"({"a": [0, {"x": 1, "y": [2, "s"]}, "two", {"x": 3, "z": {}}],
+    "b": {"c": "skip \" \\ /* ]", "d": [1, {"e": null}], "f": -1.5e3}, "g": true})";
+  auto projected = [](const std::string& _input, const std::vector<std::string>& _paths,
+                      const json::parser_control& _ctrl = json::parser_control()) {
+      json::value jroot;
+      json::value::parse(jroot, _input, json::projection(_paths), _ctrl);
+      return jroot.to_str();
+    };
+
+  struct kept { std::vector<std::string> paths; std::string expected; };
+  const kept kepts[] = {
+    // The elements before the last one kept are null, as are the scalars where a path goes on
+    { { "$.a[3].x" }, R"({"a":[null,null,null,{"x":3}]})" },
+    { { "/a/1/y/1" }, R"({"a":[null,{"y":[null,"s"]}]})" },
+    { { "$.a[*].x" }, R"({"a":[null,{"x":1},null,{"x":3}]})" },
+    { { "$.a[5]", "$.g" }, R"({"a":[],"g":true})" },
+    { { "$.b.d[1].e", "$.a[0]" }, R"({"a":[0],"b":{"d":[null,{"e":null}]}})" },
+    // A wildcard merged with a key or an index below it, added before or after it
+    { { "$.a[*].x", "$.a[1].y" }, R"({"a":[null,{"x":1,"y":[2,"s"]},null,{"x":3}]})" },
+    { { "$.a[1].y", "$.a[*].x" }, R"({"a":[null,{"x":1,"y":[2,"s"]},null,{"x":3}]})" },
+    { { "$.a[*]", "$.a[1].y[0]" }, R"({"a":[0,{"x":1,"y":[2,"s"]},"two",{"x":3,"z":{}}]})" },
+    { { "$.a[1].y[0]", "$.a[*]" }, R"({"a":[0,{"x":1,"y":[2,"s"]},"two",{"x":3,"z":{}}]})" },
+    { { "$.b.*", "$.b.d[0]" }, R"({"b":{"c":"skip \" \\ /* ]","d":[1,{"e":null}],"f":-1500}})" },
+    { { "$.b.d[0]", "$.b.*" }, R"({"b":{"c":"skip \" \\ /* ]","d":[1,{"e":null}],"f":-1500}})" },
+    { { "$.*.x", "$.b.f" }, R"({"a":[],"b":{"f":-1500}})" },
+    { { "$.b.f", "$.*.x" }, R"({"a":[],"b":{"f":-1500}})" }
+  };
+  for ( const kept& k : kepts )
+  {
+    const std::string text = projected(doc, k.paths);
+    if ( text != k.expected )
+      throw sid::exception("Projection " + sid::to_str(k.paths.size()) + " paths from " + k.paths[0]
+                           + " gives " + text + " instead of " + k.expected);
+  }
+
+  // A value that is skipped fails as it fails in a parse without projection
+  json::parser_control flexible;
+  flexible.mode.allowFlexibleKeys = flexible.mode.allowFlexibleStrings = flexible.mode.allowNocaseValues = 1;
+  const std::string skippeds[] = {
+    "@@@", "{1:2}", R"("\q")", R"("\u12G4")", "\"abc", "[1 2]", R"({"k" 1})", R"({"k":1 "l":2})",
+    "[tru]", "[TRUE]", "[01]", "-", "[1.]", "[1e99999]", R"([1,{"k":"v"]])", "{\"k\":[}", "[",
+    "[abc, d e]", "{k: v}", "[1,2,]", R"({"k":[1,/* ] */2]})", "[1 // ]\n]", "[\"\\u00e9\\/\"]"
+  };
+  size_t errors = 0;
+  for ( const std::string& skipped : skippeds )
+  {
+    for ( const json::parser_control& ctrl : { json::parser_control(), flexible } )
+    {
+      for ( const std::string& input : { R"({"a": 1, "c": )" + skipped + "}",
+                                         R"({"c": )" + skipped + R"(, "a": 1})",
+                                         "[1, " + skipped + "]" } )
+      {
+        json::value jroot;
+        const std::string expected = error_of([&]() { json::value::parse(jroot, input, ctrl); });
+        const std::string error = error_of([&]() { projected(input, { "$.a", "$[0]" }, ctrl); });
+        if ( error != expected )
+          throw sid::exception("Input [" + input + "] with a projection fails with [" + error
+                               + "] instead of [" + expected + "]");
+        errors += ! error.empty();
+      }
+    }
+  }
+  // The duplicates of the keys skipped are not detected
+  const std::string dupKeys = R"({"a": 1, "c": {"k": 1, "k": 2}})";
+  const json::parser_control reject(json::parser_control::dup_key::reject);
+  if ( error_of([&]() { json::value jroot; json::value::parse(jroot, dupKeys, reject); }).empty()
+       || projected(dupKeys, { "$.a" }, reject) != R"({"a":1})" )
+    throw sid::exception("Duplicate keys of a skipped object are not handled as documented");
+  // The value of a duplicate key projected replaces the earlier one, as in a full parse
+  const std::string dupObjects = R"({"a": {"b": 1, "c": 2}, "a": {"c": 3}})";
+  if ( projected(dupObjects, { "$.a.b" }) != R"({"a":{}})" || projected(dupObjects, { "$.a.c" }) != R"({"a":{"c":3}})" )
+    throw sid::exception("Projected duplicate keys give " + projected(dupObjects, { "$.a.b" }) + " and "
+                         + projected(dupObjects, { "$.a.c" }));
+  cout << "projection: " << std::size(kepts) << " projections, " << errors
+       << " errors of skipped values checked" << endl;
+}
+
+//! Inputs with duplicate keys, and the tree they give with parser_control::dup_key::accept
+const std::pair<std::string, std::string> duplicate_json[] = {
+  { R"({"a": "aaaaaaaaaaaaaaaaaaaaaaaaaaaaa", "a": {"b": 1}})", R"({"a":{"b":1}})" },
+  { R"({"a": [1, 2, 3], "a": {"b": 1}})", R"({"a":{"b":1}})" },
+  { R"({"a": {"b": [1, "bbbbbbbbbbbbbbbbbbbbbbbbbbbbb"]}, "a": [true]})", R"({"a":[true]})" },
+  { R"({"a": {"b": 1}, "a": "aaaaaaaaaaaaaaaaaaaaaaaaaaaaa", "c": 2})", R"({"a":"aaaaaaaaaaaaaaaaaaaaaaaaaaaaa","c":2})" },
+  // Containers are not merged, and null replaces the earlier value too
+  { R"({"a": {"b": 1}, "a": {"c": 2}})", R"({"a":{"c":2}})" },
+  { R"({"a": [1], "a": [2]})", R"({"a":[2]})" },
+  { R"({"a": 1, "a": null})", R"({"a":null})" },
+  { R"([{"x": {"a": [1, {"b": 2}], "a": {"b": {"c": 3}}}, "x": {"a": {"b": {"d": 4}}}}])", R"([{"x":{"a":{"b":{"d":4}}}}])" }
+};
+
+//! Handling of the duplicate keys that the readers must share with value::parse()
+const json::parser_control::dup_key duplicate_modes[] = {
+  json::parser_control::dup_key::accept, json::parser_control::dup_key::ignore,
+  json::parser_control::dup_key::append
+};
+
+//! Members of a json object: references to them stay valid while keys are added, and they are
+//! kept and written in the order of insertion
+void object_test()
+{
+  const std::string longStr(100, 'x');
+  size_t checks = 0;
+  for ( size_t n = 1; n <= 70; n++ )
+  {
+    json::value jobj;
+    for ( size_t i = 0; i < n; i++ )
+      jobj["key-" + sid::to_str(i)] = longStr + sid::to_str(i);
+    // A member assigned to a new key, through a reference and directly
+    json::value& jref = jobj["key-0"];
+    const json::value* pval = jobj.find("key-" + sid::to_str(n-1));
+    jobj["new"] = jref;
+    jobj["new-last"] = jobj["key-" + sid::to_str(n-1)];
+    if ( jobj["new"].get_str() != longStr + "0" || jobj["new-last"].get_str() != pval->get_str() )
+      throw sid::exception("A member of an object of " + sid::to_str(n) + " assigned to a new key gives "
+                           + text_of(jobj["new"]) + " and " + text_of(jobj["new-last"]));
+    for ( size_t i = 0; i < 100; i++ )
+      jobj["more-" + sid::to_str(i)] = int64_t(i);
+    if ( &jref != jobj.find("key-0") || pval != jobj.find("key-" + sid::to_str(n-1))
+         || jref.get_str() != longStr + "0" )
+      throw sid::exception("The members of an object of " + sid::to_str(n) + " move when keys are added");
+    // Copies keep the order, and find the same members
+    const json::value jcopy = jobj;
+    if ( jcopy.to_str() != jobj.to_str() || jcopy.get_keys() != jobj.get_keys()
+         || jcopy["more-99"].get_int64() != 99 )
+      throw sid::exception("The copy of an object of " + sid::to_str(n) + " differs");
+    checks += 3;
+  }
+
+  // Keys are written and listed in the order of insertion, not sorted
+  json::value jorder;
+  json::value::parse(jorder, R"({"b": 1, "a": {"z": null, "y": [], "x": {}}, "c": "s"})");
+  jorder["0"] = true;
+  if ( jorder.to_str() != R"({"b":1,"a":{"z":null,"y":[],"x":{}},"c":"s","0":true})"
+       || jorder.get_keys() != std::vector<std::string>{ "b", "a", "c", "0" } )
+    throw sid::exception("The keys are not in the order of insertion: " + jorder.to_str());
+  // Cleared and filled again
+  json::value& jinner = jorder["a"];
+  jinner.clear();
+  jinner["w"] = 1;
+  if ( jorder.to_str() != R"({"b":1,"a":{"w":1},"c":"s","0":true})" || jinner.find("z") != nullptr )
+    throw sid::exception("A cleared object filled again gives " + jorder.to_str());
+  checks += 2;
+
+  // The value of a duplicate key replaces the earlier one, whose memory is released
+  for ( const auto& [input, expected] : duplicate_json )
+  {
+    json::value jdup;
+    json::value::parse(jdup, input);
+    if ( jdup.to_str() != expected )
+      throw sid::exception("The duplicate keys of " + input + " give " + jdup.to_str() + " instead of " + expected);
+    checks++;
+  }
+  cout << "object: " << checks << " checks of member references, key order and duplicate keys" << endl;
+}
+
+//! Builders of json::value: emplace_back(), emplace(), reserve() and take(), with arguments
+//! referring to the value being built
+void builder_test()
+{
+  const std::string longStr(100, 'x');
+  size_t checks = 0;
+
+  // emplace_back() of an element of the same array, through every reallocation of the array
+  for ( const std::string& input : { std::string("[[1,2,3]]"), "[\"" + longStr + "\"]", std::string("[-1.5]") } )
+  {
+    json::value jarr;
+    json::value::parse(jarr, input);
+    const std::string first = text_of(jarr[size_t(0)]);
+    for ( size_t i = 1; i < 40; i++ )
+    {
+      jarr.emplace_back(jarr[i-1]);
+      if ( text_of(jarr[i]) != first )
+        throw sid::exception("emplace_back() of element " + sid::to_str(i-1) + " of " + input + " gives "
+                             + text_of(jarr[i]));
+      checks++;
+    }
+    jarr.emplace_back(std::move(jarr[size_t(0)]));
+    if ( ! jarr[size_t(0)].is_null() || text_of(jarr[jarr.size()-1]) != first )
+      throw sid::exception("emplace_back() of a moved element of " + input + " gives " + jarr.to_str());
+    checks++;
+  }
+  json::value jargs;
+  jargs.emplace_back(int64_t(-7));
+  jargs.emplace_back(std::string_view("view"));
+  jargs.emplace_back(json::value_type::object);
+  jargs.emplace_back();
+  if ( jargs.to_str() != R"([-7,"view",{},null])" )
+    throw sid::exception("emplace_back() of constructor arguments gives " + jargs.to_str());
+  checks++;
+
+  // emplace() of a member of the same object, for objects growing past each size, and of the
+  // object itself. An existing key is replaced.
+  for ( size_t n = 1; n <= 40; n++ )
+  {
+    json::value jobj;
+    for ( size_t i = 0; i < n; i++ )
+      jobj["key-" + sid::to_str(i)] = ( i % 2 == 0 )? json::value(longStr) : json::value(int64_t(i));
+    jobj.emplace("new", jobj["key-0"]);
+    if ( jobj.size() != n+1 || jobj["new"].get_str() != longStr )
+      throw sid::exception("emplace() of a member of an object of " + sid::to_str(n) + " gives "
+                           + text_of(jobj["new"]));
+    jobj.emplace("key-0", int64_t(5));
+    if ( jobj.size() != n+1 || jobj["key-0"].get_int64() != 5 )
+      throw sid::exception("emplace() of an existing key gives " + text_of(jobj["key-0"]));
+    const std::string text = jobj.to_str();
+    jobj.emplace("self", jobj);
+    if ( jobj["self"].to_str() != text )
+      throw sid::exception("emplace() of the object in itself gives " + jobj["self"].to_str());
+    checks += 3;
+  }
+
+  // reserve() keeps the elements in place while they are added, and is rejected for scalars
+  json::value jreserved(json::value_type::array);
+  jreserved.reserve(64);
+  const json::value& jfirst = jreserved.append(longStr);
+  for ( size_t i = 1; i < 64; i++ )
+    jreserved.append(int64_t(i));
+  if ( &jfirst != &jreserved[size_t(0)] || jfirst.get_str() != longStr )
+    throw sid::exception("reserve() does not keep the elements of an array in place");
+  json::value jmembers(json::value_type::object);
+  jmembers.reserve(64);
+  const json::value& jmember = jmembers["m0"] = longStr;
+  for ( size_t i = 1; i < 64; i++ )
+    jmembers["m" + sid::to_str(i)] = int64_t(i);
+  if ( &jmember != jmembers.find("m0") || jmembers.size() != 64 || jmembers["m63"].get_int64() != 63 )
+    throw sid::exception("reserve() does not keep the members of an object in place");
+  for ( json::value jscalar : { json::value(), json::value(true), json::value("str") } )
+    if ( error_of([&]() { jscalar.reserve(4); }).empty() )
+      throw sid::exception("reserve() is accepted for " + text_of(jscalar));
+  checks += 3;
+
+  // take() leaves null in place, and the subtree outlives the tree it was taken from
+  json::value jtaken;
+  {
+    json::value jtree;
+    json::value::parse(jtree, R"({"a": {"b": [1, "two", {"c": null}]}, "d": 1})");
+    jtaken = jtree["a"].take();
+    if ( ! jtree["a"].is_null() || jtree.to_str() != R"({"a":null,"d":1})" )
+      throw sid::exception("take() leaves " + jtree.to_str());
+    // A subtree taken into its own tree, and into an ancestor of it
+    jtree["e"] = jtaken["b"];
+    jtree["e"].append(jtree["e"][size_t(2)].take());
+    jtree = jtree["e"].take();
+    if ( jtree.to_str() != R"([1,"two",null,{"c":null}])" )
+      throw sid::exception("take() into the tree it was taken from gives " + jtree.to_str());
+  }
+  if ( jtaken.to_str() != R"({"b":[1,"two",{"c":null}]})" )
+    throw sid::exception("take() gives " + jtaken.to_str() + " after the tree is gone");
+  checks += 3;
+  cout << "builders: " << checks << " checks of emplace_back, emplace, reserve and take" << endl;
+}
+
+//! The strict grammar is parsed from the structural index of the input, the flexible modes are
+//! scanned. Both give the same values and the same errors, with the escape sequences, the strings
+//! and the spaces across the blocks of 64 bytes and the windows of the index.
+void index_test()
+{
+  json::parser_control scanned;
+  scanned.mode.allowFlexibleKeys = 1;
+  auto result = [](const std::string& _input, const json::parser_control& _ctrl) {
+    json::value jroot;
+    const std::string error = error_of([&]() { json::value::parse(jroot, _input, _ctrl); });
+    return error.empty()? text_of(jroot) : "error: " + error;
+  };
+  size_t inputs = 0;
+  auto check = [&](const std::string& _input, bool _isValid) {
+    const std::string indexed = result(_input, json::parser_control());
+    const std::string expected = result(_input, scanned);
+    if ( indexed != expected || ( indexed.find("error: ") != 0 ) != _isValid )
+      throw sid::exception("Input of " + sid::to_str(_input.length()) + " bytes [" + _input.substr(0, 100)
+                           + "] gives [" + indexed.substr(0, 200) + "] instead of ["
+                           + expected.substr(0, 200) + "]");
+    inputs++;
+  };
+
+  const std::string members[] = {
+    R"("plain": "a b  c / d // e /* f */ g")",
+    // An escaped quote, which does not close the string, followed by tokens after spaces
+    R"("quote": "\"", "after":  [ 1 ,  true ,  { } ,  "s" ] )",
+    R"("escapes": "\" \\ \/ \b \f \n \r \t \u00e9 \\\" \\\\")",
+    R"("numbers": [1, -2.5e3 , 0,	18446744073709551615])",
+    R"("literals": [true,false , null])",
+    R"("nested": {"x": [{}, [], {"y": "z"}], "empty": ""})",
+    R"("key\/with\"escapes": "value")"
+  };
+  for ( size_t shift = 0; shift <= 130; shift++ )
+  {
+    const std::string pad(shift, ' ');
+    auto document = [&](const std::string& _comment) {
+      std::string doc = "{" + pad;
+      for ( const std::string& member : members )
+        doc += member + pad + ",\n";
+      // Runs of backslashes, odd ones escaping a quote
+      for ( size_t n = 1; n <= 4; n++ )
+        doc += "\"run" + sid::to_str(n) + "\":\"" + std::string(n, '\\') + ( (n % 2)? "\"x" : "" ) + "\"," + pad;
+      doc += "\"long\": \"" + std::string(4096 + shift, 'l') + "\"," + std::string(shift * 40, ' ');
+      return doc + _comment + "\"last\": [" + pad + "1" + pad + "]" + pad + "}" + pad;
+    };
+    check(document(""), true);
+    // The index stops at a comment. The quotes in it do not pair.
+    check(document("/* \" */ // \"\n"), true);
+    check(document("/* \"" + pad + "*/"), true);
+
+    // Errors in strings and after spaces
+    check("{" + pad + "\"a\": \"" + std::string(shift * 50, 's'), false);
+    check("{" + pad + "\"a\": \"ab" + std::string(1, '\0') + "c\"}", false);
+    check("{" + pad + "\"a\": \"\\q\"}", false);
+    check("{" + pad + "\"a\":" + pad + "x}", false);
+    check("{" + pad + "\"a\": 1" + pad + "\"b\": 2}", false);
+    check("[" + pad + "\\\"" + pad + "]", false);
+    check("[\"a\"" + pad + "]" + pad + "\"", false);
+  }
+  cout << "index: " << inputs << " inputs give the values and the errors of the scanner" << endl;
+}
+
+//! Builds the json tree of the events reported by a reader or a push_parser
+struct tree_builder : public json::reader::handler
+{
+  json::value               root;
+  std::vector<json::value*> stack;   //! Containers open
+  std::string               nextKey; //! Key of the next member of the object open
+
+  bool start_object() override { stack.push_back(&add(json::value(json::value_type::object))); return true; }
+  bool end_object() override { stack.pop_back(); return true; }
+  bool start_array() override { stack.push_back(&add(json::value(json::value_type::array))); return true; }
+  bool end_array() override { stack.pop_back(); return true; }
+  bool key(std::string_view _key) override { nextKey = _key; return true; }
+  bool null() override { add(json::value()); return true; }
+  bool boolean(bool _val) override { add(json::value(_val)); return true; }
+  bool number(const json::value& _num) override { add(json::value(_num)); return true; }
+  bool string(std::string_view _val) override { add(json::value(std::string(_val))); return true; }
+
+  json::value& add(json::value&& _jval)
+  {
+    if ( stack.empty() )
+      return root = std::move(_jval);
+    json::value& parent = *stack.back();
+    return parent.is_array()? parent.append(std::move(_jval)) : ( parent[nextKey] = std::move(_jval) );
+  }
+};
+
+//! Report the current event of the reader to the handler
+bool report(const json::reader& _reader, json::reader::handler& _handler)
+{
+  switch ( _reader.event() )
+  {
+  case json::event_type::start_object: return _handler.start_object();
+  case json::event_type::end_object:   return _handler.end_object();
+  case json::event_type::start_array:  return _handler.start_array();
+  case json::event_type::end_array:    return _handler.end_array();
+  case json::event_type::key:          return _handler.key(_reader.get_str());
+  case json::event_type::null:         return _handler.null();
+  case json::event_type::boolean:      return _handler.boolean(_reader.get_bool());
+  case json::event_type::string:       return _handler.string(_reader.get_str());
+  case json::event_type::number:
+    if ( _reader.type() == json::value_type::_double )
+      return _handler.number(json::value(_reader.get_double()));
+    if ( _reader.type() == json::value_type::_signed )
+      return _handler.number(json::value(_reader.get_int64()));
+    return _handler.number(json::value(_reader.get_uint64()));
+  default:
+    throw sid::exception("Unexpected reader event");
+  }
+}
+
+//! Json text of the tree built by value::parse()
+std::string parsed_text(std::string_view _input)
+{
+  json::value jroot;
+  json::value::parse(jroot, _input);
+  return jroot.to_str();
+}
+
+//! Document with every kind of value, for the tests of the readers
+const std::string sample_json = R"({"name": "sid", "id": -42, "big": 18446744073709551615,
+  "pi": 3.14159, "exp": -1.5e-7, "ok": true, "no": false, "none": null,
+  "text": "esc\"aped \\ \u00e9\n", "empty": {}, "list": [],
+  "nested": {"a": [1, {"b": [2, 3]}, "c"], "d": {"e": {"f": null}}},
+  "tail": [true, [false, [null]], 0.25]})";
+
+//! Inputs that value::parse() rejects
+const std::string invalid_json[] = {
+  "{\"a\" 1}", "[1 2]", "{\"a\": tru}", "[1, 2", "{\"a\": 1", "{\"a\": \"b}", "[1] x", "{]"
+};
+
+//! json::reader: the events read with next() or parse() build the tree of value::parse(),
+//! skip() and read() consume whole values, and invalid inputs are rejected
+void reader_test(const std::string& _jsonFile)
+{
+  const sid::util::mapped_file file = get_file_contents(_jsonFile);
+  for ( const std::string_view input : { std::string_view(sample_json), file.view() } )
+  {
+    const std::string expected = parsed_text(input);
+    tree_builder pulled;
+    json::reader jreader(input);
+    while ( jreader.next() )
+      report(jreader, pulled);
+    if ( pulled.root.to_str() != expected )
+      throw sid::exception("The events read with next() do not build the parsed tree");
+
+    tree_builder pushed;
+    jreader.open(input);
+    if ( ! jreader.parse(pushed) || pushed.root.to_str() != expected )
+      throw sid::exception("The events reported by parse() do not build the parsed tree");
+  }
+
+  // skip() of a value, and of the rest of a container just started
+  tree_builder skipped;
+  json::reader jreader(sample_json);
+  while ( jreader.next() )
+  {
+    report(jreader, skipped);
+    if ( jreader.event() == json::event_type::key && jreader.get_str() == "nested" )
+    {
+      skipped.null();
+      jreader.skip();
+    }
+    else if ( jreader.event() == json::event_type::start_array && jreader.depth() == 3 )
+    {
+      jreader.skip();
+      skipped.end_array();
+    }
+  }
+  json::value jexpected;
+  json::value::parse(jexpected, sample_json);
+  jexpected["nested"] = json::value();
+  jexpected["tail"][1] = json::value(json::value_type::array);
+  if ( skipped.root.to_str() != jexpected.to_str() )
+    throw sid::exception("skip() gives " + skipped.root.to_str() + " instead of " + jexpected.to_str());
+
+  // read() of the value of a key, after which the reader goes on with the next key
+  jreader.open(sample_json);
+  json::value jnested;
+  while ( jreader.next() && ! ( jreader.event() == json::event_type::key && jreader.get_str() == "nested" ) );
+  jreader.read(jnested);
+  if ( jnested.to_str() != parsed_text(R"({"a": [1, {"b": [2, 3]}, "c"], "d": {"e": {"f": null}}})")
+       || ! jreader.next() || jreader.event() != json::event_type::key || jreader.get_str() != "tail" )
+    throw sid::exception("read() does not give the value of the key and move past it");
+
+  // read() of a document with duplicate keys gives the tree of value::parse() in every mode
+  for ( const auto& [input, expected] : duplicate_json )
+  {
+    for ( const json::parser_control::dup_key mode : duplicate_modes )
+    {
+      const json::parser_control ctrl(mode);
+      json::value jparsed, jread;
+      json::value::parse(jparsed, input, ctrl);
+      json::reader jdup(input, ctrl);
+      if ( ! jdup.next() )
+        throw sid::exception("The reader gives no event for " + input);
+      jdup.read(jread);
+      if ( jread.to_str() != jparsed.to_str() || jdup.next() )
+        throw sid::exception("read() gives " + jread.to_str() + " for the duplicate keys of " + input
+                             + " instead of " + jparsed.to_str());
+    }
+  }
+
+  // A handler stops the reading
+  struct stopper : public json::reader::handler
+  {
+    bool key(std::string_view _key) override { return _key != "ok"; }
+  } stop;
+  jreader.open(sample_json);
+  if ( jreader.parse(stop) )
+    throw sid::exception("parse() did not stop when the handler returned false");
+
+  for ( const std::string& input : invalid_json )
+  {
+    const std::string error = error_of([&]() { json::reader r(input); while ( r.next() ); });
+    if ( error.empty() )
+      throw sid::exception("The reader accepted " + input);
+  }
+  cout << "reader: events, skip, read, " << std::size(duplicate_json) << " duplicate keys, stop and "
+       << std::size(invalid_json) << " invalid inputs checked" << endl;
+}
+
+//! Feed the input to the data handler in pieces of 1 to _maxPiece bytes, each copied to a buffer
+//! that is overwritten once it has been fed, the way response::recv() passes what it reads
+bool feed_pieces(std::string_view _input, size_t _maxPiece,
+                 const std::function<bool(const char* _data, size_t _len)>& _dataHandler)
+{
+  std::string piece;
+  for ( size_t pos = 0; pos < _input.length(); pos += piece.length() )
+  {
+    const size_t len = std::min<size_t>(1 + ::rand() % _maxPiece, _input.length() - pos);
+    piece.assign(_input.substr(pos, len));
+    if ( ! _dataHandler(piece.data(), piece.length()) )
+      return false;
+    piece.assign(piece.length(), '#');
+  }
+  return true;
+}
+
+//! json::push_parser: the input fed in pieces split anywhere, inside strings, escapes and
+//! numbers included, builds the tree of value::parse(), and invalid inputs are rejected
+void push_test(const std::string& _jsonFile)
+{
+  const sid::util::mapped_file file = get_file_contents(_jsonFile);
+  size_t feeds = 0;
+  for ( const std::string_view input : { std::string_view(sample_json), file.view() } )
+  {
+    const std::string expected = parsed_text(input);
+    json::push_parser jparser;
+    auto check = [&](const std::string& _how)
+      {
+        jparser.finish();
+        if ( ! jparser.is_complete() || jparser.pending() != 0 || jparser.root().to_str() != expected )
+          throw sid::exception("The tree of the input fed " + _how + " is not the parsed tree");
+        jparser.reset();
+        ++feeds;
+      };
+    const std::function<bool(const char* _data, size_t _len)> dataHandler =
+      [&](const char* _data, size_t _len) { return jparser.feed(_data, _len); };
+
+    // Byte by byte, and in random pieces of up to 2, 7, 64 bytes and 64 KB
+    if ( input.length() <= 1024 * 1024 )
+    {
+      feed_pieces(input, 1, dataHandler);
+      check("byte by byte");
+    }
+    for ( const size_t maxPiece : { 2, 7, 64, 64 * 1024 } )
+    {
+      feed_pieces(input, maxPiece, dataHandler);
+      check("in pieces of up to " + sid::to_str(maxPiece) + " bytes");
+    }
+    // The events reported to a handler build the same tree
+    tree_builder builder;
+    json::push_parser jevents(builder);
+    feed_pieces(input, 7, [&](const char* _data, size_t _len) { return jevents.feed(_data, _len); });
+    jevents.finish();
+    if ( builder.root.to_str() != expected )
+      throw sid::exception("The events reported by push_parser do not build the parsed tree");
+  }
+
+  // Split in two at every position of the sample
+  json::push_parser jparser;
+  const std::string expected = parsed_text(sample_json);
+  for ( size_t pos = 0; pos <= sample_json.length(); pos++ )
+  {
+    std::string first = sample_json.substr(0, pos), second = sample_json.substr(pos);
+    jparser.feed(first);
+    first.assign(first.length(), '#');
+    jparser.feed(second);
+    jparser.finish();
+    if ( jparser.root().to_str() != expected )
+      throw sid::exception("The sample split at " + sid::to_str(pos) + " is not parsed as a whole");
+    jparser.reset();
+  }
+
+  // Duplicate keys give the tree of value::parse() in every mode
+  for ( const auto& [input, expected] : duplicate_json )
+  {
+    for ( const json::parser_control::dup_key mode : duplicate_modes )
+    {
+      const json::parser_control ctrl(mode);
+      json::value jparsed;
+      json::value::parse(jparsed, input, ctrl);
+      json::push_parser jdup(ctrl);
+      feed_pieces(input, 3, [&](const char* _data, size_t _len) { return jdup.feed(_data, _len); });
+      jdup.finish();
+      if ( jdup.root().to_str() != jparsed.to_str() )
+        throw sid::exception("push_parser gives " + jdup.root().to_str() + " for the duplicate keys of " + input
+                             + " instead of " + jparsed.to_str());
+    }
+  }
+
+  // A handler stops the parsing
+  struct stopper : public json::reader::handler
+  {
+    bool key(std::string_view _key) override { return _key != "ok"; }
+  } stop;
+  json::push_parser jstopped(stop);
+  if ( feed_pieces(sample_json, 7, [&](const char* _data, size_t _len) { return jstopped.feed(_data, _len); }) )
+    throw sid::exception("push_parser did not stop when the handler returned false");
+
+  for ( const std::string& input : invalid_json )
+  {
+    const std::string error = error_of([&]()
+      {
+        json::push_parser jinvalid;
+        feed_pieces(input, 1, [&](const char* _data, size_t _len) { return jinvalid.feed(_data, _len); });
+        jinvalid.finish();
+      });
+    if ( error.empty() )
+      throw sid::exception("push_parser accepted " + input);
+  }
+  cout << "push: " << feeds << " feeds, " << sample_json.length() + 1 << " splits, "
+       << std::size(duplicate_json) << " duplicate keys, stop and " << std::size(invalid_json)
+       << " invalid inputs checked" << endl;
+}
+
+//! Structures bound to json for the bind test
+struct bind_part
+{
+  std::string            name;
+  std::optional<int64_t> count;
+};
+SID_JSON_BIND(bind_part,
+  SID_JSON_FIELD("name", name),
+  SID_JSON_FIELD("count", count))
+
+struct bind_record
+{
+  std::string                name;
+  int64_t                    id = 0;
+  uint64_t                   big = 0;
+  double                     ratio = 0;
+  bool                       ok = false;
+  std::optional<std::string> label;
+  std::optional<bind_part>   part;
+  std::vector<bind_part>     parts;
+  std::vector<int>           values;
+  json::value                extra;
+};
+SID_JSON_BIND(bind_record,
+  SID_JSON_FIELD("name", name),
+  SID_JSON_FIELD("id", id),
+  SID_JSON_FIELD("big", big),
+  SID_JSON_FIELD("ratio", ratio),
+  SID_JSON_FIELD("ok", ok),
+  SID_JSON_FIELD("label", label),
+  SID_JSON_FIELD("part", part),
+  SID_JSON_FIELD("parts", parts),
+  SID_JSON_FIELD("values", values),
+  SID_JSON_FIELD("extra", extra))
+
+//! json::bind: structures written with to_str() and read back with parse() round trip,
+//! optionals and nulls are handled, unknown keys are skipped and invalid inputs are rejected
+void bind_test()
+{
+  bind_record record;
+  record.name = "esc\"aped \\ é\n";
+  record.id = -42;
+  record.big = 18446744073709551615ULL;
+  record.ratio = 0.25;
+  record.ok = true;
+  record.label = "label";
+  record.part = bind_part{ "part", 7 };
+  record.parts = { bind_part{ "a", std::nullopt }, bind_part{ "b", -1 } };
+  record.values = { 1, -2, 3 };
+  json::value::parse(record.extra, R"({"list": [1, null, {"x": "y"}], "empty": {}})");
+
+  // The text written is the text of value::to_str() for the same tree, and it reads back
+  const std::string text = json::bind::to_str(record);
+  if ( parsed_text(text) != text )
+    throw sid::exception("bind::to_str() gives " + text + " instead of " + parsed_text(text));
+  bind_record read;
+  json::bind::parse(text, read);
+  if ( json::bind::to_str(read) != text )
+    throw sid::exception("bind::parse() of " + text + " gives " + json::bind::to_str(read));
+
+  // An empty optional is not written, a null empties an optional and leaves the other members
+  bind_record empty;
+  const std::string emptyText = json::bind::to_str(empty);
+  if ( emptyText != R"({"name":"","id":0,"big":0,"ratio":0,"ok":false,"parts":[],"values":[],"extra":null})" )
+    throw sid::exception("bind::to_str() of an empty structure gives " + emptyText);
+  json::bind::parse(R"({"name": null, "id": null, "label": null, "part": null, "extra": null,
+                       "parts": [{"name": "c", "count": null}]})", read);
+  if ( read.name != record.name || read.id != record.id || read.label || read.part || ! read.extra.is_null()
+       || read.parts.size() != 1 || read.parts[0].name != "c" || read.parts[0].count )
+    throw sid::exception("The nulls give " + json::bind::to_str(read));
+
+  // Unknown keys are skipped whatever their value, missing keys leave the members as they are
+  bind_part part{ "kept", 3 };
+  json::bind::parse(R"({"unknown": {"deep": [1, {"name": "x"}, [[]]]}, "count": 9, "zz": "name",
+                       "more": [{"count": 1}]})", part);
+  if ( part.name != "kept" || part.count != 9 )
+    throw sid::exception("The unknown keys give " + json::bind::to_str(part));
+
+  // Strings from numbers and booleans, and a root array
+  std::vector<bind_part> parts;
+  json::bind::parse(R"([{"name": 12}, {"name": -1.5}, {"name": true}, {}])", parts);
+  if ( json::bind::to_str(parts) != R"([{"name":"12"},{"name":"-1.5"},{"name":"true"},{"name":""}])" )
+    throw sid::exception("A root array gives " + json::bind::to_str(parts));
+
+  // Values of the wrong type and trailing input
+  const std::pair<std::string, std::string> invalid[] = {
+    { R"({"id": "1"})", "Expected number for key id" },
+    { R"({"ok": 1})", "Expected boolean for key ok" },
+    { R"({"parts": {}})", "Expected array for key parts" },
+    { R"({"part": []})", "Expected object for key part" },
+    { R"({"name": {}})", "Expected string, number or boolean for key name" },
+    { R"({"values": [1, "2"]})", "Expected number for key values" },
+    { R"([])", "Expected object for the root" },
+    { R"({"name": "a"} x)", "after the root object is closed" },
+    { R"({"name": "a"} {})", "after the root object is closed" },
+    { R"({"name": "a"},)", "after the root object is closed" },
+    { R"({"name": "a")", "" }
+  };
+  for ( const auto& [input, expected] : invalid )
+  {
+    bind_record rejected;
+    const std::string error = error_of([&]() { json::bind::parse(input, rejected); });
+    if ( error.empty() || error.find(expected) == std::string::npos )
+      throw sid::exception("bind::parse() of " + input + " gives [" + error + "] instead of ["
+                           + expected + "]");
+  }
+  cout << "bind: round trip, nulls, unknown keys and " << std::size(invalid) << " invalid inputs checked"
+       << endl;
+}
+
+//! parser_control::internKeys: the keys longer than short_capacity are allocated once per parse,
+//! into a value or a document, and the subtrees copied, taken and destroyed in any order keep them
+void intern_test()
+{
+  // Records with keys of 14 characters, which fit in the cell, and of 15 and more
+  const std::string key14 = "fourteen_chars";
+  const std::string key15 = "fifteen_chars_k";
+  const std::string keyLong = "a_much_longer_key_of_the_records";
+  const size_t count = 200;
+  std::string input = "[";
+  for ( size_t i = 0; i < count; i++ )
+    input += ( i? ", {\"" : "{\"" ) + key14 + "\": " + sid::to_str(i) + ", \"" + key15 + "\": \"v\", \""
+             + keyLong + "\": {\"" + key15 + "\": [" + sid::to_str(i) + "]}}";
+  input += "]";
+  json::parser_control interned;
+  interned.internKeys = true;
+  json::parser_stats plainStats, internedStats;
+  json::value jplain, jroot;
+  json::value::parse(jplain, plainStats, input);
+  json::value::parse(jroot, internedStats, input, interned);
+  if ( jroot.to_str() != jplain.to_str() )
+    throw sid::exception("Interned keys give " + jroot.to_str().substr(0, 200));
+  // Without interning each record allocates its three keys of 15 and more characters. With it,
+  // the two different keys are allocated once for all. The key of 14 characters is in the cell.
+  if ( plainStats.allocations - internedStats.allocations != 3 * count - 2 )
+    throw sid::exception("Interning saves " + sid::to_str(plainStats.allocations - internedStats.allocations)
+                         + " allocations instead of " + sid::to_str(3 * count - 2));
+  size_t checks = 2;
+
+  const std::string expected3 = jroot[3].to_str();
+  const std::string expected7 = jroot[7].to_str();
+  auto check = [&](const json::value& _jval, const std::string& _expected, const std::string& _what) {
+      if ( _jval.to_str() != _expected || _jval.find(keyLong) == nullptr
+           || (*_jval.find(keyLong)).find(key15) == nullptr )
+        throw sid::exception(_what + " gives " + _jval.to_str() + " instead of " + _expected);
+      checks++;
+    };
+  // The tree destroyed before the subtrees copied and taken out of it, and them in both orders
+  for ( const bool copyFirst : { true, false } )
+  {
+    std::optional<json::value> jtree;
+    jtree.emplace();
+    json::value::parse(*jtree, input, interned);
+    std::optional<json::value> jcopy(std::in_place, (*jtree)[3]);
+    std::optional<json::value> jtaken(std::in_place, (*jtree)[7].take());
+    // A member of the taken subtree set again, and a member with the same key added to the copy
+    (*jtaken)[keyLong][key15] = "replaced";
+    (*jcopy)[keyLong + "2"] = (*jtree)[9][keyLong];
+    jtree.reset();
+    check(*jcopy, expected3.substr(0, expected3.length() - 1) + ",\"" + keyLong + "2\":{\"" + key15 + "\":[9]}}",
+          "A copy after its tree is gone");
+    check(*jtaken, expected7.substr(0, expected7.find("{\"" + key15 + "\":[")) + "{\"" + key15 + "\":\"replaced\"}}",
+          "A taken subtree after its tree is gone");
+    const std::string taken = jtaken->to_str();
+    if ( copyFirst )
+      jcopy.reset();
+    else
+      jtaken.reset();
+    if ( copyFirst )
+      check(*jtaken, taken, "A taken subtree after the copy is gone");
+    else
+      check(*jcopy, expected3.substr(0, expected3.length() - 1) + ",\"" + keyLong + "2\":{\"" + key15 + "\":[9]}}",
+            "A copy after the taken subtree is gone");
+  }
+
+  // A document: the keys are in the arena, copies are detached from it
+  for ( size_t round = 0; round < 2; round++ )
+  {
+    json::document doc;
+    doc.parse(input, interned);
+    if ( doc.root().to_str() != jplain.to_str() )
+      throw sid::exception("A document with interned keys gives " + doc.root().to_str().substr(0, 200));
+    json::value jcopy = doc.root()[5];
+    const std::string expected5 = jcopy.to_str();
+    if ( round == 1 )
+    {
+      // Subtrees moved within the modified tree, then the tree released
+      json::value& jdocRoot = doc.mutable_root();
+      jdocRoot[0][keyLong] = jdocRoot[1].take();
+      jdocRoot[2][key15 + "x"] = jdocRoot[3][keyLong].take();
+      if ( jdocRoot[0][keyLong][keyLong][key15][0].get_int64() != 1 || jdocRoot[2][key15 + "x"][key15][0].get_int64() != 3 )
+        throw sid::exception("Moved subtrees give " + jdocRoot[0].to_str() + " and " + jdocRoot[2].to_str());
+      checks++;
+    }
+    doc.parse(input, interned);
+    check(doc.root()[5], expected5, "A document parsed again");
+    doc.clear();
+    check(jcopy, expected5, "A copy after its document is cleared");
+  }
+  cout << "intern: " << checks << " checks of the keys interned into values and documents" << endl;
+}
+
+//! The statistics of a parse: the counters, the bytes, the depth, the allocations of the tree,
+//! their sum with merge() and the phases adding up to the time of the parse
+void stats_test()
+{
+  size_t checks = 0;
+  auto expect = [&](uint64_t _value, uint64_t _expected, const std::string& _what) {
+      if ( _value != _expected )
+        throw sid::exception(_what + " is " + sid::to_str(_value) + " instead of " + sid::to_str(_expected));
+      checks++;
+    };
+  // The trailing spaces are consumed by the parse
+  const std::string input = " {\"a\": [1, -2, 3.5, [[{}]]], \"b\": {\"c\": \"s\", \"d\": [true, false, null]}} \n";
+  json::parser_stats stats;
+  json::value jroot;
+  json::value::parse(jroot, stats, input);
+  expect(stats.objects, 3, "objects");
+  expect(stats.arrays, 4, "arrays");
+  expect(stats.strings, 1, "strings");
+  expect(stats.numbers, 3, "numbers");
+  expect(stats.booleans, 2, "booleans");
+  expect(stats.nulls, 1, "nulls");
+  expect(stats.keys, 4, "keys");
+  expect(stats.bytes, input.length(), "bytes");
+  expect(stats.maxDepth, 5, "maxDepth");
+  expect(stats.time_ms, stats.time_ns / 1000000, "time_ms");
+  // Without phases, none is reported
+  expect(stats.scan_ns + stats.string_ns + stats.number_ns + stats.build_ns, 0, "phases not timed");
+
+  // Each key longer than the cell is one allocation of its length at least, and the tree
+  // allocates the same on every parse
+  const size_t count = 100;
+  auto records = [&](const std::string& _key) {
+      std::string records = "[";
+      for ( size_t i = 0; i < count; i++ )
+        records += std::string( i? ", " : "" ) + "{\"" + _key + "\": " + sid::to_str(i) + "}";
+      return records + "]";
+    };
+  const std::string key14 = "fourteen_chars";
+  const std::string key20 = "twenty_characters_ky";
+  json::parser_stats shortStats, longStats, againStats;
+  json::value::parse(jroot, shortStats, records(key14));
+  json::value::parse(jroot, longStats, records(key20));
+  json::value::parse(jroot, againStats, records(key20));
+  if ( shortStats.allocations == 0 || shortStats.allocBytes < shortStats.allocations )
+    throw sid::exception("The tree of " + sid::to_str(count) + " records gives " + sid::to_str(shortStats.allocations)
+                         + " allocations of " + sid::to_str(shortStats.allocBytes) + " bytes");
+  expect(longStats.allocations - shortStats.allocations, count, "allocations of the long keys");
+  if ( longStats.allocBytes - shortStats.allocBytes < count * key20.length() )
+    throw sid::exception("The long keys allocate " + sid::to_str(longStats.allocBytes - shortStats.allocBytes)
+                         + " bytes for " + sid::to_str(count * key20.length()) + " characters");
+  expect(againStats.allocations, longStats.allocations, "allocations of a parse again");
+  expect(againStats.allocBytes, longStats.allocBytes, "bytes allocated by a parse again");
+  expect(longStats.maxDepth, 2, "maxDepth of the records");
+
+  // merge() adds the counters up and keeps the deepest of the depths
+  json::parser_stats total = stats;
+  total += longStats;
+  expect(total.objects, stats.objects + longStats.objects, "merged objects");
+  expect(total.numbers, stats.numbers + longStats.numbers, "merged numbers");
+  expect(total.keys, stats.keys + longStats.keys, "merged keys");
+  expect(total.bytes, stats.bytes + longStats.bytes, "merged bytes");
+  expect(total.time_ns, stats.time_ns + longStats.time_ns, "merged time_ns");
+  expect(total.time_ms, total.time_ns / 1000000, "merged time_ms");
+  expect(total.allocations, stats.allocations + longStats.allocations, "merged allocations");
+  expect(total.allocBytes, stats.allocBytes + longStats.allocBytes, "merged allocBytes");
+  expect(total.maxDepth, 5, "merged maxDepth");
+  total.merge(json::parser_stats());
+  expect(total.maxDepth, 5, "maxDepth merged with nothing");
+  json::parser_stats none;
+  none.merge(longStats);
+  expect(none.maxDepth, 2, "maxDepth merged into nothing");
+
+  // The sampled phases add up to the time of the parse, on inputs short enough for the sample
+  // to exceed it and on a long one
+  json::parser_control timed;
+  timed.timePhases = true;
+  std::string numbers = "[";
+  for ( size_t i = 0; i < 20000; i++ )
+    numbers += std::string( i? ", " : "" ) + "{\"n\": " + sid::to_str(i * 7919) + ".25, \"s\": \"v" + sid::to_str(i) + "\"}";
+  numbers += "]";
+  for ( const std::string& timedInput : { std::string("[1]"), std::string("{\"a\": \"b\"}"), input, numbers } )
+  {
+    for ( size_t i = 0; i < 50; i++ )
+    {
+      json::parser_stats phased;
+      json::value::parse(jroot, phased, timedInput, timed);
+      expect(phased.scan_ns + phased.string_ns + phased.number_ns + phased.build_ns, phased.time_ns,
+             "The phases of " + timedInput.substr(0, 20));
+      total.merge(phased);
+    }
+  }
+  expect(total.scan_ns + total.string_ns + total.number_ns + total.build_ns,
+         total.time_ns - stats.time_ns - longStats.time_ns, "The merged phases");
+  const std::string report = total.to_str();
+  for ( const char* line : { "(bytes).......: ", "(max depth)...: 5", "(allocations).: ", "(scan)........: " } )
+  {
+    if ( report.find(line) == std::string::npos )
+      throw sid::exception(std::string("The report has no ") + line + ":\n" + report);
+    checks++;
+  }
+  cout << "stats: " << checks << " checks of the parser statistics" << endl;
+}
+
+//! json::parse_lines() and json::lines_parser on several threads with chunks smaller than the
+//! lines: the records and the errors with their line numbers, in order or not, and the callback
+//! stopping the parsing by returning false or by throwing
+void lines_test()
+{
+  // Records longer and shorter than the chunks, blank lines, CRLF and invalid records
+  std::string input;
+  struct expected_record { uint64_t line; std::string text; };
+  std::vector<expected_record> expected;
+  uint64_t line = 1;
+  for ( int i = 0; i < 300; i++, line++ )
+  {
+    std::string text;
+    if ( i % 7 == 3 )
+      text = ( i % 2 )? "" : " \t\r";
+    else if ( i % 11 == 5 )
+      text = ( i % 2 )? R"({"id": )" + sid::to_str(i) + ", }x" : "[" + std::string(i, '1');
+    else
+      text = R"({"id": )" + sid::to_str(i) + R"(, "name": ")" + std::string(i % 40, 'n') + R"(", "list": [)"
+             + std::string(( i % 5 )? "1, 2" : "") + "]}" + ( ( i % 3 == 0 )? "\r" : "" );
+    input += text + "\n";
+    if ( text.find_first_not_of(" \t\r") == std::string::npos )
+      continue;
+    json::value jval;
+    const std::string error = error_of([&]() { json::value::parse(jval, text); });
+    expected.push_back({ line, error.empty()? jval.to_str() : "error: " + error });
+  }
+  // The last line without a new line
+  input += "[\"last\"]";
+  expected.push_back({ line, R"(["last"])" });
+
+  std::mutex mutex;
+  std::vector<expected_record> got;
+  auto collect = [&](json::line_record& _rec) {
+      std::lock_guard<std::mutex> lock(mutex);
+      got.push_back({ _rec.line, _rec.is_valid()? _rec.jval.to_str() : "error: " + _rec.error });
+      if ( ! _rec.is_valid() && ! _rec.jval.is_null() )
+        throw sid::exception("Invalid record of line " + sid::to_str(_rec.line) + " is not null");
+      return true;
+    };
+  auto compare = [&](const std::string& _what, bool _ordered) {
+      if ( ! _ordered )
+        std::sort(got.begin(), got.end(), [](const expected_record& _a, const expected_record& _b) {
+            return _a.line < _b.line; });
+      if ( got.size() != expected.size() )
+        throw sid::exception(_what + " delivers " + sid::to_str(got.size()) + " records instead of "
+                             + sid::to_str(expected.size()));
+      for ( size_t i = 0; i < got.size(); i++ )
+        if ( got[i].line != expected[i].line || got[i].text != expected[i].text )
+          throw sid::exception(_what + " delivers line " + sid::to_str(got[i].line) + " as " + got[i].text
+                               + " instead of line " + sid::to_str(expected[i].line) + " as " + expected[i].text);
+      got.clear();
+    };
+
+  size_t runs = 0;
+  for ( const uint32_t threads : { 2U, 4U } )
+  {
+    for ( const size_t chunkSize : { size_t(1), size_t(16), size_t(100) } )
+    {
+      for ( const bool ordered : { true, false } )
+      {
+        json::lines_control lctrl;
+        lctrl.threads = threads;
+        lctrl.chunkSize = chunkSize;
+        lctrl.ordered = ordered;
+        const std::string what = sid::to_str(threads) + " threads, chunks of " + sid::to_str(chunkSize)
+                                 + ( ordered? " bytes, ordered" : " bytes, unordered" );
+        if ( ! json::parse_lines(input, collect, lctrl) )
+          throw sid::exception("parse_lines() with " + what + " is stopped");
+        compare("parse_lines() with " + what, ordered);
+        // Pieces ending anywhere in the lines, carried over to the next piece
+        for ( const size_t piece : { size_t(1), size_t(3), size_t(64) } )
+        {
+          json::lines_parser jparser(collect, lctrl);
+          for ( size_t pos = 0; pos < input.length(); pos += piece )
+            if ( ! jparser.feed(std::string_view(input).substr(pos, piece)) )
+              throw sid::exception("lines_parser with " + what + " is stopped");
+          if ( ! jparser.finish() )
+            throw sid::exception("lines_parser with " + what + " is stopped by finish()");
+          compare("lines_parser with pieces of " + sid::to_str(piece) + " bytes and " + what, ordered);
+        }
+        runs += 4;
+      }
+    }
+  }
+
+  // The callback stops the parsing by returning false at the 10th record, or by throwing
+  for ( const bool ordered : { true, false } )
+  {
+    json::lines_control lctrl;
+    lctrl.threads = 4;
+    lctrl.chunkSize = 16;
+    lctrl.ordered = ordered;
+    std::atomic<size_t> count(0);
+    auto stop = [&](json::line_record&) { return ++count < 10; };
+    if ( json::parse_lines(input, stop, lctrl) )
+      throw sid::exception("parse_lines() is not stopped by the callback");
+    // In the unordered mode, the other workers may deliver their current record
+    if ( ordered? ( count != 10 ) : ( count < 10 || count >= 10 + lctrl.threads ) )
+      throw sid::exception("parse_lines() delivers " + sid::to_str(count.load()) + " records after the stop");
+    count = 0;
+    json::lines_parser jparser(stop, lctrl);
+    bool isStopped = false;
+    for ( size_t pos = 0; pos < input.length() && ! isStopped; pos += 5 )
+      isStopped = ! jparser.feed(std::string_view(input).substr(pos, 5));
+    if ( jparser.finish() )
+      throw sid::exception("lines_parser is not stopped by the callback");
+
+    auto fail = [&](json::line_record& _rec) {
+        if ( _rec.line >= 20 )
+          throw sid::exception("callback failed at line " + sid::to_str(_rec.line));
+        return true;
+      };
+    const std::string error = error_of([&]() { json::parse_lines(input, fail, lctrl); });
+    if ( error.find("callback failed at line ") != 0 )
+      throw sid::exception("parse_lines() fails with [" + error + "] instead of the callback's");
+    const std::string feedError = error_of([&]() {
+        json::lines_parser jfailing(fail, lctrl);
+        jfailing.feed(input);
+        jfailing.finish();
+      });
+    if ( feedError.find("callback failed at line ") != 0 )
+      throw sid::exception("lines_parser fails with [" + feedError + "] instead of the callback's");
+    runs += 4;
+  }
+  cout << "lines: " << runs << " runs of " << expected.size() << " records checked" << endl;
+}
+
+//! Formats that the writers building a container a piece at a time must lay out as
+//! value::to_str() does: compact and pretty, tabs of their own width, keys and strings unquoted
+std::vector<json::format> layout_formats()
+{
+  json::format tabs(json::format_type::pretty);
+  tabs.separator = '\t';
+  tabs.indent = 1;
+  json::format unindented(json::format_type::pretty);
+  unindented.separator = '\0';
+  return { json::format(), json::format(json::format_type::pretty), tabs, unindented,
+           json::format(true, true), json::format(json::format_type::pretty, true, true) };
+}
+
+//! json::writer through a string sink: the text of value::to_str() handed to the sink a buffer at
+//! a time, and the calls out of the json grammar rejected
+void writer_test(const std::string& _jsonFile)
+{
+  std::string out;
+  std::vector<size_t> pieces;
+  const json::write_sink sink = [&](const char* _data, size_t _len) {
+      out.append(_data, _len);
+      pieces.push_back(_len);
+    };
+  const sid::util::mapped_file file = get_file_contents(_jsonFile);
+  size_t checks = 0;
+  for ( const std::string_view input : { std::string_view(sample_json), file.view() } )
+  {
+    json::value jroot;
+    json::value::parse(jroot, input);
+    for ( const json::format& fmt : layout_formats() )
+    {
+      const std::string expected = jroot.to_str(fmt);
+      for ( const size_t bufferSize : { size_t(1), size_t(7), size_t(64), json::writer::default_buffer_size } )
+      {
+        out.clear();
+        pieces.clear();
+        json::writer jw(sink, fmt, bufferSize);
+        jw.value(jroot);
+        jw.finish();
+        if ( out != expected || jw.bytes() != out.length() )
+          throw sid::exception("writer in " + fmt.to_str() + " format with a buffer of " + sid::to_str(bufferSize)
+                               + " bytes gives " + out.substr(0, 200) + " instead of " + expected.substr(0, 200));
+        // The buffer is handed to the sink once it holds the buffer size, the rest by finish()
+        for ( size_t i = 0; i + 1 < pieces.size(); i++ )
+          if ( pieces[i] < bufferSize )
+            throw sid::exception("writer hands " + sid::to_str(pieces[i]) + " bytes with a buffer of "
+                                 + sid::to_str(bufferSize));
+        checks++;
+      }
+    }
+  }
+
+  // A document written a call at a time, with the escapes of the keys and the strings
+  out.clear();
+  json::writer jw(sink, json::format(), 16);
+  jw.begin_object().key("name").value("sid").key("esc\"aped \\ key").value("tab\there\n")
+    .key("ints").begin_array().value(int8_t(-8)).value(uint16_t(16)).value(-42).value(18446744073709551615ULL)
+    .end_array().key("pi").value(3.14159).key("none").value(nullptr).key("ok").value(true)
+    .key("empty").begin_object().end_object().key("list").begin_array().begin_array().end_array()
+    .value(std::string("s")).end_array().end_object().finish();
+  const std::string expected = R"({"name":"sid","esc\"aped \\ key":"tab\there\n","ints":[-8,16,-42,18446744073709551615],)"
+                               R"("pi":3.14159,"none":null,"ok":true,"empty":{},"list":[[],"s"]})";
+  if ( out != expected )
+    throw sid::exception("writer gives " + out + " instead of " + expected);
+  json::value jparsed;
+  json::value::parse(jparsed, out);
+  if ( jparsed["esc\"aped \\ key"].get_str() != "tab\there\n" )
+    throw sid::exception("The escaped key written by writer reads back as " + jparsed.to_str());
+  checks++;
+
+  // Calls out of the grammar, and a root value that is not complete
+  struct invalid { std::function<void(json::writer&)> calls; std::string error; };
+  const invalid invalids[] = {
+    { [](json::writer& _jw) { _jw.key("a"); }, "json::writer: key a is not in an object" },
+    { [](json::writer& _jw) { _jw.begin_array().key("a"); }, "json::writer: key a is not in an object" },
+    { [](json::writer& _jw) { _jw.begin_object().key("a").key("b"); }, "json::writer: key b follows a key without a value" },
+    { [](json::writer& _jw) { _jw.begin_object().value(1); }, "json::writer: a value of an object must follow its key" },
+    { [](json::writer& _jw) { _jw.value(1).value(2); }, "json::writer: the root value is already written" },
+    { [](json::writer& _jw) { _jw.begin_object().end_object().begin_array(); }, "json::writer: the root value is already written" },
+    { [](json::writer& _jw) { _jw.end_object(); }, "json::writer: end of an object that was not begun" },
+    { [](json::writer& _jw) { _jw.begin_array().end_object(); }, "json::writer: end of an object that was not begun" },
+    { [](json::writer& _jw) { _jw.begin_object().end_array(); }, "json::writer: end of an array that was not begun" },
+    { [](json::writer& _jw) { _jw.begin_object().key("a").end_object(); }, "json::writer: the last key of the object has no value" },
+    { [](json::writer& _jw) { _jw.finish(); }, "json::writer: the json is not complete, there is no root value" },
+    { [](json::writer& _jw) { _jw.begin_object().key("a").begin_array().finish(); },
+      "json::writer: the json is not complete, 2 level(s) are open" },
+    // finish() can be called again once the root value is complete
+    { [](json::writer& _jw) { _jw.begin_array().end_array().finish(); _jw.finish(); }, "" }
+  };
+  for ( const invalid& i : invalids )
+  {
+    out.clear();
+    json::writer jwi(sink);
+    const std::string error = error_of([&]() { i.calls(jwi); });
+    if ( error != i.error )
+      throw sid::exception("writer fails with [" + error + "] instead of [" + i.error + "]");
+    // Nothing is handed to the sink before the root value is complete
+    if ( ! error.empty() && ! out.empty() )
+      throw sid::exception("writer hands " + out + " to the sink before failing with " + error);
+  }
+  cout << "writer: " << checks << " documents written, " << std::size(invalids) - 1
+       << " invalid calls rejected" << endl;
+}
+
+//! JSON Pointers of the values in the given value, the value itself excluded
+void collect_pointers(const json::value& _jval, std::string _pointer, std::vector<std::string>& _pointers)
+{
+  if ( _jval.is_object() )
+  {
+    for ( const std::string& key : _jval.get_keys() )
+    {
+      std::string escaped;
+      for ( const char ch : key )
+        escaped += ( ch == '~' )? "~0" : ( ch == '/' )? "~1" : std::string(1, ch);
+      _pointers.push_back(_pointer + "/" + escaped);
+      collect_pointers(_jval[key], _pointers.back(), _pointers);
+    }
+  }
+  else if ( _jval.is_array() )
+  {
+    for ( size_t i = 0; i < _jval.size(); i++ )
+    {
+      _pointers.push_back(_pointer + "/" + sid::to_str(i));
+      collect_pointers(_jval[i], _pointers.back(), _pointers);
+    }
+  }
+}
+
+//! json::cached_value: after random changes made with at(), to_str() gives the text of
+//! root().to_str() in both formats, whether the tree changed or not
+void cached_value_test(const std::string& _jsonFile)
+{
+  const sid::util::mapped_file file = get_file_contents(_jsonFile);
+  const json::value jscalars[] = {
+    json::value(int64_t(-7)), json::value(uint64_t(18446744073709551615ULL)), json::value(0.5),
+    json::value("esc\"aped \\ \n"), json::value(std::string(40, 'x')), json::value(true), json::value()
+  };
+  size_t rounds = 0, edits = 0;
+  for ( const std::string_view input : { std::string_view(sample_json), file.view() } )
+  {
+    json::value jsource;
+    json::value::parse(jsource, input);
+    if ( ! jsource.is_object() && ! jsource.is_array() )
+      continue;
+    for ( const json::format& fmt : layout_formats() )
+    {
+      json::cached_value jcached(json::value(jsource), fmt);
+      const size_t roundCount = ( input.length() > 64 * 1024 )? 40 : 400;
+      for ( size_t round = 0; round < roundCount; round++, rounds++ )
+      {
+        std::vector<std::string> pointers;
+        collect_pointers(jcached.root(), "", pointers);
+        // Some rounds change nothing, the others make up to 3 changes
+        const size_t editCount = ( pointers.empty() || round % 5 == 0 )? 0 : 1 + ::rand() % 3;
+        std::string changes;
+        for ( size_t i = 0; i < editCount; i++, edits++ )
+        {
+          const std::string& pointer = pointers[::rand() % pointers.size()];
+          changes += " " + pointer;
+          switch ( ::rand() % 5 )
+          {
+          case 0:
+            jcached.at(pointer) = jscalars[::rand() % std::size(jscalars)];
+            break;
+          case 1:
+            // A new object, with an empty array and an empty object
+            jcached.at(pointer) = json::value(json::value_type::object);
+            jcached.at(pointer)["list"] = json::value(json::value_type::array);
+            jcached.at(pointer)["empty"] = json::value(json::value_type::object);
+            jcached.at(pointer + "/list").append(jscalars[::rand() % std::size(jscalars)]);
+            break;
+          case 2:
+          {
+            // A member or an element added to a container, an empty array made of any other value
+            json::value& jval = jcached.at(pointer);
+            if ( jval.is_array() )
+              jval.append(jscalars[::rand() % std::size(jscalars)]);
+            else if ( jval.is_object() )
+              jval["added " + sid::to_str(edits)] = jscalars[::rand() % std::size(jscalars)];
+            else
+              jval = json::value(json::value_type::array);
+            break;
+          }
+          case 3:
+          {
+            // A copy of another value, which may hold the value replaced
+            json::value jcopy = jcached.at(pointers[::rand() % pointers.size()]);
+            jcached.at(pointer) = std::move(jcopy);
+            break;
+          }
+          default:
+            jcached.at(pointer).clear();
+            break;
+          }
+          // The changed values may have removed the others
+          pointers.clear();
+          collect_pointers(jcached.root(), "", pointers);
+          if ( pointers.empty() )
+            break;
+        }
+        const std::string expected = jcached.root().to_str(fmt);
+        if ( jcached.to_str() != expected )
+          throw sid::exception("cached_value::to_str() in " + fmt.to_str() + " format differs after round "
+                               + sid::to_str(round) + ", changed at" + changes);
+        if ( editCount == 0 && round > 0 && jcached.stats().encoded != 0 )
+          throw sid::exception("cached_value::to_str() serialized an unchanged tree again");
+      }
+      // A replaced tree is serialized anew
+      jcached.reset(json::value(jsource));
+      if ( jcached.to_str() != jsource.to_str(fmt) )
+        throw sid::exception("cached_value::to_str() of a reset tree is not its text");
+    }
+  }
+  cout << "cached_value: " << rounds << " rounds with " << edits << " changes checked" << endl;
+}
+
+//! Modifications of a tree: new keys and elements with strings too long for the cell,
+//! replaced, cleared and moved subtrees, and values from outside the tree
+void modify_tree(json::value& _jroot, const json::value& _joutside)
+{
+  const std::string longStr(100, 'x');
+  _jroot["added"] = longStr;
+  _jroot["outside"] = _joutside;
+  json::value& jlist = _jroot["added list"];
+  for ( size_t i = 0; i < 40; i++ )
+    jlist.append(longStr + sid::to_str(i));
+  for ( const std::string& key : _jroot.get_keys() )
+  {
+    json::value& jval = _jroot[key];
+    if ( jval.is_object() && jval.size() > 0 )
+      jval[jval.get_keys().front()] = json::value(longStr);
+    else if ( jval.is_array() && jval.size() > 0 )
+    {
+      json::value jfirst = std::move(jval[0]);
+      jval.append(std::move(jfirst));
+      jval[size_t(0)].clear();
+    }
+    else if ( jval.is_string() )
+      jval = jval.get_str() + longStr;
+  }
+  json::value jmoved = std::move(_jroot["outside"]);
+  _jroot["moved"] = std::move(jmoved);
+}
+
+//! json::document: a tree parsed in the arena matches value::parse(), can be modified through
+//! mutable_root(), and is released whether modified or not, on reparse, clear() and destruction
+void document_test(const std::string& _jsonFile)
+{
+  const sid::util::mapped_file file = get_file_contents(_jsonFile);
+  json::value joutside;
+  json::value::parse(joutside, sample_json);
+  size_t documents = 0;
+  for ( const std::string_view input : { std::string_view(sample_json), file.view() } )
+  {
+    const std::string expected = parsed_text(input);
+    json::value jexpected;
+    json::value::parse(jexpected, input);
+    if ( ! jexpected.is_object() )
+      continue;
+    modify_tree(jexpected, joutside);
+
+    // Parsed, modified and destroyed, and a copy of a subtree that outlives the document
+    json::value jcopy;
+    {
+      json::document jdoc;
+      jdoc.parse(input);
+      if ( jdoc.root().to_str() != expected )
+        throw sid::exception("The tree of the document is not the parsed tree");
+      modify_tree(jdoc.mutable_root(), joutside);
+      if ( jdoc.root().to_str() != jexpected.to_str() )
+        throw sid::exception("The modified document is not the modified tree");
+      jcopy = jdoc.root()["moved"];
+      documents++;
+    }
+    if ( jcopy.to_str() != jexpected["moved"].to_str() )
+      throw sid::exception("A copy of a subtree of the document does not outlive it");
+
+    // Reparsed after a modification and after none, cleared, and parsed again after clear()
+    json::document jdoc;
+    for ( size_t i = 0; i < 4; i++ )
+    {
+      jdoc.parse(input);
+      if ( i % 2 == 0 )
+        modify_tree(jdoc.mutable_root(), joutside);
+      const std::string& text = ( i % 2 == 0 )? jexpected.to_str() : expected;
+      if ( jdoc.root().to_str() != text )
+        throw sid::exception("Parse " + sid::to_str(i) + " of the document gives another tree");
+      documents++;
+    }
+    jdoc.clear();
+    if ( ! jdoc.root().is_null() )
+      throw sid::exception("clear() does not leave a null root");
+    jdoc.mutable_root()["after clear"] = joutside;
+    if ( jdoc.root()["after clear"].to_str() != joutside.to_str() )
+      throw sid::exception("The cleared document cannot be modified");
+  }
+
+  // A failed parse leaves the document usable
+  json::document jdoc;
+  for ( const std::string& input : invalid_json )
+  {
+    if ( error_of([&]() { jdoc.parse(input); }).empty() )
+      throw sid::exception("The document accepted " + input);
+    jdoc.mutable_root()["a"] = input;
+  }
+  jdoc.parse(sample_json);
+  if ( jdoc.root().to_str() != parsed_text(sample_json) )
+    throw sid::exception("The document cannot be parsed after failed parses");
+  cout << "document: " << documents << " documents parsed, modified and released, "
+       << std::size(invalid_json) << " invalid inputs checked" << endl;
+}
+
+//! json::schema: each keyword accepts a value within its bound and rejects one outside it, when
+//! validated while parsing, and the same after the schema is written with to_json() and read back
+void schema_test()
+{
+  struct keyword_case
+  {
+    std::string property; //! Schema of the property "v"
+    std::string accepted; //! Value of "v" that is valid
+    std::string rejected; //! Value of "v" that is not
+    std::string error;    //! Part of the message of the violation
+  };
+  const keyword_case cases[] = {
+    { R"({"type": "integer"})", "5", "1.5", "Expected integer, found number" },
+    { R"({"type": "number"})", "1.5", "\"1.5\"", "Expected number, found string" },
+    { R"({"type": ["string", "null"]})", "null", "true", "Expected null or string, found boolean" },
+    { R"({"type": "boolean"})", "false", "{}", "Expected boolean, found object" },
+    { R"({"type": "integer", "minimum": 10})", "10", "9", "is less than minimum 10" },
+    { R"({"type": "integer", "minimum": -10})", "-10", "-11", "is less than minimum -10" },
+    { R"({"type": "number", "exclusiveMinimum": 10})", "10.5", "10", "is not more than exclusiveMinimum 10" },
+    { R"({"type": "integer", "maximum": 10})", "10", "11", "is more than maximum 10" },
+    { R"({"type": "number", "maximum": 10})", "-20", "10.5", "is more than maximum 10" },
+    { R"({"type": "integer", "exclusiveMaximum": 10})", "9", "10", "is not less than exclusiveMaximum 10" },
+    { R"({"type": "integer", "multipleOf": 3})", "-9", "10", "is not a multiple of 3" },
+    { R"({"type": "number", "multipleOf": 3})", "4.5e1", "4.5", "is not a multiple of 3" },
+    { R"({"type": "integer", "minimum": 0, "maximum": 9})", "0", "18446744073709551615", "is more than maximum 9" },
+    { R"({"type": "string", "minLength": 2})", "\"\\u00e9\\u00e9\"", "\"a\"", "Length 1 is less than minLength 2" },
+    { R"({"type": "string", "maxLength": 2})", "\"\\u00e9\\u00e9\"", "\"abc\"", "Length 3 is more than maxLength 2" },
+    { R"({"type": "string", "maxLength": 2})", "\"\\ud83d\\ude00\u00e9\"", "\"\\ud83d\\ude00ab\"",
+      "Length 3 is more than maxLength 2" },
+    { R"({"type": "string", "pattern": "^[a-z]+$"})", "\"abc\"", "\"ab1\"", "does not match the pattern" },
+    { R"({"type": "array", "minItems": 2})", "[1, 2]", "[1]", "Number of items 1 is less than minItems 2" },
+    { R"({"type": "array", "maxItems": 2})", "[1, 2]", "[1, 2, 3]", "Number of items is more than maxItems 2" },
+    { R"({"type": "array", "uniqueItems": true})", "[1, \"1\", [1], {\"a\": 1}, {\"a\": 2}]",
+      "[{\"a\": 1, \"b\": 2}, 1, {\"b\": 2, \"a\": 1.0}]", "Items 0 and 2 are the same" },
+    { R"({"type": "array", "uniqueItems": true})", "[true, false]", "[2, 2.0]", "Items 0 and 1 are the same" },
+    { R"({"type": "object", "minProperties": 1})", "{\"a\": 1}", "{}", "is less than minProperties 1" },
+    { R"({"type": "object", "maxProperties": 1})", "{\"a\": 1}", "{\"a\": 1, \"b\": 2}", "is more than maxProperties 1" },
+    { R"({"type": "object", "properties": {"a": {"type": "integer"}}, "required": ["a"]})", "{\"a\": 1}",
+      "{\"b\": 1}", "Required property \"a\" is missing" },
+    { R"({"type": "object", "properties": {"a": {"type": "string", "maxLength": 1}}})", "{\"a\": \"x\", \"b\": 1}",
+      "{\"a\": \"xy\"}", "Schema violation at /v/a: Length 2 is more than maxLength 1" }
+  };
+  size_t checks = 0;
+  for ( const keyword_case& kcase : cases )
+  {
+    json::value jschema;
+    json::value::parse(jschema, R"({"type": "object", "properties": {"v": )" + kcase.property + "}}");
+    const json::schema schema = json::schema::parse(jschema);
+    // The schema written with to_json() and read back must validate the same way
+    for ( const json::schema& jsch : { schema, json::schema::parse(schema.to_json()) } )
+    {
+      const json::validator jvalidator(jsch);
+      json::value jout;
+      const std::string accepted = "{\"v\": " + kcase.accepted + "}";
+      const std::string rejected = "{\"v\": " + kcase.rejected + "}";
+      std::string error = error_of([&]() { json::value::parse(jout, accepted, jvalidator); });
+      if ( ! error.empty() )
+        throw sid::exception("Schema " + kcase.property + " rejects " + accepted + ": " + error);
+      error = error_of([&]() { json::value::parse(jout, rejected, jvalidator); });
+      if ( error.find(kcase.error) == std::string::npos )
+        throw sid::exception("Schema " + kcase.property + " gives [" + error + "] for " + rejected
+                             + " instead of [" + kcase.error + "]");
+      checks += 2;
+    }
+  }
+  cout << "schema: " << checks << " keyword checks of " << std::size(cases) << " schemas" << endl;
+}
+
+//! Compare an element of a snapshot with the value it was written from, its members included
+void compare_element(const json::snapshot::element& _elem, const json::value& _jval, const std::string& _where)
+{
+  const auto fail = [&](const std::string& _what) {
+      throw sid::exception("Snapshot element " + _where + ": " + _what);
+    };
+  if ( _elem.type() != _jval.type() )
+    fail("type differs");
+  if ( _jval.is_object() )
+  {
+    if ( _elem.size() != _jval.size() || _elem.get_keys() != _jval.get_keys() )
+      fail("keys differ");
+    size_t count = 0;
+    for ( auto it = _elem.begin(); it != _elem.end(); ++it, ++count )
+    {
+      const std::string key(it.key());
+      if ( ! _elem.has_key(key) || ! _elem.find(key) )
+        fail("key " + key + " is not found");
+      compare_element(*it, _jval[key], _where + "." + key);
+      compare_element(_elem[key], _jval[key], _where + "[\"" + key + "\"]");
+    }
+    if ( count != _jval.size() )
+      fail("iteration gives " + sid::to_str(count) + " members");
+    if ( _elem.find("no such key") || _elem.has_key("no such key")
+         || error_of([&]() { _elem["no such key"]; }).empty() )
+      fail("a missing key is found");
+  }
+  else if ( _jval.is_array() )
+  {
+    if ( _elem.size() != _jval.size() || _elem.has_index(_jval.size()) )
+      fail("size differs");
+    size_t index = 0;
+    for ( const json::snapshot::element& member : _elem )
+    {
+      compare_element(member, _jval[index], _where + "[" + sid::to_str(index) + "]");
+      index++;
+    }
+  }
+  else if ( ( _jval.is_string() && _elem.get_view() != _jval.get_str() )
+            || ( _jval.is_bool() && _elem.get_bool() != _jval.get_bool() )
+            || ( _jval.is_signed() && _elem.get_int64() != _jval.get_int64() )
+            || ( _jval.is_unsigned() && _elem.get_uint64() != _jval.get_uint64() )
+            || ( _jval.is_double() && _elem.get_double() != static_cast<double>(_jval.get_double()) ) )
+    fail("value differs");
+}
+
+//! json::snapshot: an image written and reopened gives back every element of the source value,
+//! and truncated images and images of another format are rejected
+void snapshot_test(const std::string& _jsonFile)
+{
+  const std::string snapFile = "/tmp/common_test." + sid::to_str(::getpid()) + ".snap";
+  const auto write_image = [&](const std::string& _image) {
+      std::ofstream out(snapFile, std::ios::binary | std::ios::trunc);
+      out.write(_image.data(), _image.length());
+      if ( ! out.flush() )
+        throw sid::exception("Failed to write " + snapFile);
+    };
+  const sid::util::mapped_file file = get_file_contents(_jsonFile);
+  std::string image;
+  try
+  {
+    for ( const std::string_view input : { std::string_view(sample_json), file.view() } )
+    {
+      json::value jsource;
+      json::value::parse(jsource, input);
+      json::snapshot::write(jsource, snapFile);
+      const json::snapshot snap = json::snapshot::open(snapFile);
+      compare_element(snap.root(), jsource, "$");
+      if ( snap.root().to_value().to_str() != jsource.to_str() )
+        throw sid::exception("to_value() of the snapshot does not give the source value");
+    }
+
+    // Rejections of the last image written
+    image = get_file_contents(snapFile).view();
+    const auto open_error = [&](const std::string& _image) {
+        write_image(_image);
+        return error_of([&]() { json::snapshot::open(snapFile); });
+      };
+    std::string versioned = image;
+    versioned[8] ^= 0x7f;
+    const std::string magicError = open_error("SIDJSNAQ" + image.substr(8));
+    const std::string versionError = open_error(versioned);
+    const std::string truncatedError = open_error(image.substr(0, image.length() - 8));
+    const std::string shortError = open_error(image.substr(0, 16));
+    if ( magicError.find("not a snapshot file") == std::string::npos )
+      throw sid::exception("An image with a bad magic gives [" + magicError + "]");
+    if ( versionError.find("unsupported version") == std::string::npos )
+      throw sid::exception("An image of another version gives [" + versionError + "]");
+    if ( truncatedError.find("truncated to") == std::string::npos )
+      throw sid::exception("A truncated image gives [" + truncatedError + "]");
+    if ( shortError.find("not a snapshot file") == std::string::npos )
+      throw sid::exception("An image shorter than its header gives [" + shortError + "]");
+  }
+  catch ( ... )
+  {
+    ::unlink(snapFile.c_str());
+    throw;
+  }
+  ::unlink(snapFile.c_str());
+  cout << "snapshot: elements of 2 images, bad magic, version and truncation checked ("
+       << image.length() << " bytes)" << endl;
+}
+
+//! Parse the given file through a pipe, which cannot be mapped, and compare the result
+//! with parsing the file directly
+void pipe_test(const std::string& _jsonFile)
+{
+  const std::string contents(get_file_contents(_jsonFile).view());
+  int fds[2];
+  if ( ::pipe(fds) == -1 )
+    throw sid::exception(errno, sid::to_errno_str("Failed to create a pipe"));
+  pid_t pid = ::fork();
+  if ( pid == -1 )
+    throw sid::exception(errno, sid::to_errno_str("Failed to fork"));
+  if ( pid == 0 )
+  {
+    ::close(fds[0]);
+    size_t offset = 0;
+    while ( offset < contents.length() )
+    {
+      ssize_t count = ::write(fds[1], contents.data() + offset, contents.length() - offset);
+      if ( count <= 0 )
+        ::_exit(1);
+      offset += count;
+    }
+    ::_exit(0);
+  }
+  ::close(fds[1]);
+
+  json::value jpipe, jfile;
+  std::string error;
+  try
+  {
+    json::value::parse_file(jpipe, "/dev/fd/" + sid::to_str(fds[0]));
+  }
+  catch ( const sid::exception& e )
+  {
+    error = e.what();
+  }
+  ::close(fds[0]);
+  int status = 0;
+  ::waitpid(pid, &status, 0);
+  if ( ! error.empty() )
+    throw sid::exception("Failed to parse " + _jsonFile + " through a pipe: " + error);
+
+  json::value::parse_file(jfile, _jsonFile);
+  if ( jpipe.to_str() != jfile.to_str() )
+    throw sid::exception("Parsing " + _jsonFile + " through a pipe does not match the file");
+  cout << "pipe: parsed " << contents.length() << " bytes" << endl;
+}
+
 int main(int argc, char* argv[])
 {
   ::srand(::time(nullptr));
@@ -272,9 +2167,10 @@ int main(int argc, char* argv[])
     json::value jroot;
     sid::opt<json::format> outputFmt;
     bool isDefaultMethod = true;
+    std::string binaryMethod;
     if ( argc > 1 )
     {
-      std::string jsonStr = get_file_contents(argv[1]);
+      const std::string jsonFile = argv[1];
       std::string param, key, value;
       for ( int i = 2; i < argc; i++ )
       {
@@ -311,19 +2207,70 @@ int main(int argc, char* argv[])
           ctrl.mode.allowFlexibleStrings = 1;
         else if ( key == "--allow-nocase" || key == "--allow-nocase-values" )
           ctrl.mode.allowNocaseValues = 1;
+        else if ( key == "--time-phases" )
+          ctrl.timePhases = true;
+        else if ( key == "--intern-keys" )
+          ctrl.internKeys = true;
         else if ( key == "--show-output" )
         {
           if ( ! value.empty() && value != "false" )
             outputFmt = json::format::get(value);
         }
+        else if ( key == "--test" )
+        {
+          if ( value == "binary-depth" )
+            binary_depth_test();
+          else if ( value == "pipe" )
+            pipe_test(jsonFile);
+          else if ( value == "numbers" )
+            number_format_test();
+          else if ( value == "errors" )
+            root_error_test();
+          else if ( value == "path" )
+            path_test();
+          else if ( value == "object" )
+            object_test();
+          else if ( value == "builders" )
+            builder_test();
+          else if ( value == "index" )
+            index_test();
+          else if ( value == "projection" )
+            projection_test();
+          else if ( value == "reader" )
+            reader_test(jsonFile);
+          else if ( value == "push" )
+            push_test(jsonFile);
+          else if ( value == "snapshot" )
+            snapshot_test(jsonFile);
+          else if ( value == "schema" )
+            schema_test();
+          else if ( value == "document" )
+            document_test(jsonFile);
+          else if ( value == "cache" )
+            cached_value_test(jsonFile);
+          else if ( value == "bind" )
+            bind_test();
+          else if ( value == "writer" )
+            writer_test(jsonFile);
+          else if ( value == "lines" )
+            lines_test();
+          else if ( value == "intern" )
+            intern_test();
+          else if ( value == "stats" )
+            stats_test();
+          else
+            throw sid::exception("Invalid test. Use binary-depth|pipe|numbers|errors|path|object|builders|index|projection|reader|push|snapshot|schema|document|cache|bind|writer|lines|intern|stats");
+        }
         else if ( key == "--method" )
 	{
           if ( value == "default" )
 	    isDefaultMethod = true;
 	  else if ( value == "jsoncpp" )
 	    isDefaultMethod = false;
+	  else if ( value == "cbor" || value == "msgpack" )
+	    binaryMethod = value;
 	  else
-	    throw sid::exception("Invalid method. Use default|jsoncpp");
+	    throw sid::exception("Invalid method. Use default|jsoncpp|cbor|msgpack");
 	}
         else
           throw sid::exception("Invalid key: " + key);
@@ -333,11 +2280,13 @@ int main(int argc, char* argv[])
 	cout << "sizeof(json::value) = " << sizeof(json::value) << endl;
 	cout << "sizeof(json::schema) = " << sizeof(json::schema) << endl;
 	cout << "sizeof(json::schema::property) = " << sizeof(json::schema::property) << endl;
-	json::value::parse(jroot, stats, jsonStr, ctrl);
+	json::value::parse_file(jroot, stats, jsonFile, ctrl);
 	cout << stats.to_str() << endl;
 	//cout << jsonStr << endl;
 	if ( outputFmt )
 	  cout << jroot.to_str(outputFmt()) << endl;
+	if ( ! binaryMethod.empty() )
+	  binary_test(jroot, binaryMethod == "cbor");
       }
       else
       {
@@ -346,11 +2295,12 @@ int main(int argc, char* argv[])
 	Json::CharReaderBuilder builder;
 	Json::CharReader* reader = builder.newCharReader();
 	Json::String errs;
+	sid::util::mapped_file jsonData = get_file_contents(jsonFile);
 	struct timespec t_start = {0};
 	struct timespec t_end = {0};
 	clock_gettime(CLOCK_REALTIME, &t_start); // CLOCK_PROCESS_CPUTIME_ID
 
-	if ( !reader->parse(jsonStr.c_str(), jsonStr.c_str()+jsonStr.length(), &jroot, &errs) )
+	if ( !reader->parse(jsonData.data(), jsonData.data()+jsonData.size(), &jroot, &errs) )
 	  throw sid::exception("Failed to parse json");
 	clock_gettime(CLOCK_REALTIME, &t_end); // CLOCK_PROCESS_CPUTIME_ID
 	delete reader;
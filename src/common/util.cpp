@@ -43,6 +43,8 @@ LICENSE: END
 #include <fcntl.h> 
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
 #include <unistd.h>
 
 using namespace std;
@@ -154,3 +156,137 @@ command command::execute(const std::string& _cmd, const std::vector<std::string>
 
   return cmdOut;
 }
+
+namespace local
+{
+/**
+ * @fn int read_all(int _fd, std::string& _out);
+ * @brief Append everything that can be read from the descriptor to _out.
+ * @return 0 on success, otherwise the errno of the failed read
+ */
+int read_all(int _fd, std::string& _out)
+{
+  constexpr size_t chunkSize = 64 * 1024;
+  for ( ;; )
+  {
+    size_t len = _out.length();
+    _out.resize(len + chunkSize);
+    ssize_t count = ::read(_fd, _out.data() + len, chunkSize);
+    _out.resize(len + std::max<ssize_t>(count, 0));
+    if ( count == 0 )
+      return 0;
+    if ( count < 0 && errno != EINTR )
+      return errno;
+  }
+}
+} // namespace local
+
+/////////////////////////////////////////////////////////////////////////////////
+//
+// Implementation of mapped_file
+//
+mapped_file::mapped_file() : m_data(nullptr), m_size(0), m_isOpen(false), m_isMapped(false)
+{
+}
+
+mapped_file::mapped_file(const std::string& _filePath) : mapped_file()
+{
+  open(_filePath);
+}
+
+mapped_file::mapped_file(mapped_file&& _obj) noexcept : mapped_file()
+{
+  *this = std::move(_obj);
+}
+
+mapped_file& mapped_file::operator=(mapped_file&& _obj) noexcept
+{
+  if ( this != &_obj )
+  {
+    close();
+    m_isMapped = _obj.m_isMapped;
+    m_buffer = std::move(_obj.m_buffer);
+    // Moving the buffer may relocate short contents
+    m_data = m_isMapped ? _obj.m_data : m_buffer.data();
+    m_size = _obj.m_size;
+    m_isOpen = _obj.m_isOpen;
+    _obj.close();
+  }
+  return *this;
+}
+
+mapped_file::~mapped_file()
+{
+  close();
+}
+
+void mapped_file::open(const std::string& _filePath)
+{
+  close();
+
+  int fd = ::open(_filePath.c_str(), O_RDONLY);
+  if ( fd == -1 )
+    throw sid::exception(errno, sid::to_errno_str("Failed to open file " + _filePath));
+
+  struct stat st;
+  if ( ::fstat(fd, &st) == -1 )
+  {
+    int err = errno;
+    ::close(fd);
+    throw sid::exception(err, sid::to_errno_str(err, "Failed to get the size of file " + _filePath));
+  }
+
+  // Pipes, FIFOs and the files of /proc or /sys do not report their size. These
+  // are read into a buffer until the end of the input.
+  if ( ! S_ISREG(st.st_mode) || st.st_size == 0 )
+  {
+    int err = local::read_all(fd, m_buffer);
+    if ( err != 0 )
+    {
+      ::close(fd);
+      m_buffer.clear();
+      throw sid::exception(err, sid::to_errno_str(err, "Failed to read file " + _filePath));
+    }
+    m_data = m_buffer.data();
+    m_size = m_buffer.length();
+  }
+  else
+  {
+    void* p = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if ( p == MAP_FAILED )
+    {
+      int err = errno;
+      ::close(fd);
+      throw sid::exception(err, sid::to_errno_str(err, "Failed to map file " + _filePath));
+    }
+    // The contents are mostly scanned from the beginning to the end
+    ::madvise(p, st.st_size, MADV_SEQUENTIAL);
+    m_data = static_cast<const char*>(p);
+    m_size = st.st_size;
+    m_isMapped = true;
+  }
+  // The mapping remains valid after the descriptor is closed
+  ::close(fd);
+  m_isOpen = true;
+}
+
+void mapped_file::discard(size_t _len)
+{
+  const size_t pageSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+  _len = std::min(_len, m_size) / pageSize * pageSize;
+  // Buffered contents cannot be read again from the input
+  if ( m_isMapped && _len > 0 )
+    ::madvise(const_cast<char*>(m_data), _len, MADV_DONTNEED);
+}
+
+void mapped_file::close()
+{
+  if ( m_isMapped )
+    ::munmap(const_cast<char*>(m_data), m_size);
+  m_buffer.clear();
+  m_buffer.shrink_to_fit();
+  m_data = nullptr;
+  m_size = 0;
+  m_isOpen = false;
+  m_isMapped = false;
+}
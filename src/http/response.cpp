@@ -46,6 +46,12 @@ using namespace sid::http;
 
 using string_map = std::map< std::string, std::string >;
 
+namespace local
+{
+  //! Write the data as a chunk of the chunked transfer encoding. Throws on failure.
+  void write_chunk(connection_ptr _conn, const char* _data, size_t _len);
+}
+
 struct data_chunk
 {
   int         length;
@@ -94,6 +100,7 @@ response_handler(connection_ptr _conn) : m_conn(_conn)
     m_forceStop = false;
     m_pos = 0;
     m_contentLength = 0;
+    m_received = 0;
     m_encoding = http::transfer_encoding::none;
     m_keepAlive = false;
     m_chunk.clear();
@@ -115,6 +122,7 @@ private:
   bool parse_headers(const method& _requestMethod, /*in/out*/ response& _response);
   void parse_data_normal(/*in/out*/ response& _response);
   void parse_data_chunked(/*in/out*/ response& _response);
+  bool on_data(size_t _len, /*in/out*/ response& _response);
 
 private:
   http::connection_ptr       m_conn;          //! Pointer to the connection object
@@ -125,6 +133,7 @@ private:
   size_t                     m_pos;           //! Indicates current position of parsing
   bool                       m_endOfData;     //! Indicates end of data has been reached
   size_t                     m_contentLength; //! Content length
+  size_t                     m_received;      //! Payload bytes received so far
   http::transfer_encoding    m_encoding;      //! Transfer encoding
   bool                       m_keepAlive;     //! Is keep alive set?
   data_chunk                 m_chunk;         //! Current chunk object (if response is in chunks)
@@ -207,6 +216,82 @@ bool response::send(connection_ptr _conn)
   return isSuccess;
 }
 
+bool response::send_head(connection_ptr _conn)
+{
+  bool isSuccess = false;
+
+  try
+  {
+    this->error.clear();
+
+    if ( _conn.empty() || ! _conn->is_open() )
+      throw sid::exception("Connection is not established");
+
+    this->headers.remove_all("Content-Length");
+    this->headers("Transfer-Encoding", "chunked");
+    const std::string csHead = this->version.to_str() + " " + this->status.to_str() + CRLF
+      + this->headers.to_str() + CRLF;
+
+    ssize_t written = _conn->write(csHead.c_str(), csHead.length());
+    if ( written < 0 || csHead.length() != static_cast<size_t>(written) )
+      throw sid::exception("Failed to write data");
+
+    // set the return status to true
+    isSuccess = true;
+  }
+  catch ( const sid::exception& e )
+  {
+    this->error = __func__ + std::string(": ") + e.what();
+  }
+  catch (...)
+  {
+    this->error = __func__ + std::string(": Unhandled exception occurred");
+  }
+
+  return isSuccess;
+}
+
+bool response::send_chunk(connection_ptr _conn, const char* _data, size_t _len)
+{
+  bool isSuccess = false;
+
+  try
+  {
+    this->error.clear();
+
+    local::write_chunk(_conn, _data, _len);
+
+    // set the return status to true
+    isSuccess = true;
+  }
+  catch ( const sid::exception& e )
+  {
+    this->error = __func__ + std::string(": ") + e.what();
+  }
+  catch (...)
+  {
+    this->error = __func__ + std::string(": Unhandled exception occurred");
+  }
+
+  return isSuccess;
+}
+
+/*static*/
+std::function<void(const char* _data, size_t _len)> response::chunk_sink(connection_ptr _conn)
+{
+  return [_conn](const char* _data, size_t _len)
+    {
+      try
+      {
+        local::write_chunk(_conn, _data, _len);
+      }
+      catch ( const sid::exception& e )
+      {
+        throw sid::exception("chunk_sink: " + std::string(e.what()));
+      }
+    };
+}
+
 bool response::recv(connection_ptr _conn, const method& _requestMethod)
 {
   bool isSuccess = false;
@@ -381,9 +466,10 @@ bool response_handler::parse_headers(const method& _requestMethod, /*in/out*/ re
 void response_handler::parse_data_normal(/*in/out*/ response& _response)
 {
   size_t copyLen = m_csResponse.length() - m_pos;
-  _response.content.append(m_csResponse, m_pos, copyLen);
-  //cerr << "Len: " << m_contentLength << "-" << _response.content.length() << endl;
-  if ( _response.content.length() >= m_contentLength )
+  if ( on_data(copyLen, _response) )
+    _response.content.append(m_csResponse, m_pos, copyLen);
+  //cerr << "Len: " << m_contentLength << "-" << m_received << endl;
+  if ( m_received >= m_contentLength )
     m_endOfData = true; // END OF DATA
   else
   {
@@ -436,7 +522,8 @@ void response_handler::parse_data_chunked(/*in/out*/ response& _response)
     {
       size_t copyLen = m_csResponse.length() - m_pos;
       //_response.content.append(m_csResponse, m_pos, copyLen);
-      m_chunk.data.append(m_csResponse, m_pos, copyLen);
+      if ( on_data(copyLen, _response) )
+        m_chunk.data.append(m_csResponse, m_pos, copyLen);
       m_chunkToBeRead -= copyLen;
       // cerr << "********* Body Length-1: " << _response.content.length() << ", Response-Length: " << m_csResponse.length() << ", m_pos: " << m_pos << endl;
       m_csResponse.clear(); m_pos = 0;
@@ -446,7 +533,8 @@ void response_handler::parse_data_chunked(/*in/out*/ response& _response)
     {
       size_t balanceLen = m_csResponse.length() - m_pos - m_chunkToBeRead;
       //_response.content.append(m_csResponse, m_pos, m_chunkToBeRead);
-      m_chunk.data.append(m_csResponse, m_pos, m_chunkToBeRead);
+      if ( on_data(m_chunkToBeRead, _response) )
+        m_chunk.data.append(m_csResponse, m_pos, m_chunkToBeRead);
       if ( balanceLen <= 2 )
       {
         //cerr << "S2: begin: " << m_csResponse.length() << ", " << balanceLen << ", " << m_chunk.data.length() << endl;
@@ -490,6 +578,18 @@ void response_handler::parse_data_chunked(/*in/out*/ response& _response)
   return;
 }
 
+bool response_handler::on_data(size_t _len, /*in/out*/ response& _response)
+{
+  m_received += _len;
+  // Without a data handler the payload is stored in the content
+  if ( ! _response.data_handler )
+    return true;
+  // Pass the payload starting at the current position to the application
+  if ( _len > 0 && ! m_forceStop && ! _response.data_handler(m_csResponse.data() + m_pos, _len) )
+    m_forceStop = true; // Force stop
+  return false;
+}
+
 void response_handler::parse(const char* _buffer, int _nread, const method& _requestMethod, /*in/out*/ response& _response)
 {
   //cerr.write(buffer, nread); return;
@@ -519,7 +619,8 @@ void response_handler::parse(const char* _buffer, int _nread, const method& _req
     else if ( m_endOfStatus && m_endOfHeaders )
     {
       size_t copyLen = m_csResponse.length() - m_pos;
-      _response.content.append(m_csResponse, m_pos, copyLen);
+      if ( on_data(copyLen, _response) )
+        _response.content.append(m_csResponse, m_pos, copyLen);
 
       bool isFound;
       http::header_connection header_conn = _response.headers.connection(&isFound);
@@ -595,3 +696,24 @@ bool response_callback::is_valid(const connection_ptr _conn, response& _response
 {
   return true;
 }
+
+void local::write_chunk(connection_ptr _conn, const char* _data, size_t _len)
+{
+  if ( _conn.empty() || ! _conn->is_open() )
+    throw sid::exception("Connection is not established");
+
+  // The size line, the data and the CRLF after it go out in a single write. Separate small
+  // writes followed by a read are held back by Nagle's algorithm until the peer's delayed ACK,
+  // which stalls the end of every response. Copying the data costs far less than that.
+  static thread_local std::string s_buffer;
+  char sizeLine[24];
+  const int sizeLen = ::snprintf(sizeLine, sizeof(sizeLine), "%zx" CRLF, _len);
+  s_buffer.assign(sizeLine, sizeLen);
+  if ( _len > 0 )
+    s_buffer.append(_data, _len);
+  s_buffer.append(CRLF, 2);
+
+  ssize_t written = _conn->write(s_buffer.data(), s_buffer.length());
+  if ( written < 0 || s_buffer.length() != static_cast<size_t>(written) )
+    throw sid::exception("Failed to write data");
+}
@@ -13,14 +13,21 @@
 #include <fcntl.h>
 #include <aio.h>
 #include <sys/wait.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
 
 #include <common/exception.hpp>
 #include <common/convert.hpp>
+#include <common/json.hpp>
+#include <common/json_writer.hpp>
+#include <http/http.hpp>
 
 using namespace std;
 using namespace sid;
 
 std::string get_file_contents(const std::string& _filePath);
+void chunk_test();
 
 int main(int argc, char* argv[])
 {
@@ -32,8 +39,13 @@ int main(int argc, char* argv[])
     if ( argc < 2 )
       throw std::string("Need atleast one argument");
 
-    std::string data = get_file_contents(argv[1]);
-    cout << "File size: " << data.size() << endl;
+    if ( std::string(argv[1]) == "--test=chunks" )
+      chunk_test();
+    else
+    {
+      std::string data = get_file_contents(argv[1]);
+      cout << "File size: " << data.size() << endl;
+    }
     //cout << data << endl;
     status = 0;
   }
@@ -116,3 +128,86 @@ std::string get_file_contents(const std::string& _filePath)
   }
   return out;
 }
+
+//! json::writer through http::response::chunk_sink(): every buffer handed to the sink goes out as
+//! a chunk of its size, and send_chunk() of nothing ends the payload with the zero-length chunk
+void chunk_test()
+{
+  // A connection over the loopback, whose peer reads what is sent
+  sockaddr_in addr;
+  ::memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  socklen_t len = sizeof(addr);
+  const int listener = ::socket(AF_INET, SOCK_STREAM, 0);
+  if ( listener < 0 || ::bind(listener, (sockaddr*) &addr, len) != 0 || ::listen(listener, 1) != 0
+       || ::getsockname(listener, (sockaddr*) &addr, &len) != 0 )
+    throw sid::exception(sid::to_errno_str(errno, "Failed to listen on the loopback"));
+  const int peer = ::socket(AF_INET, SOCK_STREAM, 0);
+  if ( peer < 0 || ::connect(peer, (sockaddr*) &addr, len) != 0 )
+    throw sid::exception(sid::to_errno_str(errno, "Failed to connect to the loopback"));
+  const int fd = ::accept(listener, nullptr, nullptr);
+  ::close(listener);
+  http::connection_ptr conn = http::connection::create(http::connection_type::http);
+  if ( ! conn->open(fd) )
+    throw sid::exception(conn->error());
+
+  // The pieces handed to the sink, and the text written
+  std::vector<size_t> pieces;
+  const json::write_sink chunks = http::response::chunk_sink(conn);
+  json::writer jw([&](const char* _data, size_t _len) { pieces.push_back(_len); chunks(_data, _len); },
+                  json::format(), 64);
+  json::value jexpected(json::value_type::array);
+  jw.begin_array();
+  for ( int i = 0; i < 100; i++ )
+  {
+    jw.begin_object().key("id").value(i).key("name").value("item " + sid::to_str(i)).end_object();
+    json::value& jitem = jexpected.append(json::value(json::value_type::object));
+    jitem["id"] = i;
+    jitem["name"] = "item " + sid::to_str(i);
+  }
+  jw.end_array().finish();
+  http::response response;
+  if ( ! response.send_chunk(conn, nullptr, 0) )
+    throw sid::exception(response.error);
+  conn->close();
+
+  std::string sent;
+  char buf[4096];
+  for ( ssize_t n; (n = ::read(peer, buf, sizeof(buf))) > 0; )
+    sent.append(buf, n);
+  ::close(peer);
+
+  // Each chunk is its size in hexadecimal, CRLF, the data and CRLF. The last one is empty.
+  std::string payload;
+  std::vector<size_t> sizes;
+  size_t pos = 0;
+  while ( true )
+  {
+    const size_t eol = sent.find("\r\n", pos);
+    const std::string sizeLine = sent.substr(pos, eol - pos);
+    if ( eol == std::string::npos || sizeLine.empty()
+         || sizeLine.find_first_not_of("0123456789abcdef") != std::string::npos )
+      throw sid::exception("Invalid chunk size line at byte " + sid::to_str(pos));
+    const size_t size = std::stoul(sizeLine, nullptr, 16);
+    pos = eol + 2;
+    if ( pos + size + 2 > sent.length() || sent.compare(pos + size, 2, "\r\n") != 0 )
+      throw sid::exception("Chunk of " + sid::to_str(size) + " bytes at byte " + sid::to_str(pos)
+                           + " does not end with CRLF");
+    payload.append(sent, pos, size);
+    pos += size + 2;
+    if ( size == 0 )
+      break;
+    sizes.push_back(size);
+  }
+  if ( pos != sent.length() )
+    throw sid::exception(sid::to_str(sent.length() - pos) + " bytes follow the last chunk");
+  if ( sizes != pieces )
+    throw sid::exception(sid::to_str(sizes.size()) + " chunks are sent for " + sid::to_str(pieces.size())
+                         + " pieces handed to the sink");
+  if ( payload != jexpected.to_str() )
+    throw sid::exception("The chunks carry " + payload.substr(0, 200) + " instead of "
+                         + jexpected.to_str().substr(0, 200));
+  cout << "chunks: " << sizes.size() << " chunks of " << payload.length()
+       << " bytes and the last chunk checked" << endl;
+}